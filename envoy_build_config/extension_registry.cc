@@ -5,6 +5,7 @@
 namespace Envoy {
 
 void ExtensionRegistry::registerFactories() {
+  Envoy::Extensions::Clusters::Coalescing::forceRegisterCoalescingClusterFactory();
   Envoy::Extensions::Clusters::DynamicForwardProxy::forceRegisterClusterFactory();
   Envoy::Extensions::Compression::Gzip::Decompressor::forceRegisterGzipDecompressorLibraryFactory();
   Envoy::Extensions::HttpFilters::Assertion::forceRegisterAssertionFilterFactory();
@@ -12,11 +13,14 @@ void ExtensionRegistry::registerFactories() {
   Envoy::Extensions::HttpFilters::BufferFilter::forceRegisterBufferFilterFactory();
   Envoy::Extensions::HttpFilters::DynamicForwardProxy::
       forceRegisterDynamicForwardProxyFilterFactory();
+  Envoy::Extensions::HttpFilters::MockResponse::forceRegisterMockResponseFilterFactory();
   Envoy::Extensions::HttpFilters::PlatformBridge::forceRegisterPlatformBridgeFilterFactory();
   Envoy::Extensions::HttpFilters::RouterFilter::forceRegisterRouterFilterConfig();
   Envoy::Extensions::NetworkFilters::HttpConnectionManager::
       forceRegisterHttpConnectionManagerFilterConfigFactory();
+  Envoy::Extensions::ResourceMonitors::DeviceMemory::forceRegisterDeviceMemoryMonitorFactory();
   Envoy::Extensions::StatSinks::MetricsService::forceRegisterMetricsServiceSinkFactory();
+  Envoy::Extensions::Tls::CertVerifier::forceRegisterCertVerifierHandshakerFactory();
   Envoy::Extensions::TransportSockets::Tls::forceRegisterUpstreamSslSocketFactory();
   Envoy::Extensions::Upstreams::Http::Generic::forceRegisterGenericGenericConnPoolFactory();
   Envoy::Upstream::forceRegisterLogicalDnsClusterFactory();
@@ -13,8 +13,12 @@
 #include "extensions/transport_sockets/tls/config.h"
 #include "extensions/upstreams/http/generic/config.h"
 
+#include "library/common/extensions/clusters/coalescing/config.h"
 #include "library/common/extensions/filters/http/assertion/config.h"
+#include "library/common/extensions/filters/http/mock_response/config.h"
 #include "library/common/extensions/filters/http/platform_bridge/config.h"
+#include "library/common/extensions/resource_monitors/device_memory/config.h"
+#include "library/common/extensions/tls/cert_verifier/config.h"
 
 namespace Envoy {
 class ExtensionRegistry {
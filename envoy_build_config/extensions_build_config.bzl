@@ -6,10 +6,14 @@ EXTENSIONS = {
     "envoy.filters.http.assertion":                   "@envoy_mobile//library/common/extensions/filters/http/assertion:config",
     "envoy.filters.http.buffer":                      "//source/extensions/filters/http/buffer:config",
     "envoy.filters.http.dynamic_forward_proxy":       "//source/extensions/filters/http/dynamic_forward_proxy:config",
+    "envoy.filters.http.mock_response":               "@envoy_mobile//library/common/extensions/filters/http/mock_response:config",
     "envoy.filters.http.platform_bridge":             "@envoy_mobile//library/common/extensions/filters/http/platform_bridge:config",
     "envoy.filters.http.router":                      "//source/extensions/filters/http/router:config",
     "envoy.filters.network.http_connection_manager":  "//source/extensions/filters/network/http_connection_manager:config",
     "envoy.stat_sinks.metrics_service":               "//source/extensions/stat_sinks/metrics_service:config",
     "envoy.transport_sockets.tls":                    "//source/extensions/transport_sockets/tls:config",
+    "envoy_mobile.clusters.coalescing":               "@envoy_mobile//library/common/extensions/clusters/coalescing:config",
+    "envoy_mobile.resource_monitors.device_memory":   "@envoy_mobile//library/common/extensions/resource_monitors/device_memory:config",
+    "envoy_mobile.tls.handshaker.cert_verifier":      "@envoy_mobile//library/common/extensions/tls/cert_verifier:config",
 }
 WINDOWS_EXTENSIONS = {}
@@ -2,16 +2,27 @@
 
 #include "common/common/assert.h"
 
-#include "absl/container/flat_hash_map.h"
-
 namespace Envoy {
 namespace Api {
 namespace External {
 
-// TODO(goaway): This needs to be updated not to leak once multiple engines are supported.
-// See https://github.com/lyft/envoy-mobile/issues/332
+// APIs registered for the whole process, which every engine may retrieve.
 static absl::flat_hash_map<std::string, void*> registry_{};
 
+// The registry of the engine running on this thread, if any.
+static thread_local const Registry* thread_registry_{};
+
+void Registry::registerApi(std::string name, void* api) {
+  absl::MutexLock lock(&mutex_);
+  registry_[std::move(name)] = api;
+}
+
+void* Registry::retrieveApi(const std::string& name) const {
+  absl::MutexLock lock(&mutex_);
+  auto it = registry_.find(name);
+  return it != registry_.end() ? it->second : nullptr;
+}
+
 // TODO(goaway): To expose this for general usage, it will need to be made thread-safe. For now it
 // relies on the assumption that usage will occur only as part of Engine configuration, and thus be
 // limited to a single thread.
@@ -20,11 +31,16 @@ void registerApi(std::string name, void* api) { registry_[name] = api; }
 // TODO(goaway): This is not thread-safe, but the assumption here is that all writes will complete
 // before any reads occur.
 void* retrieveApi(std::string name) {
-  void* api = registry_[name];
+  void* api = thread_registry_ != nullptr ? thread_registry_->retrieveApi(name) : nullptr;
+  if (api == nullptr) {
+    api = registry_[name];
+  }
   ASSERT(api);
   return api;
 }
 
+void setThreadRegistry(const Registry* registry) { thread_registry_ = registry; }
+
 } // namespace External
 } // namespace Api
 } // namespace Envoy
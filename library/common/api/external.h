@@ -2,20 +2,53 @@
 
 #include <string>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
 namespace Envoy {
 namespace Api {
 namespace External {
 
+/**
+ * External runtime APIs registered for a single engine. While an engine is running, its APIs are
+ * retrieved ahead of those registered for the whole process, so that independent components of an
+ * app can register APIs under the same name.
+ */
+class Registry {
+public:
+  /**
+   * Register an external runtime API for the engine.
+   */
+  void registerApi(std::string name, void* api);
+
+  /**
+   * @return void* the API registered with the name, or nullptr if none is.
+   */
+  void* retrieveApi(const std::string& name) const;
+
+private:
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, void*> registry_ ABSL_GUARDED_BY(mutex_);
+};
+
 /**
  * Register an external runtime API for usage (e.g. in extensions).
  */
 void registerApi(std::string name, void* api);
 
 /**
- * Retrieve an external runtime API for usage (e.g. in extensions).
+ * Retrieve an external runtime API for usage (e.g. in extensions). APIs registered for the engine
+ * running on the calling thread, @see setThreadRegistry(), are preferred.
  */
 void* retrieveApi(std::string name);
 
+/**
+ * Set the registry of the engine running on the calling thread.
+ * @param registry, the registry, which must outlive its use on the thread, or nullptr to retrieve
+ *        only APIs registered for the whole process.
+ */
+void setThreadRegistry(const Registry* registry);
+
 } // namespace External
 } // namespace Api
 } // namespace Envoy
@@ -0,0 +1,438 @@
+#include "library/common/bootstrap_builder.h"
+
+#include "envoy/common/platform.h"
+#include "envoy/config/cluster/v3/cluster.pb.h"
+#include "envoy/config/core/v3/address.pb.h"
+#include "envoy/config/core/v3/socket_option.pb.h"
+#include "envoy/config/listener/v3/listener.pb.h"
+#include "envoy/config/metrics/v3/metrics_service.pb.h"
+#include "envoy/config/overload/v3/overload.pb.h"
+#include "envoy/config/route/v3/route.pb.h"
+#include "envoy/extensions/clusters/dynamic_forward_proxy/v3/cluster.pb.h"
+#include "envoy/extensions/common/dynamic_forward_proxy/v3/dns_cache.pb.h"
+#include "envoy/extensions/compression/gzip/decompressor/v3/gzip.pb.h"
+#include "envoy/extensions/filters/http/decompressor/v3/decompressor.pb.h"
+#include "envoy/extensions/filters/http/dynamic_forward_proxy/v3/dynamic_forward_proxy.pb.h"
+#include "envoy/extensions/filters/http/router/v3/router.pb.h"
+#include "envoy/extensions/filters/network/http_connection_manager/v3/http_connection_manager.pb.h"
+#include "envoy/extensions/transport_sockets/tls/v3/tls.pb.h"
+
+#include "common/common/macros.h"
+#include "common/protobuf/utility.h"
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "library/common/extensions/clusters/coalescing/cluster.pb.h"
+#include "library/common/extensions/filters/http/platform_bridge/filter.pb.h"
+#include "library/common/extensions/resource_monitors/device_memory/device_memory.pb.h"
+#include "library/common/extensions/tls/cert_verifier/cert_verifier.pb.h"
+
+namespace Envoy {
+
+namespace {
+
+// The trusted CA bundle, as embedded in config_template.
+const char* trusted_ca_template =
+#include "certificates.inc"
+    ;
+
+// Stats exported by Envoy Mobile. These must be kept in sync with config_template.
+constexpr const char* StatsInclusionPatterns[] = {
+    R"(^cluster\.[\w]+?\.upstream_cx_[\w]+)",
+    R"(^cluster\.[\w]+?\.upstream_rq_[\w]+)",
+    R"(^http.dispatcher.*)",
+    R"(^client.*)",
+    R"(^cert_verifier.*)",
+    R"(^http.hcm.decompressor.*)",
+    R"(^http.hcm.downstream_rq_(?:[12345]xx|total|completed))",
+    R"(^vhost.api.vcluster\.[\w]+?\.upstream_rq_(?:[12345]xx|retry.*|time|timeout|total))",
+};
+
+// Overload actions taken as memory pressure rises, and the pressure at which they are taken. These
+// must be kept in sync with config_template.
+constexpr const char* DeviceMemoryMonitor = "envoy_mobile.resource_monitors.device_memory";
+constexpr uint64_t MaxHeapSizeBytes = 256 * 1024 * 1024;
+// Every refresh wakes the engine, even while it is idle. The heap grows gradually and the device's
+// pressure changes rarely, so a slow refresh still reacts to both in time.
+constexpr int64_t OverloadRefreshSeconds = 10;
+constexpr std::pair<const char*, double> OverloadActions[] = {
+    {"envoy.overload_actions.shrink_heap", 0.8},
+    {"envoy.overload_actions.stop_accepting_requests", 0.95},
+};
+
+/**
+ * The certificates are embedded indented, as a YAML block scalar. Strip the indentation in the
+ * same way a YAML parser would, once per process.
+ */
+const std::string& trustedCa() {
+  CONSTRUCT_ON_FIRST_USE(std::string, []() -> std::string {
+    std::vector<absl::string_view> lines = absl::StrSplit(trusted_ca_template, '\n');
+    while (!lines.empty() && absl::StripAsciiWhitespace(lines.back()).empty()) {
+      lines.pop_back();
+    }
+
+    size_t indent = std::string::npos;
+    for (absl::string_view line : lines) {
+      if (!absl::StripAsciiWhitespace(line).empty()) {
+        indent = line.find_first_not_of(' ');
+        break;
+      }
+    }
+
+    std::string ca;
+    for (absl::string_view line : lines) {
+      if (line.size() > indent) {
+        ca.append(line.data() + indent, line.size() - indent);
+      }
+      ca.push_back('\n');
+    }
+    return ca;
+  }());
+}
+
+void addSocketOption(envoy::config::core::v3::BindConfig& bind_config, int level, int name,
+                     int64_t int_value) {
+  auto* option = bind_config.add_socket_options();
+  option->set_level(level);
+  option->set_name(name);
+  option->set_int_value(int_value);
+  option->set_state(envoy::config::core::v3::SocketOption::STATE_PREBIND);
+}
+
+/**
+ * Applies a socket profile to a cluster's upstream connections. Options are only applied through
+ * the cluster's bind config, so the cluster is bound to the wildcard address when it has any.
+ */
+void applySocketProfile(const SocketProfile& profile,
+                        envoy::config::cluster::v3::Cluster& cluster) {
+  envoy::config::core::v3::BindConfig bind_config;
+#ifdef TCP_FASTOPEN_CONNECT
+  if (profile.tcp_fast_open) {
+    addSocketOption(bind_config, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, 1);
+  }
+#endif
+#ifdef TCP_CONGESTION
+  if (!profile.congestion_control.empty()) {
+    auto* option = bind_config.add_socket_options();
+    option->set_level(IPPROTO_TCP);
+    option->set_name(TCP_CONGESTION);
+    option->set_buf_value(profile.congestion_control);
+    option->set_state(envoy::config::core::v3::SocketOption::STATE_PREBIND);
+  }
+#endif
+#ifdef TCP_NOTSENT_LOWAT
+  if (profile.not_sent_low_watermark_bytes > 0) {
+    addSocketOption(bind_config, IPPROTO_TCP, TCP_NOTSENT_LOWAT,
+                    profile.not_sent_low_watermark_bytes);
+  }
+#endif
+  if (profile.send_buffer_bytes > 0) {
+    addSocketOption(bind_config, SOL_SOCKET, SO_SNDBUF, profile.send_buffer_bytes);
+  }
+  if (profile.receive_buffer_bytes > 0) {
+    addSocketOption(bind_config, SOL_SOCKET, SO_RCVBUF, profile.receive_buffer_bytes);
+  }
+  if (bind_config.socket_options().empty()) {
+    return;
+  }
+  // DNS resolution is limited to IPv4, @see config_template. Binding to the IPv4 wildcard address
+  // makes IPv6 connections fail, so this must bind to the destination's family once DNS resolves
+  // IPv6 addresses.
+  auto* source_address = bind_config.mutable_source_address();
+  source_address->set_address("0.0.0.0");
+  source_address->set_port_value(0);
+  *cluster.mutable_upstream_bind_config() = bind_config;
+}
+
+} // namespace
+
+BootstrapBuilder& BootstrapBuilder::setConnectTimeoutSeconds(uint32_t connect_timeout_seconds) {
+  connect_timeout_seconds_ = connect_timeout_seconds;
+  return *this;
+}
+
+BootstrapBuilder& BootstrapBuilder::setDnsRefreshSeconds(uint32_t dns_refresh_seconds) {
+  dns_refresh_seconds_ = dns_refresh_seconds;
+  return *this;
+}
+
+BootstrapBuilder& BootstrapBuilder::setDnsFailureRefreshSeconds(uint32_t base_seconds,
+                                                                uint32_t max_seconds) {
+  dns_failure_refresh_seconds_base_ = base_seconds;
+  dns_failure_refresh_seconds_max_ = max_seconds;
+  return *this;
+}
+
+BootstrapBuilder& BootstrapBuilder::setStatsFlushSeconds(uint32_t stats_flush_seconds) {
+  stats_flush_seconds_ = stats_flush_seconds;
+  return *this;
+}
+
+BootstrapBuilder& BootstrapBuilder::setStatsDomain(const std::string& stats_domain) {
+  stats_domain_ = stats_domain;
+  return *this;
+}
+
+BootstrapBuilder& BootstrapBuilder::setAppVersion(const std::string& app_version) {
+  app_version_ = app_version;
+  return *this;
+}
+
+BootstrapBuilder& BootstrapBuilder::setAppId(const std::string& app_id) {
+  app_id_ = app_id;
+  return *this;
+}
+
+BootstrapBuilder& BootstrapBuilder::setDeviceOs(const std::string& device_os) {
+  device_os_ = device_os;
+  return *this;
+}
+
+BootstrapBuilder& BootstrapBuilder::addPlatformFilter(const std::string& platform_filter_name,
+                                                       uint32_t max_pooled_instances) {
+  platform_filters_.push_back({platform_filter_name, max_pooled_instances});
+  return *this;
+}
+
+BootstrapBuilder& BootstrapBuilder::addVirtualCluster(
+    const envoy::config::route::v3::VirtualCluster& virtual_cluster) {
+  virtual_clusters_.push_back(virtual_cluster);
+  return *this;
+}
+
+envoy_status_t BootstrapBuilder::setSocketProfile(envoy_network_t network,
+                                                  const SocketProfile& profile) {
+  // The network may come from the platform as a plain integer.
+  switch (network) {
+  case ENVOY_NET_GENERIC:
+  case ENVOY_NET_WLAN:
+  case ENVOY_NET_WWAN:
+    socket_profiles_[network] = profile;
+    return ENVOY_SUCCESS;
+  }
+  return ENVOY_FAILURE;
+}
+
+BootstrapPtr BootstrapBuilder::build() const {
+  auto bootstrap = std::make_unique<envoy::config::bootstrap::v3::Bootstrap>();
+
+  envoy::extensions::common::dynamic_forward_proxy::v3::DnsCacheConfig dns_cache_config;
+  dns_cache_config.set_name("dynamic_forward_proxy_cache_config");
+  dns_cache_config.set_dns_lookup_family(envoy::config::cluster::v3::Cluster::V4_ONLY);
+  dns_cache_config.mutable_dns_refresh_rate()->set_seconds(dns_refresh_seconds_);
+  dns_cache_config.mutable_dns_failure_refresh_rate()->mutable_base_interval()->set_seconds(
+      dns_failure_refresh_seconds_base_);
+  dns_cache_config.mutable_dns_failure_refresh_rate()->mutable_max_interval()->set_seconds(
+      dns_failure_refresh_seconds_max_);
+
+  // API listener.
+  envoy::extensions::filters::network::http_connection_manager::v3::HttpConnectionManager hcm;
+  hcm.set_stat_prefix("hcm");
+  hcm.add_upgrade_configs()->set_upgrade_type("websocket");
+  hcm.add_upgrade_configs()->set_upgrade_type("CONNECT");
+  auto* route_config = hcm.mutable_route_config();
+  route_config->set_name("api_router");
+  auto* virtual_host = route_config->add_virtual_hosts();
+  virtual_host->set_name("api");
+  virtual_host->set_include_attempt_count_in_response(true);
+  for (const auto& virtual_cluster : virtual_clusters_) {
+    *virtual_host->add_virtual_clusters() = virtual_cluster;
+  }
+  virtual_host->add_domains("*");
+  // Long-lived streams are not subject to a route timeout.
+  auto* connect_route = virtual_host->add_routes();
+  connect_route->mutable_match()->mutable_connect_matcher();
+  connect_route->mutable_route()->set_cluster_header("x-envoy-mobile-cluster");
+  connect_route->mutable_route()->mutable_timeout();
+  auto* websocket_route = virtual_host->add_routes();
+  websocket_route->mutable_match()->set_prefix("/");
+  auto* upgrade_header = websocket_route->mutable_match()->add_headers();
+  upgrade_header->set_name("upgrade");
+  upgrade_header->set_exact_match("websocket");
+  websocket_route->mutable_route()->set_cluster_header("x-envoy-mobile-cluster");
+  websocket_route->mutable_route()->mutable_timeout();
+  auto* route = virtual_host->add_routes();
+  route->mutable_match()->set_prefix("/");
+  route->mutable_route()->set_cluster_header("x-envoy-mobile-cluster");
+  auto* retry_back_off = route->mutable_route()->mutable_retry_policy()->mutable_retry_back_off();
+  retry_back_off->mutable_base_interval()->set_nanos(250 * 1000 * 1000);
+  retry_back_off->mutable_max_interval()->set_seconds(60);
+
+  for (const PlatformFilter& platform_filter : platform_filters_) {
+    envoymobile::extensions::filters::http::platform_bridge::PlatformBridge platform_bridge;
+    platform_bridge.set_platform_filter_name(platform_filter.name_);
+    platform_bridge.set_max_pooled_instances(platform_filter.max_pooled_instances_);
+    auto* filter = hcm.add_http_filters();
+    filter->set_name("envoy.filters.http.platform_bridge");
+    filter->mutable_typed_config()->PackFrom(platform_bridge);
+  }
+
+  envoy::extensions::filters::http::dynamic_forward_proxy::v3::FilterConfig dfp_filter;
+  *dfp_filter.mutable_dns_cache_config() = dns_cache_config;
+  auto* filter = hcm.add_http_filters();
+  filter->set_name("envoy.filters.http.dynamic_forward_proxy");
+  filter->mutable_typed_config()->PackFrom(dfp_filter);
+
+  envoy::extensions::compression::gzip::decompressor::v3::Gzip gzip;
+  gzip.mutable_window_bits()->set_value(15);
+  envoy::extensions::filters::http::decompressor::v3::Decompressor decompressor;
+  decompressor.mutable_decompressor_library()->set_name("gzip");
+  decompressor.mutable_decompressor_library()->mutable_typed_config()->PackFrom(gzip);
+  auto* request_decompression_enabled =
+      decompressor.mutable_request_direction_config()->mutable_common_config()->mutable_enabled();
+  request_decompression_enabled->mutable_default_value()->set_value(false);
+  request_decompression_enabled->set_runtime_key("request_decompressor_enabled");
+  filter = hcm.add_http_filters();
+  filter->set_name("envoy.filters.http.decompressor");
+  filter->mutable_typed_config()->PackFrom(decompressor);
+
+  filter = hcm.add_http_filters();
+  filter->set_name("envoy.router");
+  filter->mutable_typed_config()->PackFrom(envoy::extensions::filters::http::router::v3::Router());
+
+  auto* listener = bootstrap->mutable_static_resources()->add_listeners();
+  listener->set_name("base_api_listener");
+  auto* socket_address = listener->mutable_address()->mutable_socket_address();
+  socket_address->set_protocol(envoy::config::core::v3::SocketAddress::TCP);
+  socket_address->set_address("0.0.0.0");
+  socket_address->set_port_value(10000);
+  listener->mutable_api_listener()->mutable_api_listener()->PackFrom(hcm);
+
+  // Clusters.
+  envoymobile::extensions::tls::cert_verifier::CertVerifier cert_verifier;
+  cert_verifier.set_async_verification(true);
+  envoy::extensions::transport_sockets::tls::v3::UpstreamTlsContext tls_context;
+  auto* custom_handshaker = tls_context.mutable_common_tls_context()->mutable_custom_handshaker();
+  custom_handshaker->set_name("envoy_mobile.tls.handshaker.cert_verifier");
+  custom_handshaker->mutable_typed_config()->PackFrom(cert_verifier);
+  tls_context.mutable_common_tls_context()
+      ->mutable_validation_context()
+      ->mutable_trusted_ca()
+      ->set_inline_string(trustedCa());
+  envoy::config::core::v3::TransportSocket transport_socket;
+  transport_socket.set_name("envoy.transport_sockets.tls");
+  transport_socket.mutable_typed_config()->PackFrom(tls_context);
+  // Idempotent requests are sent as TLS 1.3 early data by the early data clusters, once
+  // enable_early_data is called. Only they are routed to them.
+  cert_verifier.set_enable_early_data(true);
+  custom_handshaker->mutable_typed_config()->PackFrom(cert_verifier);
+  envoy::config::core::v3::TransportSocket early_data_transport_socket = transport_socket;
+  early_data_transport_socket.mutable_typed_config()->PackFrom(tls_context);
+
+  envoy::extensions::clusters::dynamic_forward_proxy::v3::ClusterConfig dfp_cluster;
+  *dfp_cluster.mutable_dns_cache_config() = dns_cache_config;
+  envoy::config::cluster::v3::Cluster base_cluster;
+  base_cluster.mutable_connect_timeout()->set_seconds(connect_timeout_seconds_);
+  base_cluster.set_lb_policy(envoy::config::cluster::v3::Cluster::CLUSTER_PROVIDED);
+  base_cluster.mutable_cluster_type()->set_name("envoy.clusters.dynamic_forward_proxy");
+  base_cluster.mutable_cluster_type()->mutable_typed_config()->PackFrom(dfp_cluster);
+  // Coalesces requests for names which share a connection's address and certificate.
+  envoymobile::extensions::clusters::coalescing::Coalescing coalescing_cluster;
+  *coalescing_cluster.mutable_dynamic_forward_proxy() = dfp_cluster;
+  *base_cluster.mutable_transport_socket() = transport_socket;
+  auto* tcp_keepalive = base_cluster.mutable_upstream_connection_options()->mutable_tcp_keepalive();
+  tcp_keepalive->mutable_keepalive_interval()->set_value(10);
+  tcp_keepalive->mutable_keepalive_probes()->set_value(1);
+  tcp_keepalive->mutable_keepalive_time()->set_value(5);
+  // See config_template for the rationale behind the retry budget.
+  auto* thresholds = base_cluster.mutable_circuit_breakers()->add_thresholds();
+  thresholds->set_priority(envoy::config::core::v3::DEFAULT);
+  thresholds->mutable_retry_budget()->mutable_budget_percent()->set_value(100);
+  thresholds->mutable_retry_budget()->mutable_min_retry_concurrency()->set_value(1024);
+
+  constexpr std::pair<envoy_network_t, const char*> Networks[] = {
+      {ENVOY_NET_GENERIC, ""}, {ENVOY_NET_WLAN, "_wlan"}, {ENVOY_NET_WWAN, "_wwan"}};
+  for (const bool early_data : {false, true}) {
+    for (const bool http2 : {false, true}) {
+      for (const auto& network : Networks) {
+        auto* cluster = bootstrap->mutable_static_resources()->add_clusters();
+        *cluster = base_cluster;
+        cluster->set_name(absl::StrCat("base", network.second, http2 ? "_h2" : "",
+                                       early_data ? "_early_data" : ""));
+        if (http2) {
+          cluster->mutable_http2_protocol_options()->set_allow_connect(true);
+          cluster->mutable_cluster_type()->set_name("envoy_mobile.clusters.coalescing");
+          cluster->mutable_cluster_type()->mutable_typed_config()->PackFrom(coalescing_cluster);
+        }
+        if (early_data) {
+          *cluster->mutable_transport_socket() = early_data_transport_socket;
+        }
+        applySocketProfile(socket_profiles_[network.first], *cluster);
+      }
+    }
+  }
+
+  auto* stats_cluster = bootstrap->mutable_static_resources()->add_clusters();
+  stats_cluster->set_name("stats");
+  stats_cluster->mutable_connect_timeout()->set_seconds(connect_timeout_seconds_);
+  stats_cluster->mutable_dns_refresh_rate()->set_seconds(dns_refresh_seconds_);
+  stats_cluster->mutable_http2_protocol_options();
+  stats_cluster->set_lb_policy(envoy::config::cluster::v3::Cluster::ROUND_ROBIN);
+  stats_cluster->mutable_load_assignment()->set_cluster_name("stats");
+  auto* stats_address = stats_cluster->mutable_load_assignment()
+                            ->add_endpoints()
+                            ->add_lb_endpoints()
+                            ->mutable_endpoint()
+                            ->mutable_address()
+                            ->mutable_socket_address();
+  stats_address->set_address(stats_domain_);
+  stats_address->set_port_value(443);
+  *stats_cluster->mutable_transport_socket() = transport_socket;
+  stats_cluster->set_type(envoy::config::cluster::v3::Cluster::LOGICAL_DNS);
+
+  // Stats.
+  bootstrap->mutable_stats_flush_interval()->set_seconds(stats_flush_seconds_);
+  envoy::config::metrics::v3::MetricsServiceConfig metrics_service;
+  metrics_service.mutable_report_counters_as_deltas()->set_value(true);
+  metrics_service.mutable_grpc_service()->mutable_envoy_grpc()->set_cluster_name("stats");
+  auto* stats_sink = bootstrap->add_stats_sinks();
+  stats_sink->set_name("envoy.metrics_service");
+  stats_sink->mutable_typed_config()->PackFrom(metrics_service);
+  auto* inclusion_list =
+      bootstrap->mutable_stats_config()->mutable_stats_matcher()->mutable_inclusion_list();
+  for (const char* pattern : StatsInclusionPatterns) {
+    auto* safe_regex = inclusion_list->add_patterns()->mutable_safe_regex();
+    safe_regex->mutable_google_re2();
+    safe_regex->set_regex(pattern);
+  }
+
+  bootstrap->mutable_watchdog()->mutable_megamiss_timeout()->set_seconds(60);
+  bootstrap->mutable_watchdog()->mutable_miss_timeout()->set_seconds(60);
+
+  auto& metadata = *bootstrap->mutable_node()->mutable_metadata()->mutable_fields();
+  metadata["app_id"] = ValueUtil::stringValue(app_id_);
+  metadata["app_version"] = ValueUtil::stringValue(app_version_);
+  metadata["os"] = ValueUtil::stringValue(device_os_);
+
+  // Memory pressure.
+  envoymobile::extensions::resource_monitors::device_memory::DeviceMemory device_memory;
+  device_memory.set_max_heap_size_bytes(MaxHeapSizeBytes);
+  auto* overload_manager = bootstrap->mutable_overload_manager();
+  overload_manager->mutable_refresh_interval()->set_seconds(OverloadRefreshSeconds);
+  auto* resource_monitor = overload_manager->add_resource_monitors();
+  resource_monitor->set_name(DeviceMemoryMonitor);
+  resource_monitor->mutable_typed_config()->PackFrom(device_memory);
+  for (const auto& action : OverloadActions) {
+    auto* overload_action = overload_manager->add_actions();
+    overload_action->set_name(action.first);
+    auto* trigger = overload_action->add_triggers();
+    trigger->set_name(DeviceMemoryMonitor);
+    trigger->mutable_threshold()->set_value(action.second);
+  }
+
+  ProtobufWkt::Struct overload;
+  (*overload.mutable_fields())["global_downstream_max_connections"] =
+      ValueUtil::numberValue(50000);
+  auto* runtime_layer = bootstrap->mutable_layered_runtime()->add_layers();
+  runtime_layer->set_name("static_layer_0");
+  (*runtime_layer->mutable_static_layer()->mutable_fields())["overload"] =
+      ValueUtil::structValue(overload);
+  auto* admin_layer = bootstrap->mutable_layered_runtime()->add_layers();
+  admin_layer->set_name("admin_layer_0");
+  admin_layer->mutable_admin_layer();
+
+  return bootstrap;
+}
+
+} // namespace Envoy
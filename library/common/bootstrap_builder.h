@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/config/bootstrap/v3/bootstrap.pb.h"
+#include "envoy/config/route/v3/route_components.pb.h"
+
+#include "library/common/types/c_types.h"
+
+namespace Envoy {
+
+using BootstrapPtr = std::unique_ptr<envoy::config::bootstrap::v3::Bootstrap>;
+
+/**
+ * Socket settings for upstream connections over one kind of network. Settings left at their
+ * defaults keep the system's, and settings the platform does not support are ignored.
+ */
+struct SocketProfile {
+  // Send the start of each connection's first flight (i.e. the TLS ClientHello) in its SYN, for
+  // servers which previously issued a Fast Open cookie. Linux only.
+  bool tcp_fast_open{};
+  // The congestion control algorithm, e.g. "bbr". It must be available in the kernel, or
+  // connections fail. Linux only.
+  std::string congestion_control;
+  // Limit on unsent data queued in the kernel, so that data is held in Envoy's buffers where it is
+  // still subject to flow control.
+  uint32_t not_sent_low_watermark_bytes{};
+  uint32_t send_buffer_bytes{};
+  uint32_t receive_buffer_bytes{};
+};
+
+/**
+ * Builds the Envoy Mobile Bootstrap directly from typed options. The resulting configuration is
+ * equivalent to config_template with the same values substituted, but avoids producing and then
+ * parsing YAML when the engine starts.
+ */
+class BootstrapBuilder {
+public:
+  BootstrapBuilder& setConnectTimeoutSeconds(uint32_t connect_timeout_seconds);
+  BootstrapBuilder& setDnsRefreshSeconds(uint32_t dns_refresh_seconds);
+  BootstrapBuilder& setDnsFailureRefreshSeconds(uint32_t base_seconds, uint32_t max_seconds);
+  BootstrapBuilder& setStatsFlushSeconds(uint32_t stats_flush_seconds);
+  BootstrapBuilder& setStatsDomain(const std::string& stats_domain);
+  BootstrapBuilder& setAppVersion(const std::string& app_version);
+  BootstrapBuilder& setAppId(const std::string& app_id);
+  BootstrapBuilder& setDeviceOs(const std::string& device_os);
+
+  /**
+   * Append a platform filter to the filter chain. Filters run in the order they are added, ahead
+   * of the filters built into Envoy Mobile.
+   * @param platform_filter_name, the name the platform filter was registered with.
+   * @param max_pooled_instances, the number of idle instances of the filter to keep for reuse by
+   *        later streams, if the platform filter can reset them. 0 disables pooling.
+   */
+  BootstrapBuilder& addPlatformFilter(const std::string& platform_filter_name,
+                                      uint32_t max_pooled_instances = 0);
+
+  /**
+   * Add a virtual cluster to the API virtual host.
+   * @param virtual_cluster, the virtual cluster to add.
+   */
+  BootstrapBuilder&
+  addVirtualCluster(const envoy::config::route::v3::VirtualCluster& virtual_cluster);
+
+  /**
+   * Set the socket settings of the clusters requests are sent to while the given network is
+   * preferred. Connection setup time and throughput under each profile are reported by the stats
+   * of those clusters, e.g. cluster.base_wwan.upstream_cx_connect_ms.
+   * @param network, the network the profile applies to.
+   * @param profile, the socket settings.
+   * @return envoy_status_t, ENVOY_FAILURE if the network is not a known envoy_network_t, in which
+   *         case the builder is unchanged.
+   */
+  envoy_status_t setSocketProfile(envoy_network_t network, const SocketProfile& profile);
+
+  /**
+   * @return BootstrapPtr, the configuration described by the options set on this builder.
+   */
+  BootstrapPtr build() const;
+
+private:
+  uint32_t connect_timeout_seconds_{30};
+  uint32_t dns_refresh_seconds_{60};
+  uint32_t dns_failure_refresh_seconds_base_{2};
+  uint32_t dns_failure_refresh_seconds_max_{10};
+  uint32_t stats_flush_seconds_{60};
+  std::string stats_domain_{"0.0.0.0"};
+  std::string app_version_{"unspecified"};
+  std::string app_id_{"unspecified"};
+  std::string device_os_{"unspecified"};
+  struct PlatformFilter {
+    std::string name_;
+    uint32_t max_pooled_instances_;
+  };
+  std::vector<PlatformFilter> platform_filters_;
+  std::vector<envoy::config::route::v3::VirtualCluster> virtual_clusters_;
+  // Indexed by envoy_network_t.
+  std::array<SocketProfile, 3> socket_profiles_;
+};
+
+} // namespace Envoy
@@ -4,6 +4,7 @@
 
 #include "common/common/non_copyable.h"
 
+#include "library/common/stats/bridge_copy_stats.h"
 #include "library/common/types/c_types.h"
 
 namespace Envoy {
@@ -15,7 +16,11 @@ namespace Buffer {
 class BridgeFragment : NonCopyable, public BufferFragment {
 public:
   // TODO: Consider moving this to a BridgeFragmentFactory class.
-  static BridgeFragment* createBridgeFragment(envoy_data data) { return new BridgeFragment(data); }
+  static BridgeFragment* createBridgeFragment(envoy_data data) {
+    // The data itself is not copied, only wrapped.
+    ENVOY_MOBILE_BRIDGE_COPY(bridge_fragment, 0, 1);
+    return new BridgeFragment(data);
+  }
 
   // Buffer::BufferFragment
   const void* data() const override { return data_.bytes; }
@@ -0,0 +1,116 @@
+#include "library/common/buffer/spilling_replay_buffer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <vector>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Buffer {
+
+SpillingReplayBuffer::SpillingReplayBuffer(uint64_t memory_limit, std::string spill_directory,
+                                           Executor executor)
+    : memory_limit_(memory_limit), spill_directory_(std::move(spill_directory)),
+      executor_(std::move(executor)) {}
+
+bool SpillingReplayBuffer::add(const Instance& data) {
+  if (!complete()) {
+    complete_ = false;
+    return false;
+  }
+  auto copy = std::make_shared<OwnedImpl>();
+  copy->add(data);
+  // Once the memory limit is reached, everything else goes to the spill file.
+  memory_.move(*copy, std::min(copy->length(), memory_limit_ - memory_.length()));
+  if (copy->length() == 0) {
+    return true;
+  }
+  if (spill_file_ == nullptr) {
+    spill_file_ = std::make_shared<SpillFile>();
+  }
+  spilled_length_ += copy->length();
+  executor_([spill_file = spill_file_, directory = spill_directory_, copy]() -> void {
+    spill_file->write(directory, *copy);
+  });
+  return true;
+}
+
+void SpillingReplayBuffer::read(uint64_t offset, uint64_t max_length, ReadCallback cb) const {
+  ASSERT(offset < length());
+  const uint64_t memory_length = memory_.length();
+  if (offset < memory_length) {
+    const uint64_t size = std::min(max_length, memory_length - offset);
+    std::vector<char> scratch(size);
+    memory_.copyOut(offset, size, scratch.data());
+    cb(std::make_unique<OwnedImpl>(scratch.data(), size));
+    return;
+  }
+  const uint64_t size = std::min(max_length, length() - offset);
+  executor_([spill_file = spill_file_, offset = offset - memory_length, size, cb]() -> void {
+    cb(spill_file->read(offset, size));
+  });
+}
+
+SpillingReplayBuffer::SpillFile::~SpillFile() {
+  if (fd_ != -1) {
+    ::close(fd_);
+  }
+}
+
+void SpillingReplayBuffer::SpillFile::write(const std::string& directory, const Instance& data) {
+  if (failed_) {
+    return;
+  }
+  if (fd_ == -1) {
+    std::string path = directory + "/envoy_mobile_replay_XXXXXX";
+    fd_ = ::mkstemp(&path[0]);
+    if (fd_ == -1) {
+      failed_ = true;
+      return;
+    }
+    // The file is only reachable through fd_, and is removed once it is closed.
+    ::unlink(path.c_str());
+  }
+  for (const RawSlice& slice : data.getRawSlices()) {
+    const char* position = static_cast<const char*>(slice.mem_);
+    uint64_t remaining = slice.len_;
+    while (remaining > 0) {
+      const ssize_t rc = ::write(fd_, position, remaining);
+      if (rc < 0 && errno == EINTR) {
+        continue;
+      }
+      if (rc <= 0) {
+        failed_ = true;
+        return;
+      }
+      position += rc;
+      remaining -= rc;
+    }
+  }
+}
+
+InstancePtr SpillingReplayBuffer::SpillFile::read(uint64_t offset, uint64_t length) {
+  if (failed_) {
+    return nullptr;
+  }
+  std::vector<char> scratch(length);
+  uint64_t filled = 0;
+  while (filled < length) {
+    const ssize_t rc = ::pread(fd_, scratch.data() + filled, length - filled, offset + filled);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc <= 0) {
+      return nullptr;
+    }
+    filled += rc;
+  }
+  return std::make_unique<OwnedImpl>(scratch.data(), length);
+}
+
+} // namespace Buffer
+} // namespace Envoy
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "envoy/buffer/buffer.h"
+
+#include "common/buffer/buffer_impl.h"
+
+namespace Envoy {
+namespace Buffer {
+
+/**
+ * An append-only copy of a request body, which can be read back any number of times to replay the
+ * request. The first memory_limit bytes are held in memory; the remainder is spilled to an
+ * unlinked temporary file, so that large bodies can be replayed without holding them in memory.
+ * The file is removed by the system once the buffer, and any of its I/O still queued, is gone.
+ */
+class SpillingReplayBuffer {
+public:
+  /**
+   * Runs the spill file's I/O, which may block, off of the event loop. Work must run in the order
+   * it is queued, so that reads of spilled data follow the writes which spilled it.
+   */
+  using Executor = std::function<void(std::function<void()>)>;
+
+  /**
+   * Called with a chunk read back, or nullptr if it could not be read.
+   */
+  using ReadCallback = std::function<void(InstancePtr)>;
+
+  /**
+   * @param memory_limit, the number of bytes to hold in memory before spilling.
+   * @param spill_directory, the directory to create the spill file in.
+   * @param executor, runs the spill file's I/O.
+   */
+  SpillingReplayBuffer(uint64_t memory_limit, std::string spill_directory, Executor executor);
+
+  /**
+   * Append a copy of data. Data beyond the memory limit is written to the spill file on the
+   * executor, so a failure to spill it is only reflected by complete() once that has run.
+   * @param data, the data to append. It is not modified.
+   * @return bool whether the data was recorded. Once false is returned, the buffer no longer
+   *         holds the complete body and cannot be replayed.
+   */
+  bool add(const Instance& data);
+
+  /**
+   * Read back part of the contents of the buffer. Chunks held in memory are passed to cb before
+   * this returns; spilled chunks are read on the executor, and passed to cb on its thread.
+   * @param offset, the offset of the chunk, which must be less than length().
+   * @param max_length, the maximum length of the chunk.
+   * @param cb, called with the chunk.
+   */
+  void read(uint64_t offset, uint64_t max_length, ReadCallback cb) const;
+
+  /**
+   * @return uint64_t the number of bytes recorded.
+   */
+  uint64_t length() const { return memory_.length() + spilled_length_; }
+
+  /**
+   * @return bool whether all data added has been recorded, @see add.
+   */
+  bool complete() const { return complete_ && (spill_file_ == nullptr || !spill_file_->failed_); }
+
+  /**
+   * @return bool whether any data has been spilled to disk.
+   */
+  bool spilled() const { return spill_file_ != nullptr; }
+
+private:
+  // The spill file is only accessed by work on the executor, which shares it so that queued work
+  // can outlive the buffer.
+  struct SpillFile {
+    ~SpillFile();
+
+    void write(const std::string& directory, const Instance& data);
+    InstancePtr read(uint64_t offset, uint64_t length);
+
+    int fd_{-1};
+    // Set once a write fails, as the file no longer holds the spilled data.
+    std::atomic<bool> failed_{};
+  };
+
+  using SpillFileSharedPtr = std::shared_ptr<SpillFile>;
+
+  const uint64_t memory_limit_;
+  const std::string spill_directory_;
+  const Executor executor_;
+  OwnedImpl memory_;
+  SpillFileSharedPtr spill_file_;
+  uint64_t spilled_length_{};
+  bool complete_{true};
+};
+
+} // namespace Buffer
+} // namespace Envoy
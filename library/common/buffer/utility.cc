@@ -3,6 +3,7 @@
 #include "common/buffer/buffer_impl.h"
 
 #include "library/common/buffer/bridge_fragment.h"
+#include "library/common/stats/bridge_copy_stats.h"
 
 namespace Envoy {
 namespace Buffer {
@@ -23,6 +24,7 @@ envoy_data toBridgeData(Buffer::Instance& data) {
   bridge_data.bytes = static_cast<uint8_t*>(safe_malloc(sizeof(uint8_t) * bridge_data.length));
   data.copyOut(0, bridge_data.length, const_cast<uint8_t*>(bridge_data.bytes));
   data.drain(bridge_data.length);
+  ENVOY_MOBILE_BRIDGE_COPY(to_bridge_data, bridge_data.length, 1);
   bridge_data.release = free;
   bridge_data.context = const_cast<uint8_t*>(bridge_data.bytes);
   return bridge_data;
@@ -33,6 +35,7 @@ envoy_data copyToBridgeData(const Buffer::Instance& data) {
   bridge_data.length = data.length();
   bridge_data.bytes = static_cast<uint8_t*>(safe_malloc(sizeof(uint8_t) * bridge_data.length));
   data.copyOut(0, bridge_data.length, const_cast<uint8_t*>(bridge_data.bytes));
+  ENVOY_MOBILE_BRIDGE_COPY(copy_to_bridge_data, bridge_data.length, 1);
   bridge_data.release = free;
   bridge_data.context = const_cast<uint8_t*>(bridge_data.bytes);
   return bridge_data;
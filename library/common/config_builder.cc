@@ -0,0 +1,81 @@
+#include "library/common/config_builder.h"
+
+#include "library/common/config_builder_internal.h"
+
+// NOLINT(namespace-envoy)
+
+envoy_config_builder* envoy_config_builder_new() { return new envoy_config_builder(); }
+
+void envoy_config_builder_free(envoy_config_builder* builder) { delete builder; }
+
+void envoy_config_builder_set_connect_timeout_seconds(envoy_config_builder* builder,
+                                                      uint32_t seconds) {
+  builder->builder_.setConnectTimeoutSeconds(seconds);
+}
+
+void envoy_config_builder_set_dns_refresh_seconds(envoy_config_builder* builder, uint32_t seconds) {
+  builder->builder_.setDnsRefreshSeconds(seconds);
+}
+
+void envoy_config_builder_set_dns_failure_refresh_seconds(envoy_config_builder* builder,
+                                                          uint32_t base_seconds,
+                                                          uint32_t max_seconds) {
+  builder->builder_.setDnsFailureRefreshSeconds(base_seconds, max_seconds);
+}
+
+void envoy_config_builder_set_stats_flush_seconds(envoy_config_builder* builder, uint32_t seconds) {
+  builder->builder_.setStatsFlushSeconds(seconds);
+}
+
+void envoy_config_builder_set_stats_domain(envoy_config_builder* builder,
+                                           const char* stats_domain) {
+  builder->builder_.setStatsDomain(stats_domain);
+}
+
+void envoy_config_builder_set_app_version(envoy_config_builder* builder, const char* app_version) {
+  builder->builder_.setAppVersion(app_version);
+}
+
+void envoy_config_builder_set_app_id(envoy_config_builder* builder, const char* app_id) {
+  builder->builder_.setAppId(app_id);
+}
+
+void envoy_config_builder_set_device_os(envoy_config_builder* builder, const char* device_os) {
+  builder->builder_.setDeviceOs(device_os);
+}
+
+void envoy_config_builder_add_platform_filter(envoy_config_builder* builder,
+                                              const char* platform_filter_name,
+                                              uint32_t max_pooled_instances) {
+  builder->builder_.addPlatformFilter(platform_filter_name, max_pooled_instances);
+}
+
+void envoy_config_builder_add_virtual_cluster(envoy_config_builder* builder, const char* name,
+                                              const char* path_regex, const char* method) {
+  envoy::config::route::v3::VirtualCluster virtual_cluster;
+  virtual_cluster.set_name(name);
+  auto* path = virtual_cluster.add_headers();
+  path->set_name(":path");
+  path->mutable_safe_regex_match()->mutable_google_re2();
+  path->mutable_safe_regex_match()->set_regex(path_regex);
+  if (method != nullptr) {
+    auto* method_matcher = virtual_cluster.add_headers();
+    method_matcher->set_name(":method");
+    method_matcher->set_exact_match(method);
+  }
+  builder->builder_.addVirtualCluster(virtual_cluster);
+}
+
+envoy_status_t envoy_config_builder_set_socket_profile(envoy_config_builder* builder,
+                                                       envoy_network_t network,
+                                                       const envoy_socket_profile* profile) {
+  Envoy::SocketProfile socket_profile;
+  socket_profile.tcp_fast_open = profile->tcp_fast_open != 0;
+  if (profile->congestion_control != nullptr) {
+    socket_profile.congestion_control = profile->congestion_control;
+  }
+  socket_profile.not_sent_low_watermark_bytes = profile->not_sent_low_watermark_bytes;
+  socket_profile.send_buffer_bytes = profile->send_buffer_bytes;
+  socket_profile.receive_buffer_bytes = profile->receive_buffer_bytes;
+  return builder->builder_.setSocketProfile(network, socket_profile);
+}
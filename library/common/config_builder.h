@@ -0,0 +1,140 @@
+#pragma once
+#include <stdint.h>
+
+#include "library/common/types/c_types.h"
+
+// NOLINT(namespace-envoy)
+
+/**
+ * Builder for the configuration of an engine. Options which are not set assume the same defaults
+ * as the platform engine builders. The engine is configured with the resulting Bootstrap directly,
+ * without rendering and parsing config_template.
+ */
+typedef struct envoy_config_builder envoy_config_builder;
+
+/**
+ * Socket settings for upstream connections over one kind of network. Zero or NULL fields keep the
+ * system's defaults, and settings the platform does not support are ignored.
+ * tcp_fast_open sends the TLS ClientHello in the SYN to servers which issued a cookie (Linux).
+ * congestion_control names an algorithm available in the kernel, e.g. "bbr" (Linux).
+ * not_sent_low_watermark_bytes limits unsent data queued in the kernel.
+ */
+typedef struct {
+  uint8_t tcp_fast_open;
+  const char* congestion_control;
+  uint32_t not_sent_low_watermark_bytes;
+  uint32_t send_buffer_bytes;
+  uint32_t receive_buffer_bytes;
+} envoy_socket_profile;
+
+#ifdef __cplusplus
+extern "C" { // functions
+#endif
+
+/**
+ * Create a new configuration builder.
+ * @return envoy_config_builder*, the builder, to be released with envoy_config_builder_free.
+ */
+envoy_config_builder* envoy_config_builder_new();
+
+/**
+ * Release a configuration builder.
+ * @param builder, the builder to release.
+ */
+void envoy_config_builder_free(envoy_config_builder* builder);
+
+/**
+ * Set the timeout for new upstream connections.
+ * @param builder, the builder to configure.
+ * @param seconds, the timeout in seconds.
+ */
+void envoy_config_builder_set_connect_timeout_seconds(envoy_config_builder* builder,
+                                                      uint32_t seconds);
+
+/**
+ * Set the interval at which resolved DNS entries are refreshed.
+ * @param builder, the builder to configure.
+ * @param seconds, the interval in seconds.
+ */
+void envoy_config_builder_set_dns_refresh_seconds(envoy_config_builder* builder, uint32_t seconds);
+
+/**
+ * Set the bounds of the backoff applied when refreshing DNS entries fails.
+ * @param builder, the builder to configure.
+ * @param base_seconds, the initial backoff interval in seconds.
+ * @param max_seconds, the maximum backoff interval in seconds.
+ */
+void envoy_config_builder_set_dns_failure_refresh_seconds(envoy_config_builder* builder,
+                                                          uint32_t base_seconds,
+                                                          uint32_t max_seconds);
+
+/**
+ * Set the interval at which stats are flushed to the stats domain.
+ * @param builder, the builder to configure.
+ * @param seconds, the interval in seconds.
+ */
+void envoy_config_builder_set_stats_flush_seconds(envoy_config_builder* builder, uint32_t seconds);
+
+/**
+ * Set the domain stats are flushed to.
+ * @param builder, the builder to configure.
+ * @param stats_domain, the domain.
+ */
+void envoy_config_builder_set_stats_domain(envoy_config_builder* builder, const char* stats_domain);
+
+/**
+ * Set the application version reported in node metadata.
+ * @param builder, the builder to configure.
+ * @param app_version, the application version.
+ */
+void envoy_config_builder_set_app_version(envoy_config_builder* builder, const char* app_version);
+
+/**
+ * Set the application id reported in node metadata.
+ * @param builder, the builder to configure.
+ * @param app_id, the application id.
+ */
+void envoy_config_builder_set_app_id(envoy_config_builder* builder, const char* app_id);
+
+/**
+ * Set the operating system reported in node metadata.
+ * @param builder, the builder to configure.
+ * @param device_os, the operating system.
+ */
+void envoy_config_builder_set_device_os(envoy_config_builder* builder, const char* device_os);
+
+/**
+ * Append a platform filter to the filter chain. Filters run in the order they are added.
+ * @param builder, the builder to configure.
+ * @param platform_filter_name, the name the platform filter was registered with.
+ * @param max_pooled_instances, the number of idle instances of the filter to keep for reuse by
+ *        later streams, if the platform filter can reset them. 0 disables pooling.
+ */
+void envoy_config_builder_add_platform_filter(envoy_config_builder* builder,
+                                              const char* platform_filter_name,
+                                              uint32_t max_pooled_instances);
+
+/**
+ * Add a virtual cluster matching requests by path, and optionally by method.
+ * @param builder, the builder to configure.
+ * @param name, the name of the virtual cluster, used in stats.
+ * @param path_regex, a RE2 regex the :path of matching requests must fully match.
+ * @param method, the :method of matching requests, or NULL to match any method.
+ */
+void envoy_config_builder_add_virtual_cluster(envoy_config_builder* builder, const char* name,
+                                              const char* path_regex, const char* method);
+
+/**
+ * Set the socket settings of upstream connections made while the given network is preferred.
+ * @param builder, the builder to configure.
+ * @param network, the network the profile applies to.
+ * @param profile, the socket settings. Copied, so it need not outlive the call.
+ * @return envoy_status_t, ENVOY_FAILURE if the network is not a known envoy_network_t.
+ */
+envoy_status_t envoy_config_builder_set_socket_profile(envoy_config_builder* builder,
+                                                       envoy_network_t network,
+                                                       const envoy_socket_profile* profile);
+
+#ifdef __cplusplus
+} // functions
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "library/common/bootstrap_builder.h"
+#include "library/common/config_builder.h"
+
+// NOLINT(namespace-envoy)
+
+/**
+ * The C handle wraps the C++ builder so that the library can build a Bootstrap from it without
+ * exposing C++ types in config_builder.h.
+ */
+struct envoy_config_builder {
+  Envoy::BootstrapBuilder builder_;
+};
@@ -6,6 +6,7 @@ const char* platform_filter_template = R"(
             typed_config:
               "@type": type.googleapis.com/envoymobile.extensions.filters.http.platform_bridge.PlatformBridge
               platform_filter_name: {{ platform_filter_name }}
+              max_pooled_instances: {{ max_pooled_instances }}
 )";
 
 const char* config_template = R"(
@@ -21,6 +22,10 @@ static_resources:
       api_listener:
         "@type": type.googleapis.com/envoy.extensions.filters.network.http_connection_manager.v3.HttpConnectionManager
         stat_prefix: hcm
+        # Streams may be upgraded to long-lived bidirectional streams.
+        upgrade_configs:
+          - upgrade_type: websocket
+          - upgrade_type: CONNECT
         route_config:
           name: api_router
           virtual_hosts:
@@ -30,6 +35,20 @@ static_resources:
               domains:
                 - "*"
               routes:
+                # Long-lived streams are not subject to a route timeout.
+                - match:
+                    connect_matcher: {}
+                  route:
+                    cluster_header: x-envoy-mobile-cluster
+                    timeout: 0s
+                - match:
+                    prefix: "/"
+                    headers:
+                      - name: upgrade
+                        exact_match: websocket
+                  route:
+                    cluster_header: x-envoy-mobile-cluster
+                    timeout: 0s
                 - match:
                     prefix: "/"
                   route:
@@ -86,8 +105,16 @@ static_resources:
       typed_config:
         "@type": type.googleapis.com/envoy.extensions.transport_sockets.tls.v3.UpstreamTlsContext
         common_tls_context:
+          # Caches successful certificate chain verifications so that repeated handshakes with the
+          # same host skip path building and signature checks. Chains which are not cached are
+          # verified off of the engine's dispatcher so that handshakes do not stall other streams.
+          custom_handshaker:
+            name: envoy_mobile.tls.handshaker.cert_verifier
+            typed_config:
+              "@type": type.googleapis.com/envoymobile.extensions.tls.cert_verifier.CertVerifier
+              async_verification: true
           validation_context:
-            trusted_ca:
+            trusted_ca: &trusted_ca
               inline_string: |
 )"
 #include "certificates.inc"
@@ -138,7 +165,54 @@ static_resources:
     upstream_connection_options: *upstream_opts
     circuit_breakers: *circuit_breakers_settings
   - name: base_h2
-    http2_protocol_options: {}
+    http2_protocol_options:
+      # Carries upgrades, e.g. to WebSockets, as extended CONNECT requests.
+      allow_connect: true
+    connect_timeout: {{ connect_timeout_seconds }}s
+    lb_policy: CLUSTER_PROVIDED
+    cluster_type:
+      # Coalesces requests for names which share a connection's address and certificate.
+      name: envoy_mobile.clusters.coalescing
+      typed_config:
+        "@type": type.googleapis.com/envoymobile.extensions.clusters.coalescing.Coalescing
+        dynamic_forward_proxy:
+          dns_cache_config: *dns_cache_config
+    transport_socket: *base_transport_socket
+    upstream_connection_options: *upstream_opts
+    circuit_breakers: *circuit_breakers_settings
+  - name: base_wlan_h2
+    http2_protocol_options:
+      # Carries upgrades, e.g. to WebSockets, as extended CONNECT requests.
+      allow_connect: true
+    connect_timeout: {{ connect_timeout_seconds }}s
+    lb_policy: CLUSTER_PROVIDED
+    cluster_type:
+      # Coalesces requests for names which share a connection's address and certificate.
+      name: envoy_mobile.clusters.coalescing
+      typed_config:
+        "@type": type.googleapis.com/envoymobile.extensions.clusters.coalescing.Coalescing
+        dynamic_forward_proxy:
+          dns_cache_config: *dns_cache_config
+    transport_socket: *base_transport_socket
+    upstream_connection_options: *upstream_opts
+    circuit_breakers: *circuit_breakers_settings
+  - name: base_wwan_h2
+    http2_protocol_options:
+      # Carries upgrades, e.g. to WebSockets, as extended CONNECT requests.
+      allow_connect: true
+    connect_timeout: {{ connect_timeout_seconds }}s
+    lb_policy: CLUSTER_PROVIDED
+    cluster_type:
+      # Coalesces requests for names which share a connection's address and certificate.
+      name: envoy_mobile.clusters.coalescing
+      typed_config:
+        "@type": type.googleapis.com/envoymobile.extensions.clusters.coalescing.Coalescing
+        dynamic_forward_proxy:
+          dns_cache_config: *dns_cache_config
+    transport_socket: *base_transport_socket
+    upstream_connection_options: *upstream_opts
+    circuit_breakers: *circuit_breakers_settings
+  - name: base_early_data
     connect_timeout: {{ connect_timeout_seconds }}s
     lb_policy: CLUSTER_PROVIDED
     cluster_type:
@@ -146,11 +220,24 @@ static_resources:
       typed_config:
         "@type": type.googleapis.com/envoy.extensions.clusters.dynamic_forward_proxy.v3.ClusterConfig
         dns_cache_config: *dns_cache_config
-    transport_socket: *base_transport_socket
+    # Idempotent requests are sent as TLS 1.3 early data on connections which resume a session,
+    # once enable_early_data is called. Only they are routed to the early data clusters.
+    transport_socket: &early_data_transport_socket
+      name: envoy.transport_sockets.tls
+      typed_config:
+        "@type": type.googleapis.com/envoy.extensions.transport_sockets.tls.v3.UpstreamTlsContext
+        common_tls_context:
+          custom_handshaker:
+            name: envoy_mobile.tls.handshaker.cert_verifier
+            typed_config:
+              "@type": type.googleapis.com/envoymobile.extensions.tls.cert_verifier.CertVerifier
+              async_verification: true
+              enable_early_data: true
+          validation_context:
+            trusted_ca: *trusted_ca
     upstream_connection_options: *upstream_opts
     circuit_breakers: *circuit_breakers_settings
-  - name: base_wlan_h2
-    http2_protocol_options: {}
+  - name: base_wlan_early_data
     connect_timeout: {{ connect_timeout_seconds }}s
     lb_policy: CLUSTER_PROVIDED
     cluster_type:
@@ -158,11 +245,10 @@ static_resources:
       typed_config:
         "@type": type.googleapis.com/envoy.extensions.clusters.dynamic_forward_proxy.v3.ClusterConfig
         dns_cache_config: *dns_cache_config
-    transport_socket: *base_transport_socket
+    transport_socket: *early_data_transport_socket
     upstream_connection_options: *upstream_opts
     circuit_breakers: *circuit_breakers_settings
-  - name: base_wwan_h2
-    http2_protocol_options: {}
+  - name: base_wwan_early_data
     connect_timeout: {{ connect_timeout_seconds }}s
     lb_policy: CLUSTER_PROVIDED
     cluster_type:
@@ -170,7 +256,55 @@ static_resources:
       typed_config:
         "@type": type.googleapis.com/envoy.extensions.clusters.dynamic_forward_proxy.v3.ClusterConfig
         dns_cache_config: *dns_cache_config
-    transport_socket: *base_transport_socket
+    transport_socket: *early_data_transport_socket
+    upstream_connection_options: *upstream_opts
+    circuit_breakers: *circuit_breakers_settings
+  - name: base_h2_early_data
+    http2_protocol_options:
+      # Carries upgrades, e.g. to WebSockets, as extended CONNECT requests.
+      allow_connect: true
+    connect_timeout: {{ connect_timeout_seconds }}s
+    lb_policy: CLUSTER_PROVIDED
+    cluster_type:
+      # Coalesces requests for names which share a connection's address and certificate.
+      name: envoy_mobile.clusters.coalescing
+      typed_config:
+        "@type": type.googleapis.com/envoymobile.extensions.clusters.coalescing.Coalescing
+        dynamic_forward_proxy:
+          dns_cache_config: *dns_cache_config
+    transport_socket: *early_data_transport_socket
+    upstream_connection_options: *upstream_opts
+    circuit_breakers: *circuit_breakers_settings
+  - name: base_wlan_h2_early_data
+    http2_protocol_options:
+      # Carries upgrades, e.g. to WebSockets, as extended CONNECT requests.
+      allow_connect: true
+    connect_timeout: {{ connect_timeout_seconds }}s
+    lb_policy: CLUSTER_PROVIDED
+    cluster_type:
+      # Coalesces requests for names which share a connection's address and certificate.
+      name: envoy_mobile.clusters.coalescing
+      typed_config:
+        "@type": type.googleapis.com/envoymobile.extensions.clusters.coalescing.Coalescing
+        dynamic_forward_proxy:
+          dns_cache_config: *dns_cache_config
+    transport_socket: *early_data_transport_socket
+    upstream_connection_options: *upstream_opts
+    circuit_breakers: *circuit_breakers_settings
+  - name: base_wwan_h2_early_data
+    http2_protocol_options:
+      # Carries upgrades, e.g. to WebSockets, as extended CONNECT requests.
+      allow_connect: true
+    connect_timeout: {{ connect_timeout_seconds }}s
+    lb_policy: CLUSTER_PROVIDED
+    cluster_type:
+      # Coalesces requests for names which share a connection's address and certificate.
+      name: envoy_mobile.clusters.coalescing
+      typed_config:
+        "@type": type.googleapis.com/envoymobile.extensions.clusters.coalescing.Coalescing
+        dynamic_forward_proxy:
+          dns_cache_config: *dns_cache_config
+    transport_socket: *early_data_transport_socket
     upstream_connection_options: *upstream_opts
     circuit_breakers: *circuit_breakers_settings
   - name: stats
@@ -212,6 +346,9 @@ stats_config:
         - safe_regex:
             google_re2: {}
             regex: '^client.*'
+        - safe_regex:
+            google_re2: {}
+            regex: '^cert_verifier.*'
         - safe_regex:
             google_re2: {}
             regex: '^http.hcm.decompressor.*'
@@ -229,6 +366,25 @@ node:
     app_id : {{ app_id }}
     app_version : {{ app_version }}
     os: {{ device_os }}
+overload_manager:
+  # Every refresh wakes the engine, so pressure is only refreshed every few seconds.
+  refresh_interval: 10s
+  resource_monitors:
+    - name: envoy_mobile.resource_monitors.device_memory
+      typed_config:
+        "@type": type.googleapis.com/envoymobile.extensions.resource_monitors.device_memory.DeviceMemory
+        max_heap_size_bytes: 268435456
+  actions:
+    - name: envoy.overload_actions.shrink_heap
+      triggers:
+        - name: envoy_mobile.resource_monitors.device_memory
+          threshold:
+            value: 0.8
+    - name: envoy.overload_actions.stop_accepting_requests
+      triggers:
+        - name: envoy_mobile.resource_monitors.device_memory
+          threshold:
+            value: 0.95
 # Needed due to warning in https://github.com/envoyproxy/envoy/blob/6eb7e642d33f5a55b63c367188f09819925fca34/source/server/server.cc#L546
 layered_runtime:
   layers:
@@ -236,4 +392,7 @@ layered_runtime:
       static_layer:
         overload:
           global_downstream_max_connections: 50000
+    # Receives runtime values from configuration updates.
+    - name: admin_layer_0
+      admin_layer: {}
 )";
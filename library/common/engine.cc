@@ -1,16 +1,170 @@
 #include "library/common/engine.h"
 
+#include <algorithm>
+#include <unordered_map>
+
 #include "common/common/lock_guard.h"
+#include "common/common/logger.h"
+#include "common/protobuf/protobuf.h"
+#include "common/protobuf/utility.h"
+
+#include "absl/strings/str_cat.h"
+#include "library/common/stats/bridge_copy_stats.h"
+#include "library/common/thread/timer_slack.h"
 
 namespace Envoy {
 
+namespace {
+
+// Clusters which are added once the server has started, rather than statically, so that they can
+// be updated in place. Static clusters cannot be modified or removed after startup.
+bool isDynamicCluster(const envoy::config::cluster::v3::Cluster& cluster) {
+  if (!cluster.has_cluster_type()) {
+    return false;
+  }
+  // Coalescing clusters are dynamic forward proxy clusters too.
+  const std::string& type = cluster.cluster_type().name();
+  return type == "envoy.clusters.dynamic_forward_proxy" ||
+         type == "envoy_mobile.clusters.coalescing";
+}
+
+// Removes dynamic clusters from the static configuration, returning them.
+std::vector<envoy::config::cluster::v3::Cluster>
+extractDynamicClusters(envoy::config::bootstrap::v3::Bootstrap& bootstrap) {
+  std::vector<envoy::config::cluster::v3::Cluster> dynamic_clusters;
+  auto* clusters = bootstrap.mutable_static_resources()->mutable_clusters();
+  for (auto it = clusters->begin(); it != clusters->end();) {
+    if (isDynamicCluster(*it)) {
+      dynamic_clusters.push_back(*it);
+      it = clusters->erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return dynamic_clusters;
+}
+
+using RuntimeValues = std::unordered_map<std::string, std::string>;
+
+void flattenRuntimeValue(const ProtobufWkt::Value& value, const std::string& key,
+                         RuntimeValues& values) {
+  switch (value.kind_case()) {
+  case ProtobufWkt::Value::kStructValue:
+    for (const auto& field : value.struct_value().fields()) {
+      flattenRuntimeValue(field.second,
+                          key.empty() ? field.first : absl::StrCat(key, ".", field.first), values);
+    }
+    break;
+  case ProtobufWkt::Value::kNumberValue:
+    values[key] = absl::StrCat(value.number_value());
+    break;
+  case ProtobufWkt::Value::kBoolValue:
+    values[key] = value.bool_value() ? "true" : "false";
+    break;
+  case ProtobufWkt::Value::kStringValue:
+    values[key] = value.string_value();
+    break;
+  default:
+    break;
+  }
+}
+
+// Flattens the static runtime layers of a configuration to the values they define, with later
+// layers taking precedence.
+RuntimeValues staticRuntimeValues(const envoy::config::bootstrap::v3::Bootstrap& bootstrap) {
+  RuntimeValues values;
+  for (const auto& layer : bootstrap.layered_runtime().layers()) {
+    if (layer.has_static_layer()) {
+      flattenRuntimeValue(ValueUtil::structValue(layer.static_layer()), "", values);
+    }
+  }
+  return values;
+}
+
+// @return whether the configurations differ only in their dynamic clusters and runtime.
+bool updatableInPlace(const envoy::config::bootstrap::v3::Bootstrap& running,
+                      const envoy::config::bootstrap::v3::Bootstrap& updated) {
+  envoy::config::bootstrap::v3::Bootstrap running_remainder = running;
+  envoy::config::bootstrap::v3::Bootstrap updated_remainder = updated;
+  extractDynamicClusters(running_remainder);
+  extractDynamicClusters(updated_remainder);
+  running_remainder.clear_layered_runtime();
+  updated_remainder.clear_layered_runtime();
+  return Protobuf::util::MessageDifferencer::Equivalent(running_remainder, updated_remainder);
+}
+
+// Replaces the cluster of the same name in a configuration, or adds it if there is none.
+void setCluster(envoy::config::bootstrap::v3::Bootstrap& bootstrap,
+                const envoy::config::cluster::v3::Cluster& cluster) {
+  auto* clusters = bootstrap.mutable_static_resources()->mutable_clusters();
+  for (auto& existing : *clusters) {
+    if (existing.name() == cluster.name()) {
+      existing = cluster;
+      return;
+    }
+  }
+  *clusters->Add() = cluster;
+}
+
+// Removes the cluster with the name from a configuration.
+void removeCluster(envoy::config::bootstrap::v3::Bootstrap& bootstrap, const std::string& name) {
+  auto* clusters = bootstrap.mutable_static_resources()->mutable_clusters();
+  for (auto it = clusters->begin(); it != clusters->end(); ++it) {
+    if (it->name() == name) {
+      clusters->erase(it);
+      return;
+    }
+  }
+}
+
+// The clusters the HTTP dispatcher routes streams to, one for each preferred network.
+constexpr const char* BaseClusters[] = {"base", "base_wlan", "base_wwan"};
+
+// @return whether the configuration defines the variants of all base clusters with each of the
+// suffixes, e.g. base_h3, base_wlan_h3 and base_wwan_h3 for "_h3".
+bool definesBaseClusterVariants(const envoy::config::bootstrap::v3::Bootstrap& bootstrap,
+                                const std::vector<std::string>& suffixes) {
+  const auto& clusters = bootstrap.static_resources().clusters();
+  for (const std::string& suffix : suffixes) {
+    for (const char* base_cluster : BaseClusters) {
+      const std::string name = absl::StrCat(base_cluster, suffix);
+      if (std::none_of(clusters.begin(), clusters.end(),
+                       [&name](const envoy::config::cluster::v3::Cluster& cluster) {
+                         return cluster.name() == name;
+                       })) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Set on every engine's thread.
+thread_local bool engine_thread = false;
+
+} // namespace
+
 Engine::Engine(envoy_engine_callbacks callbacks, const char* config, const char* log_level,
-               std::atomic<envoy_network_t>& preferred_network)
-    : callbacks_(callbacks) {
-  // Ensure static factory registration occurs on time.
-  // TODO: ensure this is only called one time once multiple Engine objects can be allocated.
-  // https://github.com/lyft/envoy-mobile/issues/332
-  ExtensionRegistry::registerFactories();
+               std::atomic<envoy_network_t>& preferred_network,
+               const Api::External::Registry* api_registry)
+    : callbacks_(callbacks), api_registry_(api_registry) {
+  start(config, log_level, preferred_network);
+}
+
+Engine::Engine(envoy_engine_callbacks callbacks, BootstrapPtr bootstrap, const char* log_level,
+               std::atomic<envoy_network_t>& preferred_network,
+               Event::TimeSystem* time_system, const Api::External::Registry* api_registry)
+    : callbacks_(callbacks), bootstrap_(std::move(bootstrap)), time_system_(time_system),
+      api_registry_(api_registry) {
+  start("", log_level, preferred_network);
+}
+
+void Engine::start(std::string config, std::string log_level,
+                   std::atomic<envoy_network_t>& preferred_network) {
+  // Ensure static factory registration occurs on time. Factories are registered for the whole
+  // process, so only the first engine registers them.
+  static absl::once_flag register_factories;
+  absl::call_once(register_factories, []() -> void { ExtensionRegistry::registerFactories(); });
 
   // Create the Http::Dispatcher first since it contains initial queueing logic.
   // TODO: consider centralizing initial queueing in this class.
@@ -18,20 +172,35 @@ Engine::Engine(envoy_engine_callbacks callbacks, const char* config, const char*
   http_dispatcher_ = std::make_unique<Http::Dispatcher>(preferred_network);
 
   // Start the Envoy on a dedicated thread.
-  main_thread_ = std::thread(&Engine::run, this, std::string(config), std::string(log_level));
+  main_thread_ = std::thread(&Engine::run, this, std::move(config), std::move(log_level));
 }
 
 envoy_status_t Engine::run(const std::string config, const std::string log_level) {
+  engine_thread = true;
+  // Platform filters are retrieved from the engine's registry as the configuration is loaded.
+  Api::External::setThreadRegistry(api_registry_);
   {
     Thread::LockGuard lock(mutex_);
     try {
       const std::string name = "envoy";
-      const std::string config_flag = "--config-yaml";
       const std::string log_flag = "-l";
-      const char* envoy_argv[] = {name.c_str(),     config_flag.c_str(), config.c_str(),
-                                  log_flag.c_str(), log_level.c_str(),   nullptr};
-
-      main_common_ = std::make_unique<MobileMainCommon>(5, envoy_argv);
+      // The configuration is parsed here rather than by Envoy, so that the engine can hold back
+      // dynamic clusters and keep a copy to compute configuration updates against.
+      if (bootstrap_ == nullptr) {
+        bootstrap_ = std::make_unique<envoy::config::bootstrap::v3::Bootstrap>();
+        MessageUtil::loadFromYaml(config, *bootstrap_,
+                                  ProtobufMessage::getStrictValidationVisitor());
+      }
+      {
+        Thread::LockGuard config_lock(config_mutex_);
+        accepted_config_ =
+            std::make_shared<const envoy::config::bootstrap::v3::Bootstrap>(*bootstrap_);
+      }
+      running_config_ = std::make_unique<envoy::config::bootstrap::v3::Bootstrap>(*bootstrap_);
+      dynamic_clusters_ = extractDynamicClusters(*bootstrap_);
+      const char* envoy_argv[] = {name.c_str(), log_flag.c_str(), log_level.c_str(), nullptr};
+      main_common_ =
+          std::make_unique<MobileMainCommon>(3, envoy_argv, bootstrap_.get(), time_system_);
       event_dispatcher_ = &main_common_->server()->dispatcher();
       cv_.notifyAll();
     } catch (const Envoy::NoServingException& e) {
@@ -54,11 +223,23 @@ envoy_status_t Engine::run(const std::string config, const std::string log_level
     postinit_callback_handler_ = main_common_->server()->lifecycleNotifier().registerCallback(
         Envoy::Server::ServerLifecycleNotifier::Stage::PostInit, [this]() -> void {
           server_ = TS_UNCHECKED_READ(main_common_)->server();
+          for (const auto& cluster : dynamic_clusters_) {
+            try {
+              server_->clusterManager().addOrUpdateCluster(cluster, "");
+            } catch (const Envoy::EnvoyException& e) {
+              std::cerr << e.what() << std::endl;
+            }
+          }
+          dynamic_clusters_.clear();
           client_scope_ = server_->serverFactoryContext().scope().createScope("client.");
           auto api_listener = server_->listenerManager().apiListener()->get().http();
           ASSERT(api_listener.has_value());
+          http_dispatcher_->setIdleCallback([this](bool idle) -> void { onIdle(idle); });
           http_dispatcher_->ready(server_->dispatcher(), server_->serverFactoryContext().scope(),
                                   api_listener.value());
+          applyThreadOptions();
+          // Streams queued before the engine started are opened on a later loop iteration.
+          onIdle(true);
           if (callbacks_.on_engine_running != nullptr) {
             callbacks_.on_engine_running(callbacks_.context);
           }
@@ -69,6 +250,12 @@ envoy_status_t Engine::run(const std::string config, const std::string log_level
   bool run_success = TS_UNCHECKED_READ(main_common_)->run();
   // The above call is blocking; at this point the event loop has exited.
 
+  // Background work for streams posts to the event loop, which is destroyed with the server.
+  http_dispatcher_->terminate();
+
+  // Copies made while the server is destroyed aren't charged to its counters.
+  Stats::BridgeCopyStats::clearThreadCounters();
+
   // Ensure destructors run on Envoy's main thread.
   postinit_callback_handler_.reset(nullptr);
   client_scope_.reset(nullptr);
@@ -154,6 +341,231 @@ envoy_status_t Engine::recordGaugeSub(const std::string& elements, uint64_t amou
   return ENVOY_FAILURE;
 }
 
+envoy_status_t Engine::updateConfig(const std::string& config) {
+  auto bootstrap = std::make_unique<envoy::config::bootstrap::v3::Bootstrap>();
+  try {
+    MessageUtil::loadFromYaml(config, *bootstrap, ProtobufMessage::getStrictValidationVisitor());
+    MessageUtil::validate(*bootstrap, ProtobufMessage::getStrictValidationVisitor());
+  } catch (const Envoy::EnvoyException& e) {
+    std::cerr << e.what() << std::endl;
+    return ENVOY_FAILURE;
+  }
+  return updateConfig(std::move(bootstrap));
+}
+
+envoy_status_t Engine::updateConfig(BootstrapPtr bootstrap) {
+  if (!server_) {
+    return ENVOY_FAILURE;
+  }
+
+  std::shared_ptr<const envoy::config::bootstrap::v3::Bootstrap> update = std::move(bootstrap);
+  std::string version;
+  {
+    Thread::LockGuard lock(config_mutex_);
+    if (!updatableInPlace(*accepted_config_, *update) ||
+        !definesBaseClusterVariants(*update, required_cluster_suffixes_)) {
+      return ENVOY_FAILURE;
+    }
+    accepted_config_ = update;
+    version = absl::StrCat(++config_version_);
+  }
+
+  // Updates are applied in the order they are accepted, each as changes to what the server runs
+  // with once the previous one has been applied.
+  server_->dispatcher().post([this, update, version]() -> void {
+    if (applyConfig(*update, version)) {
+      return;
+    }
+    ENVOY_LOG_MISC(error, "configuration update {} was only partially applied", version);
+    Thread::LockGuard lock(config_mutex_);
+    // Unless a later update has been accepted since, later updates are checked against what the
+    // server actually runs with.
+    if (accepted_config_ == update) {
+      accepted_config_ =
+          std::make_shared<const envoy::config::bootstrap::v3::Bootstrap>(*running_config_);
+    }
+  });
+  return ENVOY_SUCCESS;
+}
+
+bool Engine::applyConfig(const envoy::config::bootstrap::v3::Bootstrap& bootstrap,
+                         const std::string& version) {
+  // Only clusters whose configuration changed are passed on, so that the others, along with their
+  // connection pools, are left untouched.
+  std::vector<envoy::config::cluster::v3::Cluster> updated_clusters;
+  std::vector<std::string> removed_clusters;
+  for (const auto& cluster : running_config_->static_resources().clusters()) {
+    if (isDynamicCluster(cluster)) {
+      removed_clusters.push_back(cluster.name());
+    }
+  }
+  for (const auto& cluster : bootstrap.static_resources().clusters()) {
+    if (!isDynamicCluster(cluster)) {
+      continue;
+    }
+    removed_clusters.erase(
+        std::remove(removed_clusters.begin(), removed_clusters.end(), cluster.name()),
+        removed_clusters.end());
+    const auto& running_clusters = running_config_->static_resources().clusters();
+    const bool unchanged = std::any_of(
+        running_clusters.begin(), running_clusters.end(),
+        [&cluster](const envoy::config::cluster::v3::Cluster& running_cluster) {
+          return Protobuf::util::MessageDifferencer::Equivalent(running_cluster, cluster);
+        });
+    if (!unchanged) {
+      updated_clusters.push_back(cluster);
+    }
+  }
+
+  // Values which are no longer set are cleared from the admin layer, which restores any value the
+  // static layers of the original configuration define.
+  RuntimeValues runtime_values;
+  const RuntimeValues running_values = staticRuntimeValues(*running_config_);
+  const RuntimeValues updated_values = staticRuntimeValues(bootstrap);
+  for (const auto& value : updated_values) {
+    auto running_value = running_values.find(value.first);
+    if (running_value == running_values.end() || running_value->second != value.second) {
+      runtime_values.insert(value);
+    }
+  }
+  for (const auto& value : running_values) {
+    if (updated_values.find(value.first) == updated_values.end()) {
+      runtime_values.emplace(value.first, "");
+    }
+  }
+
+  bool applied = true;
+  for (const auto& cluster : updated_clusters) {
+    try {
+      // The cluster manager only declines clusters it already runs with the same configuration,
+      // which running_config_ rules out, and clusters it can't update.
+      if (server_->clusterManager().addOrUpdateCluster(cluster, version)) {
+        setCluster(*running_config_, cluster);
+        continue;
+      }
+      ENVOY_LOG_MISC(error, "cluster {} was not updated", cluster.name());
+    } catch (const Envoy::EnvoyException& e) {
+      ENVOY_LOG_MISC(error, "cluster {} was not updated: {}", cluster.name(), e.what());
+    }
+    applied = false;
+  }
+  for (const auto& name : removed_clusters) {
+    if (server_->clusterManager().removeCluster(name)) {
+      removeCluster(*running_config_, name);
+      continue;
+    }
+    ENVOY_LOG_MISC(error, "cluster {} was not removed", name);
+    applied = false;
+  }
+  if (!runtime_values.empty()) {
+    try {
+      server_->runtime().mergeValues(runtime_values);
+      *running_config_->mutable_layered_runtime() = bootstrap.layered_runtime();
+    } catch (const Envoy::EnvoyException& e) {
+      ENVOY_LOG_MISC(error, "runtime values were not updated: {}", e.what());
+      applied = false;
+    }
+  }
+
+  if (applied) {
+    *running_config_ = bootstrap;
+  }
+  return applied;
+}
+
+envoy_status_t Engine::enableHttp3Upstream(const std::string& alt_svc_cache_path) {
+  {
+    Thread::LockGuard lock(config_mutex_);
+    if (accepted_config_ == nullptr || !definesBaseClusterVariants(*accepted_config_, {"_h3"})) {
+      return ENVOY_FAILURE;
+    }
+    required_cluster_suffixes_.push_back("_h3");
+  }
+  return http_dispatcher_->enableHttp3Upstream(alt_svc_cache_path);
+}
+
+envoy_status_t Engine::enableEarlyData() {
+  {
+    Thread::LockGuard lock(config_mutex_);
+    if (accepted_config_ == nullptr ||
+        !definesBaseClusterVariants(*accepted_config_, {"_early_data", "_h2_early_data"})) {
+      return ENVOY_FAILURE;
+    }
+    required_cluster_suffixes_.push_back("_early_data");
+    required_cluster_suffixes_.push_back("_h2_early_data");
+  }
+  return http_dispatcher_->enableEarlyData();
+}
+
+envoy_status_t Engine::setIdleTimerSlack(std::chrono::milliseconds slack) {
+  idle_timer_slack_ms_ = slack.count();
+  // Applied now if the engine is idle, and otherwise the next time it becomes idle. If the engine
+  // is not running yet, it is applied once it is.
+  post([this]() -> void {
+    if (idle_) {
+      onIdle(true);
+    }
+  });
+  return ENVOY_SUCCESS;
+}
+
+void Engine::onIdle(bool idle) {
+  idle_ = idle;
+  // Timers are expired promptly while streams are open. A zero slack restores the default.
+  const std::chrono::milliseconds idle_slack(idle_timer_slack_ms_.load());
+  Thread::setTimerSlack(idle ? idle_slack : std::chrono::nanoseconds(0));
+}
+
+envoy_status_t Engine::setThreadPriority(int nice) {
+  if (nice < -20 || nice > 19) {
+    return ENVOY_FAILURE;
+  }
+  {
+    Thread::LockGuard lock(thread_options_mutex_);
+    thread_nice_ = nice;
+  }
+  // If the engine is not running yet, the options are applied once it is.
+  post([this]() -> void { applyThreadOptions(); });
+  return ENVOY_SUCCESS;
+}
+
+envoy_status_t Engine::setThreadAffinity(Thread::CoreClass core_class) {
+  {
+    Thread::LockGuard lock(thread_options_mutex_);
+    thread_core_class_ = core_class;
+  }
+  // If the engine is not running yet, the options are applied once it is.
+  post([this]() -> void { applyThreadOptions(); });
+  return ENVOY_SUCCESS;
+}
+
+void Engine::applyThreadOptions() {
+  absl::optional<int> nice;
+  absl::optional<Thread::CoreClass> core_class;
+  {
+    Thread::LockGuard lock(thread_options_mutex_);
+    nice = thread_nice_;
+    core_class = thread_core_class_;
+  }
+  if (nice.has_value() && !Thread::setNiceValue(nice.value())) {
+    std::cerr << "failed to set the engine thread's nice value to " << nice.value() << std::endl;
+  }
+  if (core_class.has_value() &&
+      !Thread::setCpuAffinity(Thread::cpusOfClass(core_class.value()))) {
+    std::cerr << "failed to set the engine thread's CPU affinity" << std::endl;
+  }
+}
+
+bool Engine::onEngineThread() { return engine_thread; }
+
 Http::Dispatcher& Engine::httpDispatcher() { return *http_dispatcher_; }
 
+envoy_status_t Engine::post(Event::PostCb callback) {
+  if (!server_) {
+    return ENVOY_FAILURE;
+  }
+  server_->dispatcher().post(std::move(callback));
+  return ENVOY_SUCCESS;
+}
+
 } // namespace Envoy
@@ -1,13 +1,23 @@
 #pragma once
 
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/config/cluster/v3/cluster.pb.h"
 #include "envoy/server/lifecycle_notifier.h"
 
 #include "common/upstream/logical_dns_cluster.h"
 
 #include "absl/base/call_once.h"
+#include "absl/types/optional.h"
 #include "extension_registry.h"
+#include "library/common/api/external.h"
+#include "library/common/bootstrap_builder.h"
 #include "library/common/envoy_mobile_main_common.h"
 #include "library/common/http/dispatcher.h"
+#include "library/common/thread/scheduling.h"
 #include "library/common/types/c_types.h"
 
 namespace Envoy {
@@ -20,21 +30,54 @@ public:
    * @param config, the Envoy configuration to use when starting the instance.
    * @param log_level, the log level with which to configure the engine.
    * @param preferred_network, hook to obtain the preferred network for new streams.
+   * @param api_registry, if not null, external APIs registered for this engine, which are
+   *        retrieved ahead of those registered for the process. It must outlive the engine.
    */
   Engine(envoy_engine_callbacks callbacks, const char* config, const char* log_level,
-         std::atomic<envoy_network_t>& preferred_network);
+         std::atomic<envoy_network_t>& preferred_network,
+         const Api::External::Registry* api_registry = nullptr);
+
+  /**
+   * Constructor for a new engine instance configured with a typed Bootstrap.
+   * @param callbacks, the callbacks to use for engine lifecycle monitoring.
+   * @param bootstrap, the Envoy configuration to use when starting the instance.
+   * @param log_level, the log level with which to configure the engine.
+   * @param preferred_network, hook to obtain the preferred network for new streams.
+   * @param time_system, if not null, the time system to run with in place of real time, e.g. a
+   *        simulated time system in tests. It must outlive the engine.
+   * @param api_registry, if not null, external APIs registered for this engine, which are
+   *        retrieved ahead of those registered for the process. It must outlive the engine.
+   */
+  Engine(envoy_engine_callbacks callbacks, BootstrapPtr bootstrap, const char* log_level,
+         std::atomic<envoy_network_t>& preferred_network,
+         Event::TimeSystem* time_system = nullptr,
+         const Api::External::Registry* api_registry = nullptr);
 
   /**
    * Engine destructor.
    */
   ~Engine();
 
+  /**
+   * @return bool whether the calling thread is the thread of an engine, which engine callbacks
+   *         are called on. An engine must not be destroyed on its own thread, as its destructor
+   *         waits for the thread to exit.
+   */
+  static bool onEngineThread();
+
   /**
    * Accessor for the http dispatcher.
    * @return Http::Dispatcher&, the dispatcher being used by the engine.
    */
   Http::Dispatcher& httpDispatcher();
 
+  /**
+   * Run a functor on the engine's event loop. This is safe cross thread.
+   * @param callback, the functor to run.
+   * @return envoy_status_t, ENVOY_FAILURE if the engine is not running yet.
+   */
+  envoy_status_t post(Event::PostCb callback);
+
   /**
    * Increment a counter with a given string of elements and by the given count.
    * @param elements, joined elements of the timeseries.
@@ -63,11 +106,120 @@ public:
    */
   envoy_status_t recordGaugeSub(const std::string& elements, uint64_t amount);
 
+  /**
+   * Update the configuration of the running engine in place. Clusters Envoy Mobile routes streams
+   * to (dynamic forward proxy clusters, coalescing or not) are added, updated and removed;
+   * clusters whose configuration is unchanged keep their connection pools. Runtime values are
+   * overlaid through the runtime's admin layer. Any other change, including to the API listener's
+   * routes and filters, requires a new engine and is rejected.
+   * @param config, the complete Envoy configuration to run with from now on.
+   * @return envoy_status_t, whether the update was accepted. It is applied asynchronously. Changes
+   *         which fail to apply are logged, and left out of the configuration later updates are
+   *         computed against.
+   */
+  envoy_status_t updateConfig(const std::string& config);
+
+  /**
+   * Update the configuration of the running engine in place, @see updateConfig(config).
+   * @param bootstrap, the complete Envoy configuration to run with from now on.
+   * @return envoy_status_t, whether the update was accepted. It is applied asynchronously.
+   */
+  envoy_status_t updateConfig(BootstrapPtr bootstrap);
+
+  /**
+   * Send requests over HTTP/3 to origins which advertise it, @see
+   * Http::Dispatcher::enableHttp3Upstream. Requests are routed to the HTTP/3 variants of the base
+   * clusters (base_h3, base_wlan_h3 and base_wwan_h3), which the configuration must define. They
+   * can only be defined when Envoy is built with QUIC support, and the default configuration does
+   * not define them. Once HTTP/3 is enabled, configuration updates which remove them are rejected.
+   * @param alt_svc_cache_path, a writable file to persist advertised services to, or empty.
+   * @return envoy_status_t, ENVOY_FAILURE if the configuration does not define the clusters.
+   */
+  envoy_status_t enableHttp3Upstream(const std::string& alt_svc_cache_path);
+
+  /**
+   * Send idempotent requests as TLS 1.3 early data, @see Http::Dispatcher::enableEarlyData. They
+   * are routed to the early data variants of the base clusters (e.g. base_early_data and
+   * base_wlan_h2_early_data), which the configuration must define, as the default configuration
+   * does. Once early data is enabled, configuration updates which remove them are rejected.
+   * @return envoy_status_t, ENVOY_FAILURE if the configuration does not define the clusters.
+   */
+  envoy_status_t enableEarlyData();
+
+  /**
+   * Set the timer slack of the engine's thread while it has no open streams. A larger slack lets
+   * the kernel coalesce the engine's periodic wakeups (e.g. stats flushes and DNS refreshes) with
+   * each other and with other wakeups on the device. Only supported on Linux, including Android.
+   * @param slack, the timer slack to use while idle. Zero disables the idle timer slack.
+   * @return envoy_status_t, the resulting status of the operation.
+   */
+  envoy_status_t setIdleTimerSlack(std::chrono::milliseconds slack);
+
+  /**
+   * Set the nice value of the engine's thread, e.g. to keep the network loop from being starved
+   * by rendering while the app is busy, or to yield to it, @see Thread::setNiceValue.
+   * @param nice, the nice value, from -20 (highest priority) to 19 (lowest priority).
+   * @return envoy_status_t, whether the nice value is valid. It is applied asynchronously, once the
+   *         engine is running.
+   */
+  envoy_status_t setThreadPriority(int nice);
+
+  /**
+   * Restrict the engine's thread to a class of the device's cores. Only supported on Linux,
+   * including Android.
+   * @param core_class, the class of cores to run on.
+   * @return envoy_status_t, the resulting status of the operation. The affinity is applied
+   *         asynchronously, once the engine is running.
+   */
+  envoy_status_t setThreadAffinity(Thread::CoreClass core_class);
+
+  // Used for testing. Only to be used on the engine's event loop, once the engine is running.
+  Server::Instance& server() { return *server_; }
+
 private:
+  void onIdle(bool idle);
+  // Applies the configured scheduling options to the calling thread, i.e. the engine's thread.
+  void applyThreadOptions();
+  void start(std::string config, std::string log_level,
+             std::atomic<envoy_network_t>& preferred_network);
   envoy_status_t run(std::string config, std::string log_level);
+  // Applies the changes from running_config_ to a configuration on the engine's thread, recording
+  // each change which succeeds in running_config_.
+  // @return bool whether all changes were applied.
+  bool applyConfig(const envoy::config::bootstrap::v3::Bootstrap& bootstrap,
+                   const std::string& version);
 
   Stats::ScopePtr client_scope_;
   envoy_engine_callbacks callbacks_;
+  // If set, the configuration to run with in place of YAML.
+  BootstrapPtr bootstrap_;
+  // If set, the time system to run with in place of real time.
+  Event::TimeSystem* const time_system_{};
+  // If set, external APIs registered for this engine.
+  const Api::External::Registry* const api_registry_{};
+  // Clusters held back from the static configuration and added once the server has started, so
+  // that they can be updated in place.
+  std::vector<envoy::config::cluster::v3::Cluster> dynamic_clusters_;
+  Thread::MutexBasicLockable config_mutex_;
+  // The most recently accepted configuration, which updates are checked against. It may not have
+  // been applied yet.
+  std::shared_ptr<const envoy::config::bootstrap::v3::Bootstrap>
+      accepted_config_ GUARDED_BY(config_mutex_);
+  uint64_t config_version_ GUARDED_BY(config_mutex_){};
+  // Only accessed on the engine's thread. The configuration the server runs with, which updates are
+  // applied as changes to.
+  BootstrapPtr running_config_;
+  // Suffixes of the base cluster variants which enabled features route streams to, and which
+  // configuration updates must therefore keep.
+  std::vector<std::string> required_cluster_suffixes_ GUARDED_BY(config_mutex_);
+  std::atomic<uint64_t> idle_timer_slack_ms_{1000};
+  // Only accessed on the engine's thread. Whether the engine has no open streams, @see onIdle.
+  bool idle_{};
+  // The engine thread's scheduling options, if set. Otherwise the thread keeps the defaults it was
+  // started with.
+  Thread::MutexBasicLockable thread_options_mutex_;
+  absl::optional<int> thread_nice_ GUARDED_BY(thread_options_mutex_);
+  absl::optional<Thread::CoreClass> thread_core_class_ GUARDED_BY(thread_options_mutex_);
   Thread::MutexBasicLockable mutex_;
   Thread::CondVar cv_;
   std::unique_ptr<Http::Dispatcher> http_dispatcher_;
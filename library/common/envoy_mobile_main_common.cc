@@ -5,9 +5,13 @@
 
 namespace Envoy {
 
-MobileMainCommon::MobileMainCommon(int argc, const char* const* argv)
+MobileMainCommon::MobileMainCommon(int argc, const char* const* argv,
+                                   const envoy::config::bootstrap::v3::Bootstrap* bootstrap,
+                                   Event::TimeSystem* time_system)
     : options_(argc, argv, &MainCommon::hotRestartVersion, spdlog::level::info),
-      base_(options_, real_time_system_, default_listener_hooks_, prod_component_factory_,
+      config_proto_applied_(applyConfigProto(bootstrap)),
+      base_(options_, time_system != nullptr ? *time_system : real_time_system_,
+            default_listener_hooks_, prod_component_factory_,
             std::make_unique<Random::RandomGeneratorImpl>(), platform_impl_.threadFactory(),
             platform_impl_.fileSystem(), nullptr) {
   // Disabling signal handling in the options makes it so that the server's event dispatcher _does
@@ -20,4 +24,12 @@ MobileMainCommon::MobileMainCommon(int argc, const char* const* argv)
   options_.setSignalHandling(false);
 }
 
+bool MobileMainCommon::applyConfigProto(const envoy::config::bootstrap::v3::Bootstrap* bootstrap) {
+  if (bootstrap == nullptr) {
+    return false;
+  }
+  options_.setConfigProto(*bootstrap);
+  return true;
+}
+
 } // namespace Envoy
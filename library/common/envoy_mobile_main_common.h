@@ -1,5 +1,6 @@
 #pragma once
 
+#include "envoy/config/bootstrap/v3/bootstrap.pb.h"
 #include "envoy/event/timer.h"
 #include "envoy/server/instance.h"
 
@@ -19,7 +20,17 @@ namespace Envoy {
  */
 class MobileMainCommon {
 public:
-  MobileMainCommon(int argc, const char* const* argv);
+  /**
+   * @param argc, the number of command line arguments.
+   * @param argv, the command line arguments.
+   * @param bootstrap, if not null, typed configuration to run with, which avoids passing and
+   *        parsing configuration on the command line.
+   * @param time_system, if not null, the time system to run with in place of real time, e.g. a
+   *        simulated time system in tests. It must outlive this object.
+   */
+  MobileMainCommon(int argc, const char* const* argv,
+                   const envoy::config::bootstrap::v3::Bootstrap* bootstrap = nullptr,
+                   Event::TimeSystem* time_system = nullptr);
   bool run() { return base_.run(); }
 
   /**
@@ -29,8 +40,12 @@ public:
   Server::Instance* server() { return base_.server(); }
 
 private:
+  bool applyConfigProto(const envoy::config::bootstrap::v3::Bootstrap* bootstrap);
+
   PlatformImpl platform_impl_;
   Envoy::OptionsImpl options_;
+  // The typed configuration must be applied to options_ before base_ creates the server.
+  const bool config_proto_applied_;
   Event::RealTimeSystem real_time_system_; // NO_CHECK_FORMAT(real_time)
   DefaultListenerHooks default_listener_hooks_;
   ProdComponentFactory prod_component_factory_;
@@ -0,0 +1,58 @@
+#include "library/common/extensions/clusters/coalescing/config.h"
+
+#include "envoy/common/exception.h"
+
+#include "common/common/fmt.h"
+#include "common/protobuf/utility.h"
+
+#include "library/common/extensions/clusters/coalescing/load_balancer.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace Clusters {
+namespace Coalescing {
+
+namespace {
+constexpr char DynamicForwardProxyCluster[] = "envoy.clusters.dynamic_forward_proxy";
+} // namespace
+
+std::pair<Upstream::ClusterSharedPtr, Upstream::ThreadAwareLoadBalancerPtr>
+CoalescingClusterFactory::create(const envoy::config::cluster::v3::Cluster& cluster,
+                                 Upstream::ClusterFactoryContext& context) {
+  envoymobile::extensions::clusters::coalescing::Coalescing proto_config;
+  MessageUtil::unpackTo(cluster.cluster_type().typed_config(), proto_config);
+  MessageUtil::validate(proto_config, context.messageValidationVisitor());
+
+  auto* factory =
+      Registry::FactoryRegistry<Upstream::ClusterFactory>::getFactory(DynamicForwardProxyCluster);
+  if (factory == nullptr) {
+    throw EnvoyException(
+        fmt::format("{} requires the {} cluster factory", name(), DynamicForwardProxyCluster));
+  }
+
+  // The cluster is created as the dynamic forward proxy cluster it configures, so it shares the
+  // proxy's DNS cache as usual.
+  envoy::config::cluster::v3::Cluster dynamic_forward_proxy_cluster = cluster;
+  dynamic_forward_proxy_cluster.mutable_cluster_type()->set_name(DynamicForwardProxyCluster);
+  dynamic_forward_proxy_cluster.mutable_cluster_type()->mutable_typed_config()->PackFrom(
+      proto_config.dynamic_forward_proxy());
+  auto cluster_and_load_balancer = factory->create(dynamic_forward_proxy_cluster, context);
+
+  // Exported as cluster.<name>.upstream_rq_coalesced.
+  Stats::Counter& coalesced =
+      cluster_and_load_balancer.first->info()->statsScope().counterFromString(
+          "upstream_rq_coalesced");
+  return {cluster_and_load_balancer.first,
+          std::make_unique<CoalescingThreadAwareLoadBalancer>(
+              std::move(cluster_and_load_balancer.second), coalesced)};
+}
+
+/**
+ * Static registration for the coalescing cluster. @see Upstream::ClusterFactory.
+ */
+REGISTER_FACTORY(CoalescingClusterFactory, Upstream::ClusterFactory);
+
+} // namespace Coalescing
+} // namespace Clusters
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+
+#include "envoy/config/cluster/v3/cluster.pb.h"
+#include "envoy/registry/registry.h"
+#include "envoy/upstream/cluster_factory.h"
+
+#include "library/common/extensions/clusters/coalescing/cluster.pb.h"
+#include "library/common/extensions/clusters/coalescing/cluster.pb.validate.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace Clusters {
+namespace Coalescing {
+
+/**
+ * Config registration for the coalescing cluster. The cluster is created by the dynamic forward
+ * proxy cluster factory, and only its load balancer is replaced. @see Upstream::ClusterFactory.
+ */
+class CoalescingClusterFactory : public Upstream::ClusterFactory {
+public:
+  std::string name() const override { return "envoy_mobile.clusters.coalescing"; }
+
+  std::pair<Upstream::ClusterSharedPtr, Upstream::ThreadAwareLoadBalancerPtr>
+  create(const envoy::config::cluster::v3::Cluster& cluster,
+         Upstream::ClusterFactoryContext& context) override;
+};
+
+DECLARE_FACTORY(CoalescingClusterFactory);
+
+} // namespace Coalescing
+} // namespace Clusters
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,94 @@
+#include "library/common/extensions/clusters/coalescing/load_balancer.h"
+
+#include <algorithm>
+
+#include "library/common/network/connection_coalescing.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace Clusters {
+namespace Coalescing {
+
+namespace {
+
+constexpr size_t MinPruneThreshold = 64;
+
+// Certificates cover names, so the port is stripped from the request's authority.
+absl::string_view hostName(absl::string_view authority) {
+  const size_t colon = authority.rfind(':');
+  if (colon == absl::string_view::npos || authority.find(']', colon) != absl::string_view::npos) {
+    return authority;
+  }
+  return authority.substr(0, colon);
+}
+
+} // namespace
+
+CoalescingLoadBalancer::CoalescingLoadBalancer(Upstream::LoadBalancerPtr&& load_balancer,
+                                               Stats::Counter& coalesced)
+    : load_balancer_(std::move(load_balancer)), coalesced_(coalesced),
+      prune_threshold_(MinPruneThreshold) {}
+
+Upstream::HostConstSharedPtr
+CoalescingLoadBalancer::chooseHost(Upstream::LoadBalancerContext* context) {
+  Upstream::HostConstSharedPtr host = load_balancer_->chooseHost(context);
+  if (host == nullptr || context == nullptr || context->downstreamHeaders() == nullptr) {
+    return host;
+  }
+
+  if (hosts_.size() >= prune_threshold_) {
+    pruneHosts();
+  }
+  const std::string address = host->address()->asString();
+  std::vector<HostWeakPtr>& hosts = hosts_[address];
+  if (std::none_of(hosts.begin(), hosts.end(),
+                   [&host](const HostWeakPtr& other_host) -> bool {
+                     return other_host.lock() == host;
+                   })) {
+    hosts.push_back(host);
+  }
+
+  // The host's own connections are used as usual once it has any.
+  const absl::string_view name = hostName(context->downstreamHeaders()->getHostValue());
+  if (Network::ConnectionCoalescing::covers(*host->address(), name)) {
+    return host;
+  }
+  for (auto it = hosts.begin(); it != hosts.end();) {
+    Upstream::HostConstSharedPtr other_host = it->lock();
+    if (other_host == nullptr) {
+      it = hosts.erase(it);
+      continue;
+    }
+    ++it;
+    // Only a host still at the address the name resolved to, and whose own open connections have
+    // a certificate covering the name, may carry the request.
+    if (other_host != host && other_host->address()->asString() == address &&
+        Network::ConnectionCoalescing::covers(*other_host->address(), name)) {
+      ENVOY_LOG(debug, "coalescing request for {} onto connections to {} at {}", name,
+                other_host->hostname(), address);
+      coalesced_.inc();
+      return other_host;
+    }
+  }
+  return host;
+}
+
+void CoalescingLoadBalancer::pruneHosts() {
+  for (auto it = hosts_.begin(); it != hosts_.end();) {
+    std::vector<HostWeakPtr>& hosts = it->second;
+    hosts.erase(std::remove_if(hosts.begin(), hosts.end(),
+                               [](const HostWeakPtr& host) -> bool { return host.expired(); }),
+                hosts.end());
+    if (hosts.empty()) {
+      hosts_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  prune_threshold_ = std::max(MinPruneThreshold, 2 * hosts_.size());
+}
+
+} // namespace Coalescing
+} // namespace Clusters
+} // namespace Extensions
+} // namespace Envoy
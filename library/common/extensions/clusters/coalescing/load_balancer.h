@@ -0,0 +1,95 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/stats/stats.h"
+#include "envoy/upstream/load_balancer.h"
+
+#include "common/common/logger.h"
+
+#include "absl/container/flat_hash_map.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace Clusters {
+namespace Coalescing {
+
+/**
+ * Load balancer which sends a request to another host than the one chosen for its name, if both
+ * hosts' names resolved to the same address and the other host has an open HTTP/2 connection whose
+ * certificate covers the request's name. The request then shares the other host's connection pool,
+ * and so its connection. Otherwise hosts are chosen by the wrapped load balancer.
+ * @see Network::ConnectionCoalescing.
+ */
+class CoalescingLoadBalancer : public Upstream::LoadBalancer,
+                               Logger::Loggable<Logger::Id::upstream> {
+public:
+  CoalescingLoadBalancer(Upstream::LoadBalancerPtr&& load_balancer, Stats::Counter& coalesced);
+
+  // Upstream::LoadBalancer
+  Upstream::HostConstSharedPtr chooseHost(Upstream::LoadBalancerContext* context) override;
+  Upstream::HostConstSharedPtr peekAnotherHost(Upstream::LoadBalancerContext* context) override {
+    return load_balancer_->peekAnotherHost(context);
+  }
+
+  // Used for testing.
+  size_t rememberedAddresses() const { return hosts_.size(); }
+
+private:
+  using HostWeakPtr = std::weak_ptr<const Upstream::Host>;
+
+  // Forgets hosts which were removed from the cluster, and addresses left without hosts.
+  void pruneHosts();
+
+  const Upstream::LoadBalancerPtr load_balancer_;
+  Stats::Counter& coalesced_;
+  // The hosts chosen for their own names, by their address. Load balancers are per worker, so
+  // these are the hosts of the worker's connection pools.
+  absl::flat_hash_map<std::string, std::vector<HostWeakPtr>> hosts_;
+  // The number of addresses at which hosts_ is next pruned.
+  size_t prune_threshold_;
+};
+
+class CoalescingLoadBalancerFactory : public Upstream::LoadBalancerFactory {
+public:
+  CoalescingLoadBalancerFactory(Upstream::LoadBalancerFactorySharedPtr factory,
+                                Stats::Counter& coalesced)
+      : factory_(std::move(factory)), coalesced_(coalesced) {}
+
+  // Upstream::LoadBalancerFactory
+  Upstream::LoadBalancerPtr create() override {
+    return std::make_unique<CoalescingLoadBalancer>(factory_->create(), coalesced_);
+  }
+
+private:
+  const Upstream::LoadBalancerFactorySharedPtr factory_;
+  Stats::Counter& coalesced_;
+};
+
+/**
+ * Wraps the load balancer of the dynamic forward proxy cluster, so that the load balancers it
+ * creates for each worker coalesce requests.
+ */
+class CoalescingThreadAwareLoadBalancer : public Upstream::ThreadAwareLoadBalancer {
+public:
+  CoalescingThreadAwareLoadBalancer(Upstream::ThreadAwareLoadBalancerPtr&& load_balancer,
+                                    Stats::Counter& coalesced)
+      : load_balancer_(std::move(load_balancer)), coalesced_(coalesced) {}
+
+  // Upstream::ThreadAwareLoadBalancer
+  Upstream::LoadBalancerFactorySharedPtr factory() override {
+    return std::make_shared<CoalescingLoadBalancerFactory>(load_balancer_->factory(), coalesced_);
+  }
+  void initialize() override { load_balancer_->initialize(); }
+
+private:
+  const Upstream::ThreadAwareLoadBalancerPtr load_balancer_;
+  Stats::Counter& coalesced_;
+};
+
+} // namespace Coalescing
+} // namespace Clusters
+} // namespace Extensions
+} // namespace Envoy
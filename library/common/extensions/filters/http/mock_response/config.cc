@@ -0,0 +1,29 @@
+#include "library/common/extensions/filters/http/mock_response/config.h"
+
+#include "library/common/extensions/filters/http/mock_response/filter.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace MockResponse {
+
+Http::FilterFactoryCb MockResponseFilterFactory::createFilterFactoryFromProtoTyped(
+    const envoymobile::extensions::filters::http::mock_response::MockResponse& proto_config,
+    const std::string&, Server::Configuration::FactoryContext&) {
+
+  MockResponseFilterConfigSharedPtr filter_config =
+      std::make_shared<MockResponseFilterConfig>(proto_config);
+  return [filter_config](Http::FilterChainFactoryCallbacks& callbacks) -> void {
+    callbacks.addStreamDecoderFilter(std::make_shared<MockResponseFilter>(filter_config));
+  };
+}
+
+/**
+ * Static registration for the mock_response filter. @see NamedHttpFilterConfigFactory.
+ */
+REGISTER_FACTORY(MockResponseFilterFactory, Server::Configuration::NamedHttpFilterConfigFactory);
+
+} // namespace MockResponse
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+
+#include "extensions/filters/http/common/factory_base.h"
+
+#include "library/common/extensions/filters/http/mock_response/filter.pb.h"
+#include "library/common/extensions/filters/http/mock_response/filter.pb.validate.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace MockResponse {
+
+/**
+ * Config registration for the mock_response filter. @see NamedHttpFilterConfigFactory.
+ */
+class MockResponseFilterFactory
+    : public Common::FactoryBase<
+          envoymobile::extensions::filters::http::mock_response::MockResponse> {
+public:
+  MockResponseFilterFactory() : FactoryBase("mock_response") {}
+
+private:
+  Http::FilterFactoryCb createFilterFactoryFromProtoTyped(
+      const envoymobile::extensions::filters::http::mock_response::MockResponse& config,
+      const std::string& stats_prefix, Server::Configuration::FactoryContext& context) override;
+};
+
+DECLARE_FACTORY(MockResponseFilterFactory);
+
+} // namespace MockResponse
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
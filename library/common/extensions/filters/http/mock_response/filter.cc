@@ -0,0 +1,112 @@
+#include "library/common/extensions/filters/http/mock_response/filter.h"
+
+#include <algorithm>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/http/header_map_impl.h"
+#include "common/http/headers.h"
+#include "common/protobuf/utility.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace MockResponse {
+
+namespace {
+constexpr absl::string_view ResponseCodeDetails = "mock_response";
+} // namespace
+
+MockResponseFilterConfig::MockResponseFilterConfig(
+    const envoymobile::extensions::filters::http::mock_response::MockResponse& proto_config)
+    : status_(proto_config.status() > 0 ? proto_config.status() : 200),
+      headers_(toHeaders(proto_config.headers())), body_bytes_(proto_config.body_bytes()),
+      chunk_bytes_(proto_config.chunk_bytes() > 0
+                       ? std::min(proto_config.chunk_bytes(), proto_config.body_bytes())
+                       : proto_config.body_bytes()),
+      trailers_(toHeaders(proto_config.trailers())),
+      delay_(PROTOBUF_GET_MS_OR_DEFAULT(proto_config, delay, 0)), chunk_(chunk_bytes_, 'x') {}
+
+MockResponseFilterConfig::Headers MockResponseFilterConfig::toHeaders(
+    const Protobuf::RepeatedPtrField<envoy::config::core::v3::HeaderValue>& proto_headers) {
+  Headers headers;
+  for (const auto& header : proto_headers) {
+    headers.emplace_back(Http::LowerCaseString(header.key()), header.value());
+  }
+  return headers;
+}
+
+MockResponseFilter::MockResponseFilter(MockResponseFilterConfigSharedPtr config)
+    : config_(config) {}
+
+void MockResponseFilter::onDestroy() {
+  if (delay_timer_ != nullptr) {
+    delay_timer_->disableTimer();
+  }
+}
+
+// The request is consumed without being buffered, and the response is sent once it has ended.
+Http::FilterHeadersStatus MockResponseFilter::decodeHeaders(Http::RequestHeaderMap&,
+                                                            bool end_stream) {
+  if (end_stream) {
+    respond();
+  }
+  return Http::FilterHeadersStatus::StopIteration;
+}
+
+Http::FilterDataStatus MockResponseFilter::decodeData(Buffer::Instance&, bool end_stream) {
+  if (end_stream) {
+    respond();
+  }
+  return Http::FilterDataStatus::StopIterationNoBuffer;
+}
+
+Http::FilterTrailersStatus MockResponseFilter::decodeTrailers(Http::RequestTrailerMap&) {
+  respond();
+  return Http::FilterTrailersStatus::StopIteration;
+}
+
+void MockResponseFilter::respond() {
+  if (config_->delay().count() == 0) {
+    sendResponse();
+    return;
+  }
+  delay_timer_ = decoder_callbacks_->dispatcher().createTimer([this]() -> void { sendResponse(); });
+  delay_timer_->enableTimer(config_->delay());
+}
+
+void MockResponseFilter::sendResponse() {
+  const bool has_body = config_->bodyBytes() > 0;
+  const bool has_trailers = !config_->trailers().empty();
+
+  auto headers = Http::ResponseHeaderMapImpl::create();
+  headers->setStatus(config_->status());
+  // The response looks as if it came from upstream, rather than being a local reply, so that the
+  // engine delivers error statuses as responses.
+  headers->addReferenceKey(Http::Headers::get().EnvoyUpstreamServiceTime, 0);
+  for (const auto& header : config_->headers()) {
+    headers->addCopy(header.first, header.second);
+  }
+  decoder_callbacks_->streamInfo().setResponseCodeDetails(ResponseCodeDetails);
+  decoder_callbacks_->encodeHeaders(std::move(headers), !has_body && !has_trailers);
+
+  uint64_t remaining = config_->bodyBytes();
+  while (remaining > 0) {
+    const uint64_t length = std::min(remaining, config_->chunkBytes());
+    remaining -= length;
+    Buffer::OwnedImpl chunk(config_->chunk().data(), length);
+    decoder_callbacks_->encodeData(chunk, remaining == 0 && !has_trailers);
+  }
+
+  if (has_trailers) {
+    auto trailers = Http::ResponseTrailerMapImpl::create();
+    for (const auto& trailer : config_->trailers()) {
+      trailers->addCopy(trailer.first, trailer.second);
+    }
+    decoder_callbacks_->encodeTrailers(std::move(trailers));
+  }
+}
+
+} // namespace MockResponse
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
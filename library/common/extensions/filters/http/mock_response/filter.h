@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "envoy/event/timer.h"
+#include "envoy/http/filter.h"
+
+#include "extensions/filters/http/common/pass_through_filter.h"
+
+#include "library/common/extensions/filters/http/mock_response/filter.pb.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace MockResponse {
+
+class MockResponseFilterConfig {
+public:
+  MockResponseFilterConfig(
+      const envoymobile::extensions::filters::http::mock_response::MockResponse& proto_config);
+
+  using Headers = std::vector<std::pair<Http::LowerCaseString, std::string>>;
+
+  uint64_t status() const { return status_; }
+  const Headers& headers() const { return headers_; }
+  uint64_t bodyBytes() const { return body_bytes_; }
+  uint64_t chunkBytes() const { return chunk_bytes_; }
+  const Headers& trailers() const { return trailers_; }
+  std::chrono::milliseconds delay() const { return delay_; }
+  // A chunk's worth of body, which every data frame is copied from.
+  const std::string& chunk() const { return chunk_; }
+
+private:
+  static Headers toHeaders(
+      const Protobuf::RepeatedPtrField<envoy::config::core::v3::HeaderValue>& proto_headers);
+
+  const uint64_t status_;
+  const Headers headers_;
+  const uint64_t body_bytes_;
+  const uint64_t chunk_bytes_;
+  const Headers trailers_;
+  const std::chrono::milliseconds delay_;
+  const std::string chunk_;
+};
+
+using MockResponseFilterConfigSharedPtr = std::shared_ptr<MockResponseFilterConfig>;
+
+/**
+ * Filter which answers requests with a canned response instead of sending them upstream, for
+ * measuring the overhead of the engine itself. It takes the router's place at the end of the
+ * filter chain.
+ */
+class MockResponseFilter final : public Http::PassThroughFilter {
+public:
+  MockResponseFilter(MockResponseFilterConfigSharedPtr config);
+
+  // StreamFilterBase
+  void onDestroy() override;
+
+  // StreamDecoderFilter
+  Http::FilterHeadersStatus decodeHeaders(Http::RequestHeaderMap& headers,
+                                          bool end_stream) override;
+  Http::FilterDataStatus decodeData(Buffer::Instance& data, bool end_stream) override;
+  Http::FilterTrailersStatus decodeTrailers(Http::RequestTrailerMap& trailers) override;
+
+private:
+  // Called once the request has ended.
+  void respond();
+  void sendResponse();
+
+  const MockResponseFilterConfigSharedPtr config_;
+  Event::TimerPtr delay_timer_;
+};
+
+} // namespace MockResponse
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
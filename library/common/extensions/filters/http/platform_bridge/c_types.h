@@ -138,6 +138,13 @@ typedef envoy_filter_resume_status (*envoy_filter_on_resume_f)(envoy_headers* he
  */
 typedef void (*envoy_filter_release_f)(const void* context);
 
+/**
+ * Function signature to reset a filter instance once a stream is finished with it, so that it may
+ * be reused by a later stream. Implementations must discard all per-stream state, and must not
+ * invoke the instance's callbacks again until the instance next receives a filter invocation.
+ */
+typedef void (*envoy_filter_reset_f)(const void* context);
+
 /**
  * Function signature for asynchronous filter callback to resume filter iteration.
  */
@@ -176,6 +183,8 @@ typedef struct {
   envoy_filter_set_callbacks_f set_response_callbacks;
   envoy_filter_on_resume_f on_resume_response;
   envoy_filter_release_f release_filter;
+  // Optional. Allows instances to be pooled across streams, @see envoy_filter_reset_f.
+  envoy_filter_reset_f reset_filter;
   const void* static_context;
   const void* instance_context;
 } envoy_http_filter;
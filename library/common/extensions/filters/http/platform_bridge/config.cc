@@ -14,8 +14,9 @@ Http::FilterFactoryCb PlatformBridgeFilterFactory::createFilterFactoryFromProtoT
   PlatformBridgeFilterConfigSharedPtr filter_config =
       std::make_shared<PlatformBridgeFilterConfig>(proto_config);
   return [filter_config, &context](Http::FilterChainFactoryCallbacks& callbacks) -> void {
-    callbacks.addStreamFilter(
-        std::make_shared<PlatformBridgeFilter>(filter_config, context.dispatcher()));
+    auto filter = std::make_shared<PlatformBridgeFilter>(filter_config, context.dispatcher());
+    filter->init();
+    callbacks.addStreamFilter(filter);
   };
 }
 
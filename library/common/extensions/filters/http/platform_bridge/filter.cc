@@ -4,6 +4,7 @@
 
 #include "common/buffer/buffer_impl.h"
 #include "common/common/assert.h"
+#include "common/common/lock_guard.h"
 #include "common/common/utility.h"
 
 #include "library/common/api/external.h"
@@ -11,6 +12,7 @@
 #include "library/common/buffer/utility.h"
 #include "library/common/extensions/filters/http/platform_bridge/c_type_definitions.h"
 #include "library/common/http/header_utility.h"
+#include "library/common/logging/binary_log.h"
 
 namespace Envoy {
 namespace Extensions {
@@ -43,11 +45,41 @@ PlatformBridgeFilterConfig::PlatformBridgeFilterConfig(
     const envoymobile::extensions::filters::http::platform_bridge::PlatformBridge& proto_config)
     : filter_name_(proto_config.platform_filter_name()),
       platform_filter_(static_cast<envoy_http_filter*>(
-          Api::External::retrieveApi(proto_config.platform_filter_name()))) {}
+          Api::External::retrieveApi(proto_config.platform_filter_name()))),
+      // Instances can only be pooled if the platform filter knows how to reset them.
+      max_pooled_instances_(platform_filter_ != nullptr && platform_filter_->reset_filter != nullptr
+                                ? proto_config.max_pooled_instances()
+                                : 0) {}
+
+PlatformBridgeFilterConfig::~PlatformBridgeFilterConfig() {
+  Thread::LockGuard lock(mutex_);
+  for (const PooledPlatformFilter& instance : pool_) {
+    platform_filter_->release_filter(instance.instance_context);
+  }
+}
+
+absl::optional<PooledPlatformFilter> PlatformBridgeFilterConfig::acquireInstance() {
+  Thread::LockGuard lock(mutex_);
+  if (pool_.empty()) {
+    return absl::nullopt;
+  }
+  PooledPlatformFilter instance = pool_.back();
+  pool_.pop_back();
+  return instance;
+}
+
+bool PlatformBridgeFilterConfig::releaseInstance(const PooledPlatformFilter& instance) {
+  Thread::LockGuard lock(mutex_);
+  if (pool_.size() >= max_pooled_instances_) {
+    return false;
+  }
+  pool_.push_back(instance);
+  return true;
+}
 
 PlatformBridgeFilter::PlatformBridgeFilter(PlatformBridgeFilterConfigSharedPtr config,
                                            Event::Dispatcher& dispatcher)
-    : dispatcher_(dispatcher), filter_name_(config->filter_name()),
+    : config_(config), dispatcher_(dispatcher), filter_name_(config->filter_name()),
       platform_filter_(*config->platform_filter()) {
   // The initialization above sets platform_filter_ to a copy of the struct stored on the config.
   // In the typical case, this will represent a filter implementation that needs to be intantiated.
@@ -57,24 +89,42 @@ PlatformBridgeFilter::PlatformBridgeFilter(PlatformBridgeFilterConfigSharedPtr c
 
   // If init_filter is missing, zero out the rest of the struct for safety.
   if (platform_filter_.init_filter == nullptr) {
-    ENVOY_LOG(debug, "platform bridge filter: missing initializer for {}", filter_name_);
+    ENVOY_MOBILE_LOG(debug, "platform bridge filter: missing initializer for {}", filter_name_);
     platform_filter_ = {};
     return;
   }
 
+  iteration_state_ = IterationState::Ongoing;
+
+  // Reusing an idle instance avoids crossing the bridge to create and set up a new one. Its
+  // callback contexts are rebound to this filter by init(), in place of calling set_*_callbacks
+  // again.
+  if (config_->poolingEnabled()) {
+    absl::optional<PooledPlatformFilter> pooled = config_->acquireInstance();
+    if (pooled.has_value()) {
+      platform_filter_.instance_context = pooled->instance_context;
+      request_callback_context_ = pooled->request_callback_context;
+      response_callback_context_ = pooled->response_callback_context;
+      return;
+    }
+  }
+
   // Set the instance_context to the result of the initialization call. Cleanup will ultimately
   // occur during in the onDestroy() invocation below.
   platform_filter_.instance_context = platform_filter_.init_filter(platform_filter_.static_context);
   ASSERT(platform_filter_.instance_context,
          fmt::format("init_filter unsuccessful for {}", filter_name_));
-  iteration_state_ = IterationState::Ongoing;
+  initCallbacks();
+}
 
+void PlatformBridgeFilter::initCallbacks() {
   if (platform_filter_.set_request_callbacks) {
     platform_request_callbacks_.resume_iteration = envoy_filter_callback_resume_decoding;
     platform_request_callbacks_.release_callbacks = envoy_filter_release_callbacks;
     // We use a weak_ptr wrapper for the filter to ensure presence before dispatching callbacks.
-    platform_request_callbacks_.callback_context =
-        new PlatformBridgeFilterWeakPtr{weak_from_this()};
+    // It is bound to this filter by init(), as weak_from_this() is empty during construction.
+    request_callback_context_ = new PlatformBridgeFilterWeakPtr{};
+    platform_request_callbacks_.callback_context = request_callback_context_;
     platform_filter_.set_request_callbacks(platform_request_callbacks_,
                                            platform_filter_.instance_context);
   }
@@ -82,13 +132,22 @@ PlatformBridgeFilter::PlatformBridgeFilter(PlatformBridgeFilterConfigSharedPtr c
   if (platform_filter_.set_response_callbacks) {
     platform_response_callbacks_.resume_iteration = envoy_filter_callback_resume_encoding;
     platform_response_callbacks_.release_callbacks = envoy_filter_release_callbacks;
-    platform_response_callbacks_.callback_context =
-        new PlatformBridgeFilterWeakPtr{weak_from_this()};
+    response_callback_context_ = new PlatformBridgeFilterWeakPtr{};
+    platform_response_callbacks_.callback_context = response_callback_context_;
     platform_filter_.set_response_callbacks(platform_response_callbacks_,
                                             platform_filter_.instance_context);
   }
 }
 
+void PlatformBridgeFilter::init() {
+  if (request_callback_context_ != nullptr) {
+    *request_callback_context_ = weak_from_this();
+  }
+  if (response_callback_context_ != nullptr) {
+    *response_callback_context_ = weak_from_this();
+  }
+}
+
 void PlatformBridgeFilter::onDestroy() {
   // Allow nullptr as no-op only if nothing was initialized.
   if (platform_filter_.release_filter == nullptr) {
@@ -97,6 +156,15 @@ void PlatformBridgeFilter::onDestroy() {
     return;
   }
 
+  if (config_->poolingEnabled()) {
+    platform_filter_.reset_filter(platform_filter_.instance_context);
+    if (config_->releaseInstance({platform_filter_.instance_context, request_callback_context_,
+                                  response_callback_context_})) {
+      platform_filter_.instance_context = nullptr;
+      return;
+    }
+  }
+
   platform_filter_.release_filter(platform_filter_.instance_context);
   platform_filter_.instance_context = nullptr;
 }
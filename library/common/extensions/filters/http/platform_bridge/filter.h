@@ -3,9 +3,11 @@
 #include "envoy/http/filter.h"
 
 #include "common/common/logger.h"
+#include "common/common/thread.h"
 
 #include "extensions/filters/http/common/pass_through_filter.h"
 
+#include "absl/types/optional.h"
 #include "library/common/extensions/filters/http/platform_bridge/c_types.h"
 #include "library/common/extensions/filters/http/platform_bridge/filter.pb.h"
 
@@ -14,17 +16,52 @@ namespace Extensions {
 namespace HttpFilters {
 namespace PlatformBridge {
 
+class PlatformBridgeFilter;
+using PlatformBridgeFilterWeakPtr = std::weak_ptr<PlatformBridgeFilter>;
+
+/**
+ * An idle platform filter instance, along with the callback contexts registered with it, which
+ * remain valid for as long as the instance does.
+ */
+struct PooledPlatformFilter {
+  const void* instance_context;
+  PlatformBridgeFilterWeakPtr* request_callback_context;
+  PlatformBridgeFilterWeakPtr* response_callback_context;
+};
+
 class PlatformBridgeFilterConfig {
 public:
   PlatformBridgeFilterConfig(
       const envoymobile::extensions::filters::http::platform_bridge::PlatformBridge& proto_config);
+  ~PlatformBridgeFilterConfig();
 
   const std::string& filter_name() { return filter_name_; }
   const envoy_http_filter* platform_filter() const { return platform_filter_; }
 
+  /**
+   * @return bool whether platform filter instances may be reused across streams.
+   */
+  bool poolingEnabled() const { return max_pooled_instances_ > 0; }
+
+  /**
+   * Take an idle instance from the pool.
+   * @return absl::optional<PooledPlatformFilter>, an instance, or absl::nullopt if none is idle.
+   */
+  absl::optional<PooledPlatformFilter> acquireInstance();
+
+  /**
+   * Return an instance, which must already have been reset, to the pool.
+   * @param instance, the instance to return.
+   * @return bool whether the instance was retained. If not, the caller must release it.
+   */
+  bool releaseInstance(const PooledPlatformFilter& instance);
+
 private:
   const std::string filter_name_;
   const envoy_http_filter* platform_filter_;
+  const uint32_t max_pooled_instances_;
+  Thread::MutexBasicLockable mutex_;
+  std::vector<PooledPlatformFilter> pool_ GUARDED_BY(mutex_);
 };
 
 typedef std::shared_ptr<PlatformBridgeFilterConfig> PlatformBridgeFilterConfigSharedPtr;
@@ -51,6 +88,10 @@ class PlatformBridgeFilter final : public Http::PassThroughFilter,
 public:
   PlatformBridgeFilter(PlatformBridgeFilterConfigSharedPtr config, Event::Dispatcher& dispatcher);
 
+  // Binds the platform filter's callbacks to this filter. Must be called once the filter is owned
+  // by a shared_ptr, and before it is added to a filter chain.
+  void init();
+
   // Asynchronously trigger resumption of filter iteration, if applicable.
   // This is a no-op if filter iteration is already ongoing.
   void resumeDecoding();
@@ -101,6 +142,10 @@ private:
   // entities before resuming encoding.
   void onResumeEncoding();
 
+  // Set up callbacks for a newly created platform filter instance.
+  void initCallbacks();
+
+  const PlatformBridgeFilterConfigSharedPtr config_;
   Event::Dispatcher& dispatcher_;
   Http::HeaderMap* pending_request_headers_{};
   Http::HeaderMap* pending_response_headers_{};
@@ -111,12 +156,16 @@ private:
   envoy_http_filter platform_filter_;
   envoy_http_filter_callbacks platform_request_callbacks_{};
   envoy_http_filter_callbacks platform_response_callbacks_{};
+  // Callback contexts are owned by the platform filter instance, which releases them along with
+  // the instance, but are retained here so that they may be rebound to a later stream if the
+  // instance is pooled.
+  PlatformBridgeFilterWeakPtr* request_callback_context_{};
+  PlatformBridgeFilterWeakPtr* response_callback_context_{};
   bool request_complete_{};
   bool response_complete_{};
 };
 
 using PlatformBridgeFilterSharedPtr = std::shared_ptr<PlatformBridgeFilter>;
-using PlatformBridgeFilterWeakPtr = std::weak_ptr<PlatformBridgeFilter>;
 
 } // namespace PlatformBridge
 } // namespace HttpFilters
@@ -0,0 +1,26 @@
+#include "library/common/extensions/resource_monitors/device_memory/config.h"
+
+#include "envoy/registry/registry.h"
+
+#include "library/common/extensions/resource_monitors/device_memory/device_memory_monitor.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace ResourceMonitors {
+namespace DeviceMemory {
+
+Server::ResourceMonitorPtr DeviceMemoryMonitorFactory::createResourceMonitorFromProtoTyped(
+    const envoymobile::extensions::resource_monitors::device_memory::DeviceMemory& config,
+    Server::Configuration::ResourceMonitorFactoryContext&) {
+  return std::make_unique<DeviceMemoryMonitor>(config);
+}
+
+/**
+ * Static registration for the device memory resource monitor. @see ResourceMonitorFactory.
+ */
+REGISTER_FACTORY(DeviceMemoryMonitorFactory, Server::Configuration::ResourceMonitorFactory);
+
+} // namespace DeviceMemory
+} // namespace ResourceMonitors
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "envoy/server/resource_monitor_config.h"
+
+#include "extensions/resource_monitors/common/factory_base.h"
+
+#include "library/common/extensions/resource_monitors/device_memory/device_memory.pb.h"
+#include "library/common/extensions/resource_monitors/device_memory/device_memory.pb.validate.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace ResourceMonitors {
+namespace DeviceMemory {
+
+/**
+ * Config registration for the device memory resource monitor. @see ResourceMonitorFactory.
+ */
+class DeviceMemoryMonitorFactory
+    : public Common::FactoryBase<
+          envoymobile::extensions::resource_monitors::device_memory::DeviceMemory> {
+public:
+  DeviceMemoryMonitorFactory() : FactoryBase("envoy_mobile.resource_monitors.device_memory") {}
+
+private:
+  Server::ResourceMonitorPtr createResourceMonitorFromProtoTyped(
+      const envoymobile::extensions::resource_monitors::device_memory::DeviceMemory& config,
+      Server::Configuration::ResourceMonitorFactoryContext& context) override;
+};
+
+DECLARE_FACTORY(DeviceMemoryMonitorFactory);
+
+} // namespace DeviceMemory
+} // namespace ResourceMonitors
+} // namespace Extensions
+} // namespace Envoy
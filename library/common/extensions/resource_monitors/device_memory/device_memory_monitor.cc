@@ -0,0 +1,46 @@
+#include "library/common/extensions/resource_monitors/device_memory/device_memory_monitor.h"
+
+#include <algorithm>
+
+#include "common/memory/stats.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace ResourceMonitors {
+namespace DeviceMemory {
+
+std::atomic<double> DeviceMemoryMonitor::device_pressure_{0};
+
+uint64_t MemoryStatsReader::allocatedHeapBytes() {
+  return Memory::Stats::totalCurrentlyAllocated();
+}
+
+DeviceMemoryMonitor::DeviceMemoryMonitor(
+    const envoymobile::extensions::resource_monitors::device_memory::DeviceMemory& config,
+    std::unique_ptr<MemoryStatsReader> stats)
+    : max_heap_(config.max_heap_size_bytes()), stats_(std::move(stats)) {}
+
+void DeviceMemoryMonitor::updateResourceUsage(Server::ResourceMonitor::Callbacks& callbacks) {
+  Server::ResourceUsage usage;
+  usage.resource_pressure_ = devicePressure();
+  if (max_heap_ > 0) {
+    const double heap_pressure = static_cast<double>(stats_->allocatedHeapBytes()) / max_heap_;
+    usage.resource_pressure_ = std::max(usage.resource_pressure_, std::min(heap_pressure, 1.0));
+  }
+  callbacks.onSuccess(usage);
+}
+
+void DeviceMemoryMonitor::setDevicePressure(double pressure) {
+  // NaN compares false against both bounds, so it is treated as no pressure.
+  pressure = pressure > 0 ? std::min(pressure, 1.0) : 0;
+  device_pressure_.store(pressure, std::memory_order_relaxed);
+}
+
+double DeviceMemoryMonitor::devicePressure() {
+  return device_pressure_.load(std::memory_order_relaxed);
+}
+
+} // namespace DeviceMemory
+} // namespace ResourceMonitors
+} // namespace Extensions
+} // namespace Envoy
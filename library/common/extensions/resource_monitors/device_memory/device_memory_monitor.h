@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "envoy/server/resource_monitor.h"
+
+#include "library/common/extensions/resource_monitors/device_memory/device_memory.pb.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace ResourceMonitors {
+namespace DeviceMemory {
+
+/**
+ * Helper class for getting memory heap stats.
+ */
+class MemoryStatsReader {
+public:
+  virtual ~MemoryStatsReader() = default;
+
+  // Memory currently allocated by the engine, including buffered data.
+  virtual uint64_t allocatedHeapBytes();
+};
+
+/**
+ * Reports memory pressure for the engine's process. Pressure is the greater of the engine's heap
+ * usage relative to a configured maximum, and the pressure last reported for the device by the
+ * application, @see setDevicePressure().
+ */
+class DeviceMemoryMonitor : public Server::ResourceMonitor {
+public:
+  DeviceMemoryMonitor(
+      const envoymobile::extensions::resource_monitors::device_memory::DeviceMemory& config,
+      std::unique_ptr<MemoryStatsReader> stats = std::make_unique<MemoryStatsReader>());
+
+  // Server::ResourceMonitor
+  void updateResourceUsage(Server::ResourceMonitor::Callbacks& callbacks) override;
+
+  /**
+   * Update the memory pressure reported for the device. Safe to call from any thread. Note that
+   * this state is shared by all monitors.
+   * @param pressure, the fraction of memory available to the application which is in use. Values
+   *        outside of [0, 1] are clamped.
+   */
+  static void setDevicePressure(double pressure);
+
+  /**
+   * @return double the memory pressure last reported for the device.
+   */
+  static double devicePressure();
+
+private:
+  const uint64_t max_heap_;
+  const std::unique_ptr<MemoryStatsReader> stats_;
+
+  static std::atomic<double> device_pressure_;
+};
+
+} // namespace DeviceMemory
+} // namespace ResourceMonitors
+} // namespace Extensions
+} // namespace Envoy
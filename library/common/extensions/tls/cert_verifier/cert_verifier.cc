@@ -0,0 +1,338 @@
+#include "library/common/extensions/tls/cert_verifier/cert_verifier.h"
+
+#include "common/common/assert.h"
+#include "common/common/macros.h"
+#include "common/protobuf/utility.h"
+
+#include "extensions/transport_sockets/tls/utility.h"
+
+#include "library/common/network/early_data_rejections.h"
+#include "openssl/sha.h"
+#include "openssl/x509.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace Tls {
+namespace CertVerifier {
+
+namespace {
+constexpr uint32_t DefaultMaxCacheEntries = 256;
+constexpr uint64_t DefaultCacheTtlMs = 60 * 60 * 1000;
+} // namespace
+
+CertVerifier::CertVerifier(
+    const envoymobile::extensions::tls::cert_verifier::CertVerifier& proto_config,
+    TimeSource& time_source, Stats::Scope& scope, Thread::ThreadFactory& thread_factory)
+    : time_source_(time_source),
+      cache_ttl_(PROTOBUF_GET_MS_OR_DEFAULT(proto_config, cache_ttl, DefaultCacheTtlMs)),
+      early_data_(proto_config.enable_early_data()),
+      cache_(time_source, PROTOBUF_GET_WRAPPED_OR_DEFAULT(proto_config, max_cache_entries,
+                                                          DefaultMaxCacheEntries)),
+      stats_(generateStats("cert_verifier.", scope)),
+      worker_(proto_config.async_verification()
+                  ? std::make_unique<VerificationWorker>(thread_factory)
+                  : nullptr) {}
+
+ssl_verify_result_t CertVerifier::verify(SSL* ssl, uint8_t* out_alert) {
+  std::string key;
+  absl::optional<ssl_verify_result_t> result = verifyFromCache(ssl, out_alert, key);
+  if (result.has_value()) {
+    return result.value();
+  }
+
+  const VerificationJob job = createJob(ssl, std::move(key));
+  if (!onChainVerified(job, verifyChain(job))) {
+    *out_alert = SSL_AD_BAD_CERTIFICATE;
+    return ssl_verify_invalid;
+  }
+  return ssl_verify_ok;
+}
+
+ssl_verify_result_t CertVerifier::verifyAsync(SSL* ssl, uint8_t* out_alert,
+                                              Event::Dispatcher& dispatcher,
+                                              VerifyCompleteCb on_complete) {
+  ASSERT(async());
+  std::string key;
+  absl::optional<ssl_verify_result_t> result = verifyFromCache(ssl, out_alert, key);
+  if (result.has_value()) {
+    return result.value();
+  }
+
+  stats_.async_verify_started_.inc();
+  stats_.async_verify_pending_.inc();
+  VerificationJobSharedPtr job = std::make_shared<VerificationJob>(createJob(ssl, std::move(key)));
+  // The worker is joined before the verifier is destroyed, so capturing this is safe. The
+  // dispatcher outlives the clusters, and therefore the TLS contexts, created on it.
+  worker_->post([this, job, &dispatcher, on_complete]() -> void {
+    const bool verified = onChainVerified(*job, verifyChain(*job));
+    stats_.async_verify_pending_.dec();
+    dispatcher.post([on_complete, verified]() -> void { on_complete(verified); });
+  });
+  return ssl_verify_retry;
+}
+
+absl::optional<ssl_verify_result_t> CertVerifier::verifyFromCache(SSL* ssl, uint8_t* out_alert,
+                                                                  std::string& key) {
+  const STACK_OF(CRYPTO_BUFFER)* certs = SSL_get0_peer_certificates(ssl);
+  if (certs == nullptr || sk_CRYPTO_BUFFER_num(certs) == 0) {
+    stats_.verify_failure_.inc();
+    *out_alert = SSL_AD_CERTIFICATE_REQUIRED;
+    return ssl_verify_invalid;
+  }
+
+  key = cacheKey(ssl);
+  if (cache_.lookup(key)) {
+    stats_.cache_hit_.inc();
+    return ssl_verify_ok;
+  }
+  stats_.cache_miss_.inc();
+  return absl::nullopt;
+}
+
+bool CertVerifier::onChainVerified(const VerificationJob& job,
+                                   absl::optional<SystemTime> chain_expiry) {
+  if (!chain_expiry.has_value()) {
+    stats_.verify_failure_.inc();
+    return false;
+  }
+  stats_.verify_success_.inc();
+
+  if (job.cacheable_) {
+    const SystemTime expiry =
+        std::min(chain_expiry.value(), time_source_.systemTime() + cache_ttl_);
+    if (cache_.insert(job.key_, expiry)) {
+      stats_.cache_eviction_.inc();
+    }
+  }
+  return true;
+}
+
+std::string CertVerifier::cacheKey(SSL* ssl) {
+  SHA256_CTX sha256;
+  SHA256_Init(&sha256);
+
+  const char* server_name = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+  const absl::string_view sni = server_name != nullptr ? server_name : "";
+  const uint64_t sni_length = sni.size();
+  SHA256_Update(&sha256, &sni_length, sizeof(sni_length));
+  SHA256_Update(&sha256, sni.data(), sni.size());
+
+  const STACK_OF(CRYPTO_BUFFER)* certs = SSL_get0_peer_certificates(ssl);
+  for (const CRYPTO_BUFFER* cert : certs) {
+    // Length-prefix each certificate so that distinct chains can never produce the same input.
+    const uint64_t cert_length = CRYPTO_BUFFER_len(cert);
+    SHA256_Update(&sha256, &cert_length, sizeof(cert_length));
+    SHA256_Update(&sha256, CRYPTO_BUFFER_data(cert), cert_length);
+  }
+
+  std::string digest(SHA256_DIGEST_LENGTH, 0);
+  SHA256_Final(reinterpret_cast<uint8_t*>(&digest[0]), &sha256);
+  return digest;
+}
+
+bool CertVerifier::cacheable(SSL* ssl) {
+  X509_STORE* store = SSL_CTX_get_cert_store(SSL_get_SSL_CTX(ssl));
+  const unsigned long flags = X509_VERIFY_PARAM_get_flags(X509_STORE_get0_param(store));
+  return (flags & (X509_V_FLAG_CRL_CHECK | X509_V_FLAG_CRL_CHECK_ALL)) == 0;
+}
+
+VerificationJob CertVerifier::createJob(SSL* ssl, std::string key) {
+  VerificationJob job;
+  job.key_ = std::move(key);
+  job.cacheable_ = cacheable(ssl);
+  // Take references to everything verification needs, as the connection may be closed, and the
+  // SSL freed, before an asynchronous verification completes.
+  STACK_OF(X509)* chain = SSL_get_peer_full_cert_chain(ssl);
+  if (chain != nullptr) {
+    job.chain_.reset(X509_chain_up_ref(chain));
+  }
+  X509_STORE* store = SSL_CTX_get_cert_store(SSL_get_SSL_CTX(ssl));
+  X509_STORE_up_ref(store);
+  job.store_.reset(store);
+  job.param_.reset(X509_VERIFY_PARAM_new());
+  X509_VERIFY_PARAM_set1(job.param_.get(), SSL_get0_param(ssl));
+  return job;
+}
+
+absl::optional<SystemTime> CertVerifier::verifyChain(const VerificationJob& job) {
+  STACK_OF(X509)* chain = job.chain_.get();
+  if (chain == nullptr || sk_X509_num(chain) == 0) {
+    return absl::nullopt;
+  }
+  X509* leaf = sk_X509_value(chain, 0);
+
+  bssl::UniquePtr<X509_STORE_CTX> store_ctx(X509_STORE_CTX_new());
+  if (!X509_STORE_CTX_init(store_ctx.get(), job.store_.get(), leaf, chain)) {
+    return absl::nullopt;
+  }
+  X509_STORE_CTX_set_default(store_ctx.get(), "ssl_server");
+  // Inherit any verification parameters (e.g. expected host names) configured on the connection.
+  X509_VERIFY_PARAM_set1(X509_STORE_CTX_get0_param(store_ctx.get()), job.param_.get());
+
+  if (X509_verify_cert(store_ctx.get()) != 1) {
+    ENVOY_LOG(debug, "cert verifier: verification failed: {}",
+              X509_verify_cert_error_string(X509_STORE_CTX_get_error(store_ctx.get())));
+    return absl::nullopt;
+  }
+
+  SystemTime expiry = SystemTime::max();
+  STACK_OF(X509)* verified_chain = X509_STORE_CTX_get0_chain(store_ctx.get());
+  for (const X509* cert : verified_chain) {
+    expiry = std::min(expiry, TransportSockets::Tls::Utility::getExpirationTime(*cert));
+  }
+  return expiry;
+}
+
+CertVerifyingHandshaker::CertVerifyingHandshaker(bssl::UniquePtr<SSL> ssl,
+                                                 int ssl_extended_socket_info_index,
+                                                 Ssl::HandshakeCallbacks* handshake_callbacks,
+                                                 CertVerifierSharedPtr verifier)
+    : SslHandshakerImpl(std::move(ssl), ssl_extended_socket_info_index, this),
+      callbacks_(handshake_callbacks), verifier_(std::move(verifier)) {
+  // The custom verification callback set on the connection supersedes the X509 verification
+  // callback installed on the SSL_CTX by Envoy.
+  SSL_set_ex_data(this->ssl(), handshakerIndex(), this);
+  SSL_set_custom_verify(this->ssl(), SSL_VERIFY_PEER, verifyCallback);
+  if (verifier_->earlyData()) {
+    // Early data is only offered when the session being resumed permits it.
+    SSL_set_early_data_enabled(this->ssl(), 1);
+    SSL_set_info_callback(this->ssl(), infoCallback);
+  }
+}
+
+CertVerifyingHandshaker::~CertVerifyingHandshaker() {
+  if (verify_state_ == VerifyState::Pending) {
+    verifier_->stats().async_verify_abandoned_.inc();
+  }
+  if (coalescing_id_.has_value()) {
+    Network::ConnectionCoalescing::remove(coalescing_id_.value());
+  }
+}
+
+Network::PostIoAction CertVerifyingHandshaker::doHandshake() {
+  const Network::PostIoAction action = SslHandshakerImpl::doHandshake();
+  if (verify_state_ == VerifyState::Pending) {
+    // The handshake is waiting on an asynchronous verification, which the default handshaker
+    // reports as a failure, @see onFailure. It resumes once the verification completes.
+    setState(Ssl::SocketState::HandshakeInProgress);
+    return Network::PostIoAction::KeepOpen;
+  }
+  return action;
+}
+
+void CertVerifyingHandshaker::onSuccess(SSL* ssl) {
+  // With early data, the handshake returns before the server has responded, and it is finished by
+  // the transport socket's reads and writes. Should the server reject the early data, they fail
+  // and the connection is closed, once the rejection is recorded, @see infoCallback.
+  if (SSL_in_early_data(ssl)) {
+    early_data_attempted_ = true;
+    verifier_->stats().early_data_attempted_.inc();
+  }
+  recordForCoalescing();
+  callbacks_->onSuccess(ssl);
+}
+
+void CertVerifyingHandshaker::onFailure() {
+  // SSL_ERROR_WANT_CERTIFICATE_VERIFY is not a failure; the connection is kept open until the
+  // verification completes.
+  if (verify_state_ == VerifyState::Pending) {
+    return;
+  }
+  callbacks_->onFailure();
+}
+
+int CertVerifyingHandshaker::handshakerIndex() {
+  CONSTRUCT_ON_FIRST_USE(int, []() -> int {
+    int ssl_context_index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    RELEASE_ASSERT(ssl_context_index >= 0, "");
+    return ssl_context_index;
+  }());
+}
+
+ssl_verify_result_t CertVerifyingHandshaker::verifyCallback(SSL* ssl, uint8_t* out_alert) {
+  auto* handshaker = static_cast<CertVerifyingHandshaker*>(SSL_get_ex_data(ssl, handshakerIndex()));
+  ASSERT(handshaker != nullptr);
+  return handshaker->verify(out_alert);
+}
+
+void CertVerifyingHandshaker::recordForCoalescing() {
+  const uint8_t* alpn;
+  unsigned alpn_length;
+  SSL_get0_alpn_selected(ssl(), &alpn, &alpn_length);
+  bssl::UniquePtr<X509> cert(SSL_get_peer_certificate(ssl()));
+  if (absl::string_view(reinterpret_cast<const char*>(alpn), alpn_length) != "h2" ||
+      cert == nullptr) {
+    return;
+  }
+  coalescing_id_ = Network::ConnectionCoalescing::add(
+      callbacks_->connection().remoteAddress(),
+      TransportSockets::Tls::Utility::getSubjectAltNames(*cert, GEN_DNS));
+}
+
+void CertVerifyingHandshaker::infoCallback(const SSL* ssl, int, int) {
+  auto* handshaker = static_cast<CertVerifyingHandshaker*>(SSL_get_ex_data(ssl, handshakerIndex()));
+  ASSERT(handshaker != nullptr);
+  // The server's decision is known once its encrypted extensions have been read. That happens as
+  // the transport socket finishes the handshake, which notifies each change of state, and before
+  // it closes a connection whose early data was rejected.
+  if (!handshaker->early_data_attempted_ || handshaker->early_data_resolved_ ||
+      SSL_early_data_reason(ssl) == ssl_early_data_unknown) {
+    return;
+  }
+  handshaker->early_data_resolved_ = true;
+  if (SSL_early_data_accepted(ssl)) {
+    handshaker->verifier_->stats().early_data_accepted_.inc();
+    return;
+  }
+  handshaker->verifier_->stats().early_data_rejected_.inc();
+  const char* server_name = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+  if (server_name != nullptr) {
+    Network::EarlyDataRejections::onRejected(server_name);
+  }
+}
+
+ssl_verify_result_t CertVerifyingHandshaker::verify(uint8_t* out_alert) {
+  // BoringSSL calls back again each time the handshake is driven while a verification is
+  // outstanding, and once more after it completes to collect the result.
+  switch (verify_state_) {
+  case VerifyState::Pending:
+    return ssl_verify_retry;
+  case VerifyState::Succeeded:
+    return ssl_verify_ok;
+  case VerifyState::Failed:
+    *out_alert = SSL_AD_BAD_CERTIFICATE;
+    return ssl_verify_invalid;
+  case VerifyState::Idle:
+    break;
+  }
+
+  if (!verifier_->async()) {
+    return verifier_->verify(ssl(), out_alert);
+  }
+
+  std::weak_ptr<bool> alive = alive_;
+  const ssl_verify_result_t result = verifier_->verifyAsync(
+      ssl(), out_alert, callbacks_->connection().dispatcher(),
+      [this, alive](bool verified) -> void {
+        if (!alive.expired()) {
+          onVerifyComplete(verified);
+        }
+      });
+  if (result == ssl_verify_retry) {
+    verify_state_ = VerifyState::Pending;
+  }
+  return result;
+}
+
+void CertVerifyingHandshaker::onVerifyComplete(bool verified) {
+  ASSERT(verify_state_ == VerifyState::Pending);
+  verify_state_ = verified ? VerifyState::Succeeded : VerifyState::Failed;
+  // Nothing may arrive on the socket until the handshake progresses, so schedule a read to drive
+  // the handshake, which then collects the result from verify().
+  callbacks_->transportSocketCallbacks()->setTransportSocketIsReadable();
+}
+
+} // namespace CertVerifier
+} // namespace Tls
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "envoy/common/time.h"
+#include "envoy/event/dispatcher.h"
+#include "envoy/ssl/handshaker.h"
+#include "envoy/stats/scope.h"
+#include "envoy/stats/stats_macros.h"
+#include "envoy/thread/thread.h"
+
+#include "common/common/logger.h"
+
+#include "extensions/transport_sockets/tls/ssl_handshaker.h"
+
+#include "absl/types/optional.h"
+#include "library/common/extensions/tls/cert_verifier/cert_verifier.pb.h"
+#include "library/common/extensions/tls/cert_verifier/verification_cache.h"
+#include "library/common/extensions/tls/cert_verifier/verification_worker.h"
+#include "library/common/network/connection_coalescing.h"
+#include "openssl/ssl.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace Tls {
+namespace CertVerifier {
+
+/**
+ * All certificate verifier stats. @see stats_macros.h
+ */
+#define ALL_CERT_VERIFIER_STATS(COUNTER)                                                           \
+  COUNTER(cache_hit)                                                                               \
+  COUNTER(cache_miss)                                                                              \
+  COUNTER(cache_eviction)                                                                          \
+  COUNTER(verify_success)                                                                          \
+  COUNTER(verify_failure)                                                                          \
+  COUNTER(async_verify_started)                                                                    \
+  COUNTER(async_verify_abandoned)                                                                  \
+  COUNTER(early_data_attempted)                                                                    \
+  COUNTER(early_data_accepted)                                                                     \
+  COUNTER(early_data_rejected)                                                                     \
+  GAUGE(async_verify_pending, Accumulate)
+
+/**
+ * Struct definition for certificate verifier stats. @see stats_macros.h
+ */
+struct CertVerifierStats {
+  ALL_CERT_VERIFIER_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT)
+};
+
+/**
+ * Everything needed to verify a certificate chain independently of the connection it was
+ * presented on, so that verification can run on another thread while the connection proceeds (or
+ * is torn down) on its dispatcher.
+ */
+struct VerificationJob {
+  std::string key_;
+  bool cacheable_;
+  bssl::UniquePtr<STACK_OF(X509)> chain_;
+  bssl::UniquePtr<X509_STORE> store_;
+  bssl::UniquePtr<X509_VERIFY_PARAM> param_;
+};
+
+using VerificationJobSharedPtr = std::shared_ptr<VerificationJob>;
+
+/**
+ * Verifies peer certificate chains against the trust store of the SSL_CTX the connection was
+ * created from, remembering successful results in a VerificationCache. Shared by all handshakers
+ * created from the same TLS context configuration.
+ *
+ * When configured for asynchronous verification, chains which are not already cached are verified
+ * on a dedicated worker thread so that path building and signature checks do not stall the event
+ * loop of the connection being handshaked.
+ */
+class CertVerifier : public Logger::Loggable<Logger::Id::connection> {
+public:
+  using VerifyCompleteCb = std::function<void(bool verified)>;
+
+  CertVerifier(const envoymobile::extensions::tls::cert_verifier::CertVerifier& proto_config,
+               TimeSource& time_source, Stats::Scope& scope, Thread::ThreadFactory& thread_factory);
+
+  /**
+   * Verify the certificate chain presented by the peer of the connection.
+   * @param ssl, the connection being handshaked.
+   * @param out_alert, set to the TLS alert to send on failure.
+   * @return ssl_verify_result_t, the result of the verification.
+   */
+  ssl_verify_result_t verify(SSL* ssl, uint8_t* out_alert);
+
+  /**
+   * Verify the certificate chain presented by the peer of the connection without blocking, if
+   * the result is not already known.
+   * @param ssl, the connection being handshaked.
+   * @param out_alert, set to the TLS alert to send on failure.
+   * @param dispatcher, the dispatcher of the connection, on which on_complete will be called.
+   * @param on_complete, called with the outcome iff ssl_verify_retry is returned.
+   * @return ssl_verify_result_t, the result of the verification, or ssl_verify_retry if the
+   *         verification is in progress.
+   */
+  ssl_verify_result_t verifyAsync(SSL* ssl, uint8_t* out_alert, Event::Dispatcher& dispatcher,
+                                  VerifyCompleteCb on_complete);
+
+  /**
+   * @return bool whether verification should happen off of the connection's dispatcher.
+   */
+  bool async() const { return worker_ != nullptr; }
+
+  /**
+   * @return bool whether connections offer TLS 1.3 early data when resuming a session.
+   */
+  bool earlyData() const { return early_data_; }
+
+  CertVerifierStats& stats() { return stats_; }
+
+private:
+  static CertVerifierStats generateStats(const std::string& prefix, Stats::Scope& scope) {
+    return CertVerifierStats{ALL_CERT_VERIFIER_STATS(POOL_COUNTER_PREFIX(scope, prefix),
+                                                     POOL_GAUGE_PREFIX(scope, prefix))};
+  }
+
+  // Resolves the verification without examining the chain if the peer presented no certificates
+  // or the chain is cached. Otherwise returns absl::nullopt, having set key to the cache key.
+  absl::optional<ssl_verify_result_t> verifyFromCache(SSL* ssl, uint8_t* out_alert,
+                                                      std::string& key);
+  // Digest of the SNI and every DER-encoded certificate the peer presented.
+  static std::string cacheKey(SSL* ssl);
+  // Whether the trust store applies rules (e.g. revocation lists) that may change the outcome of
+  // verifying an unchanged chain, in which case results must not be cached.
+  static bool cacheable(SSL* ssl);
+  static VerificationJob createJob(SSL* ssl, std::string key);
+  // Performs full chain verification, returning the earliest expiration of the verified chain on
+  // success. Safe to call from any thread.
+  static absl::optional<SystemTime> verifyChain(const VerificationJob& job);
+  // Records the outcome of a full verification, returning whether it succeeded. Safe to call from
+  // any thread.
+  bool onChainVerified(const VerificationJob& job, absl::optional<SystemTime> chain_expiry);
+
+  TimeSource& time_source_;
+  const std::chrono::milliseconds cache_ttl_;
+  const bool early_data_;
+  VerificationCache cache_;
+  CertVerifierStats stats_;
+  // Declared last so that the worker thread is joined before any state it uses is destroyed.
+  std::unique_ptr<VerificationWorker> worker_;
+};
+
+using CertVerifierSharedPtr = std::shared_ptr<CertVerifier>;
+
+/**
+ * Handshaker which replaces the default X509 verification callback with one backed by a
+ * CertVerifier. Apart from verification, the handshake proceeds exactly as with the default
+ * handshaker, which drives it and reports its outcome through this handshaker's callbacks.
+ */
+class CertVerifyingHandshaker : public TransportSockets::Tls::SslHandshakerImpl,
+                                public Ssl::HandshakeCallbacks {
+public:
+  CertVerifyingHandshaker(bssl::UniquePtr<SSL> ssl, int ssl_extended_socket_info_index,
+                          Ssl::HandshakeCallbacks* handshake_callbacks,
+                          CertVerifierSharedPtr verifier);
+  ~CertVerifyingHandshaker() override;
+
+  // Ssl::Handshaker
+  Network::PostIoAction doHandshake() override;
+
+  // Ssl::HandshakeCallbacks
+  Network::Connection& connection() const override { return callbacks_->connection(); }
+  void onSuccess(SSL* ssl) override;
+  void onFailure() override;
+  Network::TransportSocketCallbacks* transportSocketCallbacks() override {
+    return callbacks_->transportSocketCallbacks();
+  }
+
+private:
+  enum class VerifyState { Idle, Pending, Succeeded, Failed };
+
+  static int handshakerIndex();
+  static ssl_verify_result_t verifyCallback(SSL* ssl, uint8_t* out_alert);
+  static void infoCallback(const SSL* ssl, int type, int value);
+  ssl_verify_result_t verify(uint8_t* out_alert);
+  void onVerifyComplete(bool verified);
+  void recordForCoalescing();
+
+  Ssl::HandshakeCallbacks* const callbacks_;
+  const CertVerifierSharedPtr verifier_;
+  VerifyState verify_state_{VerifyState::Idle};
+  // Whether the handshake was reported complete before the server's response, so that the first
+  // request is sent as early data.
+  bool early_data_attempted_{};
+  // Whether the server has accepted or rejected the early data.
+  bool early_data_resolved_{};
+  // Set while the connection is recorded as one requests may be coalesced onto.
+  absl::optional<Network::ConnectionCoalescing::ConnectionId> coalescing_id_;
+  // Observed by in-flight asynchronous verifications, which complete after the handshaker is
+  // destroyed if the connection is closed while they are running.
+  std::shared_ptr<bool> alive_{std::make_shared<bool>(true)};
+};
+
+} // namespace CertVerifier
+} // namespace Tls
+} // namespace Extensions
+} // namespace Envoy
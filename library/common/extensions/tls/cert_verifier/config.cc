@@ -0,0 +1,39 @@
+#include "library/common/extensions/tls/cert_verifier/config.h"
+
+#include "common/protobuf/utility.h"
+
+#include "library/common/extensions/tls/cert_verifier/cert_verifier.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace Tls {
+namespace CertVerifier {
+
+Ssl::HandshakerFactoryCb CertVerifierHandshakerFactory::createHandshakerCb(
+    const Protobuf::Message& message, Ssl::HandshakerFactoryContext& handshaker_factory_context,
+    ProtobufMessage::ValidationVisitor& validation_visitor) {
+  const auto& proto_config = MessageUtil::downcastAndValidate<
+      const envoymobile::extensions::tls::cert_verifier::CertVerifier&>(message,
+                                                                       validation_visitor);
+
+  // A single verifier, and therefore a single cache, is shared by all connections created from
+  // the same TLS context.
+  Api::Api& api = handshaker_factory_context.api();
+  CertVerifierSharedPtr verifier = std::make_shared<CertVerifier>(
+      proto_config, api.timeSource(), api.rootScope(), api.threadFactory());
+  return [verifier](bssl::UniquePtr<SSL> ssl, int ssl_extended_socket_info_index,
+                    Ssl::HandshakeCallbacks* handshake_callbacks) -> Ssl::HandshakerSharedPtr {
+    return std::make_shared<CertVerifyingHandshaker>(
+        std::move(ssl), ssl_extended_socket_info_index, handshake_callbacks, verifier);
+  };
+}
+
+/**
+ * Static registration for the certificate verifying handshaker. @see Ssl::HandshakerFactory.
+ */
+REGISTER_FACTORY(CertVerifierHandshakerFactory, Ssl::HandshakerFactory);
+
+} // namespace CertVerifier
+} // namespace Tls
+} // namespace Extensions
+} // namespace Envoy
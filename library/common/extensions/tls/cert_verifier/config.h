@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+
+#include "envoy/ssl/handshaker.h"
+
+#include "library/common/extensions/tls/cert_verifier/cert_verifier.pb.h"
+#include "library/common/extensions/tls/cert_verifier/cert_verifier.pb.validate.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace Tls {
+namespace CertVerifier {
+
+/**
+ * Config registration for the certificate verifying handshaker. @see Ssl::HandshakerFactory.
+ */
+class CertVerifierHandshakerFactory : public Ssl::HandshakerFactory {
+public:
+  std::string name() const override { return "envoy_mobile.tls.handshaker.cert_verifier"; }
+
+  ProtobufTypes::MessagePtr createEmptyConfigProto() override {
+    return std::make_unique<envoymobile::extensions::tls::cert_verifier::CertVerifier>();
+  }
+
+  Ssl::HandshakerFactoryCb
+  createHandshakerCb(const Protobuf::Message& message,
+                     Ssl::HandshakerFactoryContext& handshaker_factory_context,
+                     ProtobufMessage::ValidationVisitor& validation_visitor) override;
+
+  // Verification is configured per connection, so there is nothing to do on the SSL_CTX.
+  Ssl::SslCtxCb sslctxCb(Ssl::HandshakerFactoryContext&) const override {
+    return [](SSL_CTX*) {};
+  }
+};
+
+DECLARE_FACTORY(CertVerifierHandshakerFactory);
+
+} // namespace CertVerifier
+} // namespace Tls
+} // namespace Extensions
+} // namespace Envoy
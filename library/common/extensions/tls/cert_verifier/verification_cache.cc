@@ -0,0 +1,64 @@
+#include "library/common/extensions/tls/cert_verifier/verification_cache.h"
+
+#include "common/common/lock_guard.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace Tls {
+namespace CertVerifier {
+
+VerificationCache::VerificationCache(TimeSource& time_source, uint32_t max_entries)
+    : time_source_(time_source), max_entries_(max_entries) {}
+
+bool VerificationCache::lookup(const std::string& key) {
+  Thread::LockGuard lock(mutex_);
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return false;
+  }
+
+  if (time_source_.systemTime() >= it->second->expiry_) {
+    entries_.erase(it->second);
+    index_.erase(it);
+    return false;
+  }
+
+  // Move the entry to the front of the list to mark it most recently used.
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return true;
+}
+
+bool VerificationCache::insert(const std::string& key, SystemTime expiry) {
+  if (max_entries_ == 0 || expiry <= time_source_.systemTime()) {
+    return false;
+  }
+
+  Thread::LockGuard lock(mutex_);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    it->second->expiry_ = expiry;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return false;
+  }
+
+  bool evicted = false;
+  if (entries_.size() >= max_entries_) {
+    index_.erase(entries_.back().key_);
+    entries_.pop_back();
+    evicted = true;
+  }
+
+  entries_.push_front({key, expiry});
+  index_.emplace(key, entries_.begin());
+  return evicted;
+}
+
+size_t VerificationCache::size() {
+  Thread::LockGuard lock(mutex_);
+  return entries_.size();
+}
+
+} // namespace CertVerifier
+} // namespace Tls
+} // namespace Extensions
+} // namespace Envoy
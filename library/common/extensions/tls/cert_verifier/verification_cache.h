@@ -0,0 +1,62 @@
+#pragma once
+
+#include <list>
+#include <string>
+
+#include "envoy/common/time.h"
+
+#include "common/common/thread.h"
+
+#include "absl/container/flat_hash_map.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace Tls {
+namespace CertVerifier {
+
+/**
+ * Bounded LRU cache of successful certificate chain verifications. Entries are keyed by an opaque
+ * digest of the presented chain and SNI, and are considered valid until their expiry.
+ * Only successes are stored; a failed verification is always re-evaluated.
+ * This class is thread-safe.
+ */
+class VerificationCache {
+public:
+  VerificationCache(TimeSource& time_source, uint32_t max_entries);
+
+  /**
+   * Look up a prior verification result. Expired entries are removed on lookup.
+   * @param key, the digest identifying the chain and SNI.
+   * @return bool, whether a valid, unexpired successful verification is cached for key.
+   */
+  bool lookup(const std::string& key);
+
+  /**
+   * Record a successful verification.
+   * @param key, the digest identifying the chain and SNI.
+   * @param expiry, the point in time after which the result must no longer be trusted.
+   * @return bool, whether inserting the entry caused another entry to be evicted.
+   */
+  bool insert(const std::string& key, SystemTime expiry);
+
+  size_t size();
+
+private:
+  struct Entry {
+    std::string key_;
+    SystemTime expiry_;
+  };
+  using EntryList = std::list<Entry>;
+
+  TimeSource& time_source_;
+  const uint32_t max_entries_;
+  Thread::MutexBasicLockable mutex_;
+  // Most recently used entries are kept at the front of the list.
+  EntryList entries_ GUARDED_BY(mutex_);
+  absl::flat_hash_map<std::string, EntryList::iterator> index_ GUARDED_BY(mutex_);
+};
+
+} // namespace CertVerifier
+} // namespace Tls
+} // namespace Extensions
+} // namespace Envoy
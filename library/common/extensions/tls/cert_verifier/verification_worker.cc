@@ -0,0 +1,51 @@
+#include "library/common/extensions/tls/cert_verifier/verification_worker.h"
+
+#include "common/common/lock_guard.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace Tls {
+namespace CertVerifier {
+
+VerificationWorker::VerificationWorker(Thread::ThreadFactory& thread_factory)
+    : thread_(thread_factory.createThread([this]() -> void { run(); })) {}
+
+VerificationWorker::~VerificationWorker() {
+  {
+    Thread::LockGuard lock(mutex_);
+    shutdown_ = true;
+    queue_.clear();
+    cv_.notifyOne();
+  }
+  thread_->join();
+}
+
+void VerificationWorker::post(Work work) {
+  Thread::LockGuard lock(mutex_);
+  queue_.push_back(std::move(work));
+  cv_.notifyOne();
+}
+
+void VerificationWorker::run() {
+  while (true) {
+    Work work;
+    {
+      Thread::LockGuard lock(mutex_);
+      while (queue_.empty() && !shutdown_) {
+        cv_.wait(mutex_);
+      }
+      if (shutdown_) {
+        return;
+      }
+      work = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    // Work runs without holding the lock so that new work can be posted concurrently.
+    work();
+  }
+}
+
+} // namespace CertVerifier
+} // namespace Tls
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <functional>
+#include <list>
+
+#include "envoy/thread/thread.h"
+
+#include "common/common/thread.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace Tls {
+namespace CertVerifier {
+
+/**
+ * A single background thread which runs certificate verification work in FIFO order, keeping it
+ * off of the event loop. Results are expected to be posted back to the relevant dispatcher by the
+ * work itself. Destroying the worker discards any work that has not yet started and joins the
+ * thread.
+ */
+class VerificationWorker {
+public:
+  using Work = std::function<void()>;
+
+  VerificationWorker(Thread::ThreadFactory& thread_factory);
+  ~VerificationWorker();
+
+  /**
+   * Queue work to be run on the worker thread. This is safe to call from any thread.
+   * @param work, the functor to run.
+   */
+  void post(Work work);
+
+private:
+  void run();
+
+  Thread::MutexBasicLockable mutex_;
+  Thread::CondVar cv_;
+  std::list<Work> queue_ GUARDED_BY(mutex_);
+  bool shutdown_ GUARDED_BY(mutex_){};
+  // thread_ must be declared last so that it starts after the above state is initialized.
+  Thread::ThreadPtr thread_;
+};
+
+using VerificationWorkerSharedPtr = std::shared_ptr<VerificationWorker>;
+
+} // namespace CertVerifier
+} // namespace Tls
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,231 @@
+#include "library/common/http/alt_svc_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+
+namespace Envoy {
+namespace Http {
+
+namespace {
+
+// The freshness of an alternative service which does not specify a max-age, per RFC 7838.
+constexpr std::chrono::seconds DefaultMaxAge{24 * 60 * 60};
+
+// Splits a header value on a delimiter, ignoring delimiters within quoted strings.
+std::vector<absl::string_view> splitOutsideQuotes(absl::string_view value, char delimiter) {
+  std::vector<absl::string_view> parts;
+  bool quoted = false;
+  size_t start = 0;
+  for (size_t i = 0; i < value.size(); i++) {
+    if (value[i] == '"') {
+      quoted = !quoted;
+    } else if (value[i] == delimiter && !quoted) {
+      parts.push_back(value.substr(start, i - start));
+      start = i + 1;
+    }
+  }
+  parts.push_back(value.substr(start));
+  return parts;
+}
+
+// Whether two lists of services are the same, other than in when they expire.
+bool sameServices(const std::vector<AltSvcCache::AlternativeService>& a,
+                  const std::vector<AltSvcCache::AlternativeService>& b) {
+  return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                    [](const AltSvcCache::AlternativeService& service_a,
+                       const AltSvcCache::AlternativeService& service_b) {
+                      return service_a.protocol_ == service_b.protocol_ &&
+                             service_a.host_ == service_b.host_ &&
+                             service_a.port_ == service_b.port_;
+                    });
+}
+
+int64_t toEpochSeconds(SystemTime time) {
+  return std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count();
+}
+
+} // namespace
+
+constexpr std::chrono::seconds AltSvcCache::BrokenDuration;
+
+AltSvcCache::AltSvcCache(TimeSource& time_source) : time_source_(time_source) {}
+
+std::vector<AltSvcCache::AlternativeService> AltSvcCache::parse(absl::string_view alt_svc,
+                                                                 SystemTime now) {
+  std::vector<AlternativeService> services;
+  for (absl::string_view alternative : splitOutsideQuotes(alt_svc, ',')) {
+    alternative = absl::StripAsciiWhitespace(alternative);
+    if (alternative == "clear") {
+      return {};
+    }
+    const std::vector<absl::string_view> parts = splitOutsideQuotes(alternative, ';');
+    const absl::string_view service = absl::StripAsciiWhitespace(parts[0]);
+    const size_t equals = service.find('=');
+    if (equals == absl::string_view::npos) {
+      continue;
+    }
+    const absl::string_view protocol = service.substr(0, equals);
+    if (protocol != "h3" && !absl::StartsWith(protocol, "h3-")) {
+      continue;
+    }
+    absl::string_view authority = service.substr(equals + 1);
+    if (authority.size() < 2 || authority.front() != '"' || authority.back() != '"') {
+      continue;
+    }
+    authority = authority.substr(1, authority.size() - 2);
+    const size_t colon = authority.rfind(':');
+    uint32_t port;
+    if (colon == absl::string_view::npos ||
+        !absl::SimpleAtoi(authority.substr(colon + 1), &port) || port == 0 || port > 65535) {
+      continue;
+    }
+
+    std::chrono::seconds max_age = DefaultMaxAge;
+    for (size_t i = 1; i < parts.size(); i++) {
+      absl::string_view parameter = absl::StripAsciiWhitespace(parts[i]);
+      uint64_t seconds;
+      if (absl::ConsumePrefix(&parameter, "ma=") && absl::SimpleAtoi(parameter, &seconds)) {
+        max_age = std::chrono::seconds(seconds);
+      }
+    }
+    services.push_back(
+        {std::string(protocol), std::string(authority.substr(0, colon)), port, now + max_age});
+  }
+  return services;
+}
+
+bool AltSvcCache::onAltSvc(absl::string_view origin, absl::string_view alt_svc) {
+  std::vector<AlternativeService> services = parse(alt_svc, time_source_.systemTime());
+  auto it = origins_.find(origin);
+  if (services.empty()) {
+    if (it == origins_.end()) {
+      return false;
+    }
+    origins_.erase(it);
+    return true;
+  }
+
+  if (it != origins_.end() && sameServices(it->second.services_, services)) {
+    // Origins re-advertise their services on every response. Only their freshness changes, which
+    // is not worth saving for.
+    it->second.services_ = std::move(services);
+    return false;
+  }
+  if (it == origins_.end()) {
+    if (origins_.size() >= MaxOrigins) {
+      const SystemTime now = time_source_.systemTime();
+      for (auto expired = origins_.begin(); expired != origins_.end();) {
+        const auto& expired_services = expired->second.services_;
+        if (std::all_of(expired_services.begin(), expired_services.end(),
+                        [now](const AlternativeService& service) {
+                          return service.expiration_ <= now;
+                        })) {
+          origins_.erase(expired++);
+        } else {
+          ++expired;
+        }
+      }
+      if (origins_.size() >= MaxOrigins) {
+        return false;
+      }
+    }
+    it = origins_.emplace(std::string(origin), Origin()).first;
+  }
+  it->second.services_ = std::move(services);
+  return true;
+}
+
+absl::optional<AltSvcCache::AlternativeService> AltSvcCache::findHttp3(absl::string_view origin) {
+  auto it = origins_.find(origin);
+  if (it == origins_.end()) {
+    return absl::nullopt;
+  }
+  Origin& entry = it->second;
+  if (entry.broken_until_.has_value()) {
+    if (time_source_.monotonicTime() < entry.broken_until_.value()) {
+      return absl::nullopt;
+    }
+    entry.broken_until_.reset();
+  }
+
+  const SystemTime now = time_source_.systemTime();
+  auto& services = entry.services_;
+  services.erase(std::remove_if(services.begin(), services.end(),
+                                [now](const AlternativeService& service) {
+                                  return service.expiration_ <= now;
+                                }),
+                 services.end());
+  if (services.empty()) {
+    origins_.erase(it);
+    return absl::nullopt;
+  }
+  return services.front();
+}
+
+void AltSvcCache::markBroken(absl::string_view origin) {
+  auto it = origins_.find(origin);
+  if (it != origins_.end()) {
+    it->second.broken_until_ = time_source_.monotonicTime() + BrokenDuration;
+  }
+}
+
+bool AltSvcCache::persistTo(const std::string& path) {
+  path_ = path;
+  std::ifstream file(path_);
+  if (!file) {
+    return false;
+  }
+  // Each line holds one service: origin, protocol, host, port and expiration, separated by tabs.
+  const int64_t now = toEpochSeconds(time_source_.systemTime());
+  std::string line;
+  while (std::getline(file, line)) {
+    const std::vector<absl::string_view> fields = absl::StrSplit(line, '\t');
+    uint32_t port;
+    int64_t expiration;
+    if (fields.size() != 5 || !absl::SimpleAtoi(fields[3], &port) ||
+        !absl::SimpleAtoi(fields[4], &expiration) || expiration <= now) {
+      continue;
+    }
+    const std::string origin(fields[0]);
+    if (origins_.size() >= MaxOrigins && origins_.find(origin) == origins_.end()) {
+      continue;
+    }
+    origins_[origin].services_.push_back({std::string(fields[1]), std::string(fields[2]), port,
+                                          SystemTime(std::chrono::seconds(expiration))});
+  }
+  return true;
+}
+
+bool AltSvcCache::save() {
+  if (path_.empty()) {
+    return false;
+  }
+  // Written to a temporary file first, so that the cache is never left partially written.
+  const std::string temporary_path = absl::StrCat(path_, ".tmp");
+  {
+    std::ofstream file(temporary_path, std::ios::out | std::ios::trunc);
+    const SystemTime now = time_source_.systemTime();
+    for (const auto& origin : origins_) {
+      for (const AlternativeService& service : origin.second.services_) {
+        if (service.expiration_ > now) {
+          file << origin.first << '\t' << service.protocol_ << '\t' << service.host_ << '\t'
+               << service.port_ << '\t' << toEpochSeconds(service.expiration_) << '\n';
+        }
+      }
+    }
+    if (!file) {
+      return false;
+    }
+  }
+  return std::rename(temporary_path.c_str(), path_.c_str()) == 0;
+}
+
+} // namespace Http
+} // namespace Envoy
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "envoy/common/time.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+
+namespace Envoy {
+namespace Http {
+
+/**
+ * Cache of the HTTP/3 alternative services origins advertise through Alt-Svc response headers
+ * (RFC 7838), keyed by origin authority. Entries are held until they expire, and may be persisted
+ * to a file so that they survive restarts of the app. Origins whose HTTP/3 service fails to
+ * connect, e.g. because UDP is blocked on the current network, are marked broken for a while, in
+ * which time they are not returned.
+ * This class is not thread-safe.
+ */
+class AltSvcCache {
+public:
+  struct AlternativeService {
+    // The ALPN protocol id, e.g. "h3" or "h3-29".
+    std::string protocol_;
+    // The host of the service. Empty if it is the origin's host.
+    std::string host_;
+    uint32_t port_;
+    SystemTime expiration_;
+  };
+
+  static constexpr uint32_t MaxOrigins = 1000;
+  static constexpr std::chrono::seconds BrokenDuration{300};
+
+  explicit AltSvcCache(TimeSource& time_source);
+
+  /**
+   * Record the alternative services advertised by a response, replacing those previously recorded
+   * for its origin.
+   * @param origin, the authority of the request.
+   * @param alt_svc, the value of the response's Alt-Svc header.
+   * @return bool whether the origin's services changed, other than in when they expire, i.e.
+   *         whether the cache should be saved.
+   */
+  bool onAltSvc(absl::string_view origin, absl::string_view alt_svc);
+
+  /**
+   * @param origin, the authority of a request.
+   * @return the HTTP/3 alternative service to use for the origin, if there is one which has not
+   *         expired and the origin is not marked broken.
+   */
+  absl::optional<AlternativeService> findHttp3(absl::string_view origin);
+
+  /**
+   * Stop returning the origin's HTTP/3 service for BrokenDuration, so that requests fall back to
+   * TCP.
+   * @param origin, the authority of a request whose HTTP/3 connection failed.
+   */
+  void markBroken(absl::string_view origin);
+
+  /**
+   * Load entries from a file written by save(), and have save() write to it from then on.
+   * Entries which expired in the meantime are discarded.
+   * @param path, the file to persist the cache to.
+   * @return bool whether existing entries were loaded.
+   */
+  bool persistTo(const std::string& path);
+
+  /**
+   * Write all unexpired entries to the persistence file, if there is one. The cache does not save
+   * itself; its owner calls this after onAltSvc() reports a change, batching changes as it likes.
+   * @return bool whether the entries were written.
+   */
+  bool save();
+
+  /**
+   * Parse the value of an Alt-Svc header into the HTTP/3 services it advertises. Services for
+   * other protocols are ignored. "clear" results in no services.
+   * @param alt_svc, the header value.
+   * @param now, the time the header was received, from which max-age is counted.
+   * @return the HTTP/3 services, in order of preference.
+   */
+  static std::vector<AlternativeService> parse(absl::string_view alt_svc, SystemTime now);
+
+private:
+  struct Origin {
+    std::vector<AlternativeService> services_;
+    absl::optional<MonotonicTime> broken_until_;
+  };
+
+  TimeSource& time_source_;
+  std::string path_;
+  absl::flat_hash_map<std::string, Origin> origins_;
+};
+
+} // namespace Http
+} // namespace Envoy
@@ -1,20 +1,65 @@
 #include "library/common/http/dispatcher.h"
 
 #include "common/buffer/buffer_impl.h"
+#include "common/common/enum_to_int.h"
 #include "common/common/lock_guard.h"
 #include "common/http/codes.h"
+#include "common/http/header_map_impl.h"
 #include "common/http/headers.h"
 #include "common/http/utility.h"
 
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
 #include "library/common/buffer/bridge_fragment.h"
 #include "library/common/buffer/utility.h"
 #include "library/common/http/header_utility.h"
+#include "library/common/logging/binary_log.h"
+#include "library/common/network/early_data_rejections.h"
 #include "library/common/network/synthetic_address_impl.h"
+#include "library/common/stats/bridge_copy_stats.h"
 #include "library/common/thread/lock_guard.h"
 
 namespace Envoy {
 namespace Http {
 
+namespace {
+const LowerCaseString ClusterHeader{"x-envoy-mobile-cluster"};
+const std::string BaseCluster = "base";
+const std::string BaseWlanCluster = "base_wlan";
+const std::string BaseWwanCluster = "base_wwan";
+const LowerCaseString UpstreamProtocolHeader{"x-envoy-mobile-upstream-protocol"};
+const std::string Http3Protocol = "http3";
+const std::string H2Suffix = "_h2";
+const std::string BaseClusterH2 = BaseCluster + H2Suffix;
+const std::string BaseWlanClusterH2 = BaseWlanCluster + H2Suffix;
+const std::string BaseWwanClusterH2 = BaseWwanCluster + H2Suffix;
+const std::string H3Suffix = "_h3";
+const std::string BaseClusterH3 = BaseCluster + H3Suffix;
+const std::string BaseWlanClusterH3 = BaseWlanCluster + H3Suffix;
+const std::string BaseWwanClusterH3 = BaseWwanCluster + H3Suffix;
+const LowerCaseString AltSvcHeader{"alt-svc"};
+// How long changes to the Alt-Svc cache are batched for before it is saved.
+constexpr std::chrono::milliseconds AltSvcSaveDelay{5000};
+const LowerCaseString EarlyDataHeader{"x-envoy-mobile-early-data"};
+const std::string EarlyDataSuffix = "_early_data";
+
+enum class UpstreamProtocol { Http1, Http2, Http3 };
+
+const std::string& clusterFor(UpstreamProtocol protocol, const std::string& http1_cluster,
+                              const std::string& http2_cluster, const std::string& http3_cluster) {
+  switch (protocol) {
+  case UpstreamProtocol::Http2:
+    return http2_cluster;
+  case UpstreamProtocol::Http3:
+    return http3_cluster;
+  case UpstreamProtocol::Http1:
+  default:
+    return http1_cluster;
+  }
+}
+} // namespace
+
 /**
  * IMPORTANT: stream closure semantics in envoy mobile depends on the fact that the HCM fires a
  * stream reset when the remote side of the stream is closed but the local side remains open.
@@ -29,16 +74,29 @@ Dispatcher::DirectStreamCallbacks::DirectStreamCallbacks(DirectStream& direct_st
     : direct_stream_(direct_stream), bridge_callbacks_(bridge_callbacks),
       http_dispatcher_(http_dispatcher) {}
 
+Dispatcher::DirectStreamCallbacks::DirectStreamCallbacks(DirectStream& direct_stream,
+                                                         ClientStreamCallbacks& client_callbacks,
+                                                         Dispatcher& http_dispatcher)
+    : direct_stream_(direct_stream), bridge_callbacks_{}, client_callbacks_(&client_callbacks),
+      http_dispatcher_(http_dispatcher) {}
+
+Dispatcher::DirectStreamCallbacks::DirectStreamCallbacks(DirectStream& direct_stream,
+                                                         const DirectStreamCallbacks& callbacks)
+    : direct_stream_(direct_stream), bridge_callbacks_(callbacks.bridge_callbacks_),
+      client_callbacks_(callbacks.client_callbacks_), http_dispatcher_(callbacks.http_dispatcher_) {
+}
+
 void Dispatcher::DirectStreamCallbacks::encodeHeaders(const ResponseHeaderMap& headers,
                                                       bool end_stream) {
-  ENVOY_LOG(debug, "[S{}] response headers for stream (end_stream={}):\n{}",
-            direct_stream_.stream_handle_, end_stream, headers);
+  ENVOY_MOBILE_LOG(debug, "[S{}] response headers for stream (end_stream={}):\n{}",
+                   direct_stream_.stream_handle_, end_stream, headers);
 
   ASSERT(http_dispatcher_.getStream(direct_stream_.stream_handle_));
 
   uint64_t response_status = Utility::getResponseStatus(headers);
-  // Track success for later bookkeeping (stream could still be reset).
-  success_ = CodeUtility::is2xx(response_status);
+  // Track success for later bookkeeping (stream could still be reset). Upgrades succeed with a 101.
+  success_ = CodeUtility::is2xx(response_status) ||
+             (direct_stream_.upgrade_ && response_status == enumToInt(Code::SwitchingProtocols));
 
   if (end_stream) {
     closeStream();
@@ -52,7 +110,7 @@ void Dispatcher::DirectStreamCallbacks::encodeHeaders(const ResponseHeaderMap& h
   // Error path: missing EnvoyUpstreamServiceTime implies this is a local reply, which we treat as
   // a stream error.
   if (!success_ && headers.get(Headers::get().EnvoyUpstreamServiceTime).empty()) {
-    ENVOY_LOG(debug, "[S{}] intercepted local response", direct_stream_.stream_handle_);
+    ENVOY_MOBILE_LOG(debug, "[S{}] intercepted local response", direct_stream_.stream_handle_);
     mapLocalResponseToError(headers);
     if (end_stream) {
       onError();
@@ -61,14 +119,41 @@ void Dispatcher::DirectStreamCallbacks::encodeHeaders(const ResponseHeaderMap& h
   }
 
   // Normal response path.
+  StreamProgress& progress = *direct_stream_.progress_;
+  if (progress.state_.load(std::memory_order_relaxed) == ENVOY_STREAM_AWAITING_RESPONSE) {
+    // The server has received the whole request once it responds to it.
+    progress.bytes_acknowledged_.store(progress.bytes_sent_.load(std::memory_order_relaxed),
+                                       std::memory_order_relaxed);
+  }
+  progress.state_.store(ENVOY_STREAM_RECEIVING_RESPONSE, std::memory_order_release);
+
+  if (!direct_stream_.authority_.empty()) {
+    http_dispatcher_.recordAltSvc(direct_stream_, headers);
+  }
+
+  // An extended CONNECT request is accepted with a 200, rather than the 101 of an HTTP/1 upgrade.
+  ResponseHeaderMapPtr upgrade_headers;
+  if (direct_stream_.extended_connect_ &&
+      response_status == enumToInt(Code::SwitchingProtocols)) {
+    upgrade_headers = createHeaderMap<ResponseHeaderMapImpl>(headers);
+    Utility::transformUpgradeResponseFromH1toH2(*upgrade_headers);
+  }
+  const ResponseHeaderMap& dispatched_headers =
+      upgrade_headers != nullptr ? *upgrade_headers : headers;
 
   // Testing hook.
   http_dispatcher_.synchronizer_.syncPoint("dispatch_encode_headers");
 
-  ENVOY_LOG(debug, "[S{}] dispatching to platform response headers for stream (end_stream={}):\n{}",
-            direct_stream_.stream_handle_, end_stream, headers);
-  bridge_callbacks_.on_headers(Utility::toBridgeHeaders(headers), end_stream,
-                               bridge_callbacks_.context);
+  ENVOY_MOBILE_LOG(debug,
+                   "[S{}] dispatching to platform response headers for stream (end_stream={}):\n{}",
+                   direct_stream_.stream_handle_, end_stream, dispatched_headers);
+  if (client_callbacks_ != nullptr) {
+    client_callbacks_->onHeaders(createHeaderMap<ResponseHeaderMapImpl>(dispatched_headers),
+                                 end_stream);
+  } else {
+    bridge_callbacks_.on_headers(Utility::toBridgeHeaders(dispatched_headers), end_stream,
+                                 bridge_callbacks_.context);
+  }
   if (end_stream) {
     onComplete();
   }
@@ -95,8 +180,8 @@ void Dispatcher::DirectStreamCallbacks::mapLocalResponseToError(const ResponseHe
 }
 
 void Dispatcher::DirectStreamCallbacks::encodeData(Buffer::Instance& data, bool end_stream) {
-  ENVOY_LOG(debug, "[S{}] response data for stream (length={} end_stream={})",
-            direct_stream_.stream_handle_, data.length(), end_stream);
+  ENVOY_MOBILE_LOG(debug, "[S{}] response data for stream (length={} end_stream={})",
+                   direct_stream_.stream_handle_, data.length(), end_stream);
 
   ASSERT(http_dispatcher_.getStream(direct_stream_.stream_handle_));
   if (end_stream) {
@@ -108,41 +193,81 @@ void Dispatcher::DirectStreamCallbacks::encodeData(Buffer::Instance& data, bool
     ASSERT(end_stream,
            "local response has to end the stream with a single data frame. If Envoy changes "
            "this expectation, this code needs to be updated.");
-    error_message_ = Buffer::Utility::toBridgeData(data);
+    if (client_callbacks_ != nullptr) {
+      client_error_message_ = data.toString();
+    } else {
+      error_message_ = Buffer::Utility::toBridgeData(data);
+    }
     onError();
     return;
   }
 
   // Normal path.
+  direct_stream_.progress_->bytes_received_.fetch_add(data.length(), std::memory_order_relaxed);
 
   // Testing hook.
   if (end_stream) {
     http_dispatcher_.synchronizer_.syncPoint("dispatch_encode_final_data");
   }
 
-  ENVOY_LOG(debug,
-            "[S{}] dispatching to platform response data for stream (length={} end_stream={})",
-            direct_stream_.stream_handle_, data.length(), end_stream);
-  bridge_callbacks_.on_data(Buffer::Utility::toBridgeData(data), end_stream,
-                            bridge_callbacks_.context);
+  ENVOY_MOBILE_LOG(
+      debug, "[S{}] dispatching to platform response data for stream (length={} end_stream={})",
+      direct_stream_.stream_handle_, data.length(), end_stream);
+  if (client_callbacks_ != nullptr) {
+    // The response data is moved rather than copied.
+    auto client_data = std::make_unique<Buffer::OwnedImpl>();
+    client_data->move(data);
+    client_callbacks_->onData(std::move(client_data), end_stream);
+  } else {
+    bridge_callbacks_.on_data(Buffer::Utility::toBridgeData(data), end_stream,
+                              bridge_callbacks_.context);
+  }
   if (end_stream) {
     onComplete();
   }
 }
 
 void Dispatcher::DirectStreamCallbacks::encodeTrailers(const ResponseTrailerMap& trailers) {
-  ENVOY_LOG(debug, "[S{}] response trailers for stream:\n{}", direct_stream_.stream_handle_,
-            trailers);
+  ENVOY_MOBILE_LOG(debug, "[S{}] response trailers for stream:\n{}", direct_stream_.stream_handle_,
+                   trailers);
 
   ASSERT(http_dispatcher_.getStream(direct_stream_.stream_handle_));
   closeStream(); // Trailers always indicate the end of the stream.
 
-  ENVOY_LOG(debug, "[S{}] dispatching to platform response trailers for stream:\n{}",
-            direct_stream_.stream_handle_, trailers);
-  bridge_callbacks_.on_trailers(Utility::toBridgeHeaders(trailers), bridge_callbacks_.context);
+  ENVOY_MOBILE_LOG(debug, "[S{}] dispatching to platform response trailers for stream:\n{}",
+                   direct_stream_.stream_handle_, trailers);
+  if (client_callbacks_ != nullptr) {
+    client_callbacks_->onTrailers(createHeaderMap<ResponseTrailerMapImpl>(trailers));
+  } else {
+    bridge_callbacks_.on_trailers(Utility::toBridgeHeaders(trailers), bridge_callbacks_.context);
+  }
   onComplete();
 }
 
+void Dispatcher::DirectStreamCallbacks::encode100ContinueHeaders(const ResponseHeaderMap&) {
+  // The caller does not wait for a 100-continue before sending a request body, so the interim
+  // response carries nothing for it.
+  ENVOY_MOBILE_LOG(debug, "[S{}] dropping 100-continue response headers for stream",
+                   direct_stream_.stream_handle_);
+}
+
+void Dispatcher::DirectStreamCallbacks::encodeMetadata(
+    const MetadataMapVector& metadata_map_vector) {
+  // Metadata is only delivered to platforms which handle it. Streams started through the C++
+  // interface have no callback for it.
+  if (client_callbacks_ != nullptr || bridge_callbacks_.on_metadata == nullptr) {
+    ENVOY_MOBILE_LOG(debug, "[S{}] dropping response metadata for stream",
+                     direct_stream_.stream_handle_);
+    return;
+  }
+  for (const MetadataMapPtr& metadata_map : metadata_map_vector) {
+    ENVOY_MOBILE_LOG(debug, "[S{}] dispatching to platform response metadata for stream (size={})",
+                     direct_stream_.stream_handle_, metadata_map->size());
+    bridge_callbacks_.on_metadata(Utility::toBridgeMetadata(*metadata_map),
+                                  bridge_callbacks_.context);
+  }
+}
+
 void Dispatcher::DirectStreamCallbacks::closeStream() {
   // Envoy itself does not currently allow half-open streams where the local half is open
   // but the remote half is closed. Note that if local is open, Envoy will reset the stream.
@@ -150,45 +275,72 @@ void Dispatcher::DirectStreamCallbacks::closeStream() {
 }
 
 void Dispatcher::DirectStreamCallbacks::onComplete() {
-  ENVOY_LOG(debug, "[S{}] complete stream (success={})", direct_stream_.stream_handle_, success_);
+  ENVOY_MOBILE_LOG(debug, "[S{}] complete stream (success={})", direct_stream_.stream_handle_,
+                   success_);
+  http_dispatcher_.stream_progress_->untrack(direct_stream_.stream_handle_);
   if (success_) {
     http_dispatcher_.stats().stream_success_.inc();
   } else {
     http_dispatcher_.stats().stream_failure_.inc();
   }
-  bridge_callbacks_.on_complete(bridge_callbacks_.context);
+  if (client_callbacks_ != nullptr) {
+    client_callbacks_->onComplete();
+  } else {
+    bridge_callbacks_.on_complete(bridge_callbacks_.context);
+  }
 }
 
 void Dispatcher::DirectStreamCallbacks::onError() {
-  ENVOY_LOG(debug, "[S{}] remote reset stream", direct_stream_.stream_handle_);
+  ENVOY_MOBILE_LOG(debug, "[S{}] remote reset stream", direct_stream_.stream_handle_);
 
   // The stream should no longer be preset in the map, because onError() was either called from a
   // terminal callback that mapped to an error or it was called in response to a resetStream().
   ASSERT(!http_dispatcher_.getStream(direct_stream_.stream_handle_));
   envoy_error_code_t code = error_code_.value_or(ENVOY_STREAM_RESET);
-  envoy_data message = error_message_.value_or(envoy_nodata);
-  int32_t attempt_count = error_attempt_count_.value_or(-1);
+
+  // Later requests to the origin fall back to TCP if its HTTP/3 service could not be reached.
+  if (code == ENVOY_CONNECTION_FAILURE && direct_stream_.http3_) {
+    http_dispatcher_.alt_svc_cache_->markBroken(direct_stream_.authority_);
+  }
+
+  // The caller is not told about the failure if the request is replayed.
+  if (code == ENVOY_CONNECTION_FAILURE && http_dispatcher_.replayStream(direct_stream_)) {
+    return;
+  }
+  http_dispatcher_.stream_progress_->untrack(direct_stream_.stream_handle_);
 
   // Testing hook.
   http_dispatcher_.synchronizer_.syncPoint("dispatch_on_error");
 
-  ENVOY_LOG(debug, "[S{}] dispatching to platform remote reset stream",
-            direct_stream_.stream_handle_);
+  ENVOY_MOBILE_LOG(debug, "[S{}] dispatching to platform remote reset stream",
+                   direct_stream_.stream_handle_);
   http_dispatcher_.stats().stream_failure_.inc();
+  if (client_callbacks_ != nullptr) {
+    client_callbacks_->onError({code, client_error_message_, error_attempt_count_});
+    return;
+  }
+  envoy_data message = error_message_.value_or(envoy_nodata);
+  int32_t attempt_count = error_attempt_count_.value_or(-1);
   bridge_callbacks_.on_error({code, message, attempt_count}, bridge_callbacks_.context);
 }
 
 void Dispatcher::DirectStreamCallbacks::onCancel() {
-  ENVOY_LOG(debug, "[S{}] dispatching to platform cancel stream", direct_stream_.stream_handle_);
+  ENVOY_MOBILE_LOG(debug, "[S{}] dispatching to platform cancel stream",
+                   direct_stream_.stream_handle_);
+  http_dispatcher_.stream_progress_->untrack(direct_stream_.stream_handle_);
   http_dispatcher_.stats().stream_cancel_.inc();
-  bridge_callbacks_.on_cancel(bridge_callbacks_.context);
+  if (client_callbacks_ != nullptr) {
+    client_callbacks_->onCancel();
+  } else {
+    bridge_callbacks_.on_cancel(bridge_callbacks_.context);
+  }
 }
 
 Dispatcher::DirectStream::DirectStream(envoy_stream_t stream_handle, Dispatcher& http_dispatcher)
     : stream_handle_(stream_handle), parent_(http_dispatcher) {}
 
 Dispatcher::DirectStream::~DirectStream() {
-  ENVOY_LOG(debug, "[S{}] destroy stream", stream_handle_);
+  ENVOY_MOBILE_LOG(debug, "[S{}] destroy stream", stream_handle_);
 }
 
 void Dispatcher::DirectStream::resetStream(StreamResetReason reason) {
@@ -206,10 +358,46 @@ void Dispatcher::DirectStream::resetStream(StreamResetReason reason) {
   callbacks_->onError();
 }
 
+void Dispatcher::DirectStream::readDisable(bool disable) {
+  if (disable) {
+    read_disable_count_++;
+    return;
+  }
+  ASSERT(read_disable_count_ > 0);
+  if (read_disable_count_ == 0 || --read_disable_count_ > 0) {
+    return;
+  }
+  if (!request_held_ && (replay_ == nullptr || !replay_->replaying_)) {
+    return;
+  }
+  // Like a codec resuming reads, the held request, or the replay, is passed on from the event loop
+  // rather than from within the connection manager.
+  TS_UNCHECKED_READ(parent_.event_dispatcher_)
+      ->post([&parent = parent_, stream_handle = stream_handle_]() -> void {
+        parent.doResumeRequest(stream_handle);
+      });
+}
+
 Dispatcher::Dispatcher(std::atomic<envoy_network_t>& preferred_network)
     : stats_prefix_("http.dispatcher."), preferred_network_(preferred_network),
       address_(std::make_shared<Network::Address::SyntheticAddressImpl>()) {}
 
+Dispatcher::~Dispatcher() { Stats::BridgeCopyStats::clearThreadCounters(bridge_copy_counters_); }
+
+void Dispatcher::terminate() {
+  // Spilled chunks being read back are posted to the event loop, so the worker is stopped first.
+  spill_worker_.reset();
+  // The event loop has exited, so changes still waiting to be saved are saved here.
+  if (alt_svc_save_timer_ != nullptr && alt_svc_save_timer_->enabled()) {
+    alt_svc_cache_->save();
+  }
+  alt_svc_save_timer_.reset();
+  // Streams started before the engine was ready never will be. Dropping their posts stops tracking
+  // their progress.
+  Thread::LockGuard lock(ready_lock_);
+  init_queue_.clear();
+}
+
 void Dispatcher::ready(Event::Dispatcher& event_dispatcher, Stats::Scope& scope,
                        ApiListener& api_listener) {
   Thread::LockGuard lock(ready_lock_);
@@ -222,6 +410,17 @@ void Dispatcher::ready(Event::Dispatcher& event_dispatcher, Stats::Scope& scope,
   // Ordering somewhat matters here if concurrency guarantees are loosened (e.g. if
   // we rely on atomics instead of locks).
   stats_.emplace(generateStats(stats_prefix_, scope));
+  if (Stats::BridgeCopyStats::Enabled) {
+    for (size_t i = 0; i < Stats::BridgeCopyStats::SiteCount; i++) {
+      const std::string prefix = absl::StrCat(
+          stats_prefix_, "bridge.", Stats::BridgeCopyStats::name(Stats::BridgeCopySite(i)), ".");
+      bridge_copy_counters_.push_back({scope.counterFromString(prefix + "bytes_copied"),
+                                       scope.counterFromString(prefix + "allocations")});
+    }
+    // ready() is called on the event_dispatcher_'s thread, which only does work for this engine.
+    Stats::BridgeCopyStats::setThreadCounters(bridge_copy_counters_);
+  }
+  alt_svc_cache_ = std::make_unique<AltSvcCache>(event_dispatcher.timeSource());
   event_dispatcher_ = &event_dispatcher;
   api_listener_ = &api_listener;
 }
@@ -231,6 +430,8 @@ void Dispatcher::post(Event::PostCb callback) {
 
   // If the event_dispatcher_ is set, then post the functor directly to it.
   if (event_dispatcher_ != nullptr) {
+    // Copies the calling thread made to hand this work over are charged to this engine.
+    Stats::BridgeCopyStats::chargeThreadCopies(bridge_copy_counters_);
     event_dispatcher_->post(callback);
     return;
   }
@@ -240,28 +441,78 @@ void Dispatcher::post(Event::PostCb callback) {
   init_queue_.push_back(callback);
 }
 
+Memory::StreamArenaSharedPtr Dispatcher::newStreamArena() {
+  const uint64_t block_bytes = stream_arena_block_bytes_.load(std::memory_order_relaxed);
+  return block_bytes > 0 ? std::make_shared<Memory::StreamArena>(block_bytes) : nullptr;
+}
+
+Dispatcher::DirectStreamSharedPtr
+Dispatcher::newDirectStream(envoy_stream_t stream_handle, Memory::StreamArenaSharedPtr arena) {
+  DirectStreamSharedPtr direct_stream =
+      Memory::makeArenaShared<DirectStream>(arena, stream_handle, *this);
+  direct_stream->arena_ = std::move(arena);
+  return direct_stream;
+}
+
 envoy_status_t Dispatcher::startStream(envoy_stream_t new_stream_handle,
-                                       envoy_http_callbacks bridge_callbacks) {
-  post([this, new_stream_handle, bridge_callbacks]() -> void {
-    Dispatcher::DirectStreamSharedPtr direct_stream{new DirectStream(new_stream_handle, *this)};
+                                       envoy_http_callbacks bridge_callbacks,
+                                       absl::optional<envoy_stream_group_t> group) {
+  // The progress is tracked from here so that it can be read as soon as the stream is started.
+  // The arena is only used from the event loop once the stream is posted to it.
+  Memory::StreamArenaSharedPtr arena = newStreamArena();
+  // If the post never runs, e.g. because the engine is terminated before it is ready, releasing
+  // the progress with it stops tracking the stream.
+  StreamProgressSharedPtr progress = stream_progress_->track(new_stream_handle);
+  post([this, new_stream_handle, bridge_callbacks, group, progress, arena]() -> void {
+    DirectStreamSharedPtr direct_stream = newDirectStream(new_stream_handle, arena);
+    direct_stream->callbacks_ = Memory::makeArenaPtr<DirectStreamCallbacks>(
+        arena.get(), *direct_stream, bridge_callbacks, *this);
+    direct_stream->progress_ = progress;
+    doStartStream(std::move(direct_stream), group);
+  });
+
+  return ENVOY_SUCCESS;
+}
+
+envoy_status_t Dispatcher::startStream(envoy_stream_t new_stream_handle,
+                                       ClientStreamCallbacks& callbacks,
+                                       absl::optional<envoy_stream_group_t> group) {
+  Memory::StreamArenaSharedPtr arena = newStreamArena();
+  StreamProgressSharedPtr progress = stream_progress_->track(new_stream_handle);
+  post([this, new_stream_handle, &callbacks, group, progress, arena]() -> void {
+    DirectStreamSharedPtr direct_stream = newDirectStream(new_stream_handle, arena);
     direct_stream->callbacks_ =
-        std::make_unique<DirectStreamCallbacks>(*direct_stream, bridge_callbacks, *this);
-
-    // Only the initial setting of the api_listener_ is guarded.
-    //
-    // Note: streams created by Envoy Mobile are tagged as is_internally_created. This means that
-    // the Http::ConnectionManager _will not_ sanitize headers when creating a stream.
-    direct_stream->request_decoder_ =
-        &TS_UNCHECKED_READ(api_listener_)
-             ->newStream(*direct_stream->callbacks_, true /* is_internally_created */);
-
-    streams_.emplace(new_stream_handle, std::move(direct_stream));
-    ENVOY_LOG(debug, "[S{}] start stream", new_stream_handle);
+        Memory::makeArenaPtr<DirectStreamCallbacks>(arena.get(), *direct_stream, callbacks, *this);
+    direct_stream->progress_ = progress;
+    doStartStream(std::move(direct_stream), group);
   });
 
   return ENVOY_SUCCESS;
 }
 
+void Dispatcher::doStartStream(DirectStreamSharedPtr&& direct_stream,
+                               absl::optional<envoy_stream_group_t> group) {
+  const envoy_stream_t new_stream_handle = direct_stream->stream_handle_;
+  direct_stream->group_ = group;
+
+  // Only the initial setting of the api_listener_ is guarded.
+  //
+  // Note: streams created by Envoy Mobile are tagged as is_internally_created. This means that
+  // the Http::ConnectionManager _will not_ sanitize headers when creating a stream.
+  direct_stream->request_decoder_ =
+      &TS_UNCHECKED_READ(api_listener_)
+           ->newStream(*direct_stream->callbacks_, true /* is_internally_created */);
+
+  streams_.emplace(new_stream_handle, std::move(direct_stream));
+  if (streams_.size() == 1 && idle_callback_) {
+    idle_callback_(false);
+  }
+  if (group.has_value()) {
+    stream_groups_[group.value()].insert(new_stream_handle);
+  }
+  ENVOY_MOBILE_LOG(debug, "[S{}] start stream", new_stream_handle);
+}
+
 envoy_status_t Dispatcher::sendHeaders(envoy_stream_t stream, envoy_headers headers,
                                        bool end_stream) {
   post([this, stream, headers, end_stream]() -> void {
@@ -274,31 +525,77 @@ envoy_status_t Dispatcher::sendHeaders(envoy_stream_t stream, envoy_headers head
     // from the caller.
     // https://github.com/lyft/envoy-mobile/issues/301
     if (direct_stream) {
-      RequestHeaderMapPtr internal_headers = Utility::toRequestHeaders(headers);
-      setDestinationCluster(*internal_headers);
-      // Set the x-forwarded-proto header to https because Envoy Mobile only has clusters with TLS
-      // enabled. This is done here because the ApiListener's synthetic connection would make the
-      // Http::ConnectionManager set the scheme to http otherwise. In the future we might want to
-      // configure the connection instead of setting the header here.
-      // https://github.com/envoyproxy/envoy/issues/10291
-      //
-      // Setting this header is also currently important because Envoy Mobile starts stream with the
-      // ApiListener setting the is_internally_created bool to true. This means the
-      // Http::ConnectionManager *will not* mutate Envoy Mobile's request headers. One of the
-      // mutations done is adding the x-forwarded-proto header if not present. Unfortunately, the
-      // router relies on the present of this header to determine if it should provided a route for
-      // a request here:
-      // https://github.com/envoyproxy/envoy/blob/c9e3b9d2c453c7fe56a0e3615f0c742ac0d5e768/source/common/router/config_impl.cc#L1091-L1096
-      internal_headers->setReferenceForwardedProto(Headers::get().SchemeValues.Https);
-      ENVOY_LOG(debug, "[S{}] request headers for stream (end_stream={}):\n{}", stream, end_stream,
-                *internal_headers);
-      direct_stream->request_decoder_->decodeHeaders(std::move(internal_headers), end_stream);
+      doSendHeaders(*direct_stream, Utility::toRequestHeaders(headers), end_stream);
+    }
+  });
+
+  return ENVOY_SUCCESS;
+}
+
+envoy_status_t Dispatcher::sendHeaders(envoy_stream_t stream, RequestHeaderMapPtr headers,
+                                       bool end_stream) {
+  // Posted callbacks must be copyable, so the headers are held by a shared holder.
+  auto holder = std::make_shared<RequestHeaderMapPtr>(std::move(headers));
+  post([this, stream, holder, end_stream]() -> void {
+    // @see sendHeaders(envoy_stream_t, envoy_headers, bool) regarding missing streams.
+    Dispatcher::DirectStreamSharedPtr direct_stream = getStream(stream);
+    if (direct_stream) {
+      doSendHeaders(*direct_stream, std::move(*holder), end_stream);
     }
   });
 
   return ENVOY_SUCCESS;
 }
 
+void Dispatcher::doSendHeaders(DirectStream& direct_stream, RequestHeaderMapPtr&& headers,
+                               bool end_stream) {
+  if (http3_enabled_) {
+    selectHttp3(direct_stream, *headers);
+  }
+  setDestinationCluster(*headers);
+  // Set the x-forwarded-proto header to https because Envoy Mobile only has clusters with TLS
+  // enabled. This is done here because the ApiListener's synthetic connection would make the
+  // Http::ConnectionManager set the scheme to http otherwise. In the future we might want to
+  // configure the connection instead of setting the header here.
+  // https://github.com/envoyproxy/envoy/issues/10291
+  //
+  // Setting this header is also currently important because Envoy Mobile starts stream with the
+  // ApiListener setting the is_internally_created bool to true. This means the
+  // Http::ConnectionManager *will not* mutate Envoy Mobile's request headers. One of the
+  // mutations done is adding the x-forwarded-proto header if not present. Unfortunately, the
+  // router relies on the present of this header to determine if it should provided a route for
+  // a request here:
+  // https://github.com/envoyproxy/envoy/blob/c9e3b9d2c453c7fe56a0e3615f0c742ac0d5e768/source/common/router/config_impl.cc#L1091-L1096
+  headers->setReferenceForwardedProto(Headers::get().SchemeValues.Https);
+
+  // Extended CONNECT requests (RFC 8441) are passed to the connection manager as the equivalent
+  // HTTP/1 upgrade, as an HTTP/2 codec would. Upstream HTTP/2 connections send them as extended
+  // CONNECT requests again.
+  if (Utility::isH2UpgradeRequest(*headers)) {
+    Utility::transformUpgradeRequestFromH2toH1(*headers);
+    direct_stream.extended_connect_ = true;
+  }
+  direct_stream.upgrade_ = Utility::isUpgrade(*headers) ||
+                           headers->getMethodValue() == Headers::get().MethodValues.Connect;
+
+  // Requests which allow retries are recorded so they can be replayed, @see enableRequestReplay.
+  uint32_t max_retries;
+  const auto max_retries_header = headers->get(Headers::get().EnvoyMaxRetries);
+  if (replay_enabled_ && !end_stream && !direct_stream.upgrade_ && !max_retries_header.empty() &&
+      absl::SimpleAtoi(max_retries_header[0]->value().getStringView(), &max_retries) &&
+      max_retries > 0) {
+    direct_stream.replay_ = std::make_shared<RequestReplay>(
+        replay_memory_limit_bytes_, replay_spill_directory_, spillExecutor(), max_retries);
+    direct_stream.replay_->headers_ = createHeaderMap<RequestHeaderMapImpl>(*headers);
+  }
+  selectEarlyData(direct_stream, *headers, end_stream);
+
+  ENVOY_MOBILE_LOG(debug, "[S{}] request headers for stream (end_stream={}):\n{}",
+                   direct_stream.stream_handle_, end_stream, *headers);
+  recordRequestProgress(direct_stream, 0, end_stream);
+  direct_stream.request_decoder_->decodeHeaders(std::move(headers), end_stream);
+}
+
 envoy_status_t Dispatcher::sendData(envoy_stream_t stream, envoy_data data, bool end_stream) {
   post([this, stream, data, end_stream]() -> void {
     Dispatcher::DirectStreamSharedPtr direct_stream = getStream(stream);
@@ -313,16 +610,53 @@ envoy_status_t Dispatcher::sendData(envoy_stream_t stream, envoy_data data, bool
       // The buffer is moved internally, in a synchronous fashion, so we don't need the lifetime
       // of the InstancePtr to outlive this function call.
       Buffer::InstancePtr buf = Buffer::Utility::toInternalData(data);
+      doSendData(*direct_stream, *buf, end_stream);
+    }
+  });
+
+  return ENVOY_SUCCESS;
+}
 
-      ENVOY_LOG(debug, "[S{}] request data for stream (length={} end_stream={})\n", stream,
-                data.length, end_stream);
-      direct_stream->request_decoder_->decodeData(*buf, end_stream);
+envoy_status_t Dispatcher::sendData(envoy_stream_t stream, Buffer::InstancePtr data,
+                                    bool end_stream) {
+  // Posted callbacks must be copyable, so the data is held by a shared holder.
+  std::shared_ptr<Buffer::Instance> holder = std::move(data);
+  post([this, stream, holder, end_stream]() -> void {
+    // @see sendData(envoy_stream_t, envoy_data, bool) regarding missing streams.
+    Dispatcher::DirectStreamSharedPtr direct_stream = getStream(stream);
+    if (direct_stream) {
+      doSendData(*direct_stream, *holder, end_stream);
     }
   });
 
   return ENVOY_SUCCESS;
 }
 
+void Dispatcher::doSendData(DirectStream& direct_stream, Buffer::Instance& data, bool end_stream) {
+  ENVOY_MOBILE_LOG(debug, "[S{}] request data for stream (length={} end_stream={})\n",
+                   direct_stream.stream_handle_, data.length(), end_stream);
+  if (direct_stream.replay_ != nullptr) {
+    RequestReplay& replay = *direct_stream.replay_;
+    const bool recorded = replay.body_.add(data);
+    replay.end_stream_ = end_stream;
+    if (replay.pending_ || replay.replaying_) {
+      if (!recorded) {
+        // The data cannot be sent in order with the replay, so the request is lost.
+        direct_stream.resetStream(StreamResetReason::LocalReset);
+      }
+      return;
+    }
+  }
+  if (direct_stream.read_disable_count_ > 0 || direct_stream.request_held_) {
+    direct_stream.request_held_ = true;
+    direct_stream.held_data_.move(data);
+    direct_stream.held_end_stream_ = end_stream;
+    return;
+  }
+  recordRequestProgress(direct_stream, data.length(), end_stream);
+  direct_stream.request_decoder_->decodeData(data, end_stream);
+}
+
 envoy_status_t Dispatcher::sendMetadata(envoy_stream_t, envoy_headers) {
   NOT_IMPLEMENTED_GCOVR_EXCL_LINE;
 }
@@ -338,41 +672,322 @@ envoy_status_t Dispatcher::sendTrailers(envoy_stream_t stream, envoy_headers tra
     // from the caller.
     // https://github.com/lyft/envoy-mobile/issues/301
     if (direct_stream) {
-      RequestTrailerMapPtr internal_trailers = Utility::toRequestTrailers(trailers);
-      ENVOY_LOG(debug, "[S{}] request trailers for stream:\n{}", stream, *internal_trailers);
-      direct_stream->request_decoder_->decodeTrailers(std::move(internal_trailers));
+      doSendTrailers(*direct_stream, Utility::toRequestTrailers(trailers));
     }
   });
 
   return ENVOY_SUCCESS;
 }
 
+envoy_status_t Dispatcher::sendTrailers(envoy_stream_t stream, RequestTrailerMapPtr trailers) {
+  // Posted callbacks must be copyable, so the trailers are held by a shared holder.
+  auto holder = std::make_shared<RequestTrailerMapPtr>(std::move(trailers));
+  post([this, stream, holder]() -> void {
+    // @see sendTrailers(envoy_stream_t, envoy_headers) regarding missing streams.
+    Dispatcher::DirectStreamSharedPtr direct_stream = getStream(stream);
+    if (direct_stream) {
+      doSendTrailers(*direct_stream, std::move(*holder));
+    }
+  });
+
+  return ENVOY_SUCCESS;
+}
+
+void Dispatcher::doSendTrailers(DirectStream& direct_stream, RequestTrailerMapPtr&& trailers) {
+  ENVOY_MOBILE_LOG(debug, "[S{}] request trailers for stream:\n{}", direct_stream.stream_handle_,
+                   *trailers);
+  if (direct_stream.replay_ != nullptr) {
+    RequestReplay& replay = *direct_stream.replay_;
+    replay.trailers_ = createHeaderMap<RequestTrailerMapImpl>(*trailers);
+    replay.end_stream_ = true;
+    if (replay.pending_ || replay.replaying_) {
+      return;
+    }
+  }
+  if (direct_stream.read_disable_count_ > 0 || direct_stream.request_held_) {
+    direct_stream.request_held_ = true;
+    direct_stream.held_trailers_ = std::move(trailers);
+    return;
+  }
+  recordRequestProgress(direct_stream, 0, true);
+  direct_stream.request_decoder_->decodeTrailers(std::move(trailers));
+}
+
 envoy_status_t Dispatcher::cancelStream(envoy_stream_t stream) {
   post([this, stream]() -> void {
     Dispatcher::DirectStreamSharedPtr direct_stream = getStream(stream);
     if (direct_stream) {
-      removeStream(direct_stream->stream_handle_);
-
-      // Testing hook.
-      synchronizer_.syncPoint("dispatch_on_cancel");
-      direct_stream->callbacks_->onCancel();
-
-      // Since https://github.com/envoyproxy/envoy/pull/13052, the connection manager expects that
-      // response code details are set on all possible paths for streams.
-      direct_stream->setResponseDetails(getCancelDetails());
-
-      // The runResetCallbacks call synchronously causes Envoy to defer delete the HCM's
-      // ActiveStream. We have some concern that this could potentially race a terminal callback
-      // scheduled on the same iteration of the event loop. If we see violations in the callback
-      // assertions checking stream presence, this is a likely potential culprit. However, it's
-      // plausible that upstream guards will protect us here, given that Envoy allows streams to be
-      // reset from a wide variety of contexts without apparent issue.
-      direct_stream->runResetCallbacks(StreamResetReason::RemoteReset);
+      doCancelStream(*direct_stream);
+    }
+  });
+  return ENVOY_SUCCESS;
+}
+
+envoy_status_t Dispatcher::cancelStreamGroup(envoy_stream_group_t group) {
+  post([this, group]() -> void {
+    auto group_it = stream_groups_.find(group);
+    if (group_it == stream_groups_.end()) {
+      return;
+    }
+    // Cancelling a stream removes it from its group, so iterate over a copy of the members.
+    const std::vector<envoy_stream_t> members(group_it->second.begin(), group_it->second.end());
+    ENVOY_MOBILE_LOG(debug, "[G{}] cancel stream group ({} streams)", group, members.size());
+    stats().stream_group_cancel_.inc();
+    for (envoy_stream_t stream : members) {
+      // A stream's callbacks may have cancelled or completed other streams in the group.
+      Dispatcher::DirectStreamSharedPtr direct_stream = getStream(stream);
+      if (direct_stream) {
+        doCancelStream(*direct_stream);
+      }
+    }
+  });
+  return ENVOY_SUCCESS;
+}
+
+envoy_status_t Dispatcher::pauseResponse(envoy_stream_t stream, bool paused) {
+  post([this, stream, paused]() -> void {
+    Dispatcher::DirectStreamSharedPtr direct_stream = getStream(stream);
+    if (!direct_stream || direct_stream->response_paused_ == paused) {
+      return;
+    }
+    ENVOY_MOBILE_LOG(debug, "[S{}] {} response for stream", stream, paused ? "pause" : "resume");
+    direct_stream->response_paused_ = paused;
+    // The stream appears to the connection manager as a downstream whose write buffer has filled
+    // or drained, so the router stops or resumes reading the response from upstream.
+    if (paused) {
+      direct_stream->runHighWatermarkCallbacks();
+    } else {
+      direct_stream->runLowWatermarkCallbacks();
+    }
+  });
+  return ENVOY_SUCCESS;
+}
+
+void Dispatcher::doResumeRequest(envoy_stream_t stream_handle) {
+  DirectStreamSharedPtr direct_stream = getStream(stream_handle);
+  // The stream may have closed, or had reading disabled again, since the resume was scheduled.
+  if (!direct_stream || direct_stream->read_disable_count_ > 0) {
+    return;
+  }
+  // Nothing is held while a request is replayed, as the caller's data is only recorded.
+  if (direct_stream->replay_ != nullptr && direct_stream->replay_->replaying_) {
+    replayRequestBody(*direct_stream);
+    return;
+  }
+  if (!direct_stream->request_held_) {
+    return;
+  }
+  ENVOY_MOBILE_LOG(debug, "[S{}] resume request for stream (length={} end_stream={})",
+                   stream_handle, direct_stream->held_data_.length(),
+                   direct_stream->held_end_stream_);
+  direct_stream->request_held_ = false;
+  RequestTrailerMapPtr trailers = std::move(direct_stream->held_trailers_);
+  if (direct_stream->held_data_.length() > 0 || direct_stream->held_end_stream_) {
+    const bool end_stream = direct_stream->held_end_stream_;
+    direct_stream->held_end_stream_ = false;
+    recordRequestProgress(*direct_stream, direct_stream->held_data_.length(), end_stream);
+    direct_stream->request_decoder_->decodeData(direct_stream->held_data_, end_stream);
+  }
+  if (trailers != nullptr && getStream(stream_handle) == direct_stream) {
+    recordRequestProgress(*direct_stream, 0, true);
+    direct_stream->request_decoder_->decodeTrailers(std::move(trailers));
+  }
+}
+
+void Dispatcher::doCancelStream(DirectStream& direct_stream) {
+  removeStream(direct_stream.stream_handle_);
+
+  // Testing hook.
+  synchronizer_.syncPoint("dispatch_on_cancel");
+  direct_stream.callbacks_->onCancel();
+
+  // Since https://github.com/envoyproxy/envoy/pull/13052, the connection manager expects that
+  // response code details are set on all possible paths for streams.
+  direct_stream.setResponseDetails(getCancelDetails());
+
+  // The runResetCallbacks call synchronously causes Envoy to defer delete the HCM's ActiveStream.
+  // We have some concern that this could potentially race a terminal callback scheduled on the
+  // same iteration of the event loop. If we see violations in the callback assertions checking
+  // stream presence, this is a likely potential culprit. However, it's plausible that upstream
+  // guards will protect us here, given that Envoy allows streams to be reset from a wide variety
+  // of contexts without apparent issue.
+  direct_stream.runResetCallbacks(StreamResetReason::RemoteReset);
+}
+
+bool Dispatcher::replayStream(DirectStream& failed_stream) {
+  const RequestReplaySharedPtr replay = failed_stream.replay_;
+  if (replay == nullptr || replay->replays_remaining_ == 0 || !replay->body_.complete()) {
+    return false;
+  }
+  if (replay->early_data_) {
+    // Requests sent as early data are only replayed if the server rejected it, whatever their
+    // size, as the router's retries would be sent as early data again. Other failures are reported
+    // as they would be without early data.
+    if (Network::EarlyDataRejections::rejections(replay->early_data_server_name_) ==
+        replay->early_data_rejections_) {
+      return false;
+    }
+    ENVOY_MOBILE_LOG(debug, "[S{}] early data rejected", failed_stream.stream_handle_);
+  } else if (replay->body_.length() <= failed_stream.bufferLimit()) {
+    // Requests with bodies which fit in the stream's buffer are retried by the router itself, so
+    // the failure means its retries are exhausted.
+    return false;
+  }
+
+  const envoy_stream_t stream_handle = failed_stream.stream_handle_;
+  ENVOY_MOBILE_LOG(debug, "[S{}] replay stream (length={} spilled={})", stream_handle,
+                   replay->body_.length(), replay->body_.spilled());
+  stats().stream_replay_.inc();
+  replay->replays_remaining_--;
+  replay->pending_ = true;
+  replay->replaying_ = false;
+  replay->replayed_bytes_ = 0;
+  replay->reading_ = false;
+  replay->attempt_++;
+  failed_stream.replay_.reset();
+
+  DirectStreamSharedPtr direct_stream = newDirectStream(stream_handle, failed_stream.arena_);
+  direct_stream->callbacks_ = Memory::makeArenaPtr<DirectStreamCallbacks>(
+      failed_stream.arena_.get(), *direct_stream, *failed_stream.callbacks_);
+  direct_stream->replay_ = replay;
+  // The request is sent again from the start.
+  direct_stream->progress_ = failed_stream.progress_;
+  direct_stream->progress_->bytes_sent_.store(0, std::memory_order_relaxed);
+  direct_stream->progress_->bytes_acknowledged_.store(0, std::memory_order_relaxed);
+  direct_stream->progress_->bytes_received_.store(0, std::memory_order_relaxed);
+  direct_stream->progress_->state_.store(ENVOY_STREAM_SENDING_REQUEST, std::memory_order_release);
+  doStartStream(std::move(direct_stream), failed_stream.group_);
+
+  // The request is sent once the connection manager has finished with the failed stream.
+  TS_UNCHECKED_READ(event_dispatcher_)->post([this, stream_handle]() -> void {
+    doReplayStream(stream_handle);
+  });
+  return true;
+}
+
+namespace {
+// The size of the data frames a replayed request body is sent in.
+constexpr uint64_t ReplayChunkBytes = 64 * 1024;
+} // namespace
+
+void Dispatcher::doReplayStream(envoy_stream_t stream_handle) {
+  DirectStreamSharedPtr direct_stream = getStream(stream_handle);
+  // The stream may have been cancelled before the replay.
+  if (!direct_stream || direct_stream->replay_ == nullptr || !direct_stream->replay_->pending_) {
+    return;
+  }
+  RequestReplay& replay = *direct_stream->replay_;
+  replay.pending_ = false;
+
+  RequestHeaderMapPtr headers = createHeaderMap<RequestHeaderMapImpl>(*replay.headers_);
+  ENVOY_MOBILE_LOG(debug, "[S{}] replaying request headers for stream:\n{}", stream_handle,
+                   *headers);
+  const bool headers_end_stream =
+      replay.end_stream_ && replay.body_.length() == 0 && replay.trailers_ == nullptr;
+  replay.replaying_ = !headers_end_stream;
+  recordRequestProgress(*direct_stream, 0, headers_end_stream);
+  direct_stream->request_decoder_->decodeHeaders(std::move(headers), headers_end_stream);
+  // The stream may have failed, and been replaced, when its headers were sent.
+  if (!headers_end_stream && getStream(stream_handle) == direct_stream) {
+    replayRequestBody(*direct_stream);
+  }
+}
+
+void Dispatcher::replayRequestBody(DirectStream& direct_stream) {
+  RequestReplay& replay = *direct_stream.replay_;
+  // Like the caller's data, the replay waits while the connection manager has reading disabled,
+  // and is resumed by doResumeRequest.
+  if (replay.reading_ || direct_stream.read_disable_count_ > 0) {
+    return;
+  }
+  if (replay.replayed_bytes_ < replay.body_.length()) {
+    // Each chunk is sent on its own iteration of the event loop; spilled chunks are read back on
+    // the spill worker meanwhile.
+    replay.reading_ = true;
+    replay.body_.read(replay.replayed_bytes_, ReplayChunkBytes,
+                      [this, stream_handle = direct_stream.stream_handle_,
+                       attempt = replay.attempt_](Buffer::InstancePtr chunk) -> void {
+                        // Posted callbacks must be copyable, so the chunk is held by a shared
+                        // holder.
+                        std::shared_ptr<Buffer::Instance> holder = std::move(chunk);
+                        post([this, stream_handle, attempt, holder]() -> void {
+                          doReplayChunk(stream_handle, attempt, holder.get());
+                        });
+                      });
+    return;
+  }
+
+  // The whole request recorded so far has been replayed, so the stream carries on as normal.
+  replay.replaying_ = false;
+  if (replay.trailers_ != nullptr) {
+    recordRequestProgress(direct_stream, 0, true);
+    direct_stream.request_decoder_->decodeTrailers(
+        createHeaderMap<RequestTrailerMapImpl>(*replay.trailers_));
+  } else if (replay.end_stream_) {
+    // The caller ended the request after the last chunk was sent.
+    Buffer::OwnedImpl empty;
+    recordRequestProgress(direct_stream, 0, true);
+    direct_stream.request_decoder_->decodeData(empty, true);
+  }
+}
+
+void Dispatcher::doReplayChunk(envoy_stream_t stream_handle, uint32_t attempt,
+                               Buffer::Instance* chunk) {
+  DirectStreamSharedPtr direct_stream = getStream(stream_handle);
+  // The stream may have closed, or failed and been replaced, while the chunk was read back.
+  if (!direct_stream || direct_stream->replay_ == nullptr ||
+      direct_stream->replay_->attempt_ != attempt || !direct_stream->replay_->reading_) {
+    return;
+  }
+  RequestReplay& replay = *direct_stream->replay_;
+  replay.reading_ = false;
+  if (chunk == nullptr) {
+    ENVOY_MOBILE_LOG(debug, "[S{}] replayed request body could not be read", stream_handle);
+    direct_stream->resetStream(StreamResetReason::LocalReset);
+    return;
+  }
+
+  replay.replayed_bytes_ += chunk->length();
+  const bool end_stream = replay.replayed_bytes_ == replay.body_.length() && replay.end_stream_ &&
+                          replay.trailers_ == nullptr;
+  if (end_stream) {
+    replay.replaying_ = false;
+  }
+  recordRequestProgress(*direct_stream, chunk->length(), end_stream);
+  direct_stream->request_decoder_->decodeData(*chunk, end_stream);
+  // Sending the chunk may have failed the stream, or had the connection manager disable reading.
+  if (!end_stream && getStream(stream_handle) == direct_stream) {
+    replayRequestBody(*direct_stream);
+  }
+}
+
+Buffer::SpillingReplayBuffer::Executor Dispatcher::spillExecutor() {
+  return [this](std::function<void()> work) -> void {
+    // Nothing is spilled or read back once the event loop has exited, @see terminate.
+    if (spill_worker_ != nullptr) {
+      spill_worker_->post(std::move(work));
+    }
+  };
+}
+
+envoy_status_t Dispatcher::enableRequestReplay(uint64_t memory_limit_bytes,
+                                               std::string spill_directory) {
+  post([this, memory_limit_bytes, spill_directory]() -> void {
+    replay_enabled_ = true;
+    replay_memory_limit_bytes_ = memory_limit_bytes;
+    replay_spill_directory_ = spill_directory;
+    if (spill_worker_ == nullptr) {
+      spill_worker_ = std::make_unique<Thread::WorkerThread>();
     }
   });
   return ENVOY_SUCCESS;
 }
 
+envoy_status_t Dispatcher::enableStreamArena(uint64_t block_bytes) {
+  stream_arena_block_bytes_.store(block_bytes, std::memory_order_relaxed);
+  return ENVOY_SUCCESS;
+}
+
 const DispatcherStats& Dispatcher::stats() const {
   // Only the initial setting of the api_listener_ is guarded.
   // By the time the Http::Dispatcher is using its stats ready must have been called.
@@ -393,6 +1008,15 @@ void Dispatcher::removeStream(envoy_stream_t stream_handle) {
   RELEASE_ASSERT(direct_stream,
                  "removeStream is a private method that is only called with stream ids that exist");
 
+  if (direct_stream->group_.has_value()) {
+    auto group_it = stream_groups_.find(direct_stream->group_.value());
+    ASSERT(group_it != stream_groups_.end());
+    group_it->second.erase(stream_handle);
+    if (group_it->second.empty()) {
+      stream_groups_.erase(group_it);
+    }
+  }
+
   // The DirectStream should live through synchronous code that already has a reference to it.
   // Hence why it is scheduled for deferred deletion. If this was all that was needed then it
   // would be sufficient to return a shared_ptr in getStream. However, deferred deletion is still
@@ -405,52 +1029,157 @@ void Dispatcher::removeStream(envoy_stream_t stream_handle) {
   // Hence why it is synchronously erased from the streams map.
   size_t erased = streams_.erase(stream_handle);
   ASSERT(erased == 1, "removeStream should always remove one entry from the streams map");
-  ENVOY_LOG(debug, "[S{}] erased stream from streams container", stream_handle);
+  ENVOY_MOBILE_LOG(debug, "[S{}] erased stream from streams container", stream_handle);
+  if (streams_.empty() && idle_callback_) {
+    idle_callback_(true);
+  }
 }
 
-namespace {
-const LowerCaseString ClusterHeader{"x-envoy-mobile-cluster"};
-const std::string BaseCluster = "base";
-const std::string BaseWlanCluster = "base_wlan";
-const std::string BaseWwanCluster = "base_wwan";
-const LowerCaseString H2UpstreamHeader{"x-envoy-mobile-upstream-protocol"};
-const std::string H2Suffix = "_h2";
-const std::string BaseClusterH2 = BaseCluster + H2Suffix;
-const std::string BaseWlanClusterH2 = BaseWlanCluster + H2Suffix;
-const std::string BaseWwanClusterH2 = BaseWwanCluster + H2Suffix;
-} // namespace
+envoy_status_t Dispatcher::getStreamProgress(envoy_stream_t stream,
+                                             envoy_stream_progress& progress) {
+  return stream_progress_->read(stream, progress) ? ENVOY_SUCCESS : ENVOY_FAILURE;
+}
+
+void Dispatcher::recordRequestProgress(DirectStream& direct_stream, uint64_t bytes,
+                                       bool end_stream) {
+  StreamProgress& progress = *direct_stream.progress_;
+  progress.bytes_sent_.fetch_add(bytes, std::memory_order_relaxed);
+  // The response may have started before the request ended.
+  if (end_stream &&
+      progress.state_.load(std::memory_order_relaxed) == ENVOY_STREAM_SENDING_REQUEST) {
+    progress.state_.store(ENVOY_STREAM_AWAITING_RESPONSE, std::memory_order_release);
+  }
+}
 
 void Dispatcher::setDestinationCluster(HeaderMap& headers) {
 
-  // Determine upstream protocol. Use http2 if selected for explicitly, otherwise (any other value,
-  // absence of value) select http1.
-  // TODO(junr03): once http3 is available this would probably benefit from some sort of struct that
-  // maps to appropriate cluster names. However, with only two options (http1/2) this suffices.
-  bool use_h2_cluster{};
-  auto get_result = headers.get(H2UpstreamHeader);
+  // Determine upstream protocol. Use http2 or http3 if selected for explicitly, otherwise (any
+  // other value, absence of value) select http1. The HTTP/3 clusters only exist if HTTP/3 was
+  // enabled, so http3 falls back to http2 otherwise.
+  UpstreamProtocol protocol = UpstreamProtocol::Http1;
+  auto get_result = headers.get(UpstreamProtocolHeader);
   if (!get_result.empty()) {
     ASSERT(get_result.size() == 1);
     const auto value = get_result[0]->value().getStringView();
     if (value == "http2") {
-      use_h2_cluster = true;
+      protocol = UpstreamProtocol::Http2;
+    } else if (value == Http3Protocol) {
+      if (http3_enabled_) {
+        protocol = UpstreamProtocol::Http3;
+      } else {
+        ENVOY_MOBILE_LOG(debug, "http3 requested without HTTP/3 enabled, using http2");
+        protocol = UpstreamProtocol::Http2;
+      }
     } else {
       ASSERT(value == "http1", fmt::format("using unsupported protocol version {}", value));
     }
-    headers.remove(H2UpstreamHeader);
+    headers.remove(UpstreamProtocolHeader);
   }
 
   switch (preferred_network_.load()) {
   case ENVOY_NET_WLAN:
-    headers.addReference(ClusterHeader, use_h2_cluster ? BaseWlanClusterH2 : BaseWlanCluster);
+    headers.addReference(ClusterHeader, clusterFor(protocol, BaseWlanCluster, BaseWlanClusterH2,
+                                                   BaseWlanClusterH3));
     break;
   case ENVOY_NET_WWAN:
-    headers.addReference(ClusterHeader, use_h2_cluster ? BaseWwanClusterH2 : BaseWwanCluster);
+    headers.addReference(ClusterHeader, clusterFor(protocol, BaseWwanCluster, BaseWwanClusterH2,
+                                                   BaseWwanClusterH3));
     break;
   case ENVOY_NET_GENERIC:
   default:
-    headers.addReference(ClusterHeader, use_h2_cluster ? BaseClusterH2 : BaseCluster);
+    headers.addReference(ClusterHeader,
+                         clusterFor(protocol, BaseCluster, BaseClusterH2, BaseClusterH3));
+  }
+}
+
+void Dispatcher::selectHttp3(DirectStream& direct_stream, RequestHeaderMap& headers) {
+  if (headers.Host() == nullptr) {
+    return;
+  }
+  direct_stream.authority_ = std::string(headers.Host()->value().getStringView());
+  if (!headers.get(UpstreamProtocolHeader).empty()) {
+    return;
+  }
+
+  const auto service = alt_svc_cache_->findHttp3(direct_stream.authority_);
+  // The HTTP/3 clusters connect to the request's authority, so only services on the origin's own
+  // host and port can be used.
+  const size_t colon = direct_stream.authority_.rfind(':');
+  uint32_t port = 443;
+  if (colon != std::string::npos && direct_stream.authority_.back() != ']') {
+    absl::SimpleAtoi(absl::string_view(direct_stream.authority_).substr(colon + 1), &port);
+  }
+  if (service.has_value() && service->host_.empty() && service->port_ == port) {
+    ENVOY_MOBILE_LOG(debug, "[S{}] selecting {} for {}", direct_stream.stream_handle_,
+                     service->protocol_, direct_stream.authority_);
+    headers.addReference(UpstreamProtocolHeader, Http3Protocol);
+    direct_stream.http3_ = true;
+  }
+}
+
+void Dispatcher::recordAltSvc(const DirectStream& direct_stream,
+                              const ResponseHeaderMap& headers) {
+  const auto alt_svc = headers.get(AltSvcHeader);
+  if (alt_svc.empty() ||
+      !alt_svc_cache_->onAltSvc(direct_stream.authority_, alt_svc[0]->value().getStringView())) {
+    return;
+  }
+  if (alt_svc_save_timer_ != nullptr && !alt_svc_save_timer_->enabled()) {
+    alt_svc_save_timer_->enableTimer(AltSvcSaveDelay);
   }
 }
 
+void Dispatcher::selectEarlyData(DirectStream& direct_stream, RequestHeaderMap& headers,
+                                 bool end_stream) {
+  const bool requested = !headers.get(EarlyDataHeader).empty();
+  headers.remove(EarlyDataHeader);
+  const absl::string_view method = headers.getMethodValue();
+  if (!early_data_enabled_ || !end_stream || direct_stream.upgrade_ ||
+      (!requested && method != Headers::get().MethodValues.Get &&
+       method != Headers::get().MethodValues.Head)) {
+    return;
+  }
+  const auto cluster = headers.get(ClusterHeader);
+  ASSERT(cluster.size() == 1);
+  // HTTP/3 connections have their own 0-RTT, which the QUIC clusters configure.
+  if (absl::EndsWith(cluster[0]->value().getStringView(), H3Suffix)) {
+    return;
+  }
+
+  // The request is recorded as it would be sent without early data, so that it can be replayed
+  // on a connection which completes its handshake first.
+  direct_stream.replay_ = std::make_shared<RequestReplay>(0, "", spillExecutor(), 1);
+  direct_stream.replay_->headers_ = createHeaderMap<RequestHeaderMapImpl>(headers);
+  direct_stream.replay_->end_stream_ = true;
+  direct_stream.replay_->early_data_ = true;
+  // The early data is rejected by the server named in the connection's SNI, i.e. the host.
+  const absl::string_view host = headers.getHostValue();
+  const size_t colon = host.rfind(':');
+  direct_stream.replay_->early_data_server_name_ = std::string(
+      colon != absl::string_view::npos && host.back() != ']' ? host.substr(0, colon) : host);
+  direct_stream.replay_->early_data_rejections_ =
+      Network::EarlyDataRejections::rejections(direct_stream.replay_->early_data_server_name_);
+  const std::string early_data_cluster =
+      absl::StrCat(cluster[0]->value().getStringView(), EarlyDataSuffix);
+  headers.setCopy(ClusterHeader, early_data_cluster);
+}
+
+envoy_status_t Dispatcher::enableHttp3Upstream(std::string alt_svc_cache_path) {
+  post([this, alt_svc_cache_path]() -> void {
+    http3_enabled_ = true;
+    if (!alt_svc_cache_path.empty() && alt_svc_save_timer_ == nullptr) {
+      alt_svc_cache_->persistTo(alt_svc_cache_path);
+      alt_svc_save_timer_ = TS_UNCHECKED_READ(event_dispatcher_)
+                                ->createTimer([this]() -> void { alt_svc_cache_->save(); });
+    }
+  });
+  return ENVOY_SUCCESS;
+}
+
+envoy_status_t Dispatcher::enableEarlyData() {
+  post([this]() -> void { early_data_enabled_ = true; });
+  return ENVOY_SUCCESS;
+}
+
 } // namespace Http
 } // namespace Envoy
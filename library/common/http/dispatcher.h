@@ -1,5 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include "envoy/buffer/buffer.h"
 #include "envoy/event/deferred_deletable.h"
 #include "envoy/event/dispatcher.h"
@@ -8,13 +12,20 @@
 #include "envoy/http/header_map.h"
 #include "envoy/stats/stats_macros.h"
 
+#include "common/buffer/buffer_impl.h"
 #include "common/common/logger.h"
 #include "common/common/thread.h"
 #include "common/common/thread_synchronizer.h"
 #include "common/http/codec_helper.h"
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/types/optional.h"
+#include "library/common/buffer/spilling_replay_buffer.h"
+#include "library/common/http/alt_svc_cache.h"
+#include "library/common/http/stream_progress_table.h"
+#include "library/common/memory/stream_arena.h"
+#include "library/common/thread/worker_thread.h"
 #include "library/common/types/c_types.h"
 
 namespace Envoy {
@@ -26,7 +37,9 @@ namespace Http {
 #define ALL_HTTP_DISPATCHER_STATS(COUNTER)                                                         \
   COUNTER(stream_success)                                                                          \
   COUNTER(stream_failure)                                                                          \
-  COUNTER(stream_cancel)
+  COUNTER(stream_cancel)                                                                           \
+  COUNTER(stream_group_cancel)                                                                     \
+  COUNTER(stream_replay)
 
 /**
  * Struct definition for dispatcher stats. @see stats_macros.h
@@ -35,6 +48,63 @@ struct DispatcherStats {
   ALL_HTTP_DISPATCHER_STATS(GENERATE_COUNTER_STRUCT)
 };
 
+/**
+ * Terminal error on a stream started through the C++ interface of the Dispatcher.
+ */
+struct ClientStreamError {
+  envoy_error_code_t error_code_;
+  std::string message_;
+  absl::optional<int32_t> attempt_count_;
+};
+
+/**
+ * Callbacks for a stream started through the C++ interface of the Dispatcher. Responses are
+ * delivered as Envoy objects, without conversion to or from the C types used by the platform
+ * bridge. All callbacks are invoked on the engine's event loop. Exactly one of onComplete(),
+ * onError() or onCancel() is invoked for each stream, after which the callbacks are no longer
+ * referenced.
+ */
+class ClientStreamCallbacks {
+public:
+  virtual ~ClientStreamCallbacks() = default;
+
+  /**
+   * Called when response headers are received.
+   * @param headers, the response headers.
+   * @param end_stream, whether the response is complete.
+   */
+  virtual void onHeaders(ResponseHeaderMapPtr&& headers, bool end_stream) PURE;
+
+  /**
+   * Called when response data is received. This may be called multiple times.
+   * @param data, the response data.
+   * @param end_stream, whether the response is complete.
+   */
+  virtual void onData(Buffer::InstancePtr&& data, bool end_stream) PURE;
+
+  /**
+   * Called when response trailers are received. This implies the response is complete.
+   * @param trailers, the response trailers.
+   */
+  virtual void onTrailers(ResponseTrailerMapPtr&& trailers) PURE;
+
+  /**
+   * Called when the stream completes successfully.
+   */
+  virtual void onComplete() PURE;
+
+  /**
+   * Called when the stream fails.
+   * @param error, the reason for the failure.
+   */
+  virtual void onError(const ClientStreamError& error) PURE;
+
+  /**
+   * Called when the stream is cancelled by the client.
+   */
+  virtual void onCancel() PURE;
+};
+
 /**
  * Manages HTTP streams, and provides an interface to interact with them.
  * The Dispatcher executes all stream operations on the provided Event::Dispatcher's event loop.
@@ -42,18 +112,41 @@ struct DispatcherStats {
 class Dispatcher : public Logger::Loggable<Logger::Id::http> {
 public:
   Dispatcher(std::atomic<envoy_network_t>& preferred_network);
+  ~Dispatcher();
 
   void ready(Event::Dispatcher& event_dispatcher, Stats::Scope& scope, ApiListener& api_listener);
 
+  /**
+   * Stop background work which posts to the event loop, and drop work still waiting for the loop
+   * to be ready, as the loop has exited and is about to be destroyed. Must be called on the event
+   * loop's thread.
+   */
+  void terminate();
+
+  /**
+   * Called on the event loop when the dispatcher becomes idle, i.e. its last open stream closes,
+   * and when it stops being idle, i.e. a stream is started while none are open.
+   * @param idle, whether the dispatcher is now idle.
+   */
+  using IdleCallback = std::function<void(bool idle)>;
+
+  /**
+   * Set the callback for idle transitions. Must be called before ready().
+   * @param callback, the callback to invoke on idle transitions.
+   */
+  void setIdleCallback(IdleCallback callback) { idle_callback_ = std::move(callback); }
+
   /**
    * Attempts to open a new stream to the remote. Note that this function is asynchronous and
    * opening a stream may fail. The returned handle is immediately valid for use with this API, but
    * there is no guarantee it will ever functionally represent an open stream.
    * @param stream, the stream to start.
    * @param bridge_callbacks, wrapper for callbacks for events on this stream.
+   * @param group, optionally a group to add the stream to, @see cancelStreamGroup.
    * @return envoy_stream_t handle to the stream being created.
    */
-  envoy_status_t startStream(envoy_stream_t stream, envoy_http_callbacks bridge_callbacks);
+  envoy_status_t startStream(envoy_stream_t stream, envoy_http_callbacks bridge_callbacks,
+                             absl::optional<envoy_stream_group_t> group = absl::nullopt);
 
   /**
    * Send headers over an open HTTP stream. This method can be invoked once and needs to be called
@@ -99,6 +192,128 @@ public:
    */
   envoy_status_t cancelStream(envoy_stream_t stream);
 
+  /**
+   * Reset all open HTTP streams in a group, with the same semantics as calling cancelStream for
+   * each of them. The whole group is cancelled in a single event loop iteration.
+   * Streams in the group which are started after this call are not affected.
+   * @param group, the group of streams to reset.
+   * @return envoy_status_t, the resulting status of the operation.
+   */
+  envoy_status_t cancelStreamGroup(envoy_stream_group_t group);
+
+  /**
+   * Pause or resume the delivery of response data on an open HTTP stream, e.g. while the caller
+   * cannot keep up with a long-lived stream. While the response is paused, the engine stops reading
+   * it from upstream once its buffers fill, which pushes back on the server through TCP or HTTP/2
+   * flow control. Data already in flight is still delivered.
+   * @param stream, the stream to pause or resume.
+   * @param paused, whether the response is paused.
+   * @return envoy_status_t, the resulting status of the operation.
+   */
+  envoy_status_t pauseResponse(envoy_stream_t stream, bool paused);
+
+  /**
+   * Read the progress of an HTTP stream. Unlike the operations above, this does not post to the
+   * event loop: it may be called from any thread, normally without locking, and returns the
+   * progress as of the last event the event loop handled for the stream.
+   * @param stream, the stream to read the progress of.
+   * @param progress, filled in with the stream's progress.
+   * @return envoy_status_t, ENVOY_FAILURE if the stream is unknown, or the caller has already been
+   *         told it completed, failed or was cancelled.
+   */
+  envoy_status_t getStreamProgress(envoy_stream_t stream, envoy_stream_progress& progress);
+
+  // The following methods are equivalent to their counterparts above, but exchange Envoy's own
+  // types with the caller instead of the C types of the platform bridge. The two interfaces may be
+  // used with the same Dispatcher, but each stream must only be used with the interface it was
+  // started with.
+
+  /**
+   * Attempts to open a new stream to the remote, @see startStream(envoy_stream_t,
+   * envoy_http_callbacks, absl::optional<envoy_stream_group_t>).
+   * @param stream, the stream to start. Handles are shared with streams started through the C
+   *        interface, and must be obtained from init_stream().
+   * @param callbacks, the callbacks for events on this stream. They must outlive the stream.
+   * @param group, optionally a group to add the stream to, @see cancelStreamGroup.
+   * @return envoy_status_t, the resulting status of the operation.
+   */
+  envoy_status_t startStream(envoy_stream_t stream, ClientStreamCallbacks& callbacks,
+                             absl::optional<envoy_stream_group_t> group = absl::nullopt);
+
+  /**
+   * Send headers over an open HTTP stream, @see sendHeaders(envoy_stream_t, envoy_headers, bool).
+   * @param stream, the stream to send headers over.
+   * @param headers, the headers to send.
+   * @param end_stream, indicates whether to close the stream locally after sending this frame.
+   * @return envoy_status_t, the resulting status of the operation.
+   */
+  envoy_status_t sendHeaders(envoy_stream_t stream, RequestHeaderMapPtr headers, bool end_stream);
+
+  /**
+   * Send data over an open HTTP stream, @see sendData(envoy_stream_t, envoy_data, bool).
+   * @param stream, the stream to send data over.
+   * @param data, the data to send. Its contents are moved rather than copied.
+   * @param end_stream, indicates whether to close the stream locally after sending this frame.
+   * @return envoy_status_t, the resulting status of the operation.
+   */
+  envoy_status_t sendData(envoy_stream_t stream, Buffer::InstancePtr data, bool end_stream);
+
+  /**
+   * Send trailers over an open HTTP stream, @see sendTrailers(envoy_stream_t, envoy_headers).
+   * @param stream, the stream to send trailers over.
+   * @param trailers, the trailers to send.
+   * @return envoy_status_t, the resulting status of the operation.
+   */
+  envoy_status_t sendTrailers(envoy_stream_t stream, RequestTrailerMapPtr trailers);
+
+  /**
+   * Enable replaying requests on a new stream when their connection fails, for requests which
+   * allow retries (x-envoy-max-retries) but have a body too large for the router to buffer for
+   * them. A copy of such a request's body is kept while it is sent: the first memory_limit_bytes
+   * in memory, and the remainder in a temporary file, which is written and read back on a
+   * background thread. A replayed body is sent a chunk at a time, pausing while the connection
+   * manager has reading disabled. Each replay counts against the request's retry budget.
+   * @param memory_limit_bytes, the number of bytes of each body to hold in memory.
+   * @param spill_directory, a directory the engine may create temporary files in.
+   * @return envoy_status_t, the resulting status of the operation.
+   */
+  envoy_status_t enableRequestReplay(uint64_t memory_limit_bytes, std::string spill_directory);
+
+  /**
+   * Send requests over HTTP/3 to origins which advertise it through Alt-Svc response headers,
+   * unless the caller selects a protocol with x-envoy-mobile-upstream-protocol. If an origin's
+   * HTTP/3 connection fails, e.g. because UDP is blocked on the current network, its requests fall
+   * back to TCP for a while. Requires the engine's configuration to provide HTTP/3 variants of the
+   * base clusters (base_h3, base_wlan_h3 and base_wwan_h3).
+   * @param alt_svc_cache_path, a file to persist advertised services to across launches, or empty
+   *        to keep them in memory only. Changes are written a few seconds after they are made.
+   * @return envoy_status_t, the resulting status of the operation.
+   */
+  envoy_status_t enableHttp3Upstream(std::string alt_svc_cache_path);
+
+  /**
+   * Send idempotent requests, i.e. GET and HEAD requests and requests carrying
+   * x-envoy-mobile-early-data, as TLS 1.3 early data on new connections which resume a session.
+   * Only requests without a body qualify, and not those sent over HTTP/3. If the server rejects
+   * the early data, they are replayed once without it. Other failures are reported to the caller
+   * as they would be without early data. Requires the engine's configuration to provide early
+   * data variants of the base clusters, e.g. base_early_data and base_wlan_h2_early_data, whose
+   * cert_verifier handshaker sets enable_early_data.
+   * @return envoy_status_t, the resulting status of the operation.
+   */
+  envoy_status_t enableEarlyData();
+
+  /**
+   * Allocate the dispatcher's fixed per-stream state, i.e. each stream and its callbacks, from an
+   * arena belonging to the stream rather than with an allocation each. The arena is released all at
+   * once after the stream is deleted. Request data is still wrapped on the heap, so that long-lived
+   * streams carrying many data frames do not grow their arena without bound. Applies to streams
+   * started after this call.
+   * @param block_bytes, the size of the blocks the arenas are made of, or 0 to disable arenas.
+   * @return envoy_status_t, the resulting status of the operation.
+   */
+  envoy_status_t enableStreamArena(uint64_t block_bytes);
+
   const DispatcherStats& stats() const;
   // Used to fill response code details for streams that are cancelled via cancelStream.
   const std::string& getCancelDetails() {
@@ -122,6 +337,10 @@ private:
   public:
     DirectStreamCallbacks(DirectStream& direct_stream, envoy_http_callbacks bridge_callbacks,
                           Dispatcher& http_dispatcher);
+    DirectStreamCallbacks(DirectStream& direct_stream, ClientStreamCallbacks& client_callbacks,
+                          Dispatcher& http_dispatcher);
+    // Creates callbacks for a replay of a stream, which report to the same caller as callbacks.
+    DirectStreamCallbacks(DirectStream& direct_stream, const DirectStreamCallbacks& callbacks);
 
     void closeStream();
     void onComplete();
@@ -135,24 +354,62 @@ private:
     void encodeTrailers(const ResponseTrailerMap& trailers) override;
     Stream& getStream() override { return direct_stream_; }
     Http1StreamEncoderOptionsOptRef http1StreamEncoderOptions() override { return absl::nullopt; }
-    void encode100ContinueHeaders(const ResponseHeaderMap&) override {
-      // TODO(goaway): implement
-      NOT_IMPLEMENTED_GCOVR_EXCL_LINE;
-    }
+    void encode100ContinueHeaders(const ResponseHeaderMap& headers) override;
     bool streamErrorOnInvalidHttpMessage() const override { return false; }
-    void encodeMetadata(const MetadataMapVector&) override { NOT_IMPLEMENTED_GCOVR_EXCL_LINE; }
+    void encodeMetadata(const MetadataMapVector& metadata_map_vector) override;
 
   private:
     DirectStream& direct_stream_;
     const envoy_http_callbacks bridge_callbacks_;
+    // Set instead of bridge_callbacks_ for streams started through the C++ interface.
+    ClientStreamCallbacks* const client_callbacks_{};
     Dispatcher& http_dispatcher_;
     absl::optional<envoy_error_code_t> error_code_;
     absl::optional<envoy_data> error_message_;
+    std::string client_error_message_;
     absl::optional<int32_t> error_attempt_count_;
     bool success_{};
   };
 
-  using DirectStreamCallbacksPtr = std::unique_ptr<DirectStreamCallbacks>;
+  using DirectStreamCallbacksPtr = Memory::ArenaPtr<DirectStreamCallbacks>;
+
+  /**
+   * A copy of a request, from which it can be replayed on a new stream. @see enableRequestReplay.
+   */
+  struct RequestReplay {
+    RequestReplay(uint64_t memory_limit, const std::string& spill_directory,
+                  Buffer::SpillingReplayBuffer::Executor executor, uint32_t replays_remaining)
+        : body_(memory_limit, spill_directory, std::move(executor)),
+          replays_remaining_(replays_remaining) {}
+
+    RequestHeaderMapPtr headers_;
+    Buffer::SpillingReplayBuffer body_;
+    RequestTrailerMapPtr trailers_;
+    // Whether the caller has ended the request.
+    bool end_stream_{};
+    uint32_t replays_remaining_;
+    // Set from when the stream is replaced until the request's headers have been replayed on it,
+    // and then while the rest of what has been recorded is replayed. Meanwhile, request data from
+    // the caller is only recorded, and is sent as part of the replay.
+    bool pending_{};
+    bool replaying_{};
+    // How much of the body has been replayed on the current stream, and whether the next chunk is
+    // being read back.
+    uint64_t replayed_bytes_{};
+    bool reading_{};
+    // Counts the streams the request has been replayed on. Replays reuse the stream's handle, so
+    // chunks read back for a stream which has since been replaced are told apart by this.
+    uint32_t attempt_{};
+    // Whether the request was sent as early data, in which case it is replayed without, whatever
+    // its size, if the server rejected the early data. @see enableEarlyData.
+    bool early_data_{};
+    // For requests sent as early data, the server's name, and how many times servers for the name
+    // had rejected early data when the request was sent, @see Network::EarlyDataRejections.
+    std::string early_data_server_name_;
+    uint64_t early_data_rejections_{};
+  };
+
+  using RequestReplaySharedPtr = std::shared_ptr<RequestReplay>;
 
   /**
    * Contains state about an HTTP stream; both in the outgoing direction via an underlying
@@ -173,8 +430,7 @@ private:
       return parent_.address_;
     }
     absl::string_view responseDetails() override { return response_details_; }
-    // TODO: https://github.com/lyft/envoy-mobile/issues/825
-    void readDisable(bool /*disable*/) override {}
+    void readDisable(bool disable) override;
     uint32_t bufferLimit() override { return 65000; }
     // Not applicable
     void setFlushTimeout(std::chrono::milliseconds) override {}
@@ -184,6 +440,32 @@ private:
     }
 
     const envoy_stream_t stream_handle_;
+    absl::optional<envoy_stream_group_t> group_;
+    // Set if the request can be replayed on a new stream.
+    RequestReplaySharedPtr replay_;
+    // The request's authority, if Alt-Svc is recorded for the stream.
+    std::string authority_;
+    // Whether the request was sent over HTTP/3 because its origin advertised it.
+    bool http3_{};
+    // Whether the request upgrades the stream, e.g. to a WebSocket, or is a CONNECT request.
+    bool upgrade_{};
+    // Whether the caller sent the upgrade as an extended CONNECT request (RFC 8441), in which case
+    // the response is translated back to the form of an HTTP/2 response.
+    bool extended_connect_{};
+    // While the connection manager has reading disabled, request data and trailers from the caller
+    // are held here, and they are passed on once it is enabled again.
+    uint32_t read_disable_count_{};
+    bool request_held_{};
+    Buffer::OwnedImpl held_data_;
+    bool held_end_stream_{};
+    RequestTrailerMapPtr held_trailers_;
+    // @see pauseResponse.
+    bool response_paused_{};
+    // Shared with the streams the request is replayed on, @see getStreamProgress.
+    StreamProgressSharedPtr progress_;
+    // Set if the stream's state is allocated from an arena, @see enableStreamArena. Shared with the
+    // streams the request is replayed on.
+    Memory::StreamArenaSharedPtr arena_;
 
     // Used to issue outgoing HTTP stream operations.
     RequestDecoder* request_decoder_;
@@ -218,10 +500,39 @@ private:
    * @param callback, the functor to post.
    */
   void post(Event::PostCb callback);
+  // @return a new stream arena, or nullptr if they are disabled.
+  Memory::StreamArenaSharedPtr newStreamArena();
+  DirectStreamSharedPtr newDirectStream(envoy_stream_t stream_handle,
+                                        Memory::StreamArenaSharedPtr arena);
   DirectStreamSharedPtr getStream(envoy_stream_t stream_handle);
   void removeStream(envoy_stream_t stream_handle);
+  // The following must be called on the event_dispatcher_'s thread. Apart from doStartStream, they
+  // must be called with a stream that is still in streams_.
+  void doStartStream(DirectStreamSharedPtr&& direct_stream,
+                     absl::optional<envoy_stream_group_t> group);
+  void doSendHeaders(DirectStream& direct_stream, RequestHeaderMapPtr&& headers, bool end_stream);
+  void doSendData(DirectStream& direct_stream, Buffer::Instance& data, bool end_stream);
+  void doSendTrailers(DirectStream& direct_stream, RequestTrailerMapPtr&& trailers);
+  void doCancelStream(DirectStream& direct_stream);
+  // Passes on the request held while the stream had reading disabled.
+  void doResumeRequest(envoy_stream_t stream_handle);
+  // Replaces a stream whose connection failed with a new one, and schedules its request to be
+  // replayed. @return bool whether the stream was replaced.
+  bool replayStream(DirectStream& failed_stream);
+  void doReplayStream(envoy_stream_t stream_handle);
+  // Sends the next chunk of the replayed request, unless one is being read back or the connection
+  // manager has reading disabled, or the rest of it once the whole body has been replayed.
+  void replayRequestBody(DirectStream& direct_stream);
+  // Sends a chunk read back for the replay on attempt, or resets the stream if chunk is nullptr.
+  void doReplayChunk(envoy_stream_t stream_handle, uint32_t attempt, Buffer::Instance* chunk);
+  Buffer::SpillingReplayBuffer::Executor spillExecutor();
+  // Records request data about to be passed to the connection manager, ending the request if
+  // end_stream is set.
+  void recordRequestProgress(DirectStream& direct_stream, uint64_t bytes, bool end_stream);
   void setDestinationCluster(HeaderMap& headers);
-
+  void selectHttp3(DirectStream& direct_stream, RequestHeaderMap& headers);
+  void selectEarlyData(DirectStream& direct_stream, RequestHeaderMap& headers, bool end_stream);
+  void recordAltSvc(const DirectStream& direct_stream, const ResponseHeaderMap& headers);
   Thread::MutexBasicLockable ready_lock_;
   std::list<Event::PostCb> init_queue_ GUARDED_BY(ready_lock_);
   Event::Dispatcher* event_dispatcher_ GUARDED_BY(ready_lock_){};
@@ -236,7 +547,31 @@ private:
   const std::string stats_prefix_;
   absl::optional<DispatcherStats> stats_ GUARDED_BY(ready_lock_){};
   absl::flat_hash_map<envoy_stream_t, DirectStreamSharedPtr> streams_;
+  // Open streams in each group. Groups are erased once they have no open streams.
+  absl::flat_hash_map<envoy_stream_group_t, absl::flat_hash_set<envoy_stream_t>> stream_groups_;
+  // The progress of each stream, from when it is started until the caller is told it finished.
+  // May be read from any thread, @see getStreamProgress.
+  const StreamProgressTableSharedPtr stream_progress_{std::make_shared<StreamProgressTable>()};
   std::atomic<envoy_network_t>& preferred_network_;
+  IdleCallback idle_callback_;
+  // Set by ready(), and charged from any thread once it is. @see Stats::BridgeCopyStats.
+  Stats::BridgeCopyCounterSet bridge_copy_counters_;
+  // Only accessed on the event_dispatcher_'s thread. @see enableHttp3Upstream.
+  bool http3_enabled_{};
+  std::unique_ptr<AltSvcCache> alt_svc_cache_;
+  // Set if the cache is persisted. Armed when it changes, so that a burst of Alt-Svc responses
+  // rewrites the file once. Reset by terminate().
+  Event::TimerPtr alt_svc_save_timer_;
+  // Only accessed on the event_dispatcher_'s thread. @see enableEarlyData.
+  bool early_data_enabled_{};
+  // Only accessed on the event_dispatcher_'s thread. @see enableRequestReplay.
+  bool replay_enabled_{};
+  uint64_t replay_memory_limit_bytes_{};
+  std::string replay_spill_directory_;
+  // Writes and reads back the bodies replays spill to disk. Reset by terminate().
+  std::unique_ptr<Thread::WorkerThread> spill_worker_;
+  // @see enableStreamArena. Read when streams are started, on the caller's thread.
+  std::atomic<uint64_t> stream_arena_block_bytes_{};
   // Shared synthetic address across DirectStreams.
   Network::Address::InstanceConstSharedPtr address_;
   Thread::ThreadSynchronizer synchronizer_;
@@ -2,6 +2,8 @@
 
 #include "common/http/header_map_impl.h"
 
+#include "library/common/stats/bridge_copy_stats.h"
+
 namespace Envoy {
 namespace Http {
 namespace Utility {
@@ -16,6 +18,9 @@ RequestHeaderMapPtr toRequestHeaders(envoy_headers headers) {
     transformed_headers->addCopy(LowerCaseString(convertToString(headers.headers[i].key)),
                                  convertToString(headers.headers[i].value));
   }
+  // The map, and a key and value for each header.
+  ENVOY_MOBILE_BRIDGE_COPY(to_request_headers, transformed_headers->byteSize(),
+                           1 + 2 * headers.length);
   // The C envoy_headers struct can be released now because the headers have been copied.
   release_envoy_headers(headers);
   return transformed_headers;
@@ -27,6 +32,8 @@ RequestTrailerMapPtr toRequestTrailers(envoy_headers trailers) {
     transformed_trailers->addCopy(LowerCaseString(convertToString(trailers.headers[i].key)),
                                   convertToString(trailers.headers[i].value));
   }
+  ENVOY_MOBILE_BRIDGE_COPY(to_request_trailers, transformed_trailers->byteSize(),
+                           1 + 2 * trailers.length);
   // The C envoy_headers struct can be released now because the headers have been copied.
   release_envoy_headers(trailers);
   return transformed_trailers;
@@ -53,9 +60,32 @@ envoy_headers toBridgeHeaders(const HeaderMap& header_map) {
 
     return HeaderMap::Iterate::Continue;
   });
+  // The header array, and a key and value for each header.
+  ENVOY_MOBILE_BRIDGE_COPY(to_bridge_headers, header_map.byteSize(), 1 + 2 * header_map.size());
   return transformed_headers;
 }
 
+envoy_headers toBridgeMetadata(const MetadataMap& metadata) {
+  envoy_headers transformed_metadata;
+  transformed_metadata.length = 0;
+  transformed_metadata.headers =
+      static_cast<envoy_header*>(safe_malloc(sizeof(envoy_header) * metadata.size()));
+
+  uint64_t byte_size = 0;
+  for (const auto& entry : metadata) {
+    envoy_data key =
+        copy_envoy_data(entry.first.size(), reinterpret_cast<const uint8_t*>(entry.first.data()));
+    envoy_data value =
+        copy_envoy_data(entry.second.size(), reinterpret_cast<const uint8_t*>(entry.second.data()));
+    transformed_metadata.headers[transformed_metadata.length] = {key, value};
+    transformed_metadata.length++;
+    byte_size += entry.first.size() + entry.second.size();
+  }
+  // The header array, and a key and value for each entry.
+  ENVOY_MOBILE_BRIDGE_COPY(to_bridge_metadata, byte_size, 1 + 2 * metadata.size());
+  return transformed_metadata;
+}
+
 } // namespace Utility
 } // namespace Http
 } // namespace Envoy
@@ -2,6 +2,7 @@
 
 #include "envoy/buffer/buffer.h"
 #include "envoy/http/header_map.h"
+#include "envoy/http/metadata_interface.h"
 
 #include "library/common/types/c_types.h"
 
@@ -41,6 +42,15 @@ RequestTrailerMapPtr toRequestTrailers(envoy_headers trailers);
  */
 envoy_headers toBridgeHeaders(const HeaderMap& headers);
 
+/**
+ * Transform MetadataMap to envoy_headers.
+ * This function copies the content.
+ * Caller owns the allocated bytes for the return value, and needs to free after use.
+ * @param metadata, the MetadataMap to transform.
+ * @return envoy_headers, the MetadataMap 1:1 transformation of the metadata param.
+ */
+envoy_headers toBridgeMetadata(const MetadataMap& metadata);
+
 } // namespace Utility
 } // namespace Http
 } // namespace Envoy
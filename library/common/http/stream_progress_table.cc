@@ -0,0 +1,102 @@
+#include "library/common/http/stream_progress_table.h"
+
+#include "common/common/lock_guard.h"
+
+namespace Envoy {
+namespace Http {
+
+constexpr size_t StreamProgressTable::Slots;
+constexpr envoy_stream_t StreamProgressTable::NoStream;
+
+StreamProgressSharedPtr StreamProgressTable::track(envoy_stream_t stream) {
+  // The progress keeps the table alive, as it may outlive the dispatcher, e.g. in a post which
+  // never runs.
+  std::shared_ptr<StreamProgressTable> self = shared_from_this();
+  Slot& stream_slot = slot(stream);
+  bool in_use = false;
+  if (stream_slot.in_use_.compare_exchange_strong(in_use, true, std::memory_order_acquire,
+                                                  std::memory_order_relaxed)) {
+    // Readers which read the reset progress see the slot change owner when they check it again.
+    std::atomic_thread_fence(std::memory_order_release);
+    StreamProgress& progress = stream_slot.progress_;
+    progress.bytes_sent_.store(0, std::memory_order_relaxed);
+    progress.bytes_acknowledged_.store(0, std::memory_order_relaxed);
+    progress.bytes_received_.store(0, std::memory_order_relaxed);
+    progress.state_.store(ENVOY_STREAM_SENDING_REQUEST, std::memory_order_relaxed);
+    stream_slot.stream_.store(stream, std::memory_order_release);
+    return StreamProgressSharedPtr(&progress, [self, &stream_slot](StreamProgress*) -> void {
+      self->release(stream_slot);
+    });
+  }
+
+  auto* progress = new StreamProgress();
+  {
+    Thread::LockGuard lock(overflow_lock_);
+    overflow_[stream] = progress;
+    overflow_size_.store(overflow_.size(), std::memory_order_relaxed);
+  }
+  return StreamProgressSharedPtr(progress, [self, stream](StreamProgress* progress) -> void {
+    self->release(stream, progress);
+  });
+}
+
+void StreamProgressTable::untrack(envoy_stream_t stream) {
+  envoy_stream_t tracked = stream;
+  if (slot(stream).stream_.compare_exchange_strong(tracked, NoStream, std::memory_order_relaxed)) {
+    return;
+  }
+  Thread::LockGuard lock(overflow_lock_);
+  overflow_.erase(stream);
+  overflow_size_.store(overflow_.size(), std::memory_order_relaxed);
+}
+
+bool StreamProgressTable::read(envoy_stream_t stream, envoy_stream_progress& progress) {
+  const Slot& stream_slot = slot(stream);
+  if (stream_slot.stream_.load(std::memory_order_acquire) == stream) {
+    const StreamProgress& stream_progress = stream_slot.progress_;
+    progress.state = stream_progress.state_.load(std::memory_order_acquire);
+    progress.bytes_sent = stream_progress.bytes_sent_.load(std::memory_order_relaxed);
+    progress.bytes_acknowledged =
+        stream_progress.bytes_acknowledged_.load(std::memory_order_relaxed);
+    progress.bytes_received = stream_progress.bytes_received_.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // If the stream finished while being read, the slot may have been reused.
+    return stream_slot.stream_.load(std::memory_order_relaxed) == stream;
+  }
+
+  if (overflow_size_.load(std::memory_order_relaxed) == 0) {
+    return false;
+  }
+  Thread::LockGuard lock(overflow_lock_);
+  auto it = overflow_.find(stream);
+  if (it == overflow_.end()) {
+    return false;
+  }
+  const StreamProgress& stream_progress = *it->second;
+  progress.state = stream_progress.state_.load(std::memory_order_acquire);
+  progress.bytes_sent = stream_progress.bytes_sent_.load(std::memory_order_relaxed);
+  progress.bytes_acknowledged = stream_progress.bytes_acknowledged_.load(std::memory_order_relaxed);
+  progress.bytes_received = stream_progress.bytes_received_.load(std::memory_order_relaxed);
+  return true;
+}
+
+void StreamProgressTable::release(Slot& slot) {
+  slot.stream_.store(NoStream, std::memory_order_relaxed);
+  // Publishes the release to the stream which claims the slot next.
+  slot.in_use_.store(false, std::memory_order_release);
+}
+
+void StreamProgressTable::release(envoy_stream_t stream, StreamProgress* progress) {
+  {
+    Thread::LockGuard lock(overflow_lock_);
+    auto it = overflow_.find(stream);
+    if (it != overflow_.end() && it->second == progress) {
+      overflow_.erase(it);
+      overflow_size_.store(overflow_.size(), std::memory_order_relaxed);
+    }
+  }
+  delete progress;
+}
+
+} // namespace Http
+} // namespace Envoy
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "common/common/thread.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "library/common/types/c_types.h"
+
+namespace Envoy {
+namespace Http {
+
+/**
+ * The progress of a stream, @see Dispatcher::getStreamProgress. Written on the event loop, and read
+ * from any thread without waiting on it. The state is written last with release ordering, so a
+ * reader which sees a state also sees the counts written before it.
+ */
+struct StreamProgress {
+  std::atomic<uint64_t> bytes_sent_{};
+  std::atomic<uint64_t> bytes_acknowledged_{};
+  std::atomic<uint64_t> bytes_received_{};
+  std::atomic<envoy_stream_state_t> state_{ENVOY_STREAM_SENDING_REQUEST};
+};
+
+using StreamProgressSharedPtr = std::shared_ptr<StreamProgress>;
+
+/**
+ * The progress of tracked streams, readable from any thread without locking. Stream handles are
+ * handed out in sequence, so each stream's progress is held in a fixed slot indexed by its handle,
+ * which records the handle it currently belongs to. A stream whose slot is still held by an older
+ * stream, e.g. a long-lived WebSocket, is instead kept in a map guarded by a lock, which readers
+ * only take while the map has entries.
+ */
+class StreamProgressTable : public std::enable_shared_from_this<StreamProgressTable> {
+public:
+  static constexpr size_t Slots = 1024;
+
+  /**
+   * Start tracking a stream's progress.
+   * @param stream, the stream's handle.
+   * @return the progress for the event loop to update. The stream is tracked until it is untracked
+   *         or the progress is released, whichever is first. Its slot is only reused once the
+   *         progress has been released.
+   */
+  StreamProgressSharedPtr track(envoy_stream_t stream);
+
+  /**
+   * Stop tracking a stream's progress, e.g. once the caller has been told the stream finished.
+   * @param stream, the stream's handle.
+   */
+  void untrack(envoy_stream_t stream);
+
+  /**
+   * Read a stream's progress. May be called from any thread.
+   * @param stream, the stream's handle.
+   * @param progress, filled in with the stream's progress.
+   * @return bool whether the stream is tracked.
+   */
+  bool read(envoy_stream_t stream, envoy_stream_progress& progress);
+
+private:
+  static constexpr envoy_stream_t NoStream = -1;
+
+  struct Slot {
+    // The stream whose progress readers find in the slot, or NoStream.
+    std::atomic<envoy_stream_t> stream_{NoStream};
+    // Whether the progress is referenced, in which case the slot can't be reused.
+    std::atomic<bool> in_use_{};
+    StreamProgress progress_;
+  };
+
+  Slot& slot(envoy_stream_t stream) { return slots_[static_cast<uintptr_t>(stream) % Slots]; }
+  void release(Slot& slot);
+  void release(envoy_stream_t stream, StreamProgress* progress);
+
+  Slot slots_[Slots];
+  Thread::MutexBasicLockable overflow_lock_;
+  absl::flat_hash_map<envoy_stream_t, StreamProgress*> overflow_ GUARDED_BY(overflow_lock_);
+  std::atomic<size_t> overflow_size_{};
+};
+
+using StreamProgressTableSharedPtr = std::shared_ptr<StreamProgressTable>;
+
+} // namespace Http
+} // namespace Envoy
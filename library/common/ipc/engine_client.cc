@@ -0,0 +1,185 @@
+#include "library/common/ipc/engine_client.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "common/common/lock_guard.h"
+
+namespace Envoy {
+namespace Ipc {
+
+EngineClient::~EngineClient() {
+  if (fd_ >= 0) {
+    // Unblocks the reader, which then fails any open streams.
+    ::shutdown(fd_, SHUT_RDWR);
+  }
+  if (reader_.joinable()) {
+    reader_.join();
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+envoy_status_t EngineClient::connect(const std::string& path) {
+  ASSERT(fd_ < 0, "an engine client may only connect once");
+  sockaddr_un address{};
+  if (path.size() >= sizeof(address.sun_path)) {
+    ENVOY_LOG(error, "ipc socket path is too long: {}", path);
+    return ENVOY_FAILURE;
+  }
+  address.sun_family = AF_UNIX;
+  memcpy(address.sun_path, path.data(), path.size());
+
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return ENVOY_FAILURE;
+  }
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+    ENVOY_LOG(error, "unable to connect to engine host on {}: {}", path, strerror(errno));
+    ::close(fd);
+    return ENVOY_FAILURE;
+  }
+  configureSocket(fd);
+
+  fd_ = fd;
+  reader_ = std::thread(&EngineClient::readMessages, this);
+  return ENVOY_SUCCESS;
+}
+
+envoy_status_t EngineClient::startStream(envoy_stream_t stream, envoy_http_callbacks callbacks) {
+  {
+    Thread::LockGuard lock(streams_mutex_);
+    if (!streams_.emplace(stream, callbacks).second) {
+      return ENVOY_FAILURE;
+    }
+  }
+  if (send(MessageType::StartStream, stream, false, "") != ENVOY_SUCCESS) {
+    Thread::LockGuard lock(streams_mutex_);
+    streams_.erase(stream);
+    return ENVOY_FAILURE;
+  }
+  return ENVOY_SUCCESS;
+}
+
+envoy_status_t EngineClient::sendHeaders(envoy_stream_t stream, envoy_headers headers,
+                                         bool end_stream) {
+  const std::string payload = encodeHeaders(headers);
+  release_envoy_headers(headers);
+  return send(MessageType::SendHeaders, stream, end_stream, payload);
+}
+
+envoy_status_t EngineClient::sendData(envoy_stream_t stream, envoy_data data, bool end_stream) {
+  const envoy_status_t status =
+      send(MessageType::SendData, stream, end_stream,
+           absl::string_view(reinterpret_cast<const char*>(data.bytes), data.length));
+  data.release(data.context);
+  return status;
+}
+
+envoy_status_t EngineClient::sendTrailers(envoy_stream_t stream, envoy_headers trailers) {
+  const std::string payload = encodeHeaders(trailers);
+  release_envoy_headers(trailers);
+  return send(MessageType::SendTrailers, stream, true, payload);
+}
+
+envoy_status_t EngineClient::cancelStream(envoy_stream_t stream) {
+  return send(MessageType::ResetStream, stream, true, "");
+}
+
+envoy_status_t EngineClient::send(MessageType type, envoy_stream_t stream, bool end_stream,
+                                  absl::string_view payload) {
+  Thread::LockGuard lock(write_mutex_);
+  return writeMessage(fd_, type, stream, end_stream, payload) ? ENVOY_SUCCESS : ENVOY_FAILURE;
+}
+
+absl::optional<envoy_http_callbacks> EngineClient::streamCallbacks(envoy_stream_t stream,
+                                                                   bool terminal) {
+  Thread::LockGuard lock(streams_mutex_);
+  auto it = streams_.find(stream);
+  if (it == streams_.end()) {
+    return absl::nullopt;
+  }
+  const envoy_http_callbacks callbacks = it->second;
+  if (terminal) {
+    streams_.erase(it);
+  }
+  return callbacks;
+}
+
+void EngineClient::readMessages() {
+  Message message;
+  while (readMessage(fd_, message) && dispatchMessage(message)) {
+  }
+
+  // The host has gone away, so no further events will arrive for open streams.
+  absl::flat_hash_map<envoy_stream_t, envoy_http_callbacks> streams;
+  {
+    Thread::LockGuard lock(streams_mutex_);
+    streams.swap(streams_);
+  }
+  ENVOY_LOG(debug, "disconnected from engine host with {} open streams", streams.size());
+  for (const auto& stream : streams) {
+    stream.second.on_error({ENVOY_CONNECTION_FAILURE, envoy_nodata, -1}, stream.second.context);
+  }
+}
+
+bool EngineClient::dispatchMessage(const Message& message) {
+  const bool terminal = message.type_ == MessageType::OnComplete ||
+                        message.type_ == MessageType::OnError ||
+                        message.type_ == MessageType::OnCancel;
+  const absl::optional<envoy_http_callbacks> callbacks =
+      streamCallbacks(message.stream_, terminal);
+  if (!callbacks.has_value()) {
+    // The host never sends events for streams which have closed.
+    return false;
+  }
+
+  switch (message.type_) {
+  case MessageType::OnHeaders: {
+    envoy_headers headers;
+    if (!decodeHeaders(message.payload_, headers)) {
+      return false;
+    }
+    callbacks->on_headers(headers, message.end_stream_, callbacks->context);
+    return true;
+  }
+  case MessageType::OnData:
+    callbacks->on_data(copy_envoy_data(message.payload_.size(),
+                                       reinterpret_cast<const uint8_t*>(message.payload_.data())),
+                       message.end_stream_, callbacks->context);
+    return true;
+  case MessageType::OnTrailers: {
+    envoy_headers trailers;
+    if (!decodeHeaders(message.payload_, trailers)) {
+      return false;
+    }
+    callbacks->on_trailers(trailers, callbacks->context);
+    return true;
+  }
+  case MessageType::OnComplete:
+    callbacks->on_complete(callbacks->context);
+    return true;
+  case MessageType::OnError: {
+    envoy_error error;
+    if (!decodeError(message.payload_, error)) {
+      return false;
+    }
+    callbacks->on_error(error, callbacks->context);
+    return true;
+  }
+  case MessageType::OnCancel:
+    callbacks->on_cancel(callbacks->context);
+    return true;
+  default:
+    // Messages sent by clients are never valid from the host.
+    return false;
+  }
+}
+
+} // namespace Ipc
+} // namespace Envoy
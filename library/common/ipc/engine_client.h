@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <thread>
+
+#include "common/common/logger.h"
+#include "common/common/thread.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/types/optional.h"
+#include "library/common/ipc/protocol.h"
+#include "library/common/types/c_types.h"
+
+namespace Envoy {
+namespace Ipc {
+
+/**
+ * Runs streams on an engine hosted by another process on the device, @see EngineHost. Offers the
+ * stream operations of main_interface.h with the same semantics, including the invocation of each
+ * stream's envoy_http_callbacks on a single thread.
+ *
+ * If the host goes away, open streams fail with ENVOY_CONNECTION_FAILURE.
+ */
+class EngineClient : public Logger::Loggable<Logger::Id::main> {
+public:
+  ~EngineClient();
+
+  /**
+   * Connect to an engine host.
+   * @param path, the path the host's socket is bound to.
+   * @return envoy_status_t, the resulting status of the operation.
+   */
+  envoy_status_t connect(const std::string& path);
+
+  envoy_status_t startStream(envoy_stream_t stream, envoy_http_callbacks callbacks);
+  envoy_status_t sendHeaders(envoy_stream_t stream, envoy_headers headers, bool end_stream);
+  envoy_status_t sendData(envoy_stream_t stream, envoy_data data, bool end_stream);
+  envoy_status_t sendTrailers(envoy_stream_t stream, envoy_headers trailers);
+  envoy_status_t cancelStream(envoy_stream_t stream);
+
+private:
+  void readMessages();
+  bool dispatchMessage(const Message& message);
+  envoy_status_t send(MessageType type, envoy_stream_t stream, bool end_stream,
+                      absl::string_view payload);
+  // Returns the callbacks for a stream, removing the stream if the event is terminal.
+  absl::optional<envoy_http_callbacks> streamCallbacks(envoy_stream_t stream, bool terminal);
+
+  int fd_{-1};
+  Thread::MutexBasicLockable write_mutex_;
+  Thread::MutexBasicLockable streams_mutex_;
+  absl::flat_hash_map<envoy_stream_t, envoy_http_callbacks> streams_ GUARDED_BY(streams_mutex_);
+  std::thread reader_;
+};
+
+} // namespace Ipc
+} // namespace Envoy
@@ -0,0 +1,430 @@
+#include "library/common/ipc/engine_host.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/common/lock_guard.h"
+#include "common/http/header_map_impl.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "library/common/ipc/protocol.h"
+
+namespace Envoy {
+namespace Ipc {
+
+namespace {
+
+// Once this many bytes are queued for a client, the responses of its streams are paused until the
+// queue drains below the low watermark.
+constexpr uint64_t HighWatermarkBytes = 1024 * 1024;
+constexpr uint64_t LowWatermarkBytes = HighWatermarkBytes / 4;
+
+// Only processes running as the same user as the host may use its engine.
+bool isSameUser(int fd) {
+#if defined(SO_PEERCRED)
+  ucred credentials{};
+  socklen_t length = sizeof(credentials);
+  if (::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) < 0) {
+    return false;
+  }
+  return credentials.uid == ::geteuid();
+#else
+  uid_t uid;
+  gid_t gid;
+  if (::getpeereid(fd, &uid, &gid) < 0) {
+    return false;
+  }
+  return uid == ::geteuid();
+#endif
+}
+
+} // namespace
+
+/**
+ * A client process's connection. Holds the streams the client has started, which keep the
+ * connection alive until they are closed.
+ */
+class EngineHost::Connection : public std::enable_shared_from_this<Connection>,
+                               public Logger::Loggable<Logger::Id::main> {
+public:
+  Connection(Http::Dispatcher& http_dispatcher, StreamHandleAllocator allocate_stream_handle,
+             int fd)
+      : http_dispatcher_(http_dispatcher), allocate_stream_handle_(allocate_stream_handle),
+        fd_(fd) {}
+  ~Connection() { ::close(fd_); }
+
+  void start() {
+    reader_ = std::thread(&Connection::readMessages, this);
+    writer_ = std::thread(&Connection::writeFrames, this);
+  }
+  // Unblocks the reader and the writer. The reader then cancels the client's open streams.
+  void shutdown() { ::shutdown(fd_, SHUT_RDWR); }
+  void join() {
+    if (reader_.joinable()) {
+      reader_.join();
+    }
+    if (writer_.joinable()) {
+      writer_.join();
+    }
+  }
+  bool closed() const { return closed_; }
+
+  // Queues a message for the writer. Called on the engine's event loop, which must never wait on
+  // a client.
+  void send(MessageType type, envoy_stream_t stream, bool end_stream, absl::string_view payload);
+  void onStreamClosed(envoy_stream_t client_stream);
+
+private:
+  void readMessages();
+  void writeFrames();
+  bool handleMessage(Message& message);
+  // Pauses or resumes the responses of all of the client's open streams.
+  void pauseResponses(bool paused);
+  // Drops queued frames, and those sent later, once the client is gone.
+  void closeWrites();
+
+  Http::Dispatcher& http_dispatcher_;
+  const StreamHandleAllocator allocate_stream_handle_;
+  const int fd_;
+  Thread::MutexBasicLockable write_mutex_;
+  Thread::CondVar write_cv_;
+  // Frames waiting to be written to the client, @see writeFrames().
+  std::deque<std::string> frames_ GUARDED_BY(write_mutex_);
+  uint64_t queued_bytes_ GUARDED_BY(write_mutex_){};
+  bool writes_closed_ GUARDED_BY(write_mutex_){};
+  // Whether responses are paused because the client is slow to read them.
+  bool responses_paused_ GUARDED_BY(write_mutex_){};
+  Thread::MutexBasicLockable streams_mutex_;
+  // Open streams by the client's handle for them.
+  absl::flat_hash_map<envoy_stream_t, std::shared_ptr<HostStream>>
+      streams_ GUARDED_BY(streams_mutex_);
+  std::atomic<bool> closed_{};
+  std::thread reader_;
+  std::thread writer_;
+};
+
+/**
+ * Relays the events of a stream started by a client back to it.
+ */
+class EngineHost::HostStream : public Http::ClientStreamCallbacks {
+public:
+  HostStream(ConnectionSharedPtr connection, envoy_stream_t client_stream,
+             envoy_stream_t host_stream)
+      : connection_(std::move(connection)), client_stream_(client_stream),
+        host_stream_(host_stream) {}
+
+  envoy_stream_t hostStream() const { return host_stream_; }
+
+  // Http::ClientStreamCallbacks
+  void onHeaders(Http::ResponseHeaderMapPtr&& headers, bool end_stream) override {
+    connection_->send(MessageType::OnHeaders, client_stream_, end_stream, encodeHeaders(*headers));
+  }
+  void onData(Buffer::InstancePtr&& data, bool end_stream) override {
+    connection_->send(MessageType::OnData, client_stream_, end_stream, data->toString());
+  }
+  void onTrailers(Http::ResponseTrailerMapPtr&& trailers) override {
+    connection_->send(MessageType::OnTrailers, client_stream_, true, encodeHeaders(*trailers));
+  }
+  void onComplete() override { close(MessageType::OnComplete, ""); }
+  void onError(const Http::ClientStreamError& error) override {
+    close(MessageType::OnError, encodeError(error));
+  }
+  void onCancel() override { close(MessageType::OnCancel, ""); }
+
+private:
+  void close(MessageType type, absl::string_view payload) {
+    // Closing the stream releases this object, so hold the connection until done with it.
+    ConnectionSharedPtr connection = connection_;
+    const envoy_stream_t client_stream = client_stream_;
+    connection->send(type, client_stream, true, payload);
+    connection->onStreamClosed(client_stream);
+  }
+
+  const ConnectionSharedPtr connection_;
+  const envoy_stream_t client_stream_;
+  const envoy_stream_t host_stream_;
+};
+
+void EngineHost::Connection::send(MessageType type, envoy_stream_t stream, bool end_stream,
+                                  absl::string_view payload) {
+  std::string frame = encodeFrame(type, stream, end_stream, payload);
+  Thread::LockGuard lock(write_mutex_);
+  if (writes_closed_) {
+    return;
+  }
+  if (frame.empty()) {
+    // The payload can't be sent, so the client is disconnected, which cancels its streams.
+    ENVOY_LOG(error, "ipc message of {} bytes is too large", payload.size());
+    shutdown();
+    return;
+  }
+  queued_bytes_ += frame.size();
+  frames_.push_back(std::move(frame));
+  write_cv_.notifyOne();
+  if (!responses_paused_ && queued_bytes_ >= HighWatermarkBytes) {
+    ENVOY_LOG(debug, "ipc client is slow to read, pausing its responses");
+    responses_paused_ = true;
+    pauseResponses(true);
+  }
+}
+
+void EngineHost::Connection::writeFrames() {
+  while (true) {
+    std::string frame;
+    {
+      Thread::LockGuard lock(write_mutex_);
+      while (frames_.empty() && !writes_closed_) {
+        write_cv_.wait(write_mutex_);
+      }
+      if (writes_closed_) {
+        return;
+      }
+      frame = std::move(frames_.front());
+      frames_.pop_front();
+    }
+
+    // Writing blocks only this thread, for as long as the client doesn't read.
+    if (!writeFrame(fd_, frame)) {
+      // The client has gone away, in which case the reader cancels its streams.
+      closeWrites();
+      return;
+    }
+
+    Thread::LockGuard lock(write_mutex_);
+    queued_bytes_ -= frame.size();
+    if (responses_paused_ && queued_bytes_ <= LowWatermarkBytes) {
+      ENVOY_LOG(debug, "ipc client caught up, resuming its responses");
+      responses_paused_ = false;
+      pauseResponses(false);
+    }
+  }
+}
+
+void EngineHost::Connection::closeWrites() {
+  Thread::LockGuard lock(write_mutex_);
+  writes_closed_ = true;
+  frames_.clear();
+  queued_bytes_ = 0;
+  write_cv_.notifyAll();
+}
+
+void EngineHost::Connection::pauseResponses(bool paused) {
+  // Posted to the event loop while write_mutex_ is held, so that pauses and resumes are applied
+  // in the order they were decided in.
+  Thread::LockGuard lock(streams_mutex_);
+  for (const auto& stream : streams_) {
+    http_dispatcher_.pauseResponse(stream.second->hostStream(), paused);
+  }
+}
+
+void EngineHost::Connection::onStreamClosed(envoy_stream_t client_stream) {
+  std::shared_ptr<HostStream> stream;
+  {
+    Thread::LockGuard lock(streams_mutex_);
+    auto it = streams_.find(client_stream);
+    ASSERT(it != streams_.end());
+    stream = std::move(it->second);
+    streams_.erase(it);
+  }
+  // The stream is released outside of the lock.
+}
+
+void EngineHost::Connection::readMessages() {
+  Message message;
+  while (readMessage(fd_, message) && handleMessage(message)) {
+  }
+
+  // The client has gone away or violated the protocol. Cancel its open streams, which releases
+  // them once the cancellations are dispatched.
+  std::vector<envoy_stream_t> host_streams;
+  {
+    Thread::LockGuard lock(streams_mutex_);
+    for (const auto& stream : streams_) {
+      host_streams.push_back(stream.second->hostStream());
+    }
+  }
+  ENVOY_LOG(debug, "ipc client disconnected with {} open streams", host_streams.size());
+  for (envoy_stream_t host_stream : host_streams) {
+    http_dispatcher_.cancelStream(host_stream);
+  }
+  closeWrites();
+  closed_ = true;
+}
+
+bool EngineHost::Connection::handleMessage(Message& message) {
+  if (message.type_ == MessageType::StartStream) {
+    auto stream = std::make_shared<HostStream>(shared_from_this(), message.stream_,
+                                               allocate_stream_handle_());
+    {
+      Thread::LockGuard lock(streams_mutex_);
+      if (!streams_.emplace(message.stream_, stream).second) {
+        return false;
+      }
+    }
+    http_dispatcher_.startStream(stream->hostStream(), *stream);
+    Thread::LockGuard lock(write_mutex_);
+    if (responses_paused_) {
+      http_dispatcher_.pauseResponse(stream->hostStream(), true);
+    }
+    return true;
+  }
+
+  envoy_stream_t host_stream;
+  {
+    Thread::LockGuard lock(streams_mutex_);
+    auto it = streams_.find(message.stream_);
+    if (it == streams_.end()) {
+      // As with local streams, operations on streams which have closed are ignored.
+      return true;
+    }
+    host_stream = it->second->hostStream();
+  }
+
+  switch (message.type_) {
+  case MessageType::SendHeaders: {
+    auto headers = Http::RequestHeaderMapImpl::create();
+    if (!decodeHeaders(message.payload_, *headers)) {
+      return false;
+    }
+    http_dispatcher_.sendHeaders(host_stream, std::move(headers), message.end_stream_);
+    return true;
+  }
+  case MessageType::SendData:
+    http_dispatcher_.sendData(host_stream, std::make_unique<Buffer::OwnedImpl>(message.payload_),
+                              message.end_stream_);
+    return true;
+  case MessageType::SendTrailers: {
+    auto trailers = Http::RequestTrailerMapImpl::create();
+    if (!decodeHeaders(message.payload_, *trailers)) {
+      return false;
+    }
+    http_dispatcher_.sendTrailers(host_stream, std::move(trailers));
+    return true;
+  }
+  case MessageType::ResetStream:
+    http_dispatcher_.cancelStream(host_stream);
+    return true;
+  default:
+    // Messages sent by the host are never valid from a client.
+    return false;
+  }
+}
+
+EngineHost::EngineHost(Http::Dispatcher& http_dispatcher,
+                       StreamHandleAllocator allocate_stream_handle)
+    : http_dispatcher_(http_dispatcher), allocate_stream_handle_(allocate_stream_handle) {}
+
+EngineHost::~EngineHost() {
+  if (accept_thread_.joinable()) {
+    const char wake = 0;
+    while (::write(wake_fds_[1], &wake, 1) < 0 && errno == EINTR) {
+    }
+    accept_thread_.join();
+  }
+
+  std::vector<ConnectionSharedPtr> connections;
+  {
+    Thread::LockGuard lock(mutex_);
+    connections.swap(connections_);
+  }
+  for (const auto& connection : connections) {
+    connection->shutdown();
+  }
+  for (const auto& connection : connections) {
+    connection->join();
+  }
+
+  for (int fd : {listen_fd_, wake_fds_[0], wake_fds_[1]}) {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+  if (listen_fd_ >= 0) {
+    ::unlink(path_.c_str());
+  }
+}
+
+envoy_status_t EngineHost::listen(const std::string& path) {
+  ASSERT(listen_fd_ < 0, "an engine host may only listen once");
+  sockaddr_un address{};
+  if (path.size() >= sizeof(address.sun_path)) {
+    ENVOY_LOG(error, "ipc socket path is too long: {}", path);
+    return ENVOY_FAILURE;
+  }
+  address.sun_family = AF_UNIX;
+  memcpy(address.sun_path, path.data(), path.size());
+
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return ENVOY_FAILURE;
+  }
+  ::unlink(path.c_str());
+  // Only the host's user may connect to the socket. Clients which connect before its permissions
+  // are restricted are rejected by their credentials, @see acceptConnections().
+  if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+      ::chmod(path.c_str(), S_IRUSR | S_IWUSR) < 0 || ::listen(fd, SOMAXCONN) < 0 ||
+      ::pipe(wake_fds_) < 0) {
+    ENVOY_LOG(error, "unable to listen for ipc clients on {}: {}", path, strerror(errno));
+    ::close(fd);
+    return ENVOY_FAILURE;
+  }
+
+  path_ = path;
+  listen_fd_ = fd;
+  accept_thread_ = std::thread(&EngineHost::acceptConnections, this);
+  return ENVOY_SUCCESS;
+}
+
+void EngineHost::acceptConnections() {
+  while (true) {
+    pollfd fds[] = {{listen_fd_, POLLIN, 0}, {wake_fds_[0], POLLIN, 0}};
+    if (::poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ENVOY_LOG(error, "ipc accept failed: {}", strerror(errno));
+      return;
+    }
+    if (fds[1].revents != 0) {
+      return;
+    }
+
+    const int fd = ::accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) {
+      continue;
+    }
+    if (!isSameUser(fd)) {
+      ENVOY_LOG(warn, "rejected ipc client running as another user");
+      ::close(fd);
+      continue;
+    }
+    configureSocket(fd);
+    auto connection = std::make_shared<Connection>(http_dispatcher_, allocate_stream_handle_, fd);
+
+    Thread::LockGuard lock(mutex_);
+    // Release connections whose clients have gone away.
+    connections_.erase(std::remove_if(connections_.begin(), connections_.end(),
+                                      [](const ConnectionSharedPtr& existing) {
+                                        if (!existing->closed()) {
+                                          return false;
+                                        }
+                                        existing->join();
+                                        return true;
+                                      }),
+                       connections_.end());
+    connection->start();
+    connections_.push_back(std::move(connection));
+  }
+}
+
+} // namespace Ipc
+} // namespace Envoy
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/common/logger.h"
+#include "common/common/thread.h"
+
+#include "library/common/http/dispatcher.h"
+#include "library/common/types/c_types.h"
+
+namespace Envoy {
+namespace Ipc {
+
+/**
+ * Serves an engine's HTTP streams to other processes on the device over a Unix domain socket, so
+ * that they share its connection pools, DNS cache and TLS sessions. @see EngineClient.
+ *
+ * Only processes running as the same user as the host may connect. Each client connection is
+ * served by a thread which relays its stream operations to the Http::Dispatcher, and by a thread
+ * which writes responses back to the client. The engine's event loop only queues responses, so a
+ * client which is slow to read them doesn't hold up the engine; instead, the responses of its
+ * streams are paused while too many are queued.
+ */
+class EngineHost : public Logger::Loggable<Logger::Id::main> {
+public:
+  using StreamHandleAllocator = std::function<envoy_stream_t()>;
+
+  /**
+   * @param http_dispatcher, the dispatcher to relay streams to. It must outlive this host and any
+   *        streams started through it.
+   * @param allocate_stream_handle, allocates handles for relayed streams which do not collide
+   *        with those of the engine's local streams.
+   */
+  EngineHost(Http::Dispatcher& http_dispatcher, StreamHandleAllocator allocate_stream_handle);
+
+  /**
+   * Stops accepting clients and disconnects existing ones, cancelling their open streams.
+   */
+  ~EngineHost();
+
+  /**
+   * Start accepting clients.
+   * @param path, the path to bind the socket to. An existing file at the path is replaced, and the
+   *        socket is only accessible to the host's user.
+   * @return envoy_status_t, the resulting status of the operation.
+   */
+  envoy_status_t listen(const std::string& path);
+
+private:
+  class Connection;
+  class HostStream;
+  using ConnectionSharedPtr = std::shared_ptr<Connection>;
+
+  void acceptConnections();
+
+  Http::Dispatcher& http_dispatcher_;
+  const StreamHandleAllocator allocate_stream_handle_;
+  std::string path_;
+  int listen_fd_{-1};
+  // Written to wake the accept thread when shutting down.
+  int wake_fds_[2]{-1, -1};
+  Thread::MutexBasicLockable mutex_;
+  std::vector<ConnectionSharedPtr> connections_ GUARDED_BY(mutex_);
+  std::thread accept_thread_;
+};
+
+} // namespace Ipc
+} // namespace Envoy
@@ -0,0 +1,234 @@
+#include "library/common/ipc/protocol.h"
+
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include "common/http/header_map_impl.h"
+
+namespace Envoy {
+namespace Ipc {
+
+namespace {
+
+// Frame header: payload length (4), type (1), stream (8), end_stream (1), in host byte order.
+// Both ends of the socket are always on the same device.
+constexpr size_t FrameHeaderBytes = 4 + 1 + 8 + 1;
+
+#ifdef MSG_NOSIGNAL
+constexpr int SendFlags = MSG_NOSIGNAL;
+#else
+// Platforms without MSG_NOSIGNAL set SO_NOSIGPIPE on the socket instead.
+constexpr int SendFlags = 0;
+#endif
+
+bool writeAll(int fd, const char* bytes, size_t length) {
+  while (length > 0) {
+    const ssize_t written = ::send(fd, bytes, length, SendFlags);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    bytes += written;
+    length -= written;
+  }
+  return true;
+}
+
+bool readAll(int fd, char* bytes, size_t length) {
+  while (length > 0) {
+    const ssize_t read = ::recv(fd, bytes, length, 0);
+    if (read < 0 && errno == EINTR) {
+      continue;
+    }
+    if (read <= 0) {
+      return false;
+    }
+    bytes += read;
+    length -= read;
+  }
+  return true;
+}
+
+template <class T> void appendValue(std::string& output, T value) {
+  output.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class T> bool consumeValue(absl::string_view& input, T& value) {
+  if (input.size() < sizeof(T)) {
+    return false;
+  }
+  memcpy(&value, input.data(), sizeof(T));
+  input.remove_prefix(sizeof(T));
+  return true;
+}
+
+void appendString(std::string& output, absl::string_view value) {
+  appendValue<uint32_t>(output, value.size());
+  output.append(value.data(), value.size());
+}
+
+bool consumeString(absl::string_view& input, absl::string_view& value) {
+  uint32_t length;
+  if (!consumeValue(input, length) || input.size() < length) {
+    return false;
+  }
+  value = input.substr(0, length);
+  input.remove_prefix(length);
+  return true;
+}
+
+// Header blocks are a sequence of (key, value) strings.
+template <class Callback> bool forEachHeader(absl::string_view payload, Callback callback) {
+  while (!payload.empty()) {
+    absl::string_view key;
+    absl::string_view value;
+    if (!consumeString(payload, key) || !consumeString(payload, value)) {
+      return false;
+    }
+    callback(key, value);
+  }
+  return true;
+}
+
+absl::string_view toStringView(envoy_data data) {
+  return {reinterpret_cast<const char*>(data.bytes), data.length};
+}
+
+envoy_data toBridgeData(absl::string_view value) {
+  return copy_envoy_data(value.size(), reinterpret_cast<const uint8_t*>(value.data()));
+}
+
+} // namespace
+
+void configureSocket(int fd) {
+#if !defined(MSG_NOSIGNAL) && defined(SO_NOSIGPIPE)
+  int enabled = 1;
+  ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+#else
+  (void)fd;
+#endif
+}
+
+std::string encodeFrame(MessageType type, envoy_stream_t stream, bool end_stream,
+                        absl::string_view payload) {
+  std::string frame;
+  if (payload.size() > MaxPayloadBytes) {
+    return frame;
+  }
+  frame.reserve(FrameHeaderBytes + payload.size());
+  appendValue<uint32_t>(frame, payload.size());
+  appendValue<uint8_t>(frame, static_cast<uint8_t>(type));
+  appendValue<int64_t>(frame, stream);
+  appendValue<uint8_t>(frame, end_stream);
+  frame.append(payload.data(), payload.size());
+  return frame;
+}
+
+bool writeFrame(int fd, absl::string_view frame) {
+  return writeAll(fd, frame.data(), frame.size());
+}
+
+bool writeMessage(int fd, MessageType type, envoy_stream_t stream, bool end_stream,
+                  absl::string_view payload) {
+  const std::string frame = encodeFrame(type, stream, end_stream, payload);
+  return !frame.empty() && writeFrame(fd, frame);
+}
+
+bool readMessage(int fd, Message& message) {
+  char header[FrameHeaderBytes];
+  if (!readAll(fd, header, sizeof(header))) {
+    return false;
+  }
+  absl::string_view input(header, sizeof(header));
+  uint32_t length;
+  uint8_t type;
+  int64_t stream;
+  uint8_t end_stream;
+  consumeValue(input, length);
+  consumeValue(input, type);
+  consumeValue(input, stream);
+  consumeValue(input, end_stream);
+  if (length > MaxPayloadBytes || type > static_cast<uint8_t>(MessageType::OnCancel)) {
+    return false;
+  }
+
+  message.type_ = static_cast<MessageType>(type);
+  message.stream_ = stream;
+  message.end_stream_ = end_stream != 0;
+  message.payload_.resize(length);
+  return readAll(fd, &message.payload_[0], length);
+}
+
+std::string encodeHeaders(envoy_headers headers) {
+  std::string payload;
+  for (envoy_header_size_t i = 0; i < headers.length; i++) {
+    appendString(payload, toStringView(headers.headers[i].key));
+    appendString(payload, toStringView(headers.headers[i].value));
+  }
+  return payload;
+}
+
+std::string encodeHeaders(const Http::HeaderMap& headers) {
+  std::string payload;
+  headers.iterate([&payload](const Http::HeaderEntry& header) -> Http::HeaderMap::Iterate {
+    appendString(payload, header.key().getStringView());
+    appendString(payload, header.value().getStringView());
+    return Http::HeaderMap::Iterate::Continue;
+  });
+  return payload;
+}
+
+bool decodeHeaders(absl::string_view payload, Http::HeaderMap& headers) {
+  return forEachHeader(payload, [&headers](absl::string_view key, absl::string_view value) {
+    headers.addCopy(Http::LowerCaseString(std::string(key)), value);
+  });
+}
+
+bool decodeHeaders(absl::string_view payload, envoy_headers& headers) {
+  std::vector<envoy_header> entries;
+  const bool valid = forEachHeader(payload, [&entries](absl::string_view key,
+                                                       absl::string_view value) {
+    entries.push_back({toBridgeData(key), toBridgeData(value)});
+  });
+  if (!valid) {
+    for (const envoy_header& entry : entries) {
+      entry.key.release(entry.key.context);
+      entry.value.release(entry.value.context);
+    }
+    return false;
+  }
+
+  headers.length = entries.size();
+  headers.headers = static_cast<envoy_header*>(safe_malloc(sizeof(envoy_header) * entries.size()));
+  std::copy(entries.begin(), entries.end(), headers.headers);
+  return true;
+}
+
+std::string encodeError(const Http::ClientStreamError& error) {
+  std::string payload;
+  appendValue<int32_t>(payload, error.error_code_);
+  appendValue<int32_t>(payload, error.attempt_count_.value_or(-1));
+  payload.append(error.message_);
+  return payload;
+}
+
+bool decodeError(absl::string_view payload, envoy_error& error) {
+  int32_t error_code;
+  int32_t attempt_count;
+  if (!consumeValue(payload, error_code) || !consumeValue(payload, attempt_count)) {
+    return false;
+  }
+  error.error_code = static_cast<envoy_error_code_t>(error_code);
+  error.attempt_count = attempt_count;
+  error.message = payload.empty() ? envoy_nodata : toBridgeData(payload);
+  return true;
+}
+
+} // namespace Ipc
+} // namespace Envoy
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "envoy/http/header_map.h"
+
+#include "absl/strings/string_view.h"
+#include "library/common/http/dispatcher.h"
+#include "library/common/types/c_types.h"
+
+namespace Envoy {
+namespace Ipc {
+
+/**
+ * Messages exchanged between an engine host and its clients over a Unix domain socket.
+ */
+enum class MessageType : uint8_t {
+  // Client to host.
+  StartStream,
+  SendHeaders,
+  SendData,
+  SendTrailers,
+  ResetStream,
+  // Host to client.
+  OnHeaders,
+  OnData,
+  OnTrailers,
+  OnComplete,
+  OnError,
+  OnCancel,
+};
+
+/**
+ * A framed message. Streams are identified by the client's handle for them.
+ */
+struct Message {
+  MessageType type_;
+  envoy_stream_t stream_;
+  bool end_stream_{};
+  // Encoded headers, data or an error, depending on type_.
+  std::string payload_;
+};
+
+// Messages larger than this are treated as a protocol error.
+constexpr uint32_t MaxPayloadBytes = 64 * 1024 * 1024;
+
+/**
+ * Prepare a connected socket for use with writeMessage().
+ * @param fd, the socket.
+ */
+void configureSocket(int fd);
+
+/**
+ * Encode a message as a frame, to be written with writeFrame().
+ * @param type, the message type.
+ * @param stream, the client's handle for the stream the message is for.
+ * @param end_stream, whether the message ends its direction of the stream.
+ * @param payload, the message payload.
+ * @return std::string, the frame; empty if the payload is too large to send.
+ */
+std::string encodeFrame(MessageType type, envoy_stream_t stream, bool end_stream,
+                        absl::string_view payload);
+
+/**
+ * Write an encoded frame to a socket, blocking until it is written.
+ * @param fd, the socket to write to.
+ * @param frame, the frame, @see encodeFrame().
+ * @return bool whether the frame was written; false if the socket is closed.
+ */
+bool writeFrame(int fd, absl::string_view frame);
+
+/**
+ * Write a message to a socket, blocking until it is written.
+ * @param fd, the socket to write to.
+ * @param type, the message type.
+ * @param stream, the client's handle for the stream the message is for.
+ * @param end_stream, whether the message ends its direction of the stream.
+ * @param payload, the message payload.
+ * @return bool whether the message was written; false if the socket is closed.
+ */
+bool writeMessage(int fd, MessageType type, envoy_stream_t stream, bool end_stream,
+                  absl::string_view payload);
+
+/**
+ * Read a message from a socket, blocking until one is read.
+ * @param fd, the socket to read from.
+ * @param message, the message to read into.
+ * @return bool whether a message was read; false if the socket is closed or the message is
+ *         malformed.
+ */
+bool readMessage(int fd, Message& message);
+
+/**
+ * Encode headers as a message payload.
+ */
+std::string encodeHeaders(envoy_headers headers);
+std::string encodeHeaders(const Http::HeaderMap& headers);
+
+/**
+ * Decode headers from a message payload.
+ * @return bool whether the payload was well formed. On failure, no headers are returned.
+ */
+bool decodeHeaders(absl::string_view payload, Http::HeaderMap& headers);
+bool decodeHeaders(absl::string_view payload, envoy_headers& headers);
+
+/**
+ * Encode a stream error as a message payload.
+ */
+std::string encodeError(const Http::ClientStreamError& error);
+
+/**
+ * Decode a stream error from a message payload.
+ * @return bool whether the payload was well formed. On success, the caller owns error.message.
+ */
+bool decodeError(absl::string_view payload, envoy_error& error);
+
+} // namespace Ipc
+} // namespace Envoy
@@ -8,6 +8,7 @@
 #include "library/common/jni/jni_utility.h"
 #include "library/common/jni/jni_version.h"
 #include "library/common/main_interface.h"
+#include "library/common/stats/bridge_copy_stats.h"
 
 // NOLINT(namespace-envoy)
 
@@ -114,6 +115,7 @@ static void pass_headers(JNIEnv* env, envoy_headers headers, jobject j_context)
   jmethodID jmid_passHeader = env->GetMethodID(jcls_JvmCallbackContext, "passHeader", "([B[BZ)V");
   env->PushLocalFrame(headers.length * 2);
   jboolean start_headers = JNI_TRUE;
+  uint64_t bytes_copied = 0;
 
   for (envoy_header_size_t i = 0; i < headers.length; i++) {
     // Note this is just an initial implementation, and we will pass a more optimized structure in
@@ -139,6 +141,7 @@ static void pass_headers(JNIEnv* env, envoy_headers headers, jobject j_context)
     void* critical_value = env->GetPrimitiveArrayCritical(value, nullptr);
     memcpy(critical_value, headers.headers[i].value.bytes, headers.headers[i].value.length);
     env->ReleasePrimitiveArrayCritical(value, critical_value, 0);
+    bytes_copied += headers.headers[i].key.length + headers.headers[i].value.length;
 
     // Pass this header pair to the platform
     env->CallVoidMethod(j_context, jmid_passHeader, key, value, start_headers);
@@ -147,6 +150,8 @@ static void pass_headers(JNIEnv* env, envoy_headers headers, jobject j_context)
     // consider this and/or periodically popping the frame.
     start_headers = JNI_FALSE;
   }
+  // Each key and value is copied into a new JVM array.
+  ENVOY_MOBILE_BRIDGE_COPY(jni_pass_headers, bytes_copied, 2 * headers.length);
 
   env->PopLocalFrame(nullptr);
   env->DeleteLocalRef(jcls_JvmCallbackContext);
@@ -239,6 +244,7 @@ static void* jvm_on_data(const char* method, envoy_data data, bool end_stream, v
   // Here '0' (for which there is no named constant) indicates we want to commit the changes back
   // to the JVM and free the c array, where applicable.
   env->ReleasePrimitiveArrayCritical(j_data, critical_data, 0);
+  ENVOY_MOBILE_BRIDGE_COPY(jni_on_data, data.length, 1);
   jobject result =
       env->CallObjectMethod(j_context, jmid_onData, j_data, end_stream ? JNI_TRUE : JNI_FALSE);
 
@@ -440,6 +446,19 @@ static const void* jvm_http_filter_init(const void* context) {
   return retained_filter;
 }
 
+static void jvm_http_filter_reset(const void* context) {
+  __android_log_write(ANDROID_LOG_VERBOSE, "[Envoy]", "jvm_filter_reset");
+
+  JNIEnv* env = get_env();
+  jobject j_context = static_cast<jobject>(const_cast<void*>(context));
+
+  jclass jcls_JvmFilterContext = env->GetObjectClass(j_context);
+  jmethodID jmid_reset = env->GetMethodID(jcls_JvmFilterContext, "reset", "()V");
+  env->CallVoidMethod(j_context, jmid_reset);
+
+  env->DeleteLocalRef(jcls_JvmFilterContext);
+}
+
 // EnvoyHTTPStream
 
 extern "C" JNIEXPORT jlong JNICALL Java_io_envoyproxy_envoymobile_engine_JniLibrary_initStream(
@@ -476,11 +495,11 @@ extern "C" JNIEXPORT jint JNICALL Java_io_envoyproxy_envoymobile_engine_JniLibra
 
 extern "C" JNIEXPORT jint JNICALL
 Java_io_envoyproxy_envoymobile_engine_JniLibrary_registerFilterFactory(JNIEnv* env, jclass,
+                                                                       jlong engine,
                                                                        jstring filter_name,
                                                                        jobject j_context) {
 
   // TODO(goaway): Everything here leaks, but it's all be tied to the life of the engine.
-  // This will need to be updated for https://github.com/lyft/envoy-mobile/issues/332
   __android_log_write(ANDROID_LOG_VERBOSE, "[Envoy]", "registerFilterFactory");
   __android_log_print(ANDROID_LOG_VERBOSE, "[Envoy]", "j_context: %p", j_context);
   jclass jcls_JvmFilterFactoryContext = env->GetObjectClass(j_context);
@@ -495,10 +514,11 @@ Java_io_envoyproxy_envoymobile_engine_JniLibrary_registerFilterFactory(JNIEnv* e
   api->on_response_data = jvm_http_filter_on_response_data;
   api->on_response_trailers = jvm_http_filter_on_response_trailers;
   api->release_filter = jni_delete_const_global_ref;
+  api->reset_filter = jvm_http_filter_reset;
   api->static_context = retained_context;
   api->instance_context = NULL;
 
-  register_platform_api(env->GetStringUTFChars(filter_name, nullptr), api);
+  register_engine_platform_api(engine, env->GetStringUTFChars(filter_name, nullptr), api);
   env->DeleteLocalRef(jcls_JvmFilterFactoryContext);
   return ENVOY_SUCCESS;
 }
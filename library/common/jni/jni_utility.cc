@@ -4,6 +4,7 @@
 #include <string.h>
 
 #include "library/common/jni/jni_version.h"
+#include "library/common/stats/bridge_copy_stats.h"
 
 // NOLINT(namespace-envoy)
 
@@ -54,6 +55,7 @@ envoy_data array_to_native_data(JNIEnv* env, jbyteArray j_data) {
   void* critical_data = env->GetPrimitiveArrayCritical(j_data, 0);
   memcpy(native_bytes, critical_data, data_length);
   env->ReleasePrimitiveArrayCritical(j_data, critical_data, 0);
+  ENVOY_MOBILE_BRIDGE_COPY(jni_array_to_native_data, data_length, 1);
   return {data_length, native_bytes, free, native_bytes};
 }
 
@@ -85,6 +87,7 @@ envoy_headers to_native_headers(JNIEnv* env, jobjectArray headers) {
   envoy_header_size_t length = env->GetArrayLength(headers);
   envoy_header* header_array =
       static_cast<envoy_header*>(safe_malloc(sizeof(envoy_header) * length / 2));
+  uint64_t bytes_copied = 0;
 
   for (envoy_header_size_t i = 0; i < length; i += 2) {
     // Copy native byte array for header key
@@ -106,7 +109,10 @@ envoy_headers to_native_headers(JNIEnv* env, jobjectArray headers) {
     envoy_data header_value = {value_length, native_value, free, native_value};
 
     header_array[i / 2] = {header_key, header_value};
+    bytes_copied += key_length + value_length;
   }
+  // The header array, and a key and value for each header.
+  ENVOY_MOBILE_BRIDGE_COPY(jni_to_native_headers, bytes_copied, 1 + length);
 
   envoy_headers native_headers = {length / 2, header_array};
   return native_headers;
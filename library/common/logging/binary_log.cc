@@ -0,0 +1,456 @@
+#include "library/common/logging/binary_log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "common/signal/fatal_error_handler.h"
+
+namespace Envoy {
+namespace Logging {
+
+/**
+ * A record. Apart from sequence_, fields are written only by the ring's thread, and are read by
+ * dumping threads under a sequence lock: sequence_ is 2i+1 while record i is being written, and
+ * 2i+2 once it has been.
+ */
+struct Slot {
+  std::atomic<uint64_t> sequence_{0};
+  // The thread which wrote the record. A ring's records may be from several threads, one after
+  // another, as rings are reused.
+  uint32_t thread_index_;
+  const BinaryLogSite* site_;
+  int64_t timestamp_ns_;
+  uint16_t length_;
+  bool truncated_;
+  uint8_t payload_[BinaryLog::PayloadBytes];
+};
+
+struct BinaryLog::Ring {
+  // Whether a thread owns the ring. Cleared when the thread exits, so that another can claim it.
+  std::atomic<bool> in_use_{true};
+  // The owning thread's index. Only accessed by the owning thread.
+  uint32_t thread_index_;
+  // Index of the next record. Only modified by the owning thread.
+  std::atomic<uint64_t> next_{};
+  // The next ring in the list of all rings, which is only ever prepended to.
+  Ring* next_ring_{};
+  // The records remaining to be written by dumpOnCrash().
+  uint64_t crash_dump_next_{};
+  uint64_t crash_dump_end_{};
+  Slot slots_[RingSlots];
+};
+
+namespace {
+
+// Rings are never freed, so that dumps never race with thread exit. Instead, a thread's ring is
+// released when it exits, and claimed by the next thread which logs, so there are only as many
+// rings as threads which have logged at the same time. Only threads which log while the binary
+// log is enabled claim a ring. The list can be read without locking, so that it can be dumped
+// while the process crashes.
+std::atomic<BinaryLog::Ring*> rings{nullptr};
+std::atomic<uint32_t> thread_count{0};
+
+// The calling thread's ring, once it has logged.
+thread_local BinaryLog::Ring* thread_ring = nullptr;
+
+/**
+ * Releases the thread's ring when the thread exits.
+ */
+struct ThreadRingRelease {
+  ~ThreadRingRelease() {
+    if (thread_ring != nullptr) {
+      // Publishes the ring's state to the thread which claims it next.
+      thread_ring->in_use_.store(false, std::memory_order_release);
+      thread_ring = nullptr;
+    }
+  }
+};
+thread_local ThreadRingRelease thread_ring_release;
+
+/**
+ * Dumps the binary log when the process crashes.
+ */
+class BinaryLogFatalErrorHandler : public FatalErrorHandlerInterface {
+public:
+  void onFatalError(std::ostream& os) const override {
+    os << "Binary log:\n";
+    BinaryLog::dumpOnCrash(os);
+  }
+};
+
+struct Record {
+  uint32_t thread_index_;
+  const BinaryLogSite* site_;
+  int64_t timestamp_ns_;
+  bool truncated_;
+  std::vector<uint8_t> payload_;
+};
+
+/**
+ * Writes a record's arguments one at a time, in order. Stops at the end of the payload, or at the
+ * first argument which is corrupt or runs past the end.
+ */
+class ArgumentWriter {
+public:
+  ArgumentWriter(const uint8_t* payload, size_t length)
+      : position_(payload), end_(payload + length) {}
+
+  // @return bool whether an argument was written.
+  bool writeNext(std::ostream& os) {
+    if (position_ >= end_) {
+      return false;
+    }
+    switch (static_cast<BinaryLogTag>(*position_)) {
+    case BinaryLogTag::Signed: {
+      int64_t value;
+      return read(value) && static_cast<bool>(os << value);
+    }
+    case BinaryLogTag::Unsigned: {
+      uint64_t value;
+      return read(value) && static_cast<bool>(os << value);
+    }
+    case BinaryLogTag::Bool: {
+      uint8_t value;
+      return read(value) && static_cast<bool>(os << (value ? "true" : "false"));
+    }
+    case BinaryLogTag::Double: {
+      double value;
+      return read(value) && static_cast<bool>(os << value);
+    }
+    case BinaryLogTag::String: {
+      uint16_t length;
+      if (!read(length) || length > end_ - position_) {
+        position_ = end_;
+        return false;
+      }
+      os.write(reinterpret_cast<const char*>(position_), length);
+      position_ += length;
+      return true;
+    }
+    }
+    // The record is corrupt; stop rather than misinterpret it.
+    position_ = end_;
+    return false;
+  }
+
+private:
+  // Reads the value following the current argument's tag.
+  template <class T> bool read(T& value) {
+    if (sizeof(T) >= static_cast<size_t>(end_ - position_)) {
+      position_ = end_;
+      return false;
+    }
+    memcpy(&value, position_ + 1, sizeof(T));
+    position_ += 1 + sizeof(T);
+    return true;
+  }
+
+  const uint8_t* position_;
+  const uint8_t* end_;
+};
+
+// Writes a timestamp as an RFC 3339 UTC time, without allocating.
+void writeTimestamp(std::ostream& os, int64_t timestamp_ns) {
+  constexpr int64_t NanosPerSecond = 1000000000;
+  constexpr int64_t SecondsPerDay = 86400;
+  int64_t seconds = timestamp_ns / NanosPerSecond;
+  int64_t nanos = timestamp_ns % NanosPerSecond;
+  if (nanos < 0) {
+    seconds--;
+    nanos += NanosPerSecond;
+  }
+  int64_t days = seconds / SecondsPerDay;
+  int64_t second_of_day = seconds % SecondsPerDay;
+  if (second_of_day < 0) {
+    days--;
+    second_of_day += SecondsPerDay;
+  }
+  // Converts days since the epoch to a civil date in the proleptic Gregorian calendar.
+  const int64_t z = days + 719468;
+  const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  const int64_t day_of_era = z - era * 146097;
+  const int64_t year_of_era =
+      (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+  const int64_t day_of_year =
+      day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+  const int64_t month_index = (5 * day_of_year + 2) / 153;
+  const int64_t day = day_of_year - (153 * month_index + 2) / 5 + 1;
+  const int64_t month = month_index < 10 ? month_index + 3 : month_index - 9;
+  const int64_t year = year_of_era + era * 400 + (month <= 2 ? 1 : 0);
+
+  char buffer[64];
+  const int length =
+      snprintf(buffer, sizeof(buffer), "%04lld-%02lld-%02lldT%02lld:%02lld:%02lld.%09lldZ",
+               static_cast<long long>(year), static_cast<long long>(month),
+               static_cast<long long>(day), static_cast<long long>(second_of_day / 3600),
+               static_cast<long long>(second_of_day / 60 % 60),
+               static_cast<long long>(second_of_day % 60), static_cast<long long>(nanos));
+  if (length > 0) {
+    os.write(buffer, std::min<size_t>(length, sizeof(buffer) - 1));
+  }
+}
+
+// Writes a record, substituting its arguments for the replacement fields of its site's format
+// string. Format specifications are ignored, and missing arguments are rendered as "?". Doesn't
+// allocate, so that it can be used while the process crashes.
+void writeRecord(std::ostream& os, uint32_t thread_index, const BinaryLogSite& site,
+                 int64_t timestamp_ns, const uint8_t* payload, size_t length, bool truncated) {
+  os << "[";
+  writeTimestamp(os, timestamp_ns);
+  os << "][T" << thread_index << "][" << site.file_ << ":" << site.line_ << "] ";
+  ArgumentWriter arguments(payload, std::min(length, BinaryLog::PayloadBytes));
+  const absl::string_view format(site.format_);
+  size_t literal_start = 0;
+  for (size_t i = 0; i < format.size(); i++) {
+    const char c = format[i];
+    const bool escaped = (c == '{' || c == '}') && i + 1 < format.size() && format[i + 1] == c;
+    if (!escaped && c != '{') {
+      continue;
+    }
+    os.write(format.data() + literal_start, i - literal_start);
+    if (escaped) {
+      os.put(c);
+      literal_start = ++i + 1;
+      continue;
+    }
+    const size_t close = format.find('}', i);
+    if (close == absl::string_view::npos) {
+      literal_start = i;
+      break;
+    }
+    if (!arguments.writeNext(os)) {
+      os.put('?');
+    }
+    i = close;
+    literal_start = close + 1;
+  }
+  if (literal_start < format.size()) {
+    os.write(format.data() + literal_start, format.size() - literal_start);
+  }
+  os << (truncated ? " [truncated]" : "") << "\n";
+}
+
+} // namespace
+
+std::atomic<bool> BinaryLog::enabled_{false};
+
+void BinaryLog::setEnabled(bool enabled) {
+  if (enabled) {
+    static const BinaryLogFatalErrorHandler* fatal_error_handler = []() {
+      auto* handler = new BinaryLogFatalErrorHandler();
+      FatalErrorHandler::registerFatalErrorHandler(*handler);
+      return handler;
+    }();
+    (void)fatal_error_handler;
+  }
+  enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+BinaryLog::Ring& BinaryLog::threadRing() {
+  if (thread_ring != nullptr) {
+    return *thread_ring;
+  }
+  // Registers the release of the ring at thread exit.
+  (void)&thread_ring_release;
+  for (Ring* ring = rings.load(std::memory_order_acquire); ring != nullptr;
+       ring = ring->next_ring_) {
+    bool in_use = false;
+    if (ring->in_use_.compare_exchange_strong(in_use, true, std::memory_order_acquire,
+                                              std::memory_order_relaxed)) {
+      thread_ring = ring;
+      break;
+    }
+  }
+  if (thread_ring == nullptr) {
+    thread_ring = new Ring();
+    thread_ring->next_ring_ = rings.load(std::memory_order_relaxed);
+    while (!rings.compare_exchange_weak(thread_ring->next_ring_, thread_ring,
+                                        std::memory_order_release, std::memory_order_relaxed)) {
+    }
+  }
+  thread_ring->thread_index_ = thread_count.fetch_add(1, std::memory_order_relaxed);
+  return *thread_ring;
+}
+
+size_t BinaryLog::ringCount() {
+  size_t count = 0;
+  for (const Ring* ring = rings.load(std::memory_order_acquire); ring != nullptr;
+       ring = ring->next_ring_) {
+    count++;
+  }
+  return count;
+}
+
+BinaryLog::Writer::Writer(const BinaryLogSite& site)
+    : ring_(threadRing()), index_(ring_.next_.load(std::memory_order_relaxed)) {
+  Slot& slot = ring_.slots_[index_ % RingSlots];
+  slot.sequence_.store(2 * index_ + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.thread_index_ = ring_.thread_index_;
+  slot.site_ = &site;
+  slot.timestamp_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::system_clock::now() // NO_CHECK_FORMAT(real_time)
+                               .time_since_epoch())
+                           .count();
+  payload_ = slot.payload_;
+}
+
+BinaryLog::Writer::~Writer() {
+  Slot& slot = ring_.slots_[index_ % RingSlots];
+  slot.length_ = length_;
+  slot.truncated_ = truncated_;
+  slot.sequence_.store(2 * index_ + 2, std::memory_order_release);
+  ring_.next_.store(index_ + 1, std::memory_order_relaxed);
+}
+
+bool BinaryLog::Writer::reserve(size_t bytes) {
+  if (length_ + bytes > PayloadBytes) {
+    truncated_ = true;
+    return false;
+  }
+  return true;
+}
+
+size_t BinaryLog::Writer::beginString() {
+  if (!reserve(1 + sizeof(uint16_t))) {
+    return 0;
+  }
+  payload_[length_++] = static_cast<uint8_t>(BinaryLogTag::String);
+  const size_t length_offset = length_;
+  length_ += sizeof(uint16_t);
+  return length_offset;
+}
+
+void BinaryLog::Writer::appendStringBytes(absl::string_view bytes) {
+  const size_t available = PayloadBytes - length_;
+  if (bytes.size() > available) {
+    truncated_ = true;
+    bytes = bytes.substr(0, available);
+  }
+  memcpy(payload_ + length_, bytes.data(), bytes.size());
+  length_ += bytes.size();
+}
+
+void BinaryLog::Writer::endString(size_t length_offset) {
+  const uint16_t length = length_ - length_offset - sizeof(uint16_t);
+  memcpy(payload_ + length_offset, &length, sizeof(length));
+}
+
+void BinaryLog::Writer::appendString(absl::string_view value) {
+  const size_t length_offset = beginString();
+  if (length_offset == 0) {
+    return;
+  }
+  appendStringBytes(value);
+  endString(length_offset);
+}
+
+void BinaryLog::Writer::append(const Http::HeaderMap& headers) {
+  const size_t length_offset = beginString();
+  if (length_offset == 0) {
+    return;
+  }
+  headers.iterate([this](const Http::HeaderEntry& header) -> Http::HeaderMap::Iterate {
+    appendStringBytes(header.key().getStringView());
+    appendStringBytes(": ");
+    appendStringBytes(header.value().getStringView());
+    appendStringBytes("\n");
+    return truncated_ ? Http::HeaderMap::Iterate::Break : Http::HeaderMap::Iterate::Continue;
+  });
+  endString(length_offset);
+}
+
+void BinaryLog::dump(std::ostream& os) {
+  std::vector<Record> records;
+  for (const Ring* ring = rings.load(std::memory_order_acquire); ring != nullptr;
+       ring = ring->next_ring_) {
+    for (const Slot& slot : ring->slots_) {
+      const uint64_t sequence = slot.sequence_.load(std::memory_order_acquire);
+      if (sequence == 0 || sequence % 2 == 1) {
+        continue;
+      }
+      Record record{slot.thread_index_, slot.site_, slot.timestamp_ns_, slot.truncated_, {}};
+      const uint16_t length = std::min<uint16_t>(slot.length_, PayloadBytes);
+      record.payload_.assign(slot.payload_, slot.payload_ + length);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      // Skip the record if it was overwritten while being copied.
+      if (slot.sequence_.load(std::memory_order_relaxed) != sequence) {
+        continue;
+      }
+      records.push_back(std::move(record));
+    }
+  }
+
+  std::stable_sort(records.begin(), records.end(), [](const Record& a, const Record& b) {
+    return a.timestamp_ns_ < b.timestamp_ns_;
+  });
+  for (const Record& record : records) {
+    writeRecord(os, record.thread_index_, *record.site_, record.timestamp_ns_,
+                record.payload_.data(), record.payload_.size(), record.truncated_);
+  }
+}
+
+void BinaryLog::dumpOnCrash(std::ostream& os) {
+  Ring* const first_ring = rings.load(std::memory_order_acquire);
+  for (Ring* ring = first_ring; ring != nullptr; ring = ring->next_ring_) {
+    ring->crash_dump_end_ = ring->next_.load(std::memory_order_relaxed);
+    ring->crash_dump_next_ =
+        ring->crash_dump_end_ > RingSlots ? ring->crash_dump_end_ - RingSlots : 0;
+  }
+  // Each ring's records are in order, so the rings are merged by repeatedly writing the oldest of
+  // their next records.
+  while (true) {
+    Ring* oldest = nullptr;
+    for (Ring* ring = first_ring; ring != nullptr; ring = ring->next_ring_) {
+      // Skip records which are being written, or have been overwritten since the dump started.
+      while (ring->crash_dump_next_ < ring->crash_dump_end_ &&
+             ring->slots_[ring->crash_dump_next_ % RingSlots].sequence_.load(
+                 std::memory_order_acquire) != 2 * ring->crash_dump_next_ + 2) {
+        ring->crash_dump_next_++;
+      }
+      if (ring->crash_dump_next_ == ring->crash_dump_end_) {
+        continue;
+      }
+      if (oldest == nullptr ||
+          ring->slots_[ring->crash_dump_next_ % RingSlots].timestamp_ns_ <
+              oldest->slots_[oldest->crash_dump_next_ % RingSlots].timestamp_ns_) {
+        oldest = ring;
+      }
+    }
+    if (oldest == nullptr) {
+      return;
+    }
+    // The record is read in place, as copying it would allocate. Other threads may still be
+    // logging, so it may be garbled if it is overwritten while being written out.
+    const Slot& slot = oldest->slots_[oldest->crash_dump_next_ % RingSlots];
+    writeRecord(os, slot.thread_index_, *slot.site_, slot.timestamp_ns_, slot.payload_,
+                slot.length_, slot.truncated_);
+    oldest->crash_dump_next_++;
+  }
+}
+
+bool BinaryLog::dumpToFile(const std::string& path) {
+  std::ofstream file(path, std::ios::out | std::ios::trunc);
+  if (!file) {
+    return false;
+  }
+  dump(file);
+  return static_cast<bool>(file);
+}
+
+void BinaryLog::resetForTest() {
+  for (Ring* ring = rings.load(std::memory_order_acquire); ring != nullptr;
+       ring = ring->next_ring_) {
+    for (Slot& slot : ring->slots_) {
+      slot.sequence_.store(0, std::memory_order_relaxed);
+    }
+    ring->next_.store(0, std::memory_order_relaxed);
+  }
+}
+
+} // namespace Logging
+} // namespace Envoy
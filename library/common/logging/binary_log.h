@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+#include "envoy/http/header_map.h"
+
+#include "common/common/logger.h"
+
+#include "absl/strings/string_view.h"
+
+namespace Envoy {
+namespace Logging {
+
+/**
+ * A static log statement. Records refer to their site rather than carrying the format string, and
+ * only the site's arguments are captured when logging.
+ */
+struct BinaryLogSite {
+  const char* format_;
+  const char* file_;
+  int line_;
+};
+
+/**
+ * Encodings of recorded arguments.
+ */
+enum class BinaryLogTag : uint8_t { Signed, Unsigned, Bool, Double, String };
+
+/**
+ * In-process binary log sink. When enabled, ENVOY_MOBILE_LOG statements record their site and raw
+ * arguments into a lock-free ring buffer owned by the logging thread instead of formatting a
+ * message. Records are only formatted when the log is dumped, which happens on demand or when the
+ * process crashes. This makes always-on diagnostic logging affordable on the engine's dispatcher.
+ *
+ * Each thread's ring holds the most recent RingSlots records. A thread's ring is reused by
+ * another thread after it exits, so threads which come and go don't each keep a ring. Arguments
+ * which do not fit in a record (e.g. large header maps) are truncated.
+ */
+class BinaryLog {
+public:
+  static constexpr size_t RingSlots = 512;
+  static constexpr size_t PayloadBytes = 480;
+
+  /**
+   * @return bool whether ENVOY_MOBILE_LOG statements are recorded to the binary log, in place of
+   *         being formatted and logged through the Envoy logger.
+   */
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  /**
+   * Select the binary log as the logger for ENVOY_MOBILE_LOG statements.
+   * @param enabled, whether to record statements to the binary log.
+   */
+  static void setEnabled(bool enabled);
+
+  /**
+   * Record a log statement on the calling thread's ring.
+   * @param site, the statement being logged.
+   * @param args, the arguments to the statement's format.
+   */
+  template <class... Args> static void record(const BinaryLogSite& site, const Args&... args) {
+    Writer writer(site);
+    // Evaluates append() for each argument in order.
+    int unused[] = {0, (writer.append(args), 0)...};
+    (void)unused;
+  }
+
+  /**
+   * Format all records currently held in all rings, oldest first. Safe to call from any thread
+   * concurrently with logging; records overwritten while being read are skipped.
+   * @param os, the stream to write formatted records to.
+   */
+  static void dump(std::ostream& os);
+
+  /**
+   * Format all records currently held in all rings, oldest first, without allocating. Records are
+   * read in place, so one overwritten while being written out may be garbled. Only for use by the
+   * fatal error handler, which is never run concurrently with itself.
+   * @param os, the stream to write formatted records to.
+   */
+  static void dumpOnCrash(std::ostream& os);
+
+  /**
+   * Format all records to a file, @see dump(std::ostream&).
+   * @param path, the file to write to. It is truncated if it exists.
+   * @return bool whether the file was written.
+   */
+  static bool dumpToFile(const std::string& path);
+
+  /**
+   * Discard all records. Only for use in tests, while no thread is logging.
+   */
+  static void resetForTest();
+
+  /**
+   * @return size_t the number of rings allocated, whether in use or waiting to be reused.
+   */
+  static size_t ringCount();
+
+  // Per-thread record storage.
+  struct Ring;
+
+private:
+  /**
+   * Encodes arguments into a slot of the calling thread's ring, publishing the record when
+   * destroyed.
+   */
+  class Writer {
+  public:
+    explicit Writer(const BinaryLogSite& site);
+    ~Writer();
+
+    template <class T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type
+    append(T value) {
+      if (std::is_signed<T>::value) {
+        appendScalar(BinaryLogTag::Signed, static_cast<int64_t>(value));
+      } else {
+        appendScalar(BinaryLogTag::Unsigned, static_cast<uint64_t>(value));
+      }
+    }
+    template <class T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type append(T value) {
+      appendScalar(BinaryLogTag::Double, static_cast<double>(value));
+    }
+    void append(bool value) { appendScalar(BinaryLogTag::Bool, static_cast<uint8_t>(value)); }
+    void append(const char* value) { appendString(value); }
+    void append(const std::string& value) { appendString(value); }
+    void append(absl::string_view value) { appendString(value); }
+    // Headers are captured as raw bytes, which is far cheaper than formatting them.
+    void append(const Http::HeaderMap& headers);
+
+  private:
+    template <class T> void appendScalar(BinaryLogTag tag, T value) {
+      if (!reserve(1 + sizeof(T))) {
+        return;
+      }
+      payload_[length_++] = static_cast<uint8_t>(tag);
+      memcpy(payload_ + length_, &value, sizeof(T));
+      length_ += sizeof(T);
+    }
+    void appendString(absl::string_view value);
+    // Starts a string argument, returning the offset of its length field, or 0 if it doesn't fit.
+    size_t beginString();
+    void appendStringBytes(absl::string_view bytes);
+    void endString(size_t length_offset);
+    bool reserve(size_t bytes);
+
+    Ring& ring_;
+    uint64_t index_;
+    uint8_t* payload_;
+    size_t length_{};
+    bool truncated_{};
+  };
+
+  static Ring& threadRing();
+  static std::atomic<bool> enabled_;
+};
+
+} // namespace Logging
+} // namespace Envoy
+
+/**
+ * Log a statement through the binary log if it is enabled, or the Envoy logger otherwise. Must be
+ * used where ENVOY_LOG may be used. Either way, the statement is only logged if LEVEL is enabled
+ * for the logger. Arguments must be integers, floating point numbers, booleans, strings or header
+ * maps.
+ */
+#define ENVOY_MOBILE_LOG(LEVEL, FORMAT, ...)                                                       \
+  do {                                                                                             \
+    if (::Envoy::Logging::BinaryLog::enabled()) {                                                  \
+      if (ENVOY_LOG_CHECK_LEVEL(LEVEL)) {                                                          \
+        static const ::Envoy::Logging::BinaryLogSite binary_log_site{FORMAT, __FILE__, __LINE__};  \
+        ::Envoy::Logging::BinaryLog::record(binary_log_site, ##__VA_ARGS__);                       \
+      }                                                                                            \
+    } else {                                                                                       \
+      ENVOY_LOG(LEVEL, FORMAT, ##__VA_ARGS__);                                                     \
+    }                                                                                              \
+  } while (0)
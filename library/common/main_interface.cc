@@ -1,38 +1,210 @@
 #include "library/common/main_interface.h"
 
 #include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
 #include "library/common/api/external.h"
+#include "library/common/config_builder_internal.h"
 #include "library/common/engine.h"
 #include "library/common/extensions/filters/http/platform_bridge/c_types.h"
+#include "library/common/extensions/resource_monitors/device_memory/device_memory_monitor.h"
 #include "library/common/http/dispatcher.h"
+#include "library/common/ipc/engine_client.h"
+#include "library/common/ipc/engine_host.h"
+#include "library/common/logging/binary_log.h"
+#include "library/common/memory/heap_profiler.h"
+#include "library/common/thread/scheduling.h"
 
 // NOLINT(namespace-envoy)
 
-static std::shared_ptr<Envoy::Engine> strong_engine_;
-static std::weak_ptr<Envoy::Engine> engine_;
-static std::atomic<envoy_stream_t> current_stream_handle_{0};
-static std::atomic<envoy_network_t> preferred_network_{ENVOY_NET_GENERIC};
+namespace {
 
-envoy_stream_t init_stream(envoy_engine_t) { return current_stream_handle_++; }
+// Handles of streams and stream groups carry the handle of their engine in their upper bits, so
+// that operations on them reach the engine without a lookup by stream. The rest of the bits count
+// the engine's streams, and so are scoped to the engine.
+constexpr int EngineHandleBits = 8;
+constexpr int StreamHandleBits = sizeof(envoy_stream_t) * 8 - 1 - EngineHandleBits;
+constexpr envoy_engine_t MaxEngineHandle = (1 << EngineHandleBits) - 1;
+constexpr envoy_stream_t StreamHandleMask =
+    (static_cast<envoy_stream_t>(1) << StreamHandleBits) - 1;
+
+/**
+ * What an engine refers to of its handle's state for as long as it runs.
+ */
+struct EngineContext {
+  explicit EngineContext(envoy_network_t preferred_network)
+      : preferred_network_(preferred_network) {}
+
+  std::atomic<envoy_network_t> preferred_network_;
+  // External APIs registered for the engine, @see register_engine_platform_api().
+  Envoy::Api::External::Registry api_registry_;
+};
+
+/**
+ * The state of an engine handle, from init_engine() until terminate_engine().
+ */
+struct EngineState {
+  explicit EngineState(envoy_network_t preferred_network)
+      : context_(std::make_shared<EngineContext>(preferred_network)) {}
+
+  // Kept alive by the engine too, as calling threads may briefly hold the engine past
+  // terminate_engine().
+  const std::shared_ptr<EngineContext> context_;
+  std::atomic<envoy_stream_t> next_stream_{0};
+  std::atomic<envoy_stream_group_t> next_stream_group_{0};
+  // Set by run_engine().
+  std::shared_ptr<Envoy::Engine> engine_;
+  // Notified once the engine has been destroyed, which may be after its last reference outside of
+  // the state has been released.
+  const std::shared_ptr<absl::Notification> engine_destroyed_{
+      std::make_shared<absl::Notification>()};
+  // Serves the engine to other processes, if enabled with host_engine().
+  std::unique_ptr<Envoy::Ipc::EngineHost> engine_host_;
+};
+
+using EngineStateSharedPtr = std::shared_ptr<EngineState>;
+
+absl::Mutex engines_mutex_;
+// The engines are kept alive until they are terminated, or until static destruction occurs.
+absl::flat_hash_map<envoy_engine_t, EngineStateSharedPtr>
+    engines_ ABSL_GUARDED_BY(engines_mutex_);
+envoy_engine_t last_engine_handle_ ABSL_GUARDED_BY(engines_mutex_){0};
+// The engines which have been run and not yet torn down, in the order they were run. Engines share
+// Envoy's process-wide logging context, which each engine's teardown restores to the one that was
+// active when it was run. They must therefore be torn down in the reverse order they were run.
+std::vector<std::pair<envoy_engine_t, EngineStateSharedPtr>>
+    started_engines_ ABSL_GUARDED_BY(engines_mutex_);
+// Held while engines are torn down, so that concurrent terminations do not reorder teardowns.
+absl::Mutex teardown_mutex_ ABSL_ACQUIRED_BEFORE(engines_mutex_);
+// The network new engines start with, and which set_preferred_network() applies to every engine.
+std::atomic<envoy_network_t> preferred_network_{ENVOY_NET_GENERIC};
+// Set by connect_to_engine(), in place of running an engine in this process.
+std::shared_ptr<Envoy::Ipc::EngineClient> engine_client_ ABSL_GUARDED_BY(engines_mutex_);
+
+envoy_engine_t engineOfHandle(envoy_stream_t handle) {
+  return static_cast<envoy_engine_t>(handle >> StreamHandleBits);
+}
+
+envoy_stream_t toHandle(envoy_engine_t engine, envoy_stream_t count) {
+  return (static_cast<envoy_stream_t>(engine) << StreamHandleBits) | (count & StreamHandleMask);
+}
+
+EngineStateSharedPtr engineState(envoy_engine_t engine) {
+  absl::ReaderMutexLock lock(&engines_mutex_);
+  auto it = engines_.find(engine);
+  return it != engines_.end() ? it->second : nullptr;
+}
+
+// Acquires the running engine of a handle, ensuring that it persists at least for the duration of
+// the calling operation.
+std::shared_ptr<Envoy::Engine> runningEngine(envoy_engine_t engine) {
+  absl::ReaderMutexLock lock(&engines_mutex_);
+  auto it = engines_.find(engine);
+  return it != engines_.end() ? it->second->engine_ : nullptr;
+}
+
+// The engine host this process runs streams on, if it is connected to one. Held by callers for the
+// duration of the calling operation, as with runningEngine().
+std::shared_ptr<Envoy::Ipc::EngineClient> engineClient() {
+  absl::ReaderMutexLock lock(&engines_mutex_);
+  return engine_client_;
+}
+
+// Runs an engine for a handle which has none running yet.
+envoy_status_t
+startEngine(envoy_engine_t engine,
+            const std::function<Envoy::Engine*(EngineContext& context)>& create_engine) {
+  absl::MutexLock lock(&engines_mutex_);
+  auto it = engines_.find(engine);
+  // Processes connected to an engine host don't run engines of their own.
+  if (it == engines_.end() || it->second->engine_ != nullptr || engine_client_ != nullptr) {
+    return ENVOY_FAILURE;
+  }
+  std::shared_ptr<EngineContext> context = it->second->context_;
+  std::shared_ptr<absl::Notification> destroyed = it->second->engine_destroyed_;
+  // Starting the engine does not wait on its thread, so the lock is held only briefly.
+  it->second->engine_ = std::shared_ptr<Envoy::Engine>(
+      create_engine(*context),
+      [context, destroyed](Envoy::Engine* running_engine) -> void {
+        // Destroying an engine waits for its thread to exit, so if the last reference is released
+        // on an engine's thread, e.g. by a callback, the engine is destroyed on another thread.
+        if (Envoy::Engine::onEngineThread()) {
+          std::thread([context, destroyed, running_engine]() -> void {
+            delete running_engine;
+            destroyed->Notify();
+          }).detach();
+          return;
+        }
+        delete running_engine;
+        destroyed->Notify();
+      });
+  started_engines_.emplace_back(engine, it->second);
+  return ENVOY_SUCCESS;
+}
+
+} // namespace
+
+envoy_stream_t init_stream(envoy_engine_t engine) {
+  if (auto state = engineState(engine)) {
+    return toHandle(engine, state->next_stream_++);
+  }
+  // Operations on a stream of an unknown engine fail.
+  return toHandle(0, 0);
+}
 
 envoy_status_t start_stream(envoy_stream_t stream, envoy_http_callbacks callbacks) {
-  if (auto e = engine_.lock()) {
+  if (auto client = engineClient()) {
+    return client->startStream(stream, callbacks);
+  }
+  if (auto e = runningEngine(engineOfHandle(stream))) {
     return e->httpDispatcher().startStream(stream, callbacks);
   }
   return ENVOY_FAILURE;
 }
 
+envoy_stream_group_t init_stream_group(envoy_engine_t engine) {
+  if (auto state = engineState(engine)) {
+    return toHandle(engine, state->next_stream_group_++);
+  }
+  return toHandle(0, 0);
+}
+
+envoy_status_t start_stream_in_group(envoy_stream_t stream, envoy_stream_group_t group,
+                                     envoy_http_callbacks callbacks) {
+  // Engine hosts don't relay this operation.
+  if (engineClient()) {
+    return ENVOY_FAILURE;
+  }
+  if (auto e = runningEngine(engineOfHandle(stream))) {
+    return e->httpDispatcher().startStream(stream, callbacks, group);
+  }
+  return ENVOY_FAILURE;
+}
+
 envoy_status_t send_headers(envoy_stream_t stream, envoy_headers headers, bool end_stream) {
-  if (auto e = engine_.lock()) {
+  if (auto client = engineClient()) {
+    return client->sendHeaders(stream, headers, end_stream);
+  }
+  if (auto e = runningEngine(engineOfHandle(stream))) {
     return e->httpDispatcher().sendHeaders(stream, headers, end_stream);
   }
   return ENVOY_FAILURE;
 }
 
 envoy_status_t send_data(envoy_stream_t stream, envoy_data data, bool end_stream) {
-  if (auto e = engine_.lock()) {
+  if (auto client = engineClient()) {
+    return client->sendData(stream, data, end_stream);
+  }
+  if (auto e = runningEngine(engineOfHandle(stream))) {
     return e->httpDispatcher().sendData(stream, data, end_stream);
   }
   return ENVOY_FAILURE;
@@ -42,88 +214,347 @@ envoy_status_t send_data(envoy_stream_t stream, envoy_data data, bool end_stream
 envoy_status_t send_metadata(envoy_stream_t, envoy_headers) { return ENVOY_FAILURE; }
 
 envoy_status_t send_trailers(envoy_stream_t stream, envoy_headers trailers) {
-  if (auto e = engine_.lock()) {
+  if (auto client = engineClient()) {
+    return client->sendTrailers(stream, trailers);
+  }
+  if (auto e = runningEngine(engineOfHandle(stream))) {
     return e->httpDispatcher().sendTrailers(stream, trailers);
   }
   return ENVOY_FAILURE;
 }
 
 envoy_status_t reset_stream(envoy_stream_t stream) {
-  if (auto e = engine_.lock()) {
+  if (auto client = engineClient()) {
+    return client->cancelStream(stream);
+  }
+  if (auto e = runningEngine(engineOfHandle(stream))) {
     return e->httpDispatcher().cancelStream(stream);
   }
   return ENVOY_FAILURE;
 }
 
+envoy_status_t reset_stream_group(envoy_stream_group_t group) {
+  // Engine hosts don't relay this operation.
+  if (engineClient()) {
+    return ENVOY_FAILURE;
+  }
+  if (auto e = runningEngine(engineOfHandle(group))) {
+    return e->httpDispatcher().cancelStreamGroup(group);
+  }
+  return ENVOY_FAILURE;
+}
+
+envoy_status_t pause_response(envoy_stream_t stream, bool paused) {
+  // Engine hosts don't relay this operation.
+  if (engineClient()) {
+    return ENVOY_FAILURE;
+  }
+  if (auto e = runningEngine(engineOfHandle(stream))) {
+    return e->httpDispatcher().pauseResponse(stream, paused);
+  }
+  return ENVOY_FAILURE;
+}
+
+envoy_status_t get_stream_progress(envoy_stream_t stream, envoy_stream_progress* progress) {
+  // Engine hosts don't relay this operation.
+  if (engineClient()) {
+    return ENVOY_FAILURE;
+  }
+  if (auto e = runningEngine(engineOfHandle(stream))) {
+    return e->httpDispatcher().getStreamProgress(stream, *progress);
+  }
+  return ENVOY_FAILURE;
+}
+
 envoy_engine_t init_engine() {
-  // TODO(goaway): return new handle once multiple engine support is in place.
-  // https://github.com/lyft/envoy-mobile/issues/332
-  return 1;
+  absl::MutexLock lock(&engines_mutex_);
+  // Handles are reused as late as possible, so that a stale handle is unlikely to reach a newer
+  // engine.
+  for (envoy_engine_t i = 0; i < MaxEngineHandle; i++) {
+    const envoy_engine_t engine = last_engine_handle_ % MaxEngineHandle + 1;
+    last_engine_handle_ = engine;
+    if (engines_.find(engine) == engines_.end()) {
+      engines_.emplace(engine, std::make_shared<EngineState>(preferred_network_.load()));
+      return engine;
+    }
+  }
+  return 0;
 }
 
 envoy_status_t set_preferred_network(envoy_network_t network) {
+  absl::ReaderMutexLock lock(&engines_mutex_);
   preferred_network_.store(network);
+  for (const auto& engine : engines_) {
+    engine.second->context_->preferred_network_.store(network);
+  }
   return ENVOY_SUCCESS;
 }
 
-envoy_status_t record_counter(envoy_engine_t, const char* elements, uint64_t count) {
-  // TODO: use specific engine once multiple engine support is in place.
-  // https://github.com/lyft/envoy-mobile/issues/332
-  if (auto e = engine_.lock()) {
+envoy_status_t set_device_memory_pressure(double pressure) {
+  Envoy::Extensions::ResourceMonitors::DeviceMemory::DeviceMemoryMonitor::setDevicePressure(
+      pressure);
+  return ENVOY_SUCCESS;
+}
+
+envoy_status_t record_counter(envoy_engine_t engine, const char* elements, uint64_t count) {
+  if (auto e = runningEngine(engine)) {
     return e->recordCounterInc(std::string(elements), count);
   }
   return ENVOY_FAILURE;
 }
 
-envoy_status_t record_gauge_set(envoy_engine_t, const char* elements, uint64_t value) {
-  // TODO: use specific engine once multiple engine support is in place.
-  // https://github.com/lyft/envoy-mobile/issues/332
-  if (auto e = engine_.lock()) {
+envoy_status_t record_gauge_set(envoy_engine_t engine, const char* elements, uint64_t value) {
+  if (auto e = runningEngine(engine)) {
     return e->recordGaugeSet(std::string(elements), value);
   }
   return ENVOY_FAILURE;
 }
 
-envoy_status_t record_gauge_add(envoy_engine_t, const char* elements, uint64_t amount) {
-  // TODO: use specific engine once multiple engine support is in place.
-  // https://github.com/lyft/envoy-mobile/issues/332
-  if (auto e = engine_.lock()) {
+envoy_status_t record_gauge_add(envoy_engine_t engine, const char* elements, uint64_t amount) {
+  if (auto e = runningEngine(engine)) {
     return e->recordGaugeAdd(std::string(elements), amount);
   }
   return ENVOY_FAILURE;
 }
 
-envoy_status_t record_gauge_sub(envoy_engine_t, const char* elements, uint64_t amount) {
-  // TODO: use specific engine once multiple engine support is in place.
-  // https://github.com/lyft/envoy-mobile/issues/332
-  if (auto e = engine_.lock()) {
+envoy_status_t record_gauge_sub(envoy_engine_t engine, const char* elements, uint64_t amount) {
+  if (auto e = runningEngine(engine)) {
     return e->recordGaugeSub(std::string(elements), amount);
   }
   return ENVOY_FAILURE;
 }
 
+envoy_status_t enable_request_replay(envoy_engine_t engine, uint64_t memory_limit_bytes,
+                                     const char* spill_directory) {
+  if (auto e = runningEngine(engine)) {
+    return e->httpDispatcher().enableRequestReplay(memory_limit_bytes,
+                                                   std::string(spill_directory));
+  }
+  return ENVOY_FAILURE;
+}
+
+envoy_status_t enable_http3_upstream(envoy_engine_t engine, const char* alt_svc_cache_path) {
+  if (auto e = runningEngine(engine)) {
+    return e->enableHttp3Upstream(std::string(alt_svc_cache_path));
+  }
+  return ENVOY_FAILURE;
+}
+
+envoy_status_t enable_early_data(envoy_engine_t engine) {
+  if (auto e = runningEngine(engine)) {
+    return e->enableEarlyData();
+  }
+  return ENVOY_FAILURE;
+}
+
+envoy_status_t enable_stream_arena(envoy_engine_t engine, uint64_t block_bytes) {
+  if (auto e = runningEngine(engine)) {
+    return e->httpDispatcher().enableStreamArena(block_bytes);
+  }
+  return ENVOY_FAILURE;
+}
+
+envoy_status_t set_idle_timer_slack(envoy_engine_t engine, uint32_t milliseconds) {
+  if (auto e = runningEngine(engine)) {
+    return e->setIdleTimerSlack(std::chrono::milliseconds(milliseconds));
+  }
+  return ENVOY_FAILURE;
+}
+
+envoy_status_t set_engine_thread_priority(envoy_engine_t engine, int32_t nice) {
+  if (auto e = runningEngine(engine)) {
+    return e->setThreadPriority(nice);
+  }
+  return ENVOY_FAILURE;
+}
+
+envoy_status_t set_engine_thread_affinity(envoy_engine_t engine, envoy_core_class_t core_class) {
+  if (auto e = runningEngine(engine)) {
+    switch (core_class) {
+    case ENVOY_CORES_ANY:
+      return e->setThreadAffinity(Envoy::Thread::CoreClass::Any);
+    case ENVOY_CORES_BIG:
+      return e->setThreadAffinity(Envoy::Thread::CoreClass::Big);
+    case ENVOY_CORES_LITTLE:
+      return e->setThreadAffinity(Envoy::Thread::CoreClass::Little);
+    }
+  }
+  return ENVOY_FAILURE;
+}
+
+envoy_status_t set_binary_logging_enabled(bool enabled) {
+  Envoy::Logging::BinaryLog::setEnabled(enabled);
+  return ENVOY_SUCCESS;
+}
+
+envoy_status_t dump_binary_log(const char* path) {
+  return Envoy::Logging::BinaryLog::dumpToFile(std::string(path)) ? ENVOY_SUCCESS : ENVOY_FAILURE;
+}
+
+envoy_status_t start_heap_profiler(const char* path_prefix) {
+  return Envoy::Memory::HeapProfiler::start(std::string(path_prefix)) ? ENVOY_SUCCESS
+                                                                       : ENVOY_FAILURE;
+}
+
+envoy_status_t stop_heap_profiler() {
+  return Envoy::Memory::HeapProfiler::stop() ? ENVOY_SUCCESS : ENVOY_FAILURE;
+}
+
+envoy_status_t dump_heap_profile(const char* path) {
+  return Envoy::Memory::HeapProfiler::dumpProfile(std::string(path)) ? ENVOY_SUCCESS
+                                                                      : ENVOY_FAILURE;
+}
+
+envoy_status_t get_heap_stats(envoy_heap_stats* stats) {
+  Envoy::Memory::HeapStats heap_stats;
+  if (!Envoy::Memory::HeapProfiler::stats(heap_stats)) {
+    return ENVOY_FAILURE;
+  }
+  stats->allocated_bytes = heap_stats.allocated_bytes_;
+  stats->heap_bytes = heap_stats.heap_bytes_;
+  stats->free_bytes = heap_stats.free_bytes_;
+  stats->unmapped_bytes = heap_stats.unmapped_bytes_;
+  stats->fragmentation = heap_stats.fragmentation_;
+  return ENVOY_SUCCESS;
+}
+
+envoy_status_t dump_heap_summary(const char* path, uint32_t max_sites) {
+  return Envoy::Memory::HeapProfiler::dumpSummary(std::string(path), max_sites) ? ENVOY_SUCCESS
+                                                                                 : ENVOY_FAILURE;
+}
+
+envoy_status_t mark_heap() {
+  return Envoy::Memory::HeapProfiler::mark() ? ENVOY_SUCCESS : ENVOY_FAILURE;
+}
+
+envoy_status_t dump_heap_delta_since_mark(const char* path, uint32_t max_sites) {
+  return Envoy::Memory::HeapProfiler::dumpDeltaSinceMark(std::string(path), max_sites)
+             ? ENVOY_SUCCESS
+             : ENVOY_FAILURE;
+}
+
 envoy_status_t register_platform_api(const char* name, void* api) {
   Envoy::Api::External::registerApi(std::string(name), api);
   return ENVOY_SUCCESS;
 }
 
+envoy_status_t register_engine_platform_api(envoy_engine_t engine, const char* name, void* api) {
+  if (auto state = engineState(engine)) {
+    state->context_->api_registry_.registerApi(std::string(name), api);
+    return ENVOY_SUCCESS;
+  }
+  return ENVOY_FAILURE;
+}
+
 /**
  * External entrypoint for library.
  */
-envoy_status_t run_engine(envoy_engine_t, envoy_engine_callbacks callbacks, const char* config,
-                          const char* log_level) {
-  // This will change once multiple engine support is in place.
-  // https://github.com/lyft/envoy-mobile/issues/332
-
-  // The shared pointer created here will keep the engine alive until static destruction occurs.
-  strong_engine_ =
-      std::make_shared<Envoy::Engine>(callbacks, config, log_level, preferred_network_);
-
-  // The weak pointer we actually expose allows calling threads to atomically check if the engine
-  // still exists and acquire a shared pointer to it - ensuring the engine persists at least for
-  // the duration of the call.
-  engine_ = strong_engine_;
+envoy_status_t run_engine(envoy_engine_t engine, envoy_engine_callbacks callbacks,
+                          const char* config, const char* log_level) {
+  return startEngine(engine, [&](EngineContext& context) -> Envoy::Engine* {
+    return new Envoy::Engine(callbacks, config, log_level, context.preferred_network_,
+                             &context.api_registry_);
+  });
+}
+
+envoy_status_t run_engine_with_config_builder(envoy_engine_t engine,
+                                              envoy_engine_callbacks callbacks,
+                                              const envoy_config_builder* builder,
+                                              const char* log_level) {
+  return startEngine(engine, [&](EngineContext& context) -> Envoy::Engine* {
+    return new Envoy::Engine(callbacks, builder->builder_.build(), log_level,
+                             context.preferred_network_, nullptr, &context.api_registry_);
+  });
+}
+
+envoy_status_t update_engine_config(envoy_engine_t engine, const char* config) {
+  if (auto e = runningEngine(engine)) {
+    return e->updateConfig(std::string(config));
+  }
+  return ENVOY_FAILURE;
+}
+
+envoy_status_t update_engine_config_with_config_builder(envoy_engine_t engine,
+                                                        const envoy_config_builder* builder) {
+  if (auto e = runningEngine(engine)) {
+    return e->updateConfig(builder->builder_.build());
+  }
+  return ENVOY_FAILURE;
+}
+
+envoy_status_t host_engine(envoy_engine_t engine, const char* socket_path) {
+  EngineStateSharedPtr state = engineState(engine);
+  std::shared_ptr<Envoy::Engine> running_engine = runningEngine(engine);
+  if (state == nullptr || running_engine == nullptr) {
+    return ENVOY_FAILURE;
+  }
+  // The host is torn down before the engine's state.
+  EngineState* host_state = state.get();
+  auto engine_host = std::make_unique<Envoy::Ipc::EngineHost>(
+      running_engine->httpDispatcher(), [engine, host_state]() -> envoy_stream_t {
+        return toHandle(engine, host_state->next_stream_++);
+      });
+  absl::MutexLock lock(&engines_mutex_);
+  if (state->engine_host_ != nullptr || engine_host->listen(socket_path) != ENVOY_SUCCESS) {
+    return ENVOY_FAILURE;
+  }
+  state->engine_host_ = std::move(engine_host);
   return ENVOY_SUCCESS;
 }
 
-void terminate_engine(envoy_engine_t) { strong_engine_.reset(); }
+envoy_status_t connect_to_engine(const char* socket_path) {
+  auto engine_client = std::make_shared<Envoy::Ipc::EngineClient>();
+  if (engine_client->connect(socket_path) != ENVOY_SUCCESS) {
+    return ENVOY_FAILURE;
+  }
+  absl::MutexLock lock(&engines_mutex_);
+  if (engine_client_ != nullptr) {
+    return ENVOY_FAILURE;
+  }
+  for (const auto& engine : engines_) {
+    if (engine.second->engine_ != nullptr) {
+      return ENVOY_FAILURE;
+    }
+  }
+  engine_client_ = std::move(engine_client);
+  return ENVOY_SUCCESS;
+}
+
+void terminate_engine(envoy_engine_t engine) {
+  if (Envoy::Engine::onEngineThread()) {
+    // Tearing down engines waits for their threads to exit, which an engine's thread must not do.
+    std::thread([engine]() -> void { terminate_engine(engine); }).detach();
+    return;
+  }
+
+  absl::MutexLock teardown_lock(&teardown_mutex_);
+  EngineStateSharedPtr state;
+  std::vector<EngineStateSharedPtr> teardowns;
+  {
+    absl::MutexLock lock(&engines_mutex_);
+    auto it = engines_.find(engine);
+    if (it == engines_.end()) {
+      return;
+    }
+    state = std::move(it->second);
+    engines_.erase(it);
+    // Engines run after this one and still running keep it from being torn down, until the last
+    // of them is terminated, @see started_engines_.
+    while (!started_engines_.empty()) {
+      auto running = engines_.find(started_engines_.back().first);
+      if (running != engines_.end() && running->second == started_engines_.back().second) {
+        break;
+      }
+      teardowns.push_back(std::move(started_engines_.back().second));
+      started_engines_.pop_back();
+    }
+  }
+  // The host relays streams to the engine, so it must be torn down first.
+  state->engine_host_.reset();
+  for (const EngineStateSharedPtr& teardown : teardowns) {
+    teardown->engine_host_.reset();
+    teardown->engine_.reset();
+    // The engine is destroyed once calling threads release it too, @see runningEngine().
+    teardown->engine_destroyed_->WaitForNotification();
+  }
+}
@@ -3,6 +3,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "library/common/config_builder.h"
 #include "library/common/types/c_types.h"
 
 // NOLINT(namespace-envoy)
@@ -26,7 +27,8 @@ extern const char* platform_filter_template;
 /**
  * Initialize an underlying HTTP stream.
  * @param engine, handle to the engine that will manage this stream.
- * @return envoy_stream_t, handle to the underlying stream.
+ * @return envoy_stream_t, handle to the underlying stream. Handles are scoped to their engine, and
+ * operations on a stream are carried out by the engine it was initialized with.
  */
 envoy_stream_t init_stream(envoy_engine_t engine);
 
@@ -39,9 +41,30 @@ envoy_stream_t init_stream(envoy_engine_t engine);
  */
 envoy_status_t start_stream(envoy_stream_t stream, envoy_http_callbacks callbacks);
 
+/**
+ * Initialize a group of streams, which can be reset together.
+ * @param engine, handle to the engine that will manage the group's streams.
+ * @return envoy_stream_group_t, handle to the group.
+ */
+envoy_stream_group_t init_stream_group(envoy_engine_t engine);
+
+/**
+ * Open an underlying HTTP stream as a member of a group, @see start_stream.
+ * @param stream, handle to the stream to be started.
+ * @param group, the group to add the stream to.
+ * @param callbacks, the callbacks that will run the stream callbacks.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t start_stream_in_group(envoy_stream_t stream, envoy_stream_group_t group,
+                                     envoy_http_callbacks callbacks);
+
 /**
  * Send headers over an open HTTP stream. This method can be invoked once and needs to be called
  * before send_data.
+ * Streams may be upgraded to long-lived bidirectional streams: a WebSocket upgrade (upgrade:
+ * websocket), a CONNECT request, or an extended CONNECT request (a CONNECT with a :protocol header)
+ * over HTTP/2. Once the response headers accept the upgrade, data flows both ways until either side
+ * ends the stream. @see pause_response.
  * @param stream, the stream to send headers over.
  * @param headers, the headers to send.
  * @param end_stream, supplies whether this is headers only.
@@ -83,19 +106,63 @@ envoy_status_t send_trailers(envoy_stream_t stream, envoy_headers trailers);
 envoy_status_t reset_stream(envoy_stream_t stream);
 
 /**
- * Initialize an engine for handling network streams.
- * @return envoy_engine_t, handle to the underlying engine.
+ * Reset every open stream in a group, as if reset_stream were called for each of them. This is
+ * considerably cheaper than resetting the streams individually. Streams started in the group after
+ * this call are not affected.
+ * @param group, the group of streams to reset.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t reset_stream_group(envoy_stream_group_t group);
+
+/**
+ * Pause or resume the delivery of response data on an open HTTP stream, e.g. while the application
+ * cannot keep up with a long-lived stream such as a WebSocket. While the response is paused, the
+ * engine stops reading it from upstream once its buffers fill, which pushes back on the server.
+ * Data already in flight is still delivered.
+ * @param stream, the stream to pause or resume.
+ * @param paused, whether the response is paused.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t pause_response(envoy_stream_t stream, bool paused);
+
+/**
+ * Read the progress of an open HTTP stream, e.g. to drive a progress indicator for an upload or
+ * download. This may be called from any thread, as often as needed: it reads counters which the
+ * engine updates as the stream progresses, and does not wait on the engine's event loop.
+ * @param stream, the stream to read the progress of.
+ * @param progress, filled in with the stream's progress.
+ * @return envoy_status_t, ENVOY_FAILURE if the stream is unknown or has completed, failed or been
+ * cancelled.
+ */
+envoy_status_t get_stream_progress(envoy_stream_t stream, envoy_stream_progress* progress);
+
+/**
+ * Initialize an engine for handling network streams. Engines are independent of each other: each
+ * runs its own event loop on its own thread, with its own streams, stats, registered platform APIs
+ * and preferred network. Up to 255 engines may be initialized at a time.
+ * @return envoy_engine_t, handle to the underlying engine, or 0 if too many engines are
+ * initialized. The handle is valid until terminate_engine().
  */
 envoy_engine_t init_engine();
 
 /**
  * Update the network interface to the preferred network for opening new streams.
- * Note that this state is shared by all engines.
+ * Note that this applies to every engine, and to engines initialized later.
  * @param network, the network to be preferred for new streams.
  * @return envoy_status_t, the resulting status of the operation.
  */
 envoy_status_t set_preferred_network(envoy_network_t network);
 
+/**
+ * Report the memory pressure the device is under, e.g. in response to a low memory warning from
+ * the platform. As pressure rises, engines shed memory and then stop accepting new requests.
+ * Note that this state is shared by all engines.
+ * @param pressure, the fraction of memory available to the application which is in use, in
+ *        [0, 1].
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t set_device_memory_pressure(double pressure);
+
 /**
  * Increment a counter with the given elements and by the given count.
  * @param engine, the engine that owns the counter.
@@ -127,6 +194,165 @@ envoy_status_t record_gauge_add(envoy_engine_t engine, const char* elements, uin
  * @param amount, amount to subtract from the gauge.
  */
 envoy_status_t record_gauge_sub(envoy_engine_t engine, const char* elements, uint64_t amount);
+
+/**
+ * Replay requests on a new connection when their connection fails, for requests which allow
+ * retries but have bodies too large for Envoy to buffer for retrying. Bodies are copied as they
+ * are sent: the first bytes in memory, and the remainder to a temporary file.
+ * @param engine, the engine to enable replays on.
+ * @param memory_limit_bytes, the number of bytes of each body to hold in memory.
+ * @param spill_directory, a writable directory for temporary files, e.g. the app's cache directory.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t enable_request_replay(envoy_engine_t engine, uint64_t memory_limit_bytes,
+                                     const char* spill_directory);
+
+/**
+ * Send requests over HTTP/3 to origins which advertise it through Alt-Svc response headers.
+ * Requests to an origin go over TCP until it has advertised HTTP/3, and fall back to TCP for a
+ * while if its HTTP/3 connection fails, e.g. when the network blocks UDP. Requests which select
+ * an upstream protocol explicitly are not affected. Requests are routed to the HTTP/3 variants of
+ * the base clusters (base_h3, base_wlan_h3 and base_wwan_h3), which the engine's configuration
+ * must define. This requires an Envoy built with QUIC support, and the default configuration does
+ * not define them.
+ * @param engine, the engine to enable HTTP/3 on.
+ * @param alt_svc_cache_path, a writable file to persist advertised services to across restarts,
+ *        e.g. in the app's cache directory. May be empty to only hold them in memory.
+ * @return envoy_status_t, ENVOY_FAILURE if the configuration does not define the HTTP/3 clusters.
+ */
+envoy_status_t enable_http3_upstream(envoy_engine_t engine, const char* alt_svc_cache_path);
+
+/**
+ * Send idempotent requests without a body (GET, HEAD, or any request carrying the
+ * x-envoy-mobile-early-data header) as TLS 1.3 early data when a new connection resumes a
+ * session, saving the handshake's round-trip. If the server rejects the early data, the request is
+ * sent again once the handshake has completed. The configuration must provide early data variants
+ * of the base clusters, as the default configuration does.
+ * @param engine, the engine to enable early data on.
+ * @return envoy_status_t, ENVOY_FAILURE if the configuration does not define the early data
+ *         clusters.
+ */
+envoy_status_t enable_early_data(envoy_engine_t engine);
+
+/**
+ * Allocate the engine's fixed per-stream bookkeeping from an arena belonging to each stream, which
+ * is released all at once when the stream is done. This replaces several small allocations per
+ * stream with a few larger ones. Request data passed to the engine is not allocated from the arena.
+ * Applies to streams started after this call.
+ * @param engine, the engine to enable stream arenas on.
+ * @param block_bytes, the size of the blocks each arena is made of, e.g. 4096, or 0 to disable
+ *        stream arenas.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t enable_stream_arena(envoy_engine_t engine, uint64_t block_bytes);
+
+/**
+ * Set the timer slack of the engine's thread while it has no open streams, which lets the kernel
+ * coalesce the engine's periodic wakeups when the app isn't using the network. Defaults to one
+ * second. Only supported on Linux, including Android. Takes effect immediately if the engine is
+ * idle, and otherwise the next time it becomes idle.
+ * @param engine, the engine to configure.
+ * @param milliseconds, the timer slack while idle. Zero disables the idle timer slack.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t set_idle_timer_slack(envoy_engine_t engine, uint32_t milliseconds);
+
+/**
+ * Set the nice value of the engine's thread, which weighs its share of the CPU against the app's
+ * threads, e.g. rendering. On Apple platforms it is mapped onto the closest quality of service
+ * class. Lowering it below the app's may require privileges. Takes effect once the engine is
+ * running.
+ * @param engine, the engine to configure.
+ * @param nice, the nice value, from -20 (highest priority) to 19 (lowest priority).
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t set_engine_thread_priority(envoy_engine_t engine, int32_t nice);
+
+/**
+ * Restrict the engine's thread to a class of the device's cores, e.g. to the little cores to save
+ * power, or to the big cores for latency. Only supported on Linux, including Android. Takes effect
+ * once the engine is running.
+ * @param engine, the engine to configure.
+ * @param core_class, the class of cores to run on. ENVOY_CORES_ANY removes the restriction.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t set_engine_thread_affinity(envoy_engine_t engine, envoy_core_class_t core_class);
+
+/**
+ * Select the in-process binary log for Envoy Mobile's own debug logging. When enabled, log
+ * statements are recorded without being formatted, and are only formatted when dumped. The binary
+ * log is also dumped to stderr if the process crashes.
+ * Note that this state is shared by all engines.
+ * @param enabled, whether to record to the binary log.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t set_binary_logging_enabled(bool enabled);
+
+/**
+ * Format the records currently held by the binary log to a file.
+ * @param path, the file to write to. It is truncated if it exists.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t dump_binary_log(const char* path);
+
+/**
+ * Start the heap profiler, which records the site of every allocation. Profiles are written
+ * periodically as the heap grows. Heap profiling requires Envoy Mobile to be built with tcmalloc,
+ * e.g. with --define=tcmalloc=gperftools; otherwise this and the other heap functions fail.
+ * Note that this state is shared by all engines.
+ * @param path_prefix, the prefix of the profile files written, as <path_prefix>.NNNN.heap.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t start_heap_profiler(const char* path_prefix);
+
+/**
+ * Stop the heap profiler, writing a final profile.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t stop_heap_profiler();
+
+/**
+ * Write the live allocation sites to a file in the format read by pprof. Sites come from the heap
+ * profiler if it is running, and otherwise from tcmalloc's allocation sampling, which is only
+ * active if the process was started with TCMALLOC_SAMPLE_PARAMETER set.
+ * @param path, the file to write to. It is truncated if it exists.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t dump_heap_profile(const char* path);
+
+/**
+ * Query the process' heap usage.
+ * @param stats, filled in with the current heap usage.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t get_heap_stats(envoy_heap_stats* stats);
+
+/**
+ * Write the heap usage and the live allocation sites holding the most bytes to a file, in a
+ * readable form. Sites are symbolized, and attributed to the component which made them, e.g.
+ * "bridge", "dns_cache", "stats" or "connection_pool".
+ * @param path, the file to write to. It is truncated if it exists.
+ * @param max_sites, the number of sites to write.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t dump_heap_summary(const char* path, uint32_t max_sites);
+
+/**
+ * Record the current heap usage and live allocation sites, to be compared against later with
+ * dump_heap_delta_since_mark(). Replaces any previous mark.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t mark_heap();
+
+/**
+ * Write the growth of the heap since mark_heap() to a file, in a readable form, @see
+ * dump_heap_summary.
+ * @param path, the file to write to. It is truncated if it exists.
+ * @param max_sites, the number of sites which grew the most to write.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t dump_heap_delta_since_mark(const char* path, uint32_t max_sites);
+
 /**
  * Statically register APIs leveraging platform libraries.
  * Warning: Must be completed before any calls to run_engine().
@@ -136,6 +362,18 @@ envoy_status_t record_gauge_sub(envoy_engine_t engine, const char* elements, uin
  */
 envoy_status_t register_platform_api(const char* name, void* api);
 
+/**
+ * Register an API leveraging platform libraries for a single engine. The engine retrieves it ahead
+ * of an API of the same name registered with register_platform_api(), so that independent
+ * components of an app can each run an engine with their own platform filters.
+ * Warning: Must be completed before run_engine() is called for the engine.
+ * @param engine, handle to the engine to register the API for.
+ * @param name, identifier of the platform API
+ * @param api, type-erased c struct containing function pointers and context.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t register_engine_platform_api(envoy_engine_t engine, const char* name, void* api);
+
 /**
  * External entry point for library.
  * @param engine, handle to the engine to run.
@@ -147,6 +385,72 @@ envoy_status_t register_platform_api(const char* name, void* api);
 envoy_status_t run_engine(envoy_engine_t engine, envoy_engine_callbacks callbacks,
                           const char* config, const char* log_level);
 
+/**
+ * External entry point for library, configuring the engine from a configuration builder rather
+ * than a configuration blob.
+ * @param engine, handle to the engine to run.
+ * @param callbacks, the callbacks that will run the engine callbacks.
+ * @param builder, the configuration builder to run envoy with. The builder is not consumed.
+ * @param log_level, the logging level to run envoy with.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t run_engine_with_config_builder(envoy_engine_t engine,
+                                              envoy_engine_callbacks callbacks,
+                                              const envoy_config_builder* builder,
+                                              const char* log_level);
+
+/**
+ * Update the configuration of a running engine without restarting it. Clusters and runtime values
+ * are updated in place, and connection pools of clusters whose configuration is unchanged are
+ * preserved. Changes to anything else, such as routes or filters, require a new engine.
+ * @param engine, handle to the engine to update.
+ * @param config, the complete configuration blob to run envoy with from now on.
+ * @return envoy_status_t, whether the update was accepted. It is applied asynchronously.
+ */
+envoy_status_t update_engine_config(envoy_engine_t engine, const char* config);
+
+/**
+ * Update the configuration of a running engine from a configuration builder,
+ * @see update_engine_config.
+ * @param engine, handle to the engine to update.
+ * @param builder, the configuration builder to run envoy with from now on. The builder is not
+ *        consumed.
+ * @return envoy_status_t, whether the update was accepted. It is applied asynchronously.
+ */
+envoy_status_t update_engine_config_with_config_builder(envoy_engine_t engine,
+                                                        const envoy_config_builder* builder);
+
+/**
+ * Serve a running engine's streams to other processes on the device, so that they share its
+ * connections and caches. Only processes running as the same user may connect.
+ * @see connect_to_engine.
+ * @param engine, handle to the engine to serve.
+ * @param socket_path, the path to bind a Unix domain socket to. An existing file at the path is
+ *        replaced.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t host_engine(envoy_engine_t engine, const char* socket_path);
+
+/**
+ * Run streams on an engine served by another process with host_engine(), in place of running an
+ * engine in this process. Must be called before any streams are started, and cannot be combined
+ * with run_engine(). Streams behave as they would on a local engine. If the host goes away, open
+ * streams fail with ENVOY_CONNECTION_FAILURE, and later ones fail to start. Stream groups,
+ * pause_response() and get_stream_progress() are not relayed to the host, and fail.
+ * @param socket_path, the path the host's socket is bound to.
+ * @return envoy_status_t, the resulting status of the operation.
+ */
+envoy_status_t connect_to_engine(const char* socket_path);
+
+/**
+ * Terminate an engine and release its handle. Other engines are unaffected. Engines share Envoy's
+ * process-wide logging context, so they are torn down in the reverse order they were run: an
+ * engine terminated while engines run after it are still running stops accepting new streams at
+ * once, but is only torn down, and calls on_exit, once the last of them is terminated. Otherwise,
+ * the engine is torn down before this returns, unless it is called on an engine's thread, e.g. from
+ * an engine callback, in which case the engine is torn down asynchronously.
+ * @param engine, handle to the engine to terminate.
+ */
 void terminate_engine(envoy_engine_t engine);
 
 #ifdef __cplusplus
@@ -0,0 +1,337 @@
+#include "library/common/memory/heap_profiler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+
+#include "common/common/lock_guard.h"
+#include "common/common/macros.h"
+#include "common/common/thread.h"
+#include "common/memory/stats.h"
+#include "common/profiler/profiler.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/debugging/symbolize.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+
+#ifdef TCMALLOC
+#include "gperftools/heap-profiler.h"
+#include "gperftools/malloc_extension.h"
+#endif
+
+namespace Envoy {
+namespace Memory {
+
+namespace {
+
+struct ComponentPattern {
+  absl::string_view component_;
+  absl::string_view pattern_;
+};
+
+// Frames are matched against these in order, innermost frame first.
+constexpr ComponentPattern ComponentPatterns[] = {
+    {"bridge", "Envoy::Http::Dispatcher"},
+    {"bridge", "Envoy::Http::Utility::to"},
+    {"bridge", "Envoy::Buffer::Utility"},
+    {"bridge", "PlatformBridge"},
+    {"bridge", "Java_io_envoyproxy_envoymobile"},
+    {"bridge", "copy_envoy_"},
+    {"bridge", "to_native_"},
+    {"bridge", "native_data"},
+    {"dns_cache", "DnsCache"},
+    {"dns_cache", "Envoy::Network::Dns"},
+    {"stats", "Envoy::Stats::"},
+    {"connection_pool", "ConnPool"},
+};
+
+constexpr absl::string_view OtherComponent = "other";
+
+using SiteBytes = std::map<std::vector<uintptr_t>, int64_t>;
+
+struct Mark {
+  Thread::MutexBasicLockable mutex_;
+  bool marked_ GUARDED_BY(mutex_){};
+  HeapStats stats_ GUARDED_BY(mutex_);
+  SiteBytes sites_ GUARDED_BY(mutex_);
+};
+
+Mark& heapMark() { MUTABLE_CONSTRUCT_ON_FIRST_USE(Mark); }
+
+// The live allocation sites, from the heap profiler if it is running and from allocation sampling
+// otherwise. Empty if neither is supported.
+std::string currentProfile() {
+  std::string profile;
+#ifdef TCMALLOC
+  if (IsHeapProfilerRunning()) {
+    char* full_profile = GetHeapProfile();
+    if (full_profile != nullptr) {
+      profile = full_profile;
+      free(full_profile);
+      return profile;
+    }
+  }
+  MallocExtension::instance()->GetHeapSample(&profile);
+#endif
+  return profile;
+}
+
+// Sites are keyed by their frames, as the same stack may be listed more than once.
+SiteBytes currentSites() {
+  SiteBytes sites;
+  for (const AllocationSite& site : HeapProfiler::parseProfile(currentProfile())) {
+    sites[site.frames_] += site.bytes_;
+  }
+  return sites;
+}
+
+/**
+ * Symbolizes frames, remembering the symbol of each address.
+ */
+class Symbolizer {
+public:
+  const std::vector<std::string>& symbolize(const std::vector<uintptr_t>& frames) {
+    auto it = sites_.find(frames);
+    if (it != sites_.end()) {
+      return it->second;
+    }
+    std::vector<std::string>& symbols = sites_[frames];
+    for (const uintptr_t frame : frames) {
+      symbols.push_back(symbolizeFrame(frame));
+    }
+    return symbols;
+  }
+
+private:
+  const std::string& symbolizeFrame(uintptr_t frame) {
+    auto it = frames_.find(frame);
+    if (it != frames_.end()) {
+      return it->second;
+    }
+    char symbol[1024];
+    // Frames are return addresses, so the call itself is the instruction before.
+    std::string name = absl::Symbolize(reinterpret_cast<void*>(frame - 1), symbol, sizeof(symbol))
+                           ? std::string(symbol)
+                           : absl::StrFormat("0x%x", frame);
+    return frames_.emplace(frame, std::move(name)).first->second;
+  }
+
+  absl::flat_hash_map<uintptr_t, std::string> frames_;
+  std::map<std::vector<uintptr_t>, std::vector<std::string>> sites_;
+};
+
+} // namespace
+
+bool HeapProfiler::available() {
+#ifdef TCMALLOC
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool HeapProfiler::start(const std::string& path_prefix) {
+  if (!Profiler::Heap::profilerEnabled() || Profiler::Heap::isProfilerStarted()) {
+    return false;
+  }
+  return Profiler::Heap::startProfiler(path_prefix);
+}
+
+bool HeapProfiler::stop() { return Profiler::Heap::stopProfiler(); }
+
+bool HeapProfiler::dumpProfile(const std::string& path) {
+  const std::string profile = currentProfile();
+  if (profile.empty()) {
+    return false;
+  }
+  std::ofstream file(path, std::ios::out | std::ios::trunc);
+  if (!file) {
+    return false;
+  }
+  file << profile;
+  return static_cast<bool>(file);
+}
+
+bool HeapProfiler::stats(HeapStats& stats) {
+  if (!available()) {
+    return false;
+  }
+  stats.allocated_bytes_ = Stats::totalCurrentlyAllocated();
+  stats.heap_bytes_ = Stats::totalCurrentlyReserved();
+  stats.free_bytes_ = Stats::totalPageHeapFree() + Stats::totalThreadCacheBytes();
+  stats.unmapped_bytes_ = Stats::totalPageHeapUnmapped();
+  const uint64_t resident_bytes = stats.heap_bytes_ - stats.unmapped_bytes_;
+  stats.fragmentation_ =
+      resident_bytes > stats.allocated_bytes_
+          ? static_cast<double>(resident_bytes - stats.allocated_bytes_) / resident_bytes
+          : 0;
+  return true;
+}
+
+bool HeapProfiler::dumpSummary(const std::string& path, uint32_t max_sites) {
+  HeapStats heap_stats;
+  if (!stats(heap_stats)) {
+    return false;
+  }
+  std::ofstream file(path, std::ios::out | std::ios::trunc);
+  if (!file) {
+    return false;
+  }
+  writeStats(file, heap_stats);
+
+  const SiteBytes sites = currentSites();
+  std::vector<std::pair<int64_t, const std::vector<uintptr_t>*>> by_bytes;
+  std::map<absl::string_view, int64_t> components;
+  Symbolizer symbolizer;
+  for (const auto& site : sites) {
+    by_bytes.emplace_back(site.second, &site.first);
+    components[componentOf(symbolizer.symbolize(site.first))] += site.second;
+  }
+  std::sort(by_bytes.begin(), by_bytes.end(),
+            [](const auto& a, const auto& b) -> bool { return a.first > b.first; });
+
+  file << "\nbytes by component:\n";
+  for (const auto& component : components) {
+    file << "  " << component.first << ": " << component.second << "\n";
+  }
+  file << "\ntop sites:\n";
+  for (size_t i = 0; i < by_bytes.size() && i < max_sites; i++) {
+    writeSite(file, by_bytes[i].first, symbolizer.symbolize(*by_bytes[i].second));
+  }
+  return static_cast<bool>(file);
+}
+
+bool HeapProfiler::mark() {
+  HeapStats heap_stats;
+  if (!stats(heap_stats)) {
+    return false;
+  }
+  SiteBytes sites = currentSites();
+  Mark& heap_mark = heapMark();
+  Thread::LockGuard lock(heap_mark.mutex_);
+  heap_mark.marked_ = true;
+  heap_mark.stats_ = heap_stats;
+  heap_mark.sites_ = std::move(sites);
+  return true;
+}
+
+bool HeapProfiler::dumpDeltaSinceMark(const std::string& path, uint32_t max_sites) {
+  HeapStats heap_stats;
+  if (!stats(heap_stats)) {
+    return false;
+  }
+  SiteBytes deltas = currentSites();
+  HeapStats marked_stats;
+  {
+    Mark& heap_mark = heapMark();
+    Thread::LockGuard lock(heap_mark.mutex_);
+    if (!heap_mark.marked_) {
+      return false;
+    }
+    marked_stats = heap_mark.stats_;
+    for (const auto& site : heap_mark.sites_) {
+      deltas[site.first] -= site.second;
+    }
+  }
+  std::ofstream file(path, std::ios::out | std::ios::trunc);
+  if (!file) {
+    return false;
+  }
+  writeStats(file, heap_stats);
+  file << "allocated bytes since mark: "
+       << static_cast<int64_t>(heap_stats.allocated_bytes_ - marked_stats.allocated_bytes_)
+       << "\nheap bytes since mark: "
+       << static_cast<int64_t>(heap_stats.heap_bytes_ - marked_stats.heap_bytes_) << "\n";
+
+  std::vector<std::pair<int64_t, const std::vector<uintptr_t>*>> by_growth;
+  std::map<absl::string_view, int64_t> components;
+  Symbolizer symbolizer;
+  for (const auto& site : deltas) {
+    if (site.second == 0) {
+      continue;
+    }
+    by_growth.emplace_back(site.second, &site.first);
+    components[componentOf(symbolizer.symbolize(site.first))] += site.second;
+  }
+  std::sort(by_growth.begin(), by_growth.end(),
+            [](const auto& a, const auto& b) -> bool { return a.first > b.first; });
+
+  file << "\nbytes since mark by component:\n";
+  for (const auto& component : components) {
+    file << "  " << component.first << ": " << component.second << "\n";
+  }
+  file << "\ntop growing sites:\n";
+  for (size_t i = 0; i < by_growth.size() && i < max_sites && by_growth[i].first > 0; i++) {
+    writeSite(file, by_growth[i].first, symbolizer.symbolize(*by_growth[i].second));
+  }
+  return static_cast<bool>(file);
+}
+
+std::vector<AllocationSite> HeapProfiler::parseProfile(absl::string_view profile) {
+  // Each site is listed as "<count>: <bytes> [<total count>: <total bytes>] @ <frames>", after a
+  // header line of the same shape, and before a listing of the process' mappings.
+  std::vector<AllocationSite> sites;
+  for (absl::string_view line : absl::StrSplit(profile, '\n')) {
+    line = absl::StripAsciiWhitespace(line);
+    if (absl::StartsWith(line, "MAPPED_LIBRARIES:")) {
+      break;
+    }
+    const std::vector<absl::string_view> parts = absl::StrSplit(line, absl::MaxSplits(" @ ", 1));
+    if (parts.size() != 2 || absl::StartsWith(line, "heap profile:")) {
+      continue;
+    }
+    const std::vector<absl::string_view> totals =
+        absl::StrSplit(parts[0], absl::ByAnyChar(": []"), absl::SkipEmpty());
+    AllocationSite site;
+    if (totals.size() < 2 || !absl::SimpleAtoi(totals[0], &site.count_) ||
+        !absl::SimpleAtoi(totals[1], &site.bytes_)) {
+      continue;
+    }
+    for (absl::string_view frame : absl::StrSplit(parts[1], ' ', absl::SkipEmpty())) {
+      const std::string address(frame);
+      site.frames_.push_back(static_cast<uintptr_t>(std::strtoull(address.c_str(), nullptr, 16)));
+    }
+    sites.push_back(std::move(site));
+  }
+  return sites;
+}
+
+absl::string_view HeapProfiler::componentOf(const std::vector<std::string>& frames) {
+  for (const std::string& frame : frames) {
+    for (const ComponentPattern& pattern : ComponentPatterns) {
+      if (absl::StrContains(frame, pattern.pattern_)) {
+        return pattern.component_;
+      }
+    }
+  }
+  return OtherComponent;
+}
+
+void HeapProfiler::resetForTest() {
+  Mark& heap_mark = heapMark();
+  Thread::LockGuard lock(heap_mark.mutex_);
+  heap_mark.marked_ = false;
+  heap_mark.sites_.clear();
+}
+
+void HeapProfiler::writeStats(std::ostream& os, const HeapStats& stats) {
+  os << "allocated bytes: " << stats.allocated_bytes_ << "\nheap bytes: " << stats.heap_bytes_
+     << "\nfree bytes: " << stats.free_bytes_ << "\nunmapped bytes: " << stats.unmapped_bytes_
+     << "\nfragmentation: " << absl::StrFormat("%.3f", stats.fragmentation_) << "\n";
+}
+
+void HeapProfiler::writeSite(std::ostream& os, int64_t bytes,
+                             const std::vector<std::string>& frames) {
+  os << "  " << bytes << " bytes (" << componentOf(frames) << ")\n";
+  for (const std::string& frame : frames) {
+    os << "    " << frame << "\n";
+  }
+}
+
+} // namespace Memory
+} // namespace Envoy
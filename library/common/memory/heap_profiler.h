@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+namespace Envoy {
+namespace Memory {
+
+/**
+ * Process-wide heap usage, as reported by tcmalloc.
+ */
+struct HeapStats {
+  // Bytes in use by the application.
+  uint64_t allocated_bytes_{};
+  // Bytes reserved from the system, including unmapped pages.
+  uint64_t heap_bytes_{};
+  // Bytes reserved but not in use, held by the page heap and the thread caches.
+  uint64_t free_bytes_{};
+  // Bytes released back to the system.
+  uint64_t unmapped_bytes_{};
+  // The fraction of resident heap which is not in use by the application.
+  double fragmentation_{};
+};
+
+/**
+ * A stack from which live allocations were made.
+ */
+struct AllocationSite {
+  int64_t count_{};
+  int64_t bytes_{};
+  // Return addresses, innermost first.
+  std::vector<uintptr_t> frames_;
+};
+
+/**
+ * Heap profiling of the process, for investigating heap growth in the field.
+ *
+ * Allocation sites come from the gperftools heap profiler while it is running, @see start(), and
+ * otherwise from tcmalloc's allocation sampling, which is only active if the process was started
+ * with TCMALLOC_SAMPLE_PARAMETER set. Sites are symbolized in the process, and attributed to the
+ * Envoy Mobile component which made them (e.g. "bridge" or "dns_cache") by their frames.
+ *
+ * All of this requires Envoy Mobile to be built with tcmalloc, e.g. with
+ * --define=tcmalloc=gperftools; otherwise every operation fails.
+ */
+class HeapProfiler {
+public:
+  /**
+   * @return bool whether heap profiling is supported by this build.
+   */
+  static bool available();
+
+  /**
+   * Start the gperftools heap profiler, which records the site of every allocation. Full profiles
+   * are written periodically as the heap grows to <path_prefix>.NNNN.heap.
+   * @param path_prefix, the prefix of the profile files written.
+   * @return bool whether the profiler was started.
+   */
+  static bool start(const std::string& path_prefix);
+
+  /**
+   * Stop the heap profiler, writing a final profile.
+   * @return bool whether the profiler was running.
+   */
+  static bool stop();
+
+  /**
+   * Write the live allocation sites to a file in the format read by pprof.
+   * @param path, the file to write to. It is truncated if it exists.
+   * @return bool whether a profile was available and written.
+   */
+  static bool dumpProfile(const std::string& path);
+
+  /**
+   * @param stats, filled in with the current heap usage.
+   * @return bool whether heap stats are supported by this build.
+   */
+  static bool stats(HeapStats& stats);
+
+  /**
+   * Write the heap stats and the live allocation sites holding the most bytes to a file, with the
+   * bytes held by each component.
+   * @param path, the file to write to. It is truncated if it exists.
+   * @param max_sites, the number of sites to write.
+   * @return bool whether the file was written.
+   */
+  static bool dumpSummary(const std::string& path, uint32_t max_sites);
+
+  /**
+   * Record the current heap usage and live allocation sites, to be compared against later with
+   * dumpDeltaSinceMark(). Replaces any previous mark.
+   * @return bool whether heap stats are supported by this build.
+   */
+  static bool mark();
+
+  /**
+   * Write the growth in heap usage since mark() to a file, with the growth of each component and
+   * of the allocation sites which grew the most.
+   * @param path, the file to write to. It is truncated if it exists.
+   * @param max_sites, the number of sites to write.
+   * @return bool whether a mark had been recorded and the file was written.
+   */
+  static bool dumpDeltaSinceMark(const std::string& path, uint32_t max_sites);
+
+  /**
+   * Parse the allocation sites of a heap profile in the text format written by gperftools.
+   * @param profile, the profile.
+   * @return the sites in the profile, in the order listed.
+   */
+  static std::vector<AllocationSite> parseProfile(absl::string_view profile);
+
+  /**
+   * @param frames, the symbolized frames of an allocation site, innermost first.
+   * @return absl::string_view the component the innermost frame belonging to one made the
+   *         allocation, or "other".
+   */
+  static absl::string_view componentOf(const std::vector<std::string>& frames);
+
+  /**
+   * Discard the mark. Only for use in tests.
+   */
+  static void resetForTest();
+
+private:
+  static void writeStats(std::ostream& os, const HeapStats& stats);
+  static void writeSite(std::ostream& os, int64_t bytes, const std::vector<std::string>& frames);
+};
+
+} // namespace Memory
+} // namespace Envoy
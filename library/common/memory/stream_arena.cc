@@ -0,0 +1,38 @@
+#include "library/common/memory/stream_arena.h"
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Memory {
+
+StreamArena::StreamArena(uint64_t block_bytes) : block_bytes_(block_bytes) {}
+
+void* StreamArena::allocate(size_t bytes, size_t alignment) {
+  ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
+  bytes_allocated_ += bytes;
+  const uintptr_t next = reinterpret_cast<uintptr_t>(next_);
+  const uintptr_t aligned = (next + alignment - 1) & ~(uintptr_t(alignment) - 1);
+  if (next_ != nullptr && aligned + bytes <= reinterpret_cast<uintptr_t>(end_)) {
+    next_ = reinterpret_cast<uint8_t*>(aligned + bytes);
+    return reinterpret_cast<void*>(aligned);
+  }
+
+  // Blocks come from operator new[], which aligns them for any fundamental type; larger alignments
+  // are padded for.
+  const size_t padding = alignment > alignof(std::max_align_t) ? alignment : 0;
+  if (bytes + padding > block_bytes_) {
+    // Oversized allocations get a block of their own, and the current block stays in use.
+    blocks_.emplace_back(new uint8_t[bytes + padding]);
+    const uintptr_t block = reinterpret_cast<uintptr_t>(blocks_.back().get());
+    return reinterpret_cast<void*>((block + alignment - 1) & ~(uintptr_t(alignment) - 1));
+  }
+  blocks_.emplace_back(new uint8_t[block_bytes_]);
+  const uintptr_t block = reinterpret_cast<uintptr_t>(blocks_.back().get());
+  const uintptr_t start = (block + alignment - 1) & ~(uintptr_t(alignment) - 1);
+  next_ = reinterpret_cast<uint8_t*>(start + bytes);
+  end_ = blocks_.back().get() + block_bytes_;
+  return reinterpret_cast<void*>(start);
+}
+
+} // namespace Memory
+} // namespace Envoy
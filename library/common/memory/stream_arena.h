@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "common/common/non_copyable.h"
+
+namespace Envoy {
+namespace Memory {
+
+/**
+ * A bump allocator for the allocations made over the lifetime of a stream. Memory is carved out
+ * of blocks in order, and is only returned to the system, all at once, when the arena is
+ * destroyed. Allocations larger than a block get a block of their own.
+ *
+ * The arena is not thread safe: allocations must be made from one thread at a time. It is shared
+ * by the objects allocated in it (@see ArenaAllocator), so that it lives until the last of them
+ * is released.
+ */
+class StreamArena : NonCopyable {
+public:
+  /**
+   * @param block_bytes, the size of the blocks allocations are made from.
+   */
+  explicit StreamArena(uint64_t block_bytes);
+
+  /**
+   * @param bytes, the size of the allocation.
+   * @param alignment, the alignment of the allocation. Must be a power of two.
+   * @return void* the allocation, which stays valid until the arena is destroyed.
+   */
+  void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+  /**
+   * @return uint64_t the bytes handed out by allocate(), not including alignment padding.
+   */
+  uint64_t bytesAllocated() const { return bytes_allocated_; }
+
+  /**
+   * @return uint64_t the number of blocks reserved from the system.
+   */
+  uint64_t blockCount() const { return blocks_.size(); }
+
+private:
+  const uint64_t block_bytes_;
+  std::vector<std::unique_ptr<uint8_t[]>> blocks_;
+  // The unused part of the current block.
+  uint8_t* next_{};
+  uint8_t* end_{};
+  uint64_t bytes_allocated_{};
+};
+
+using StreamArenaSharedPtr = std::shared_ptr<StreamArena>;
+
+/**
+ * A standard allocator drawing from a StreamArena, e.g. for std::allocate_shared. Deallocation is
+ * a no-op: the memory is released with the arena, which each copy of the allocator keeps alive.
+ */
+template <class T> class ArenaAllocator {
+public:
+  using value_type = T;
+
+  explicit ArenaAllocator(StreamArenaSharedPtr arena) : arena_(std::move(arena)) {}
+  template <class U> ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {}
+
+  T* allocate(size_t n) { return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T))); }
+  void deallocate(T*, size_t) {}
+
+  const StreamArenaSharedPtr& arena() const { return arena_; }
+
+  template <class U> bool operator==(const ArenaAllocator<U>& other) const {
+    return arena_ == other.arena();
+  }
+  template <class U> bool operator!=(const ArenaAllocator<U>& other) const {
+    return !(*this == other);
+  }
+
+private:
+  StreamArenaSharedPtr arena_;
+};
+
+/**
+ * Deleter for objects which may have been constructed in a StreamArena: those are only destroyed,
+ * and the others are deleted.
+ */
+template <class T> struct ArenaDeleter {
+  void operator()(T* object) const {
+    if (in_arena_) {
+      object->~T();
+    } else {
+      delete object;
+    }
+  }
+
+  bool in_arena_{};
+};
+
+template <class T> using ArenaPtr = std::unique_ptr<T, ArenaDeleter<T>>;
+
+/**
+ * Construct an object in an arena, or on the heap if there is none. The object must not outlive
+ * the arena.
+ * @param arena, the arena to construct the object in, or nullptr.
+ * @param args, the arguments to the object's constructor.
+ * @return ArenaPtr<T> the object.
+ */
+template <class T, class... Args> ArenaPtr<T> makeArenaPtr(StreamArena* arena, Args&&... args) {
+  if (arena == nullptr) {
+    return ArenaPtr<T>(new T(std::forward<Args>(args)...), ArenaDeleter<T>{false});
+  }
+  void* memory = arena->allocate(sizeof(T), alignof(T));
+  return ArenaPtr<T>(new (memory) T(std::forward<Args>(args)...), ArenaDeleter<T>{true});
+}
+
+/**
+ * Construct a shared object in an arena, or on the heap if there is none. The object keeps the
+ * arena alive.
+ * @param arena, the arena to construct the object in, or nullptr.
+ * @param args, the arguments to the object's constructor.
+ * @return std::shared_ptr<T> the object.
+ */
+template <class T, class... Args>
+std::shared_ptr<T> makeArenaShared(const StreamArenaSharedPtr& arena, Args&&... args) {
+  if (arena == nullptr) {
+    return std::make_shared<T>(std::forward<Args>(args)...);
+  }
+  return std::allocate_shared<T>(ArenaAllocator<T>(arena), std::forward<Args>(args)...);
+}
+
+} // namespace Memory
+} // namespace Envoy
@@ -0,0 +1,100 @@
+#include "library/common/network/connection_coalescing.h"
+
+#include <algorithm>
+
+#include "common/common/lock_guard.h"
+#include "common/common/macros.h"
+#include "common/common/thread.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/match.h"
+
+namespace Envoy {
+namespace Network {
+
+namespace {
+
+struct Connection {
+  ConnectionCoalescing::ConnectionId id_;
+  // Held so that the instance isn't reused for another host's address while it is recorded.
+  Address::InstanceConstSharedPtr address_;
+  std::vector<std::string> dns_names_;
+};
+
+struct Registry {
+  Thread::MutexBasicLockable mutex_;
+  ConnectionCoalescing::ConnectionId next_id_ GUARDED_BY(mutex_){};
+  // Open connections by the address instance they were made to.
+  absl::flat_hash_map<const Address::Instance*, std::vector<Connection>>
+      connections_ GUARDED_BY(mutex_);
+  absl::flat_hash_map<ConnectionCoalescing::ConnectionId, const Address::Instance*>
+      addresses_ GUARDED_BY(mutex_);
+};
+
+Registry& registry() { MUTABLE_CONSTRUCT_ON_FIRST_USE(Registry); }
+
+} // namespace
+
+ConnectionCoalescing::ConnectionId
+ConnectionCoalescing::add(Address::InstanceConstSharedPtr address,
+                          std::vector<std::string> dns_names) {
+  Registry& registry = Network::registry();
+  Thread::LockGuard lock(registry.mutex_);
+  const ConnectionId id = registry.next_id_++;
+  const Address::Instance* key = address.get();
+  registry.connections_[key].push_back({id, std::move(address), std::move(dns_names)});
+  registry.addresses_[id] = key;
+  return id;
+}
+
+void ConnectionCoalescing::remove(ConnectionId id) {
+  Registry& registry = Network::registry();
+  Thread::LockGuard lock(registry.mutex_);
+  auto address_it = registry.addresses_.find(id);
+  if (address_it == registry.addresses_.end()) {
+    return;
+  }
+  auto connections_it = registry.connections_.find(address_it->second);
+  std::vector<Connection>& connections = connections_it->second;
+  connections.erase(std::find_if(
+      connections.begin(), connections.end(),
+      [id](const Connection& connection) -> bool { return connection.id_ == id; }));
+  if (connections.empty()) {
+    registry.connections_.erase(connections_it);
+  }
+  registry.addresses_.erase(address_it);
+}
+
+bool ConnectionCoalescing::covers(const Address::Instance& address, absl::string_view host) {
+  Registry& registry = Network::registry();
+  Thread::LockGuard lock(registry.mutex_);
+  auto connections_it = registry.connections_.find(&address);
+  if (connections_it == registry.connections_.end()) {
+    return false;
+  }
+  for (const Connection& connection : connections_it->second) {
+    for (const std::string& dns_name : connection.dns_names_) {
+      if (dnsNameMatch(host, dns_name)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool ConnectionCoalescing::dnsNameMatch(absl::string_view host, absl::string_view dns_name) {
+  if (absl::EqualsIgnoreCase(host, dns_name)) {
+    return true;
+  }
+  // A wildcard covers a single, non-empty label: *.example.com covers a.example.com, but neither
+  // example.com nor a.b.example.com.
+  if (!absl::StartsWith(dns_name, "*.")) {
+    return false;
+  }
+  const size_t dot = host.find('.');
+  return dot != absl::string_view::npos && dot > 0 &&
+         absl::EqualsIgnoreCase(host.substr(dot), dns_name.substr(1));
+}
+
+} // namespace Network
+} // namespace Envoy
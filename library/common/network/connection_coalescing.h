@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "envoy/network/address.h"
+
+#include "absl/strings/string_view.h"
+
+namespace Envoy {
+namespace Network {
+
+/**
+ * Process-wide record of the open upstream HTTP/2 connections, with the names the server's
+ * certificate covers. A request for another name may be sent on such a connection if the name
+ * resolves to the connection's address and the certificate covers it (RFC 7540, section 9.1.1).
+ * Connections are recorded by the handshaker which verified them, and looked up by the clusters
+ * which coalesce requests onto them.
+ *
+ * Connections are recorded by the address instance they were made to rather than by its value. An
+ * upstream connection keeps the instance of the host which created it, and dynamic forward proxy
+ * hosts each hold an instance of their own, so the instance tells apart the connections of hosts
+ * whose names resolve to the same IP address.
+ * This class is thread-safe.
+ */
+class ConnectionCoalescing {
+public:
+  using ConnectionId = uint64_t;
+
+  /**
+   * Record an open connection.
+   * @param address, the address instance the connection was made to.
+   * @param dns_names, the DNS names the server's certificate covers, which may be wildcards.
+   * @return ConnectionId, the id to remove the connection by once it is closed.
+   */
+  static ConnectionId add(Address::InstanceConstSharedPtr address,
+                          std::vector<std::string> dns_names);
+
+  /**
+   * Forget a connection, once it is closed.
+   * @param id, the id the connection was added with.
+   */
+  static void remove(ConnectionId id);
+
+  /**
+   * @param address, the address instance of an upstream host.
+   * @param host, the name a request is for, without a port.
+   * @return bool whether one of the host's open connections has a certificate covering host.
+   */
+  static bool covers(const Address::Instance& address, absl::string_view host);
+
+  /**
+   * @return bool whether a certificate's DNS name covers host. The name may be a wildcard in its
+   *         leftmost label, which covers exactly one label. Names are compared case-insensitively.
+   */
+  static bool dnsNameMatch(absl::string_view host, absl::string_view dns_name);
+};
+
+} // namespace Network
+} // namespace Envoy
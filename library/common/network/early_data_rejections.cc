@@ -0,0 +1,41 @@
+#include "library/common/network/early_data_rejections.h"
+
+#include <string>
+
+#include "common/common/lock_guard.h"
+#include "common/common/macros.h"
+#include "common/common/thread.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/ascii.h"
+
+namespace Envoy {
+namespace Network {
+
+namespace {
+
+struct Registry {
+  Thread::MutexBasicLockable mutex_;
+  // Rejections by lower case server name.
+  absl::flat_hash_map<std::string, uint64_t> rejections_ GUARDED_BY(mutex_);
+};
+
+Registry& registry() { MUTABLE_CONSTRUCT_ON_FIRST_USE(Registry); }
+
+} // namespace
+
+void EarlyDataRejections::onRejected(absl::string_view server_name) {
+  Registry& registry = Network::registry();
+  Thread::LockGuard lock(registry.mutex_);
+  registry.rejections_[absl::AsciiStrToLower(server_name)]++;
+}
+
+uint64_t EarlyDataRejections::rejections(absl::string_view server_name) {
+  Registry& registry = Network::registry();
+  Thread::LockGuard lock(registry.mutex_);
+  auto it = registry.rejections_.find(absl::AsciiStrToLower(server_name));
+  return it == registry.rejections_.end() ? 0 : it->second;
+}
+
+} // namespace Network
+} // namespace Envoy
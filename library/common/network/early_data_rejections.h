@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+
+namespace Envoy {
+namespace Network {
+
+/**
+ * Process-wide count of the TLS 1.3 early data servers have rejected, by server name. A server
+ * which rejects early data makes the connection fail, so the streams sent on it see a connection
+ * failure like any other. Rejections are recorded by the handshaker which offered the early data
+ * before the connection is closed, so that the HTTP dispatcher can tell them apart.
+ * This class is thread-safe.
+ */
+class EarlyDataRejections {
+public:
+  /**
+   * Record that a server rejected a connection's early data.
+   * @param server_name, the name the connection was made to, i.e. its SNI.
+   */
+  static void onRejected(absl::string_view server_name);
+
+  /**
+   * @param server_name, the name a request is for, without a port.
+   * @return uint64_t the number of times servers for the name have rejected early data. Early data
+   *         was rejected while a request was in flight if the count changed in the meantime.
+   */
+  static uint64_t rejections(absl::string_view server_name);
+};
+
+} // namespace Network
+} // namespace Envoy
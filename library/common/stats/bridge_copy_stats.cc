@@ -0,0 +1,56 @@
+#include "library/common/stats/bridge_copy_stats.h"
+
+namespace Envoy {
+namespace Stats {
+
+namespace {
+
+#define GENERATE_BRIDGE_COPY_SITE_NAME(NAME) #NAME,
+
+const char* const SiteNames[] = {ALL_BRIDGE_COPY_SITES(GENERATE_BRIDGE_COPY_SITE_NAME)};
+
+} // namespace
+
+BridgeCopyStats::Totals BridgeCopyStats::totals_[BridgeCopyStats::SiteCount];
+thread_local const BridgeCopyCounterSet* BridgeCopyStats::thread_counters_{};
+thread_local BridgeCopyStats::ThreadCopies
+    BridgeCopyStats::thread_copies_[BridgeCopyStats::SiteCount];
+
+const char* BridgeCopyStats::name(BridgeCopySite site) {
+  return SiteNames[static_cast<size_t>(site)];
+}
+
+void BridgeCopyStats::setThreadCounters(const BridgeCopyCounterSet& counters) {
+  thread_counters_ = &counters;
+}
+
+void BridgeCopyStats::clearThreadCounters(const BridgeCopyCounterSet& counters) {
+  if (thread_counters_ == &counters) {
+    thread_counters_ = nullptr;
+  }
+}
+
+void BridgeCopyStats::chargeThreadCopies(const BridgeCopyCounterSet& counters) {
+  for (size_t i = 0; i < counters.size(); i++) {
+    ThreadCopies& copies = thread_copies_[i];
+    if (copies.allocations_ == 0 && copies.bytes_copied_ == 0) {
+      continue;
+    }
+    counters[i].bytes_copied_.add(copies.bytes_copied_);
+    counters[i].allocations_.add(copies.allocations_);
+    copies = {};
+  }
+}
+
+void BridgeCopyStats::resetForTest() {
+  for (Totals& totals : totals_) {
+    totals.bytes_copied_.store(0, std::memory_order_relaxed);
+    totals.allocations_.store(0, std::memory_order_relaxed);
+  }
+  for (ThreadCopies& copies : thread_copies_) {
+    copies = {};
+  }
+}
+
+} // namespace Stats
+} // namespace Envoy
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "envoy/stats/stats.h"
+
+namespace Envoy {
+namespace Stats {
+
+/**
+ * The boundaries at which data is copied between Envoy and the platform bridge. Each is exported
+ * as http.dispatcher.bridge.<site>.bytes_copied and http.dispatcher.bridge.<site>.allocations.
+ */
+#define ALL_BRIDGE_COPY_SITES(SITE)                                                                \
+  SITE(copy_to_bridge_data)                                                                        \
+  SITE(to_bridge_data)                                                                             \
+  SITE(to_bridge_headers)                                                                          \
+  SITE(to_bridge_metadata)                                                                         \
+  SITE(to_request_headers)                                                                         \
+  SITE(to_request_trailers)                                                                        \
+  SITE(copy_envoy_headers)                                                                         \
+  SITE(bridge_fragment)                                                                            \
+  SITE(jni_array_to_native_data)                                                                   \
+  SITE(jni_pass_headers)                                                                           \
+  SITE(jni_to_native_headers)                                                                      \
+  SITE(jni_on_data)
+
+#define GENERATE_BRIDGE_COPY_SITE_ENUM(NAME) NAME,
+
+enum class BridgeCopySite { ALL_BRIDGE_COPY_SITES(GENERATE_BRIDGE_COPY_SITE_ENUM) Count };
+
+/**
+ * An engine's counters for a bridge boundary.
+ */
+struct BridgeCopyCounters {
+  Counter& bytes_copied_;
+  Counter& allocations_;
+};
+
+/**
+ * An engine's counters for every bridge boundary, indexed by BridgeCopySite.
+ */
+using BridgeCopyCounterSet = std::vector<BridgeCopyCounters>;
+
+/**
+ * Process-wide totals of the bytes copied and allocations made by each bridge boundary, so that
+ * the cost of the bridge (and the effect of removing copies from it) can be measured.
+ *
+ * Each crossing is also charged to the counters of the engine it was made for. Crossings on an
+ * engine's own thread are charged to its counters as they are recorded. Crossings on other threads
+ * (e.g. converting a platform's request before it is sent) are held by the thread, and charged to
+ * the engine which the thread next hands work to, @see chargeThreadCopies.
+ *
+ * Recording is compiled out entirely when ENVOY_MOBILE_DISABLE_BRIDGE_COPY_STATS is defined, e.g.
+ * with --copt=-DENVOY_MOBILE_DISABLE_BRIDGE_COPY_STATS.
+ */
+class BridgeCopyStats {
+public:
+#ifdef ENVOY_MOBILE_DISABLE_BRIDGE_COPY_STATS
+  static constexpr bool Enabled = false;
+#else
+  static constexpr bool Enabled = true;
+#endif
+  static constexpr size_t SiteCount = static_cast<size_t>(BridgeCopySite::Count);
+
+  /**
+   * Record a crossing of a boundary. Use ENVOY_MOBILE_BRIDGE_COPY rather than calling this
+   * directly, so that the call is compiled out when disabled.
+   * @param site, the boundary crossed.
+   * @param bytes, the number of bytes copied.
+   * @param allocations, the number of allocations made.
+   */
+  static void record(BridgeCopySite site, uint64_t bytes, uint64_t allocations) {
+    const size_t index = static_cast<size_t>(site);
+    Totals& totals = totals_[index];
+    totals.bytes_copied_.fetch_add(bytes, std::memory_order_relaxed);
+    totals.allocations_.fetch_add(allocations, std::memory_order_relaxed);
+    if (thread_counters_ != nullptr) {
+      (*thread_counters_)[index].bytes_copied_.add(bytes);
+      (*thread_counters_)[index].allocations_.add(allocations);
+    } else {
+      thread_copies_[index].bytes_copied_ += bytes;
+      thread_copies_[index].allocations_ += allocations;
+    }
+  }
+
+  /**
+   * Charge crossings recorded on the calling thread to an engine's counters as they are recorded.
+   * Called on an engine's thread, which then only does work for that engine.
+   * @param counters, the engine's counters, which must outlive their use by the thread, @see
+   * clearThreadCounters.
+   */
+  static void setThreadCounters(const BridgeCopyCounterSet& counters);
+
+  /**
+   * Stop charging crossings recorded on the calling thread to an engine's counters. Called on an
+   * engine's thread once its counters are to be destroyed.
+   */
+  static void clearThreadCounters() { thread_counters_ = nullptr; }
+
+  /**
+   * Stop charging crossings recorded on the calling thread to an engine's counters, if they are
+   * the counters being charged.
+   * @param counters, the engine's counters.
+   */
+  static void clearThreadCounters(const BridgeCopyCounterSet& counters);
+
+  /**
+   * Charge the crossings held by the calling thread to an engine's counters. Called as the thread
+   * hands work to the engine, which the crossings were most recently made for.
+   * @param counters, the engine's counters.
+   */
+  static void chargeThreadCopies(const BridgeCopyCounterSet& counters);
+
+  /**
+   * @return uint64_t the number of bytes copied at the site since the process started.
+   */
+  static uint64_t bytesCopied(BridgeCopySite site) {
+    return totals_[static_cast<size_t>(site)].bytes_copied_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @return uint64_t the number of allocations made at the site since the process started.
+   */
+  static uint64_t allocations(BridgeCopySite site) {
+    return totals_[static_cast<size_t>(site)].allocations_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @return const char* the name of the site in stats.
+   */
+  static const char* name(BridgeCopySite site);
+
+  /**
+   * Zero all totals, and the crossings held by the calling thread. Only for use in tests.
+   */
+  static void resetForTest();
+
+private:
+  struct Totals {
+    std::atomic<uint64_t> bytes_copied_{};
+    std::atomic<uint64_t> allocations_{};
+  };
+
+  struct ThreadCopies {
+    uint64_t bytes_copied_{};
+    uint64_t allocations_{};
+  };
+
+  static Totals totals_[SiteCount];
+  static thread_local const BridgeCopyCounterSet* thread_counters_;
+  static thread_local ThreadCopies thread_copies_[SiteCount];
+};
+
+} // namespace Stats
+} // namespace Envoy
+
+#ifdef ENVOY_MOBILE_DISABLE_BRIDGE_COPY_STATS
+// The arguments are referenced without being evaluated, so that variables which only exist to be
+// recorded don't trigger unused variable warnings.
+#define ENVOY_MOBILE_BRIDGE_COPY(SITE, BYTES, ALLOCATIONS)                                         \
+  do {                                                                                             \
+    (void)sizeof(BYTES);                                                                           \
+    (void)sizeof(ALLOCATIONS);                                                                     \
+  } while (0)
+#else
+/**
+ * Record that BYTES were copied with ALLOCATIONS allocations at the named bridge boundary, @see
+ * ALL_BRIDGE_COPY_SITES. The arguments are not evaluated when bridge copy stats are disabled.
+ */
+#define ENVOY_MOBILE_BRIDGE_COPY(SITE, BYTES, ALLOCATIONS)                                         \
+  ::Envoy::Stats::BridgeCopyStats::record(::Envoy::Stats::BridgeCopySite::SITE, BYTES, ALLOCATIONS)
+#endif
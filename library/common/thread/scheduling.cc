@@ -0,0 +1,116 @@
+#include "library/common/thread/scheduling.h"
+
+#include <algorithm>
+#include <string>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <fstream>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#include <sys/qos.h>
+#endif
+
+namespace Envoy {
+namespace Thread {
+
+#if defined(__linux__)
+bool setNiceValue(int nice) {
+  // Linux schedules each thread with its own nice value, addressed by thread id.
+  const id_t tid = static_cast<id_t>(::syscall(SYS_gettid));
+  return ::setpriority(PRIO_PROCESS, tid, nice) == 0;
+}
+
+bool setCpuAffinity(const std::vector<uint32_t>& cpus) {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  if (cpus.empty()) {
+    for (uint32_t cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      CPU_SET(cpu, &cpu_set);
+    }
+  }
+  for (const uint32_t cpu : cpus) {
+    if (cpu >= CPU_SETSIZE) {
+      return false;
+    }
+    CPU_SET(cpu, &cpu_set);
+  }
+  return ::sched_setaffinity(0, sizeof(cpu_set), &cpu_set) == 0;
+}
+
+std::vector<uint32_t> cpusOfClass(CoreClass core_class) {
+  std::map<uint32_t, uint64_t> max_frequencies;
+  const std::string base = "/sys/devices/system/cpu/";
+  DIR* dir = ::opendir(base.c_str());
+  if (dir == nullptr) {
+    return {};
+  }
+  while (dirent* entry = ::readdir(dir)) {
+    const std::string name = entry->d_name;
+    if (name.size() <= 3 || name.compare(0, 3, "cpu") != 0 ||
+        name.find_first_not_of("0123456789", 3) != std::string::npos) {
+      continue;
+    }
+    uint64_t max_frequency = 0;
+    std::ifstream file(base + name + "/cpufreq/cpuinfo_max_freq");
+    file >> max_frequency;
+    max_frequencies[static_cast<uint32_t>(std::strtoul(name.c_str() + 3, nullptr, 10))] =
+        file ? max_frequency : 0;
+  }
+  ::closedir(dir);
+  return cpusOfClass(core_class, max_frequencies);
+}
+#else
+#if defined(__APPLE__)
+bool setNiceValue(int nice) {
+  qos_class_t qos_class = QOS_CLASS_DEFAULT;
+  if (nice <= -10) {
+    qos_class = QOS_CLASS_USER_INTERACTIVE;
+  } else if (nice < 0) {
+    qos_class = QOS_CLASS_USER_INITIATED;
+  } else if (nice > 10) {
+    qos_class = QOS_CLASS_BACKGROUND;
+  } else if (nice > 0) {
+    qos_class = QOS_CLASS_UTILITY;
+  }
+  return ::pthread_set_qos_class_self_np(qos_class, 0) == 0;
+}
+#else
+bool setNiceValue(int) { return false; }
+#endif
+
+bool setCpuAffinity(const std::vector<uint32_t>&) { return false; }
+
+std::vector<uint32_t> cpusOfClass(CoreClass) { return {}; }
+#endif
+
+std::vector<uint32_t> cpusOfClass(CoreClass core_class,
+                                  const std::map<uint32_t, uint64_t>& max_frequencies) {
+  uint64_t lowest = UINT64_MAX;
+  uint64_t highest = 0;
+  for (const auto& cpu : max_frequencies) {
+    lowest = std::min(lowest, cpu.second);
+    highest = std::max(highest, cpu.second);
+  }
+  std::vector<uint32_t> cpus;
+  for (const auto& cpu : max_frequencies) {
+    // If any frequency is unknown, the classes cannot be told apart.
+    // Big cores are every core faster than the slowest, e.g. both the "big" and "prime" cores of a
+    // tri-cluster SoC. On devices with a single class of cores, every core is in both classes.
+    if (core_class == CoreClass::Any || lowest == 0 || lowest == highest ||
+        (core_class == CoreClass::Big && cpu.second > lowest) ||
+        (core_class == CoreClass::Little && cpu.second == lowest)) {
+      cpus.push_back(cpu.first);
+    }
+  }
+  return cpus;
+}
+
+} // namespace Thread
+} // namespace Envoy
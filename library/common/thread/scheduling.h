@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace Envoy {
+namespace Thread {
+
+/**
+ * A class of the device's CPU cores, by their performance.
+ */
+enum class CoreClass {
+  // Every core.
+  Any,
+  // The cores faster than the slowest, by maximum frequency, e.g. the "big" cores of a big.LITTLE
+  // SoC, together with any "prime" cores.
+  Big,
+  // The cores with the lowest maximum frequency, e.g. the "LITTLE" cores of a big.LITTLE SoC.
+  Little,
+};
+
+/**
+ * Set the calling thread's nice value, which weighs its share of the CPU against other threads.
+ * On Linux, including Android, this is the thread's nice value; lowering it below zero may require
+ * privileges. On Apple platforms the nice value is mapped onto the closest quality of service
+ * class.
+ * @param nice, the nice value, from -20 (highest priority) to 19 (lowest priority).
+ * @return bool whether the nice value was set.
+ */
+bool setNiceValue(int nice);
+
+/**
+ * Restrict the calling thread to run on the given CPUs. Only supported on Linux, including
+ * Android.
+ * @param cpus, the CPUs to run on. Empty lets the thread run on any CPU.
+ * @return bool whether the affinity was set.
+ */
+bool setCpuAffinity(const std::vector<uint32_t>& cpus);
+
+/**
+ * @param core_class, the class of cores to return.
+ * @return the CPUs of the device in the class, from their maximum frequencies in sysfs. On devices
+ *         with a single class of cores, or where frequencies are not known, every CPU is in every
+ *         class. Empty if the CPUs cannot be listed, i.e. on other platforms than Linux.
+ */
+std::vector<uint32_t> cpusOfClass(CoreClass core_class);
+
+/**
+ * @param core_class, the class of cores to return.
+ * @param max_frequencies, the maximum frequency of each CPU, keyed by CPU. Zero if unknown.
+ * @return the CPUs in the class, @see cpusOfClass(core_class).
+ */
+std::vector<uint32_t> cpusOfClass(CoreClass core_class,
+                                  const std::map<uint32_t, uint64_t>& max_frequencies);
+
+} // namespace Thread
+} // namespace Envoy
@@ -0,0 +1,19 @@
+#include "library/common/thread/timer_slack.h"
+
+#if defined(__linux__)
+#include <sys/prctl.h>
+#endif
+
+namespace Envoy {
+namespace Thread {
+
+#if defined(__linux__)
+bool setTimerSlack(std::chrono::nanoseconds slack) {
+  return ::prctl(PR_SET_TIMERSLACK, static_cast<unsigned long>(slack.count()), 0, 0, 0) == 0;
+}
+#else
+bool setTimerSlack(std::chrono::nanoseconds) { return false; }
+#endif
+
+} // namespace Thread
+} // namespace Envoy
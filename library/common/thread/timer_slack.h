@@ -0,0 +1,18 @@
+#pragma once
+
+#include <chrono>
+
+namespace Envoy {
+namespace Thread {
+
+/**
+ * Set the calling thread's timer slack: how late the kernel may expire the thread's timers,
+ * including event loop timeouts, so that its wakeups can be coalesced with other wakeups. Only
+ * supported on Linux, including Android.
+ * @param slack, the timer slack. Zero restores the thread's default timer slack.
+ * @return bool whether the timer slack was set.
+ */
+bool setTimerSlack(std::chrono::nanoseconds slack);
+
+} // namespace Thread
+} // namespace Envoy
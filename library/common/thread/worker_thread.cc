@@ -0,0 +1,46 @@
+#include "library/common/thread/worker_thread.h"
+
+#include "common/common/lock_guard.h"
+
+namespace Envoy {
+namespace Thread {
+
+WorkerThread::WorkerThread() : thread_([this]() -> void { run(); }) {}
+
+WorkerThread::~WorkerThread() {
+  {
+    LockGuard lock(mutex_);
+    shutdown_ = true;
+    queue_.clear();
+    cv_.notifyOne();
+  }
+  thread_.join();
+}
+
+void WorkerThread::post(Work work) {
+  LockGuard lock(mutex_);
+  queue_.push_back(std::move(work));
+  cv_.notifyOne();
+}
+
+void WorkerThread::run() {
+  while (true) {
+    Work work;
+    {
+      LockGuard lock(mutex_);
+      while (queue_.empty() && !shutdown_) {
+        cv_.wait(mutex_);
+      }
+      if (shutdown_) {
+        return;
+      }
+      work = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    // Work runs without holding the lock so that new work can be posted concurrently.
+    work();
+  }
+}
+
+} // namespace Thread
+} // namespace Envoy
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <functional>
+#include <list>
+#include <thread>
+
+#include "common/common/thread.h"
+
+namespace Envoy {
+namespace Thread {
+
+/**
+ * A single background thread which runs work in FIFO order, keeping blocking work such as file
+ * I/O off of the event loop. Results are expected to be posted back to the relevant dispatcher by
+ * the work itself. Destroying the worker discards any work that has not yet started, and waits for
+ * the work that has.
+ */
+class WorkerThread {
+public:
+  using Work = std::function<void()>;
+
+  WorkerThread();
+  ~WorkerThread();
+
+  /**
+   * Queue work to be run on the worker thread. This is safe to call from any thread.
+   * @param work, the functor to run.
+   */
+  void post(Work work);
+
+private:
+  void run();
+
+  MutexBasicLockable mutex_;
+  CondVar cv_;
+  std::list<Work> queue_ GUARDED_BY(mutex_);
+  bool shutdown_ GUARDED_BY(mutex_){};
+  // thread_ must be declared last so that it starts after the above state is initialized.
+  std::thread thread_;
+};
+
+} // namespace Thread
+} // namespace Envoy
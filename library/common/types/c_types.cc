@@ -5,6 +5,8 @@
 
 #include "common/common/assert.h"
 
+#include "library/common/stats/bridge_copy_stats.h"
+
 const int kEnvoySuccess = ENVOY_SUCCESS;
 const int kEnvoyFailure = ENVOY_FAILURE;
 
@@ -38,12 +40,15 @@ void release_envoy_headers(envoy_headers headers) {
 envoy_headers copy_envoy_headers(envoy_headers src) {
   envoy_header* dst_header_array =
       static_cast<envoy_header*>(safe_malloc(sizeof(envoy_header) * src.length));
+  uint64_t bytes_copied = 0;
   for (envoy_header_size_t i = 0; i < src.length; i++) {
     envoy_header new_header = {
         copy_envoy_data(src.headers[i].key.length, src.headers[i].key.bytes),
         copy_envoy_data(src.headers[i].value.length, src.headers[i].value.bytes)};
     dst_header_array[i] = new_header;
+    bytes_copied += new_header.key.length + new_header.value.length;
   }
+  ENVOY_MOBILE_BRIDGE_COPY(copy_envoy_headers, bytes_copied, 1 + 2 * src.length);
   envoy_headers dst = {src.length, dst_header_array};
   return dst;
 }
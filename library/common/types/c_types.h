@@ -19,6 +19,12 @@ typedef intptr_t envoy_engine_t;
  */
 typedef intptr_t envoy_stream_t;
 
+/**
+ * Handle to a group of Envoy HTTP streams, which may be operated on together. Not intended for any
+ * external interpretation or use.
+ */
+typedef intptr_t envoy_stream_group_t;
+
 /**
  * Result codes returned by all calls made to this interface.
  */
@@ -50,6 +56,40 @@ typedef enum {
  */
 typedef enum { ENVOY_NET_GENERIC, ENVOY_NET_WLAN, ENVOY_NET_WWAN } envoy_network_t;
 
+/**
+ * Classes of the device's CPU cores, by their performance.
+ * ENVOY_CORES_ANY includes every core.
+ * ENVOY_CORES_BIG includes every core faster than the slowest, by maximum frequency.
+ * ENVOY_CORES_LITTLE includes the cores with the lowest maximum frequency.
+ */
+typedef enum { ENVOY_CORES_ANY, ENVOY_CORES_BIG, ENVOY_CORES_LITTLE } envoy_core_class_t;
+
+/**
+ * The phase an open HTTP stream is in.
+ * ENVOY_STREAM_SENDING_REQUEST until the request has been ended and sent.
+ * ENVOY_STREAM_AWAITING_RESPONSE once the request is sent, until response headers arrive.
+ * ENVOY_STREAM_RECEIVING_RESPONSE once response headers have arrived.
+ */
+typedef enum {
+  ENVOY_STREAM_SENDING_REQUEST,
+  ENVOY_STREAM_AWAITING_RESPONSE,
+  ENVOY_STREAM_RECEIVING_RESPONSE
+} envoy_stream_state_t;
+
+/**
+ * Progress of an open HTTP stream.
+ */
+typedef struct {
+  // Request body bytes passed on to be sent upstream.
+  uint64_t bytes_sent;
+  // Request body bytes the server is known to have received, i.e. all bytes sent once the response
+  // has started after the request ended, and none before.
+  uint64_t bytes_acknowledged;
+  // Response body bytes received.
+  uint64_t bytes_received;
+  envoy_stream_state_t state;
+} envoy_stream_progress;
+
 #ifdef __cplusplus
 extern "C" { // release function
 #endif
@@ -101,6 +141,22 @@ typedef struct {
   envoy_header* headers;
 } envoy_headers;
 
+/**
+ * Process-wide heap usage.
+ */
+typedef struct {
+  // Bytes in use by the application.
+  uint64_t allocated_bytes;
+  // Bytes reserved from the system, including unmapped pages.
+  uint64_t heap_bytes;
+  // Bytes reserved but not in use.
+  uint64_t free_bytes;
+  // Bytes released back to the system.
+  uint64_t unmapped_bytes;
+  // The fraction of resident heap which is not in use by the application.
+  double fragmentation;
+} envoy_heap_stats;
+
 #ifdef __cplusplus
 extern "C" { // utility functions
 #endif
@@ -60,7 +60,9 @@ public class EnvoyConfiguration {
     final StringBuilder filterConfigBuilder = new StringBuilder();
     for (EnvoyHTTPFilterFactory filterFactory : httpFilterFactories) {
       String filterConfig =
-          filterTemplateYAML.replace("{{ platform_filter_name }}", filterFactory.getFilterName());
+          filterTemplateYAML.replace("{{ platform_filter_name }}", filterFactory.getFilterName())
+              .replace("{{ max_pooled_instances }}",
+                       String.format("%s", filterFactory.getMaxPooledInstances()));
       filterConfigBuilder.append(filterConfig);
     }
     String filterConfigChain = filterConfigBuilder.toString();
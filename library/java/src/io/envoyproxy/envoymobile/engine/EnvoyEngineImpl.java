@@ -65,7 +65,7 @@ public class EnvoyEngineImpl implements EnvoyEngine {
   public int runWithConfig(EnvoyConfiguration envoyConfiguration, String logLevel,
                            EnvoyOnEngineRunning onEngineRunning) {
     for (EnvoyHTTPFilterFactory filterFactory : envoyConfiguration.httpFilterFactories) {
-      JniLibrary.registerFilterFactory(filterFactory.getFilterName(),
+      JniLibrary.registerFilterFactory(engineHandle, filterFactory.getFilterName(),
                                        new JvmFilterFactoryContext(filterFactory));
     }
 
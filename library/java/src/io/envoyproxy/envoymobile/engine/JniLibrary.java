@@ -112,13 +112,14 @@ class JniLibrary {
   protected static native int resetStream(long stream);
 
   /**
-   * Register a factory for creating platform filter instances for each HTTP stream.
+   * Register a factory for creating platform filter instances for each HTTP stream of an engine.
    *
-   * @param filterName, unique name identifying this filter in the chain.
+   * @param engine,     handle to the engine the filter runs in.
+   * @param filterName, unique name identifying this filter in the engine's chain.
    * @param context,    context containing logic necessary to invoke a new filter instance.
    * @return int, the resulting status of the operation.
    */
-  protected static native int registerFilterFactory(String filterName,
+  protected static native int registerFilterFactory(long engine, String filterName,
                                                     JvmFilterFactoryContext context);
 
   // Native entry point
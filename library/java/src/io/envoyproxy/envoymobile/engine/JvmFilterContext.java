@@ -18,6 +18,12 @@ class JvmFilterContext {
     this.filter = filter;
   }
 
+  /**
+   * Prepares this context, and its filter, for reuse by a later stream. Only called for filters
+   * whose factory pools them, @see EnvoyHTTPFilterFactory.getMaxPooledInstances.
+   */
+  public void reset() { filter.reset(); }
+
   /**
    * Delegates header retrieval to the bridge utility.
    *
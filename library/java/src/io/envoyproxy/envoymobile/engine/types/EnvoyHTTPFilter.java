@@ -53,4 +53,10 @@ public interface EnvoyHTTPFilter {
    * @param trailers, the trailers received.
    */
   Object[] onResponseTrailers(Map<String, List<String>> trailers);
+
+  /**
+   * Called once a stream is done with the filter, before it is reused by a later stream. Only
+   * called if the filter's factory pools filters, @see EnvoyHTTPFilterFactory.
+   */
+  void reset();
 }
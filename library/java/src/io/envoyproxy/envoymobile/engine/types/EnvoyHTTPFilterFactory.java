@@ -4,5 +4,14 @@ public interface EnvoyHTTPFilterFactory {
 
   String getFilterName();
 
+  /**
+   * The number of idle filters to keep for reuse by later streams, rather than creating a filter
+   * for each stream. Filters are only pooled if this is above 0, in which case their reset() must
+   * clear any state they keep for a stream.
+   *
+   * @return int, the maximum number of idle filters to keep.
+   */
+  int getMaxPooledInstances();
+
   EnvoyHTTPFilter create();
 }
@@ -1,5 +1,7 @@
 package io.envoyproxy.envoymobile.engine
 
+import io.envoyproxy.envoymobile.engine.types.EnvoyHTTPFilter
+import io.envoyproxy.envoymobile.engine.types.EnvoyHTTPFilterFactory
 import org.assertj.core.api.Assertions.assertThat
 import org.junit.Test
 
@@ -25,6 +27,7 @@ mock_template:
 private const val FILTER_CONFIG =
   """
     - platform_filter_name: {{ platform_filter_name }}
+      max_pooled_instances: {{ max_pooled_instances }}
 """
 
 class EnvoyConfigurationTest {
@@ -46,6 +49,20 @@ class EnvoyConfigurationTest {
     assertThat(resolvedTemplate).contains("virtual_clusters: [test]")
   }
 
+  @Test
+  fun `resolving with filters resolves their pooling`() {
+    val filterFactory = object : EnvoyHTTPFilterFactory {
+      override fun getFilterName(): String = "pooled_filter"
+      override fun getMaxPooledInstances(): Int = 4
+      override fun create(): EnvoyHTTPFilter = throw UnsupportedOperationException()
+    }
+    val envoyConfiguration = EnvoyConfiguration("stats.foo.com", 123, 234, 345, 456, listOf(filterFactory), 567, "v1.2.3", "com.mydomain.myapp", "[test]")
+
+    val resolvedTemplate = envoyConfiguration.resolveTemplate(TEST_CONFIG, FILTER_CONFIG)
+    assertThat(resolvedTemplate).contains("platform_filter_name: pooled_filter")
+    assertThat(resolvedTemplate).contains("max_pooled_instances: 4")
+  }
+
   @Test(expected = EnvoyConfiguration.ConfigurationException::class)
   fun `resolve templates with invalid templates will throw on build`() {
     val envoyConfiguration = EnvoyConfiguration("stats.foo.com", 123, 234, 345, 456, emptyList(), 567, "v1.2.3", "com.mydomain.myapp", "[test]")
@@ -119,6 +119,21 @@ open class EngineBuilder(
     return this
   }
 
+  /**
+   * Add an HTTP filter factory used to create filters for streams sent by this client, whose
+   * filters are reset and reused by later streams rather than created for each stream.
+   *
+   * @param maxPooledInstances the maximum number of idle filters to keep for reuse.
+   * @param factory closure returning an instantiated filter.
+   *
+   * @return this builder.
+   */
+  fun addFilter(maxPooledInstances: Int, factory: () -> ResettableFilter): EngineBuilder {
+    val filterName = UUID.randomUUID().toString()
+    this.filterChain.add(FilterFactory(filterName, factory, maxPooledInstances))
+    return this
+  }
+
   /**
    * Set a closure to be called when the engine finishes its async startup and begins running.
    *
@@ -12,12 +12,17 @@ interface Filter
 
 internal class FilterFactory(
   private val filterName: String,
-  private val factory: () -> Filter
+  private val factory: () -> Filter,
+  private val maxPooledInstances: Int = 0
 ) : EnvoyHTTPFilterFactory {
   override fun getFilterName(): String {
     return filterName
   }
 
+  override fun getMaxPooledInstances(): Int {
+    return maxPooledInstances
+  }
+
   override fun create(): EnvoyHTTPFilter { return EnvoyHTTPFilterAdapter(factory()) }
 }
 
@@ -95,4 +100,8 @@ internal class EnvoyHTTPFilterAdapter(
     }
     return arrayOf(0, trailers)
   }
+
+  override fun reset() {
+    (filter as? ResettableFilter)?.reset()
+  }
 }
@@ -0,0 +1,14 @@
+package io.envoyproxy.envoymobile
+
+/*
+ * Filter which can be reused by later streams once a stream is done with it, rather than a new
+ * filter being created for each stream. See `EngineBuilder.addFilter`.
+ */
+interface ResettableFilter : Filter {
+  /**
+   * Called once a stream is done with the filter, before it is reused by a later stream.
+   *
+   * Filters must clear any state they keep for a stream.
+   */
+  fun reset()
+}
@@ -39,6 +39,9 @@
     NSString *filterConfig =
         [filterTemplate stringByReplacingOccurrencesOfString:@"{{ platform_filter_name }}"
                                                   withString:filterFactory.filterName];
+    // iOS filters can't be reset for reuse, @see EnvoyEngineImpl.
+    filterConfig = [filterConfig stringByReplacingOccurrencesOfString:@"{{ max_pooled_instances }}"
+                                                           withString:@"0"];
     filterConfigChain = [filterConfigChain stringByAppendingString:filterConfig];
   }
 
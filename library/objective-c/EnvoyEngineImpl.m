@@ -240,7 +240,6 @@ static void ios_http_filter_release(const void *context) {
 
 - (int)registerFilterFactory:(EnvoyHTTPFilterFactory *)filterFactory {
   // TODO(goaway): Everything here leaks, but it's all be tied to the life of the engine.
-  // This will need to be updated for https://github.com/lyft/envoy-mobile/issues/332
   envoy_http_filter *api = safe_malloc(sizeof(envoy_http_filter));
   api->init_filter = ios_http_filter_init;
   api->on_request_headers = ios_http_filter_on_request_headers;
@@ -254,10 +253,13 @@ static void ios_http_filter_release(const void *context) {
   api->set_response_callbacks = ios_http_filter_set_response_callbacks;
   api->on_resume_response = ios_http_filter_on_resume_response;
   api->release_filter = ios_http_filter_release;
+  // iOS filter instances are the platform filters themselves, which can't be reset for reuse, so
+  // they aren't pooled.
+  api->reset_filter = NULL;
   api->static_context = CFBridgingRetain(filterFactory);
   api->instance_context = NULL;
 
-  register_platform_api(filterFactory.filterName.UTF8String, api);
+  register_engine_platform_api(_engineHandle, filterFactory.filterName.UTF8String, api);
   return kEnvoySuccess;
 }
 
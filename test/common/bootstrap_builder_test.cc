@@ -0,0 +1,139 @@
+#include "envoy/common/platform.h"
+
+#include "test/test_common/utility.h"
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_replace.h"
+#include "gtest/gtest.h"
+#include "library/common/bootstrap_builder.h"
+#include "library/common/config_builder_internal.h"
+#include "library/common/main_interface.h"
+
+namespace Envoy {
+
+// Renders config_template the way the platform configuration classes do.
+envoy::config::bootstrap::v3::Bootstrap
+renderTemplate(const std::vector<std::pair<std::string, uint32_t>>& platform_filters,
+               const std::string& virtual_clusters) {
+  std::string filter_chain;
+  for (const auto& platform_filter : platform_filters) {
+    filter_chain += absl::StrReplaceAll(
+        platform_filter_template,
+        {{"{{ platform_filter_name }}", platform_filter.first},
+         {"{{ max_pooled_instances }}", absl::StrCat(platform_filter.second)}});
+  }
+  const std::string yaml = absl::StrReplaceAll(
+      config_template, {{"{{ stats_domain }}", "stats.example.com"},
+                        {"{{ platform_filter_chain }}", filter_chain},
+                        {"{{ connect_timeout_seconds }}", "15"},
+                        {"{{ dns_refresh_rate_seconds }}", "120"},
+                        {"{{ dns_failure_refresh_rate_seconds_base }}", "3"},
+                        {"{{ dns_failure_refresh_rate_seconds_max }}", "30"},
+                        {"{{ stats_flush_interval_seconds }}", "45"},
+                        {"{{ device_os }}", "probably-ios"},
+                        {"{{ app_version }}", "1.2.3"},
+                        {"{{ app_id }}", "com.example.app"},
+                        {"{{ virtual_clusters }}", virtual_clusters}});
+  envoy::config::bootstrap::v3::Bootstrap bootstrap;
+  TestUtility::loadFromYaml(yaml, bootstrap);
+  return bootstrap;
+}
+
+BootstrapBuilder configuredBuilder() {
+  BootstrapBuilder builder;
+  builder.setStatsDomain("stats.example.com")
+      .setConnectTimeoutSeconds(15)
+      .setDnsRefreshSeconds(120)
+      .setDnsFailureRefreshSeconds(3, 30)
+      .setStatsFlushSeconds(45)
+      .setDeviceOs("probably-ios")
+      .setAppVersion("1.2.3")
+      .setAppId("com.example.app");
+  return builder;
+}
+
+TEST(BootstrapBuilderTest, MatchesTemplate) {
+  BootstrapPtr bootstrap = configuredBuilder().build();
+  EXPECT_TRUE(TestUtility::protoEqual(renderTemplate({}, "[]"), *bootstrap));
+}
+
+TEST(BootstrapBuilderTest, MatchesTemplateWithPlatformFilters) {
+  BootstrapBuilder builder = configuredBuilder();
+  builder.addPlatformFilter("first").addPlatformFilter("second", 4);
+  BootstrapPtr bootstrap = builder.build();
+  EXPECT_TRUE(
+      TestUtility::protoEqual(renderTemplate({{"first", 0}, {"second", 4}}, "[]"), *bootstrap));
+}
+
+TEST(BootstrapBuilderTest, MatchesTemplateWithVirtualClusters) {
+  envoy_config_builder* c_builder = envoy_config_builder_new();
+  c_builder->builder_ = configuredBuilder();
+  envoy_config_builder_add_virtual_cluster(c_builder, "users", "/users/[0-9]+", nullptr);
+  envoy_config_builder_add_virtual_cluster(c_builder, "create", "/users", "POST");
+  BootstrapPtr bootstrap = c_builder->builder_.build();
+  envoy_config_builder_free(c_builder);
+
+  const std::string virtual_clusters =
+      R"([{name: users, headers: [{name: ":path", safe_regex_match: {google_re2: {}, )"
+      R"(regex: "/users/[0-9]+"}}]}, {name: create, headers: [{name: ":path", )"
+      R"(safe_regex_match: {google_re2: {}, regex: "/users"}}, {name: ":method", )"
+      R"(exact_match: POST}]}])";
+  EXPECT_TRUE(TestUtility::protoEqual(renderTemplate({}, virtual_clusters), *bootstrap));
+}
+
+TEST(BootstrapBuilderTest, SocketProfiles) {
+  envoy_config_builder* c_builder = envoy_config_builder_new();
+  envoy_socket_profile profile{};
+  profile.send_buffer_bytes = 256 * 1024;
+  profile.receive_buffer_bytes = 512 * 1024;
+  EXPECT_EQ(ENVOY_SUCCESS, envoy_config_builder_set_socket_profile(c_builder, ENVOY_NET_WWAN,
+                                                                   &profile));
+  // Networks the platform passes as integers are validated.
+  EXPECT_EQ(ENVOY_FAILURE, envoy_config_builder_set_socket_profile(
+                               c_builder, static_cast<envoy_network_t>(3), &profile));
+  BootstrapPtr bootstrap = c_builder->builder_.build();
+  envoy_config_builder_free(c_builder);
+
+  // The profile applies to the clusters used while the network is preferred, and only to them.
+  int profiled_clusters = 0;
+  for (const auto& cluster : bootstrap->static_resources().clusters()) {
+    if (!absl::StartsWith(cluster.name(), "base_wwan")) {
+      EXPECT_FALSE(cluster.has_upstream_bind_config()) << cluster.name();
+      continue;
+    }
+    profiled_clusters++;
+    const auto& bind_config = cluster.upstream_bind_config();
+    EXPECT_EQ("0.0.0.0", bind_config.source_address().address());
+    EXPECT_EQ(0, bind_config.source_address().port_value());
+    ASSERT_EQ(2, bind_config.socket_options_size());
+    EXPECT_EQ(SOL_SOCKET, bind_config.socket_options(0).level());
+    EXPECT_EQ(SO_SNDBUF, bind_config.socket_options(0).name());
+    EXPECT_EQ(256 * 1024, bind_config.socket_options(0).int_value());
+    EXPECT_EQ(SO_RCVBUF, bind_config.socket_options(1).name());
+    EXPECT_EQ(512 * 1024, bind_config.socket_options(1).int_value());
+  }
+  EXPECT_EQ(4, profiled_clusters);
+
+  // An empty profile leaves the configuration unchanged.
+  BootstrapBuilder builder;
+  EXPECT_EQ(ENVOY_SUCCESS, builder.setSocketProfile(ENVOY_NET_WLAN, SocketProfile()));
+  EXPECT_TRUE(TestUtility::protoEqual(*BootstrapBuilder().build(), *builder.build()));
+}
+
+TEST(BootstrapBuilderTest, DefaultsMatchPlatformBuilders) {
+  BootstrapPtr bootstrap = BootstrapBuilder().build();
+  EXPECT_EQ(30, bootstrap->static_resources().clusters(0).connect_timeout().seconds());
+  EXPECT_EQ("0.0.0.0", bootstrap->static_resources()
+                           .clusters(12)
+                           .load_assignment()
+                           .endpoints(0)
+                           .lb_endpoints(0)
+                           .endpoint()
+                           .address()
+                           .socket_address()
+                           .address());
+  EXPECT_EQ(60, bootstrap->stats_flush_interval().seconds());
+}
+
+} // namespace Envoy
@@ -0,0 +1,129 @@
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "common/buffer/buffer_impl.h"
+
+#include "test/test_common/environment.h"
+
+#include "gtest/gtest.h"
+#include "library/common/buffer/spilling_replay_buffer.h"
+
+namespace Envoy {
+namespace Buffer {
+
+// Runs the spill file's I/O as soon as it is queued.
+void runInline(std::function<void()> work) { work(); }
+
+std::string readToString(const SpillingReplayBuffer& buffer, uint64_t chunk_size,
+                         uint32_t* chunks = nullptr) {
+  std::string contents;
+  uint32_t count = 0;
+  while (contents.size() < buffer.length()) {
+    InstancePtr chunk;
+    buffer.read(contents.size(), chunk_size,
+                [&chunk](InstancePtr read) { chunk = std::move(read); });
+    EXPECT_NE(nullptr, chunk);
+    if (chunk == nullptr) {
+      break;
+    }
+    EXPECT_LE(chunk->length(), chunk_size);
+    contents += chunk->toString();
+    count++;
+  }
+  if (chunks != nullptr) {
+    *chunks = count;
+  }
+  return contents;
+}
+
+TEST(SpillingReplayBufferTest, Empty) {
+  SpillingReplayBuffer buffer(16, TestEnvironment::temporaryDirectory(), runInline);
+  EXPECT_EQ(0, buffer.length());
+  EXPECT_FALSE(buffer.spilled());
+  EXPECT_TRUE(buffer.complete());
+}
+
+TEST(SpillingReplayBufferTest, WithinMemoryLimit) {
+  SpillingReplayBuffer buffer(16, TestEnvironment::temporaryDirectory(),
+                              [](std::function<void()>) { FAIL() << "unexpected file I/O"; });
+  OwnedImpl data("0123456789");
+  EXPECT_TRUE(buffer.add(data));
+  // The data added is left as it was.
+  EXPECT_EQ("0123456789", data.toString());
+  EXPECT_EQ(10, buffer.length());
+  EXPECT_FALSE(buffer.spilled());
+  EXPECT_TRUE(buffer.complete());
+  EXPECT_EQ("0123456789", readToString(buffer, 64));
+  InstancePtr chunk;
+  buffer.read(2, 4, [&chunk](InstancePtr read) { chunk = std::move(read); });
+  ASSERT_NE(nullptr, chunk);
+  EXPECT_EQ("2345", chunk->toString());
+}
+
+TEST(SpillingReplayBufferTest, SpillsBeyondMemoryLimit) {
+  SpillingReplayBuffer buffer(5, TestEnvironment::temporaryDirectory(), runInline);
+  std::string expected;
+  for (int i = 0; i < 100; i++) {
+    const std::string fragment = std::to_string(i) + ",";
+    OwnedImpl data(fragment);
+    EXPECT_TRUE(buffer.add(data));
+    expected += fragment;
+  }
+  EXPECT_TRUE(buffer.spilled());
+  EXPECT_TRUE(buffer.complete());
+  EXPECT_EQ(expected.size(), buffer.length());
+
+  // Chunks are read from memory and from the spill file separately, and the buffer can be read
+  // back repeatedly.
+  uint32_t chunks;
+  EXPECT_EQ(expected, readToString(buffer, 7, &chunks));
+  EXPECT_EQ(1 + (expected.size() - 5 + 6) / 7, chunks);
+  EXPECT_EQ(expected, readToString(buffer, 1024, &chunks));
+  EXPECT_EQ(2, chunks);
+}
+
+TEST(SpillingReplayBufferTest, SpillsOnExecutor) {
+  std::vector<std::function<void()>> queued;
+  SpillingReplayBuffer buffer(4, TestEnvironment::temporaryDirectory(),
+                              [&queued](std::function<void()> work) { queued.push_back(work); });
+  OwnedImpl data("0123456789");
+  EXPECT_TRUE(buffer.add(data));
+  EXPECT_EQ(10, buffer.length());
+  EXPECT_TRUE(buffer.spilled());
+  ASSERT_EQ(1, queued.size());
+
+  // Chunks in memory are read back immediately; spilled chunks once the executor has run the
+  // write, and then the read.
+  InstancePtr chunk;
+  buffer.read(0, 64, [&chunk](InstancePtr read) { chunk = std::move(read); });
+  ASSERT_NE(nullptr, chunk);
+  EXPECT_EQ("0123", chunk->toString());
+  chunk.reset();
+  buffer.read(4, 64, [&chunk](InstancePtr read) { chunk = std::move(read); });
+  EXPECT_EQ(nullptr, chunk);
+  ASSERT_EQ(2, queued.size());
+  for (const auto& work : queued) {
+    work();
+  }
+  ASSERT_NE(nullptr, chunk);
+  EXPECT_EQ("456789", chunk->toString());
+}
+
+TEST(SpillingReplayBufferTest, SpillFailure) {
+  SpillingReplayBuffer buffer(4, "/nonexistent/directory", runInline);
+  OwnedImpl data("0123456789");
+  // The failure is only seen once the write has run.
+  EXPECT_TRUE(buffer.add(data));
+  EXPECT_FALSE(buffer.complete());
+  EXPECT_FALSE(buffer.add(data));
+  bool called = false;
+  buffer.read(4, 64, [&called](InstancePtr read) {
+    EXPECT_EQ(nullptr, read);
+    called = true;
+  });
+  EXPECT_TRUE(called);
+}
+
+} // namespace Buffer
+} // namespace Envoy
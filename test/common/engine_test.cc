@@ -1,32 +1,169 @@
+#if defined(__linux__)
+#include <sys/prctl.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "test/test_common/utility.h"
+
 #include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
 #include "gtest/gtest.h"
+#include "library/common/bootstrap_builder.h"
 #include "library/common/engine.h"
 #include "library/common/main_interface.h"
 
 namespace Envoy {
 
-class EngineTest : public testing::Test {};
+namespace {
+
+const std::string config =
+    "{\"admin\":{},\"static_resources\":{\"listeners\":[{\"name\":\"base_api_listener\","
+    "\"address\":{\"socket_address\":{\"protocol\":\"TCP\",\"address\":\"0.0.0.0\",\"port_"
+    "value\":10000}},\"api_listener\":{\"api_listener\":{\"@type\":\"type.googleapis.com/"
+    "envoy.extensions.filters.network.http_connection_manager.v3.HttpConnectionManager\",\"stat_"
+    "prefix\":\"hcm\",\"route_config\":{\"name\":\"api_router\",\"virtual_hosts\":[{\"name\":"
+    "\"api\",\"include_attempt_count_in_response\":true,\"domains\":[\"*\"],\"routes\":[{"
+    "\"match\":{\"prefix\":\"/"
+    "\"},\"route\":{\"cluster_header\":\"x-envoy-mobile-cluster\",\"retry_policy\":{\"retry_back_"
+    "off\":{\"base_interval\":\"0.25s\",\"max_interval\":\"60s\"}}}}]}]},\"http_filters\":[{"
+    "\"name\":\"envoy.router\",\"typed_config\":{\"@type\":\"type.googleapis.com/"
+    "envoy.extensions.filters.http.router.v3.Router\"}}]}}}]},\"layered_runtime\":{\"layers\":[{"
+    "\"name\":\"static_layer_0\",\"static_layer\":{\"overload\":{\"global_downstream_max_"
+    "connections\":50000}}},{\"name\":\"admin_layer_0\",\"admin_layer\":{}}]}}";
+
+// Routes to dynamic forward proxy clusters, of which base_h2 coalesces requests.
+const std::string clusters_config = R"EOF(
+static_resources:
+  listeners:
+  - name: base_api_listener
+    address:
+      socket_address:
+        protocol: TCP
+        address: 0.0.0.0
+        port_value: 10000
+    api_listener:
+      api_listener:
+        "@type": type.googleapis.com/envoy.extensions.filters.network.http_connection_manager.v3.HttpConnectionManager
+        stat_prefix: hcm
+        route_config:
+          name: api_router
+          virtual_hosts:
+          - name: api
+            domains: ["*"]
+            routes:
+            - match: {prefix: "/"}
+              route: {cluster_header: x-envoy-mobile-cluster}
+        http_filters:
+        - name: envoy.router
+          typed_config:
+            "@type": type.googleapis.com/envoy.extensions.filters.http.router.v3.Router
+  clusters:
+  - name: base
+    connect_timeout: 30s
+    lb_policy: CLUSTER_PROVIDED
+    cluster_type:
+      name: envoy.clusters.dynamic_forward_proxy
+      typed_config:
+        "@type": type.googleapis.com/envoy.extensions.clusters.dynamic_forward_proxy.v3.ClusterConfig
+        dns_cache_config: &dns_cache_config
+          name: dynamic_forward_proxy_cache_config
+          dns_lookup_family: V4_ONLY
+  - name: base_h2
+    connect_timeout: 30s
+    lb_policy: CLUSTER_PROVIDED
+    http2_protocol_options: {}
+    cluster_type:
+      name: envoy_mobile.clusters.coalescing
+      typed_config:
+        "@type": type.googleapis.com/envoymobile.extensions.clusters.coalescing.Coalescing
+        dynamic_forward_proxy:
+          dns_cache_config: *dns_cache_config
+layered_runtime:
+  layers:
+  - name: static_layer_0
+    static_layer:
+      overload:
+        global_downstream_max_connections: 50000
+  - name: admin_layer_0
+    admin_layer: {}
+)EOF";
+
+// Adds clusters named for each of the base clusters with a suffix to a configuration, e.g. base_h3,
+// base_wlan_h3 and base_wwan_h3 for "_h3".
+std::string withBaseClusterVariants(const std::string& suffix,
+                                    std::string config = clusters_config) {
+  std::string clusters;
+  for (const std::string base_cluster : {"base", "base_wlan", "base_wwan"}) {
+    clusters += "  - name: " + base_cluster + suffix + R"EOF(
+    connect_timeout: 30s
+    lb_policy: CLUSTER_PROVIDED
+    cluster_type:
+      name: envoy.clusters.dynamic_forward_proxy
+      typed_config:
+        "@type": type.googleapis.com/envoy.extensions.clusters.dynamic_forward_proxy.v3.ClusterConfig
+        dns_cache_config: *dns_cache_config
+)EOF";
+  }
+  config.insert(config.find("layered_runtime:"), clusters);
+  return config;
+}
+
+} // namespace
 
 typedef struct {
   absl::Notification on_engine_running;
   absl::Notification on_exit;
 } engine_test_context;
 
+class EngineTest : public testing::Test {
+public:
+  // Runs an engine in this process, whose server tests may inspect.
+  std::unique_ptr<Engine> startEngine(const std::string& yaml) {
+    auto engine =
+        std::make_unique<Engine>(engineCallbacks(), yaml.c_str(), "debug", preferred_network_);
+    EXPECT_TRUE(test_context_.on_engine_running.WaitForNotificationWithTimeout(absl::Seconds(3)));
+    return engine;
+  }
+
+  // Runs an engine with a configuration built in place of YAML.
+  std::unique_ptr<Engine> startEngine(BootstrapPtr bootstrap) {
+    auto engine = std::make_unique<Engine>(engineCallbacks(), std::move(bootstrap), "debug",
+                                           preferred_network_);
+    EXPECT_TRUE(test_context_.on_engine_running.WaitForNotificationWithTimeout(absl::Seconds(3)));
+    return engine;
+  }
+
+  envoy_engine_callbacks engineCallbacks() {
+    return {[](void* context) -> void {
+              static_cast<engine_test_context*>(context)->on_engine_running.Notify();
+            } /*on_engine_running*/,
+            [](void* context) -> void {
+              static_cast<engine_test_context*>(context)->on_exit.Notify();
+            } /*on_exit*/,
+            &test_context_ /*context*/};
+  }
+
+  // Runs a function on the engine's event loop, after any updates posted before it.
+  void runOnEngine(Engine& engine, std::function<void(Server::Instance&)> function) {
+    absl::Notification done;
+    engine.post([&]() -> void {
+      function(engine.server());
+      done.Notify();
+    });
+    ASSERT_TRUE(done.WaitForNotificationWithTimeout(absl::Seconds(3)));
+  }
+
+  engine_test_context test_context_{};
+  std::atomic<envoy_network_t> preferred_network_{ENVOY_NET_GENERIC};
+};
+
 TEST_F(EngineTest, EarlyExit) {
-  const std::string config =
-      "{\"admin\":{},\"static_resources\":{\"listeners\":[{\"name\":\"base_api_listener\","
-      "\"address\":{\"socket_address\":{\"protocol\":\"TCP\",\"address\":\"0.0.0.0\",\"port_"
-      "value\":10000}},\"api_listener\":{\"api_listener\":{\"@type\":\"type.googleapis.com/"
-      "envoy.extensions.filters.network.http_connection_manager.v3.HttpConnectionManager\",\"stat_"
-      "prefix\":\"hcm\",\"route_config\":{\"name\":\"api_router\",\"virtual_hosts\":[{\"name\":"
-      "\"api\",\"include_attempt_count_in_response\":true,\"domains\":[\"*\"],\"routes\":[{"
-      "\"match\":{\"prefix\":\"/"
-      "\"},\"route\":{\"cluster_header\":\"x-envoy-mobile-cluster\",\"retry_policy\":{\"retry_back_"
-      "off\":{\"base_interval\":\"0.25s\",\"max_interval\":\"60s\"}}}}]}]},\"http_filters\":[{"
-      "\"name\":\"envoy.router\",\"typed_config\":{\"@type\":\"type.googleapis.com/"
-      "envoy.extensions.filters.http.router.v3.Router\"}}]}}}]},\"layered_runtime\":{\"layers\":[{"
-      "\"name\":\"static_layer_0\",\"static_layer\":{\"overload\":{\"global_downstream_max_"
-      "connections\":50000}}}]}}";
+  const envoy_engine_t engine = init_engine();
   const std::string level = "debug";
 
   engine_test_context test_context{};
@@ -41,12 +178,206 @@ TEST_F(EngineTest, EarlyExit) {
                                    } /*on_exit*/,
                                    &test_context /*context*/};
 
-  run_engine(0, callbacks, config.c_str(), level.c_str());
+  run_engine(engine, callbacks, config.c_str(), level.c_str());
   ASSERT_TRUE(test_context.on_engine_running.WaitForNotificationWithTimeout(absl::Seconds(3)));
 
-  terminate_engine(0);
+  terminate_engine(engine);
   ASSERT_TRUE(test_context.on_exit.WaitForNotificationWithTimeout(absl::Seconds(3)));
 
   start_stream(0, {});
 }
+
+TEST_F(EngineTest, UpdateConfig) {
+  std::unique_ptr<Engine> engine = startEngine(clusters_config);
+  const Upstream::ThreadLocalCluster* base = nullptr;
+  const Upstream::ClusterInfo* base_info = nullptr;
+  const Upstream::ClusterInfo* base_h2_info = nullptr;
+  runOnEngine(*engine, [&](Server::Instance& server) -> void {
+    base = server.clusterManager().get("base");
+    base_info = base->info().get();
+    base_h2_info = server.clusterManager().get("base_h2")->info().get();
+    EXPECT_EQ(50000, server.runtime().snapshot().getInteger(
+                         "overload.global_downstream_max_connections", 0));
+  });
+
+  // Runtime and cluster changes are applied in place.
+  std::string update = clusters_config;
+  update.replace(update.find("50000"), 5, "1000");
+  update.replace(update.find("30s", update.find("- name: base_h2")), 3, "10s");
+  EXPECT_EQ(ENVOY_SUCCESS, engine->updateConfig(update));
+  runOnEngine(*engine, [&](Server::Instance& server) -> void {
+    EXPECT_EQ(1000, server.runtime().snapshot().getInteger(
+                        "overload.global_downstream_max_connections", 0));
+    // Only the changed cluster is replaced. The unchanged one keeps its thread local cluster,
+    // which holds its connection pools.
+    EXPECT_EQ(1, server.stats().counterFromString("cluster_manager.cluster_modified").value());
+    EXPECT_EQ(base, server.clusterManager().get("base"));
+    EXPECT_EQ(base_info, server.clusterManager().get("base")->info().get());
+    EXPECT_NE(base_h2_info, server.clusterManager().get("base_h2")->info().get());
+  });
+
+  // Runtime values which are no longer set are restored to the value they started with.
+  std::string runtime_removal = update;
+  runtime_removal.replace(runtime_removal.find("static_layer:"),
+                          runtime_removal.find("- name: admin_layer_0") -
+                              runtime_removal.find("static_layer:"),
+                          "static_layer: {}\n  ");
+  EXPECT_EQ(ENVOY_SUCCESS, engine->updateConfig(runtime_removal));
+  runOnEngine(*engine, [&](Server::Instance& server) -> void {
+    EXPECT_EQ(50000, server.runtime().snapshot().getInteger(
+                         "overload.global_downstream_max_connections", 0));
+    EXPECT_EQ(base, server.clusterManager().get("base"));
+  });
+
+  // Listener changes require a new engine.
+  std::string listener_update = update;
+  listener_update.replace(listener_update.find("stat_prefix: hcm"), 16, "stat_prefix: api");
+  EXPECT_EQ(ENVOY_FAILURE, engine->updateConfig(listener_update));
+
+  EXPECT_EQ(ENVOY_FAILURE, engine->updateConfig("not: [a, configuration"));
+
+  engine.reset();
+  ASSERT_TRUE(test_context_.on_exit.WaitForNotificationWithTimeout(absl::Seconds(3)));
+}
+
+TEST_F(EngineTest, UpdateCoalescingClusterInPlace) {
+  std::unique_ptr<Engine> engine = startEngine(clusters_config);
+
+  // Coalescing clusters are updated in place, like other dynamic forward proxy clusters.
+  std::string cluster_update = clusters_config;
+  const size_t base_h2 = cluster_update.find("- name: base_h2");
+  cluster_update.replace(cluster_update.find("30s", base_h2), 3, "10s");
+  EXPECT_EQ(ENVOY_SUCCESS, engine->updateConfig(cluster_update));
+  runOnEngine(*engine, [](Server::Instance& server) -> void {
+    EXPECT_EQ(std::chrono::milliseconds(10000),
+              server.clusterManager().get("base_h2")->info()->connectTimeout());
+    EXPECT_EQ(std::chrono::milliseconds(30000),
+              server.clusterManager().get("base")->info()->connectTimeout());
+  });
+
+  engine.reset();
+  ASSERT_TRUE(test_context_.on_exit.WaitForNotificationWithTimeout(absl::Seconds(3)));
+}
+
+TEST_F(EngineTest, UpdateConfigKeepsChangesWhichFailed) {
+  std::unique_ptr<Engine> engine = startEngine(clusters_config);
+
+  // base_h2 can't switch to a DNS cache of the same name with other settings while base still uses
+  // the original one, so only the change to base is applied.
+  std::string partial_update = clusters_config;
+  const size_t base_h2 = partial_update.find("- name: base_h2");
+  partial_update.replace(partial_update.find("30s", base_h2), 3, "10s");
+  partial_update.replace(
+      partial_update.find("*dns_cache_config", base_h2), 17,
+      "{name: dynamic_forward_proxy_cache_config, dns_lookup_family: V6_ONLY}");
+  partial_update.replace(partial_update.find("30s"), 3, "20s");
+  EXPECT_EQ(ENVOY_SUCCESS, engine->updateConfig(partial_update));
+  runOnEngine(*engine, [](Server::Instance& server) -> void {
+    EXPECT_EQ(std::chrono::milliseconds(20000),
+              server.clusterManager().get("base")->info()->connectTimeout());
+    EXPECT_EQ(std::chrono::milliseconds(30000),
+              server.clusterManager().get("base_h2")->info()->connectTimeout());
+    EXPECT_EQ(1, server.stats().counterFromString("cluster_manager.cluster_modified").value());
+  });
+
+  // Later updates are computed against what was applied, so base_h2 is left as it is.
+  std::string update = clusters_config;
+  update.replace(update.find("30s"), 3, "20s");
+  EXPECT_EQ(ENVOY_SUCCESS, engine->updateConfig(update));
+  runOnEngine(*engine, [](Server::Instance& server) -> void {
+    EXPECT_EQ(1, server.stats().counterFromString("cluster_manager.cluster_modified").value());
+  });
+
+  engine.reset();
+  ASSERT_TRUE(test_context_.on_exit.WaitForNotificationWithTimeout(absl::Seconds(3)));
+}
+
+TEST_F(EngineTest, EnableHttp3RequiresClusters) {
+  std::unique_ptr<Engine> engine = startEngine(clusters_config);
+  EXPECT_EQ(ENVOY_FAILURE, engine->enableHttp3Upstream(""));
+
+  // Once the configuration defines the clusters HTTP/3 requests are routed to, it can be enabled,
+  // and they can't be removed.
+  EXPECT_EQ(ENVOY_SUCCESS, engine->updateConfig(withBaseClusterVariants("_h3")));
+  EXPECT_EQ(ENVOY_SUCCESS, engine->enableHttp3Upstream(""));
+  EXPECT_EQ(ENVOY_FAILURE, engine->updateConfig(clusters_config));
+  runOnEngine(*engine, [](Server::Instance& server) -> void {
+    EXPECT_NE(nullptr, server.clusterManager().get("base_wwan_h3"));
+  });
+
+  engine.reset();
+  ASSERT_TRUE(test_context_.on_exit.WaitForNotificationWithTimeout(absl::Seconds(3)));
+}
+
+TEST_F(EngineTest, EnableEarlyDataRequiresClusters) {
+  std::unique_ptr<Engine> engine = startEngine(clusters_config);
+  EXPECT_EQ(ENVOY_FAILURE, engine->enableEarlyData());
+
+  const std::string early_data_config =
+      withBaseClusterVariants("_early_data", withBaseClusterVariants("_h2_early_data"));
+  EXPECT_EQ(ENVOY_SUCCESS, engine->updateConfig(early_data_config));
+  EXPECT_EQ(ENVOY_SUCCESS, engine->enableEarlyData());
+  EXPECT_EQ(ENVOY_FAILURE, engine->updateConfig(withBaseClusterVariants("_early_data")));
+
+  engine.reset();
+  ASSERT_TRUE(test_context_.on_exit.WaitForNotificationWithTimeout(absl::Seconds(3)));
+}
+
+#if defined(__linux__)
+TEST_F(EngineTest, IdleTimerSlackAppliesWhileIdle) {
+  std::unique_ptr<Engine> engine = startEngine(config);
+
+  // The engine has no open streams, so the slack is applied without waiting for it to become idle.
+  EXPECT_EQ(ENVOY_SUCCESS, engine->setIdleTimerSlack(std::chrono::milliseconds(250)));
+  runOnEngine(*engine, [](Server::Instance&) -> void {
+    EXPECT_EQ(250000000, ::prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0));
+  });
+
+  engine.reset();
+  ASSERT_TRUE(test_context_.on_exit.WaitForNotificationWithTimeout(absl::Seconds(3)));
+}
+#endif
+
+TEST_F(EngineTest, DeviceMemoryPressureTriggersOverloadActions) {
+  // The default configuration's overload manager, refreshed often so that the test needn't wait.
+  BootstrapPtr bootstrap = std::make_unique<envoy::config::bootstrap::v3::Bootstrap>();
+  TestUtility::loadFromYaml(clusters_config, *bootstrap);
+  *bootstrap->mutable_overload_manager() = BootstrapBuilder().build()->overload_manager();
+  *bootstrap->mutable_overload_manager()->mutable_refresh_interval() =
+      Protobuf::util::TimeUtil::MillisecondsToDuration(10);
+  std::unique_ptr<Engine> engine = startEngine(std::move(bootstrap));
+
+  const auto active = [&](const std::string& action) -> bool {
+    bool is_active = false;
+    runOnEngine(*engine, [&](Server::Instance& server) -> void {
+      is_active = server.stats()
+                      .gaugeFromString("overload.envoy.overload_actions." + action + ".active",
+                                       Stats::Gauge::ImportMode::NeverImport)
+                      .value() == 1;
+    });
+    return is_active;
+  };
+  const auto eventually = [](std::function<bool()> condition) -> bool {
+    for (int i = 0; i < 300 && !condition(); i++) {
+      absl::SleepFor(absl::Milliseconds(10));
+    }
+    return condition();
+  };
+
+  EXPECT_EQ(ENVOY_SUCCESS, set_device_memory_pressure(0.9));
+  EXPECT_TRUE(eventually([&]() -> bool { return active("shrink_heap"); }));
+  EXPECT_FALSE(active("stop_accepting_requests"));
+
+  EXPECT_EQ(ENVOY_SUCCESS, set_device_memory_pressure(1.0));
+  EXPECT_TRUE(eventually([&]() -> bool { return active("stop_accepting_requests"); }));
+
+  EXPECT_EQ(ENVOY_SUCCESS, set_device_memory_pressure(0));
+  EXPECT_TRUE(eventually([&]() -> bool {
+    return !active("shrink_heap") && !active("stop_accepting_requests");
+  }));
+
+  engine.reset();
+  ASSERT_TRUE(test_context_.on_exit.WaitForNotificationWithTimeout(absl::Seconds(3)));
+}
+
 } // namespace Envoy
@@ -0,0 +1,162 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/network/address_impl.h"
+#include "common/stats/isolated_store_impl.h"
+
+#include "test/mocks/upstream/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+#include "library/common/extensions/clusters/coalescing/load_balancer.h"
+#include "library/common/network/connection_coalescing.h"
+
+using testing::NiceMock;
+using testing::Return;
+
+namespace Envoy {
+namespace Extensions {
+namespace Clusters {
+namespace Coalescing {
+namespace {
+
+using MockHostSharedPtr = std::shared_ptr<NiceMock<Upstream::MockHost>>;
+
+class CoalescingLoadBalancerTest : public testing::Test {
+public:
+  CoalescingLoadBalancerTest() {
+    auto load_balancer = std::make_unique<NiceMock<Upstream::MockLoadBalancer>>();
+    inner_load_balancer_ = load_balancer.get();
+    load_balancer_ = std::make_unique<CoalescingLoadBalancer>(std::move(load_balancer),
+                                                              coalesced_);
+  }
+
+  ~CoalescingLoadBalancerTest() override {
+    for (Network::ConnectionCoalescing::ConnectionId id : connections_) {
+      Network::ConnectionCoalescing::remove(id);
+    }
+  }
+
+  // Each host holds an address instance of its own, as dynamic forward proxy hosts do.
+  MockHostSharedPtr host(const std::string& ip) {
+    auto host = std::make_shared<NiceMock<Upstream::MockHost>>();
+    Network::Address::InstanceConstSharedPtr address =
+        std::make_shared<Network::Address::Ipv4Instance>(ip, 443);
+    ON_CALL(*host, address()).WillByDefault(Return(address));
+    return host;
+  }
+
+  // Records an open connection of host's, whose certificate covers dns_names.
+  void connect(const MockHostSharedPtr& host, std::vector<std::string> dns_names) {
+    connections_.push_back(
+        Network::ConnectionCoalescing::add(host->address(), std::move(dns_names)));
+  }
+
+  // Chooses a host for a request to authority, which the dynamic forward proxy resolved to host.
+  Upstream::HostConstSharedPtr choose(const MockHostSharedPtr& host, const std::string& authority) {
+    Http::TestRequestHeaderMapImpl headers{{":authority", authority}};
+    NiceMock<Upstream::MockLoadBalancerContext> context;
+    ON_CALL(context, downstreamHeaders()).WillByDefault(Return(&headers));
+    EXPECT_CALL(*inner_load_balancer_, chooseHost(&context)).WillOnce(Return(host));
+    Upstream::HostConstSharedPtr chosen = load_balancer_->chooseHost(&context);
+    // Releases the expectation's reference to host.
+    testing::Mock::VerifyAndClearExpectations(inner_load_balancer_);
+    return chosen;
+  }
+
+  Stats::IsolatedStoreImpl store_;
+  Stats::Counter& coalesced_{store_.counterFromString("upstream_rq_coalesced")};
+  NiceMock<Upstream::MockLoadBalancer>* inner_load_balancer_;
+  std::unique_ptr<CoalescingLoadBalancer> load_balancer_;
+  std::vector<Network::ConnectionCoalescing::ConnectionId> connections_;
+};
+
+TEST_F(CoalescingLoadBalancerTest, CoalescesOntoCoveringConnection) {
+  MockHostSharedPtr api = host("192.0.2.1");
+  MockHostSharedPtr img = host("192.0.2.1");
+  EXPECT_EQ(api, choose(api, "api.example.com"));
+  connect(api, {"api.example.com", "*.example.com"});
+
+  EXPECT_EQ(api, choose(img, "img.example.com:443"));
+  EXPECT_EQ(api, choose(img, "img.example.com"));
+  EXPECT_EQ(2, coalesced_.value());
+}
+
+TEST_F(CoalescingLoadBalancerTest, OnlyCoalescesOntoOpenConnections) {
+  MockHostSharedPtr api = host("192.0.2.1");
+  MockHostSharedPtr img = host("192.0.2.1");
+  EXPECT_EQ(api, choose(api, "api.example.com"));
+
+  // The other host has no open connection yet, so there is nothing to coalesce onto.
+  EXPECT_EQ(img, choose(img, "img.example.com"));
+  EXPECT_EQ(0, coalesced_.value());
+}
+
+TEST_F(CoalescingLoadBalancerTest, OnlyCoalescesOntoConnectionsCoveringTheName) {
+  MockHostSharedPtr api = host("192.0.2.1");
+  MockHostSharedPtr cdn = host("192.0.2.1");
+  MockHostSharedPtr img_com = host("192.0.2.1");
+  MockHostSharedPtr img_org = host("192.0.2.1");
+  EXPECT_EQ(api, choose(api, "api.example.com"));
+  connect(api, {"*.example.com"});
+  EXPECT_EQ(cdn, choose(cdn, "cdn.example.org"));
+  connect(cdn, {"*.example.org"});
+
+  // Each request goes to the host whose own connection's certificate covers its name, even
+  // though all connections are to the same IP address.
+  EXPECT_EQ(cdn, choose(img_org, "img.example.org"));
+  EXPECT_EQ(api, choose(img_com, "img.example.com"));
+  EXPECT_EQ(2, coalesced_.value());
+
+  // Names neither certificate covers use their own host.
+  MockHostSharedPtr other = host("192.0.2.1");
+  EXPECT_EQ(other, choose(other, "example.net"));
+}
+
+TEST_F(CoalescingLoadBalancerTest, DoesNotCoalesceAcrossAddresses) {
+  MockHostSharedPtr api = host("192.0.2.1");
+  MockHostSharedPtr img = host("192.0.2.2");
+  EXPECT_EQ(api, choose(api, "api.example.com"));
+  connect(api, {"*.example.com"});
+
+  EXPECT_EQ(img, choose(img, "img.example.com"));
+  EXPECT_EQ(0, coalesced_.value());
+}
+
+TEST_F(CoalescingLoadBalancerTest, PrefersOwnConnections) {
+  MockHostSharedPtr api = host("192.0.2.1");
+  MockHostSharedPtr img = host("192.0.2.1");
+  EXPECT_EQ(api, choose(api, "api.example.com"));
+  connect(api, {"*.example.com"});
+  connect(img, {"img.example.com"});
+
+  EXPECT_EQ(img, choose(img, "img.example.com"));
+  EXPECT_EQ(0, coalesced_.value());
+}
+
+TEST_F(CoalescingLoadBalancerTest, ForgetsRemovedHosts) {
+  // Hosts removed from the cluster aren't coalesced onto, and their addresses are forgotten.
+  for (int i = 0; i < 100; i++) {
+    MockHostSharedPtr removed = host(absl::StrCat("192.0.2.", i));
+    EXPECT_EQ(removed, choose(removed, "api.example.com"));
+  }
+  EXPECT_LE(load_balancer_->rememberedAddresses(), 64);
+
+  MockHostSharedPtr img = host("192.0.2.1");
+  EXPECT_EQ(img, choose(img, "img.example.com"));
+  EXPECT_EQ(0, coalesced_.value());
+}
+
+TEST_F(CoalescingLoadBalancerTest, NoHost) {
+  NiceMock<Upstream::MockLoadBalancerContext> context;
+  EXPECT_CALL(*inner_load_balancer_, chooseHost(&context)).WillOnce(Return(nullptr));
+  EXPECT_EQ(nullptr, load_balancer_->chooseHost(&context));
+}
+
+} // namespace
+} // namespace Coalescing
+} // namespace Clusters
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,134 @@
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/http/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "gtest/gtest.h"
+#include "library/common/extensions/filters/http/mock_response/filter.h"
+#include "library/common/extensions/filters/http/mock_response/filter.pb.h"
+
+using testing::_;
+using testing::InSequence;
+using testing::Invoke;
+
+namespace Envoy {
+namespace Extensions {
+namespace HttpFilters {
+namespace MockResponse {
+namespace {
+
+class MockResponseFilterTest : public testing::Test {
+public:
+  void setUpFilter(std::string&& yaml) {
+    envoymobile::extensions::filters::http::mock_response::MockResponse config;
+    TestUtility::loadFromYaml(yaml, config);
+    config_ = std::make_shared<MockResponseFilterConfig>(config);
+    filter_ = std::make_unique<MockResponseFilter>(config_);
+    filter_->setDecoderFilterCallbacks(decoder_callbacks_);
+  }
+
+  MockResponseFilterConfigSharedPtr config_{};
+  std::unique_ptr<MockResponseFilter> filter_{};
+  NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder_callbacks_;
+};
+
+TEST_F(MockResponseFilterTest, HeadersOnly) {
+  setUpFilter("{}");
+
+  EXPECT_CALL(decoder_callbacks_, encodeHeaders_(_, true))
+      .WillOnce(Invoke([](Http::ResponseHeaderMap& headers, bool) -> void {
+        EXPECT_EQ("200", headers.getStatusValue());
+        EXPECT_FALSE(headers.get(Http::Headers::get().EnvoyUpstreamServiceTime).empty());
+      }));
+  EXPECT_CALL(decoder_callbacks_, encodeData(_, _)).Times(0);
+  Http::TestRequestHeaderMapImpl request_headers{{":method", "GET"}};
+  EXPECT_EQ(Http::FilterHeadersStatus::StopIteration,
+            filter_->decodeHeaders(request_headers, true));
+}
+
+TEST_F(MockResponseFilterTest, RespondsOnceRequestEnds) {
+  setUpFilter(R"EOF(
+status: 503
+headers:
+- key: x-mock
+  value: value
+body_bytes: 10
+)EOF");
+
+  Http::TestRequestHeaderMapImpl request_headers{{":method", "POST"}};
+  EXPECT_CALL(decoder_callbacks_, encodeHeaders_(_, _)).Times(0);
+  EXPECT_EQ(Http::FilterHeadersStatus::StopIteration,
+            filter_->decodeHeaders(request_headers, false));
+  Buffer::OwnedImpl request_data("request");
+  EXPECT_EQ(Http::FilterDataStatus::StopIterationNoBuffer,
+            filter_->decodeData(request_data, false));
+
+  InSequence s;
+  EXPECT_CALL(decoder_callbacks_, encodeHeaders_(_, false))
+      .WillOnce(Invoke([](Http::ResponseHeaderMap& headers, bool) -> void {
+        EXPECT_EQ("503", headers.getStatusValue());
+        const auto mock_header = headers.get(Http::LowerCaseString("x-mock"));
+        ASSERT_EQ(1, mock_header.size());
+        EXPECT_EQ("value", mock_header[0]->value().getStringView());
+      }));
+  EXPECT_CALL(decoder_callbacks_, encodeData(BufferStringEqual("xxxxxxxxxx"), true));
+  Http::TestRequestTrailerMapImpl request_trailers;
+  EXPECT_EQ(Http::FilterTrailersStatus::StopIteration, filter_->decodeTrailers(request_trailers));
+}
+
+TEST_F(MockResponseFilterTest, ChunksAndTrailers) {
+  setUpFilter(R"EOF(
+body_bytes: 10
+chunk_bytes: 4
+trailers:
+- key: x-trailer
+  value: value
+)EOF");
+
+  InSequence s;
+  EXPECT_CALL(decoder_callbacks_, encodeHeaders_(_, false));
+  EXPECT_CALL(decoder_callbacks_, encodeData(BufferStringEqual("xxxx"), false));
+  EXPECT_CALL(decoder_callbacks_, encodeData(BufferStringEqual("xxxx"), false));
+  EXPECT_CALL(decoder_callbacks_, encodeData(BufferStringEqual("xx"), false));
+  EXPECT_CALL(decoder_callbacks_, encodeTrailers_(_))
+      .WillOnce(Invoke([](Http::ResponseTrailerMap& trailers) -> void {
+        const auto trailer = trailers.get(Http::LowerCaseString("x-trailer"));
+        ASSERT_EQ(1, trailer.size());
+        EXPECT_EQ("value", trailer[0]->value().getStringView());
+      }));
+  Http::TestRequestHeaderMapImpl request_headers{{":method", "GET"}};
+  filter_->decodeHeaders(request_headers, true);
+}
+
+TEST_F(MockResponseFilterTest, Delay) {
+  setUpFilter(R"EOF(
+delay: 0.5s
+)EOF");
+
+  auto* timer = new NiceMock<Event::MockTimer>(&decoder_callbacks_.dispatcher_);
+  EXPECT_CALL(*timer, enableTimer(std::chrono::milliseconds(500), _));
+  EXPECT_CALL(decoder_callbacks_, encodeHeaders_(_, _)).Times(0);
+  Http::TestRequestHeaderMapImpl request_headers{{":method", "GET"}};
+  filter_->decodeHeaders(request_headers, true);
+
+  EXPECT_CALL(decoder_callbacks_, encodeHeaders_(_, true));
+  timer->invokeCallback();
+}
+
+TEST_F(MockResponseFilterTest, DestroyedWhileDelayed) {
+  setUpFilter(R"EOF(
+delay: 0.5s
+)EOF");
+
+  auto* timer = new NiceMock<Event::MockTimer>(&decoder_callbacks_.dispatcher_);
+  Http::TestRequestHeaderMapImpl request_headers{{":method", "GET"}};
+  filter_->decodeHeaders(request_headers, true);
+
+  EXPECT_CALL(*timer, disableTimer());
+  filter_->onDestroy();
+}
+
+} // namespace
+} // namespace MockResponse
+} // namespace HttpFilters
+} // namespace Extensions
+} // namespace Envoy
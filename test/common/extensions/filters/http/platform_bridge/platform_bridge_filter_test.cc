@@ -53,6 +53,7 @@ public:
 
     config_ = std::make_shared<PlatformBridgeFilterConfig>(config);
     filter_ = std::make_shared<PlatformBridgeFilter>(config_, dispatcher_);
+    filter_->init();
     filter_->setDecoderFilterCallbacks(decoder_callbacks_);
     filter_->setEncoderFilterCallbacks(encoder_callbacks_);
   }
@@ -70,6 +71,7 @@ public:
     unsigned int set_response_callbacks_calls;
     unsigned int on_resume_response_calls;
     unsigned int release_filter_calls;
+    unsigned int reset_filter_calls;
   } filter_invocations;
 
   PlatformBridgeFilterConfigSharedPtr config_;
@@ -1691,6 +1693,112 @@ platform_filter_name: StopOnResponseHeadersThenBufferThenResumeOnResumeEncoding
       "yes");
 }
 
+std::vector<envoy_http_filter_callbacks> retained_callbacks;
+
+TEST_F(PlatformBridgeFilterTest, PooledInstancesAreReusedAcrossStreams) {
+  envoy_http_filter platform_filter{};
+  filter_invocations invocations{};
+  platform_filter.static_context = &invocations;
+  platform_filter.init_filter = [](const void* context) -> const void* {
+    filter_invocations* invocations = static_cast<filter_invocations*>(const_cast<void*>(context));
+    invocations->init_filter_calls++;
+    return context;
+  };
+  platform_filter.set_request_callbacks = [](envoy_http_filter_callbacks callbacks,
+                                             const void* context) -> void {
+    filter_invocations* invocations = static_cast<filter_invocations*>(const_cast<void*>(context));
+    invocations->set_request_callbacks_calls++;
+    // Callbacks are retained until the end of the test, as they would be by the instance.
+    retained_callbacks.push_back(callbacks);
+  };
+  platform_filter.reset_filter = [](const void* context) -> void {
+    filter_invocations* invocations = static_cast<filter_invocations*>(const_cast<void*>(context));
+    invocations->reset_filter_calls++;
+  };
+  platform_filter.release_filter = [](const void* context) -> void {
+    filter_invocations* invocations = static_cast<filter_invocations*>(const_cast<void*>(context));
+    invocations->release_filter_calls++;
+  };
+
+  setUpFilter(R"EOF(
+platform_filter_name: PooledInstancesAreReusedAcrossStreams
+max_pooled_instances: 1
+)EOF",
+              &platform_filter);
+  EXPECT_EQ(invocations.init_filter_calls, 1);
+  EXPECT_EQ(invocations.set_request_callbacks_calls, 1);
+
+  // The instance's callbacks resume the filter which created it.
+  EXPECT_CALL(dispatcher_, post(_));
+  retained_callbacks[0].resume_iteration(retained_callbacks[0].callback_context);
+  testing::Mock::VerifyAndClearExpectations(&dispatcher_);
+
+  // A second, concurrent stream requires a new instance.
+  auto concurrent_filter = std::make_shared<PlatformBridgeFilter>(config_, dispatcher_);
+  concurrent_filter->init();
+  EXPECT_EQ(invocations.init_filter_calls, 2);
+
+  // The first instance to finish is pooled, the second is released as the pool is full.
+  filter_->onDestroy();
+  EXPECT_EQ(invocations.reset_filter_calls, 1);
+  EXPECT_EQ(invocations.release_filter_calls, 0);
+  concurrent_filter->onDestroy();
+  EXPECT_EQ(invocations.reset_filter_calls, 2);
+  EXPECT_EQ(invocations.release_filter_calls, 1);
+  filter_.reset();
+  concurrent_filter.reset();
+
+  // A later stream reuses the pooled instance without crossing the bridge.
+  auto later_filter = std::make_shared<PlatformBridgeFilter>(config_, dispatcher_);
+  later_filter->init();
+  EXPECT_EQ(invocations.init_filter_calls, 2);
+  EXPECT_EQ(invocations.set_request_callbacks_calls, 2);
+
+  // The first filter is gone, so the pooled instance's callbacks only resume a filter if they were
+  // rebound to the later one.
+  EXPECT_CALL(dispatcher_, post(_));
+  retained_callbacks[0].resume_iteration(retained_callbacks[0].callback_context);
+  testing::Mock::VerifyAndClearExpectations(&dispatcher_);
+  later_filter->onDestroy();
+  EXPECT_EQ(invocations.reset_filter_calls, 3);
+
+  // Pooled instances are released along with the configuration.
+  later_filter.reset();
+  config_.reset();
+  EXPECT_EQ(invocations.release_filter_calls, 2);
+
+  // Only the two instances which were created had callbacks set.
+  EXPECT_EQ(retained_callbacks.size(), 2);
+  for (const envoy_http_filter_callbacks& callbacks : retained_callbacks) {
+    callbacks.release_callbacks(callbacks.callback_context);
+  }
+  retained_callbacks.clear();
+}
+
+TEST_F(PlatformBridgeFilterTest, PoolingRequiresResetFilter) {
+  envoy_http_filter platform_filter{};
+  filter_invocations invocations{};
+  platform_filter.static_context = &invocations;
+  platform_filter.init_filter = [](const void* context) -> const void* {
+    filter_invocations* invocations = static_cast<filter_invocations*>(const_cast<void*>(context));
+    invocations->init_filter_calls++;
+    return context;
+  };
+  platform_filter.release_filter = [](const void* context) -> void {
+    filter_invocations* invocations = static_cast<filter_invocations*>(const_cast<void*>(context));
+    invocations->release_filter_calls++;
+  };
+
+  setUpFilter(R"EOF(
+platform_filter_name: PoolingRequiresResetFilter
+max_pooled_instances: 1
+)EOF",
+              &platform_filter);
+  EXPECT_FALSE(config_->poolingEnabled());
+  filter_->onDestroy();
+  EXPECT_EQ(invocations.release_filter_calls, 1);
+}
+
 } // namespace
 } // namespace PlatformBridge
 } // namespace HttpFilters
@@ -0,0 +1,74 @@
+#include "envoy/common/exception.h"
+
+#include "absl/types/optional.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "library/common/extensions/resource_monitors/device_memory/device_memory_monitor.h"
+
+using testing::Return;
+
+namespace Envoy {
+namespace Extensions {
+namespace ResourceMonitors {
+namespace DeviceMemory {
+namespace {
+
+class MockMemoryStatsReader : public MemoryStatsReader {
+public:
+  MOCK_METHOD(uint64_t, allocatedHeapBytes, ());
+};
+
+class ResourcePressure : public Server::ResourceMonitor::Callbacks {
+public:
+  void onSuccess(const Server::ResourceUsage& usage) override {
+    pressure_ = usage.resource_pressure_;
+  }
+  void onFailure(const EnvoyException&) override { FAIL(); }
+
+  absl::optional<double> pressure_;
+};
+
+class DeviceMemoryMonitorTest : public testing::Test {
+protected:
+  void TearDown() override { DeviceMemoryMonitor::setDevicePressure(0); }
+
+  double pressure(uint64_t max_heap_size_bytes, uint64_t allocated) {
+    envoymobile::extensions::resource_monitors::device_memory::DeviceMemory config;
+    config.set_max_heap_size_bytes(max_heap_size_bytes);
+    auto stats = std::make_unique<MockMemoryStatsReader>();
+    ON_CALL(*stats, allocatedHeapBytes()).WillByDefault(Return(allocated));
+    DeviceMemoryMonitor monitor(config, std::move(stats));
+    ResourcePressure resource;
+    monitor.updateResourceUsage(resource);
+    EXPECT_TRUE(resource.pressure_.has_value());
+    return resource.pressure_.value_or(0);
+  }
+};
+
+TEST_F(DeviceMemoryMonitorTest, HeapPressure) {
+  EXPECT_DOUBLE_EQ(0.25, pressure(400, 100));
+  // Pressure saturates once the maximum is exceeded.
+  EXPECT_DOUBLE_EQ(1.0, pressure(400, 800));
+}
+
+TEST_F(DeviceMemoryMonitorTest, DevicePressure) {
+  DeviceMemoryMonitor::setDevicePressure(0.6);
+  // The greater of the two pressures is reported.
+  EXPECT_DOUBLE_EQ(0.6, pressure(400, 100));
+  EXPECT_DOUBLE_EQ(0.75, pressure(400, 300));
+  // The heap isn't monitored without a maximum.
+  EXPECT_DOUBLE_EQ(0.6, pressure(0, 300));
+}
+
+TEST_F(DeviceMemoryMonitorTest, DevicePressureIsClamped) {
+  DeviceMemoryMonitor::setDevicePressure(2.0);
+  EXPECT_DOUBLE_EQ(1.0, DeviceMemoryMonitor::devicePressure());
+  DeviceMemoryMonitor::setDevicePressure(-1.0);
+  EXPECT_DOUBLE_EQ(0.0, DeviceMemoryMonitor::devicePressure());
+}
+
+} // namespace
+} // namespace DeviceMemory
+} // namespace ResourceMonitors
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,80 @@
+#include "test/test_common/simulated_time_system.h"
+
+#include "gtest/gtest.h"
+#include "library/common/extensions/tls/cert_verifier/verification_cache.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace Tls {
+namespace CertVerifier {
+
+class VerificationCacheTest : public testing::Test {
+public:
+  SystemTime inOneHour() { return time_system_.systemTime() + std::chrono::hours(1); }
+
+  Event::SimulatedTimeSystem time_system_;
+};
+
+TEST_F(VerificationCacheTest, MissThenHit) {
+  VerificationCache cache(time_system_, 4);
+  EXPECT_FALSE(cache.lookup("chain"));
+
+  EXPECT_FALSE(cache.insert("chain", inOneHour()));
+  EXPECT_TRUE(cache.lookup("chain"));
+  EXPECT_FALSE(cache.lookup("other_chain"));
+  EXPECT_EQ(1, cache.size());
+}
+
+TEST_F(VerificationCacheTest, ExpiredEntriesAreRemoved) {
+  VerificationCache cache(time_system_, 4);
+  cache.insert("chain", time_system_.systemTime() + std::chrono::seconds(10));
+  EXPECT_TRUE(cache.lookup("chain"));
+
+  time_system_.advanceTimeWait(std::chrono::seconds(10));
+  EXPECT_FALSE(cache.lookup("chain"));
+  EXPECT_EQ(0, cache.size());
+}
+
+TEST_F(VerificationCacheTest, AlreadyExpiredEntriesAreNotInserted) {
+  VerificationCache cache(time_system_, 4);
+  EXPECT_FALSE(cache.insert("chain", time_system_.systemTime()));
+  EXPECT_FALSE(cache.lookup("chain"));
+  EXPECT_EQ(0, cache.size());
+}
+
+TEST_F(VerificationCacheTest, EvictsLeastRecentlyUsed) {
+  VerificationCache cache(time_system_, 2);
+  EXPECT_FALSE(cache.insert("first", inOneHour()));
+  EXPECT_FALSE(cache.insert("second", inOneHour()));
+
+  // Touch the first entry so that the second becomes least recently used.
+  EXPECT_TRUE(cache.lookup("first"));
+  EXPECT_TRUE(cache.insert("third", inOneHour()));
+
+  EXPECT_TRUE(cache.lookup("first"));
+  EXPECT_FALSE(cache.lookup("second"));
+  EXPECT_TRUE(cache.lookup("third"));
+  EXPECT_EQ(2, cache.size());
+}
+
+TEST_F(VerificationCacheTest, ReinsertRefreshesExpiry) {
+  VerificationCache cache(time_system_, 2);
+  cache.insert("chain", time_system_.systemTime() + std::chrono::seconds(10));
+  cache.insert("chain", inOneHour());
+
+  time_system_.advanceTimeWait(std::chrono::seconds(10));
+  EXPECT_TRUE(cache.lookup("chain"));
+  EXPECT_EQ(1, cache.size());
+}
+
+TEST_F(VerificationCacheTest, ZeroEntriesDisablesCaching) {
+  VerificationCache cache(time_system_, 0);
+  EXPECT_FALSE(cache.insert("chain", inOneHour()));
+  EXPECT_FALSE(cache.lookup("chain"));
+  EXPECT_EQ(0, cache.size());
+}
+
+} // namespace CertVerifier
+} // namespace Tls
+} // namespace Extensions
+} // namespace Envoy
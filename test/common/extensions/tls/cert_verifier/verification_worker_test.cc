@@ -0,0 +1,42 @@
+#include <thread>
+
+#include "test/test_common/thread_factory_for_test.h"
+
+#include "absl/synchronization/notification.h"
+#include "gtest/gtest.h"
+#include "library/common/extensions/tls/cert_verifier/verification_worker.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace Tls {
+namespace CertVerifier {
+
+TEST(VerificationWorkerTest, RunsWorkOffTheCallingThread) {
+  VerificationWorker worker(Thread::threadFactoryForTest());
+  const std::thread::id caller = std::this_thread::get_id();
+  std::thread::id runner;
+  absl::Notification done;
+  worker.post([&]() -> void {
+    runner = std::this_thread::get_id();
+    done.Notify();
+  });
+  done.WaitForNotification();
+  EXPECT_NE(caller, runner);
+}
+
+TEST(VerificationWorkerTest, RunsWorkInOrder) {
+  VerificationWorker worker(Thread::threadFactoryForTest());
+  std::vector<int> order;
+  absl::Notification done;
+  for (int i = 0; i < 10; i++) {
+    worker.post([&order, i]() -> void { order.push_back(i); });
+  }
+  worker.post([&done]() -> void { done.Notify(); });
+  done.WaitForNotification();
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), order);
+}
+
+} // namespace CertVerifier
+} // namespace Tls
+} // namespace Extensions
+} // namespace Envoy
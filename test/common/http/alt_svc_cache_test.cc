@@ -0,0 +1,146 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "test/test_common/environment.h"
+#include "test/test_common/simulated_time_system.h"
+
+#include "gtest/gtest.h"
+#include "library/common/http/alt_svc_cache.h"
+
+namespace Envoy {
+namespace Http {
+
+class AltSvcCacheTest : public testing::Test {
+public:
+  Event::SimulatedTimeSystem time_system_;
+};
+
+TEST_F(AltSvcCacheTest, Parse) {
+  const SystemTime now = time_system_.systemTime();
+  const auto services = AltSvcCache::parse(
+      "h2=\":443\", h3-29=\":8443\"; ma=60, h3=\"alt.example.com:443\"; persist=1", now);
+  ASSERT_EQ(2, services.size());
+  EXPECT_EQ("h3-29", services[0].protocol_);
+  EXPECT_EQ("", services[0].host_);
+  EXPECT_EQ(8443, services[0].port_);
+  EXPECT_EQ(now + std::chrono::seconds(60), services[0].expiration_);
+  EXPECT_EQ("h3", services[1].protocol_);
+  EXPECT_EQ("alt.example.com", services[1].host_);
+  EXPECT_EQ(443, services[1].port_);
+  EXPECT_EQ(now + std::chrono::hours(24), services[1].expiration_);
+}
+
+TEST_F(AltSvcCacheTest, ParseInvalid) {
+  const SystemTime now = time_system_.systemTime();
+  EXPECT_TRUE(AltSvcCache::parse("clear", now).empty());
+  EXPECT_TRUE(AltSvcCache::parse("h3=\":443\", clear", now).empty());
+  EXPECT_TRUE(AltSvcCache::parse("h3", now).empty());
+  EXPECT_TRUE(AltSvcCache::parse("h3=:443", now).empty());
+  EXPECT_TRUE(AltSvcCache::parse("h3=\"443\"", now).empty());
+  EXPECT_TRUE(AltSvcCache::parse("h3=\":0\"", now).empty());
+  EXPECT_TRUE(AltSvcCache::parse("h3=\":65536\"", now).empty());
+  EXPECT_TRUE(AltSvcCache::parse("quic=\":443\"", now).empty());
+}
+
+TEST_F(AltSvcCacheTest, FindHttp3) {
+  AltSvcCache cache(time_system_);
+  EXPECT_FALSE(cache.findHttp3("example.com").has_value());
+  EXPECT_FALSE(cache.onAltSvc("example.com", "h2=\":443\""));
+
+  EXPECT_TRUE(cache.onAltSvc("example.com", "h3=\":443\"; ma=10"));
+  const auto service = cache.findHttp3("example.com");
+  ASSERT_TRUE(service.has_value());
+  EXPECT_EQ("h3", service->protocol_);
+  EXPECT_EQ(443, service->port_);
+  EXPECT_FALSE(cache.findHttp3("other.example.com").has_value());
+
+  time_system_.advanceTimeWait(std::chrono::seconds(10));
+  EXPECT_FALSE(cache.findHttp3("example.com").has_value());
+}
+
+TEST_F(AltSvcCacheTest, Readvertised) {
+  AltSvcCache cache(time_system_);
+  EXPECT_TRUE(cache.onAltSvc("example.com", "h3=\":443\"; ma=10"));
+
+  // Advertising the same services again only refreshes them, which is not reported as a change.
+  time_system_.advanceTimeWait(std::chrono::seconds(5));
+  EXPECT_FALSE(cache.onAltSvc("example.com", "h3=\":443\"; ma=10"));
+  time_system_.advanceTimeWait(std::chrono::seconds(5));
+  EXPECT_TRUE(cache.findHttp3("example.com").has_value());
+
+  EXPECT_TRUE(cache.onAltSvc("example.com", "h3-29=\":443\"; ma=10"));
+  EXPECT_TRUE(cache.onAltSvc("example.com", "h3-29=\":443\", h3=\":443\""));
+}
+
+TEST_F(AltSvcCacheTest, Clear) {
+  AltSvcCache cache(time_system_);
+  EXPECT_TRUE(cache.onAltSvc("example.com", "h3=\":443\""));
+  EXPECT_TRUE(cache.onAltSvc("example.com", "clear"));
+  EXPECT_FALSE(cache.findHttp3("example.com").has_value());
+  EXPECT_FALSE(cache.onAltSvc("example.com", "clear"));
+}
+
+TEST_F(AltSvcCacheTest, MarkBroken) {
+  AltSvcCache cache(time_system_);
+  EXPECT_TRUE(cache.onAltSvc("example.com", "h3=\":443\""));
+  cache.markBroken("example.com");
+  EXPECT_FALSE(cache.findHttp3("example.com").has_value());
+
+  time_system_.advanceTimeWait(AltSvcCache::BrokenDuration);
+  EXPECT_TRUE(cache.findHttp3("example.com").has_value());
+}
+
+TEST_F(AltSvcCacheTest, MaxOrigins) {
+  AltSvcCache cache(time_system_);
+  for (uint32_t i = 0; i < AltSvcCache::MaxOrigins; i++) {
+    EXPECT_TRUE(cache.onAltSvc("example" + std::to_string(i) + ".com", "h3=\":443\"; ma=10"));
+  }
+  EXPECT_FALSE(cache.onAltSvc("example.com", "h3=\":443\""));
+
+  // Expired origins make room for new ones.
+  time_system_.advanceTimeWait(std::chrono::seconds(10));
+  EXPECT_TRUE(cache.onAltSvc("example.com", "h3=\":443\""));
+  EXPECT_TRUE(cache.findHttp3("example.com").has_value());
+}
+
+TEST_F(AltSvcCacheTest, Persistence) {
+  const std::string path = TestEnvironment::temporaryPath("alt_svc_cache");
+  std::remove(path.c_str());
+
+  {
+    AltSvcCache cache(time_system_);
+    EXPECT_FALSE(cache.persistTo(path));
+    EXPECT_TRUE(cache.onAltSvc("example.com", "h3=\":443\"; ma=3600"));
+    EXPECT_TRUE(cache.onAltSvc("short.example.com", "h3-29=\":443\"; ma=10"));
+    EXPECT_TRUE(cache.save());
+  }
+
+  time_system_.advanceTimeWait(std::chrono::seconds(10));
+  AltSvcCache cache(time_system_);
+  EXPECT_TRUE(cache.persistTo(path));
+  const auto service = cache.findHttp3("example.com");
+  ASSERT_TRUE(service.has_value());
+  EXPECT_EQ("h3", service->protocol_);
+  EXPECT_EQ("", service->host_);
+  EXPECT_EQ(443, service->port_);
+  EXPECT_FALSE(cache.findHttp3("short.example.com").has_value());
+}
+
+TEST_F(AltSvcCacheTest, PersistenceIgnoresMalformedLines) {
+  const std::string path = TestEnvironment::temporaryPath("alt_svc_cache_malformed");
+  {
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    file << "garbage\n"
+         << "example.com\th3\t\tport\t99999999999\n"
+         << "other.example.com\th3\t\t443\t99999999999\n";
+  }
+
+  AltSvcCache cache(time_system_);
+  EXPECT_TRUE(cache.persistTo(path));
+  EXPECT_FALSE(cache.findHttp3("example.com").has_value());
+  EXPECT_TRUE(cache.findHttp3("other.example.com").has_value());
+}
+
+} // namespace Http
+} // namespace Envoy
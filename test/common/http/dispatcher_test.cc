@@ -1,4 +1,6 @@
 #include <atomic>
+#include <cstdio>
+#include <fstream>
 
 #include "common/buffer/buffer_impl.h"
 #include "common/http/context_impl.h"
@@ -11,12 +13,16 @@
 #include "test/mocks/http/mocks.h"
 #include "test/mocks/local_info/mocks.h"
 #include "test/mocks/upstream/mocks.h"
+#include "test/test_common/environment.h"
 
+#include "absl/synchronization/notification.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "library/common/buffer/utility.h"
 #include "library/common/http/dispatcher.h"
 #include "library/common/http/header_utility.h"
+#include "library/common/network/early_data_rejections.h"
+#include "library/common/stats/bridge_copy_stats.h"
 #include "library/common/types/c_types.h"
 
 using testing::_;
@@ -41,6 +47,16 @@ ResponseHeaderMapPtr toResponseHeaders(envoy_headers headers) {
   return transformed_headers;
 }
 
+class MockClientStreamCallbacks : public ClientStreamCallbacks {
+public:
+  MOCK_METHOD(void, onHeaders, (ResponseHeaderMapPtr && headers, bool end_stream));
+  MOCK_METHOD(void, onData, (Buffer::InstancePtr && data, bool end_stream));
+  MOCK_METHOD(void, onTrailers, (ResponseTrailerMapPtr && trailers));
+  MOCK_METHOD(void, onComplete, ());
+  MOCK_METHOD(void, onError, (const ClientStreamError& error));
+  MOCK_METHOD(void, onCancel, ());
+};
+
 class DispatcherTest : public testing::Test {
 public:
   void ready() { http_dispatcher_.ready(event_dispatcher_, stats_store_, api_listener_); }
@@ -299,6 +315,26 @@ TEST_F(DispatcherTest, SetDestinationClusterUpstreamProtocol) {
   EXPECT_CALL(request_decoder_, decodeHeaders_(HeaderMapEqual(&expected_headers4), true));
   send_headers_post_cb4();
 
+  // Setting http3 without HTTP/3 enabled, whose clusters may not exist.
+  TestRequestHeaderMapImpl headers5{{"x-envoy-mobile-upstream-protocol", "http3"}};
+  HttpTestUtility::addDefaultHeaders(headers5);
+  envoy_headers c_headers5 = Utility::toBridgeHeaders(headers5);
+
+  Event::PostCb send_headers_post_cb5;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_headers_post_cb5));
+  http_dispatcher_.sendHeaders(stream, c_headers5, true);
+
+  TestResponseHeaderMapImpl expected_headers5{
+      {":scheme", "http"},
+      {":method", "GET"},
+      {":authority", "host"},
+      {":path", "/"},
+      {"x-envoy-mobile-cluster", "base_wwan_h2"},
+      {"x-forwarded-proto", "https"},
+  };
+  EXPECT_CALL(request_decoder_, decodeHeaders_(HeaderMapEqual(&expected_headers5), true));
+  send_headers_post_cb5();
+
   // Encode response headers.
   EXPECT_CALL(event_dispatcher_, isThreadSafe()).Times(1).WillRepeatedly(Return(true));
   EXPECT_CALL(event_dispatcher_, deferredDelete_(_)).Times(1);
@@ -309,6 +345,168 @@ TEST_F(DispatcherTest, SetDestinationClusterUpstreamProtocol) {
   ASSERT_EQ(cc.on_complete_calls, 1);
 }
 
+TEST_F(DispatcherTest, Http3FromAltSvc) {
+  ready();
+
+  Event::PostCb enable_http3_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&enable_http3_post_cb));
+  http_dispatcher_.enableHttp3Upstream("");
+  enable_http3_post_cb();
+
+  MockClientStreamCallbacks client_callbacks;
+  EXPECT_CALL(event_dispatcher_, isThreadSafe()).WillRepeatedly(Return(true));
+  EXPECT_CALL(event_dispatcher_, deferredDelete_(_)).Times(3);
+
+  // Starts a stream and sends its headers, returning the cluster they were routed to.
+  auto send_request = [&](envoy_stream_t stream) -> std::string {
+    Event::PostCb start_stream_post_cb;
+    EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&start_stream_post_cb));
+    http_dispatcher_.startStream(stream, client_callbacks);
+    EXPECT_CALL(api_listener_, newStream(_, _))
+        .WillOnce(Invoke([&](ResponseEncoder& encoder, bool) -> RequestDecoder& {
+          response_encoder_ = &encoder;
+          return request_decoder_;
+        }));
+    start_stream_post_cb();
+
+    auto headers = std::make_unique<TestRequestHeaderMapImpl>();
+    HttpTestUtility::addDefaultHeaders(*headers);
+    Event::PostCb send_headers_post_cb;
+    EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_headers_post_cb));
+    http_dispatcher_.sendHeaders(stream, std::move(headers), true);
+    std::string cluster;
+    EXPECT_CALL(request_decoder_, decodeHeaders_(_, true))
+        .WillOnce(Invoke([&](RequestHeaderMapPtr& sent_headers, bool) {
+          cluster = std::string(sent_headers->get(LowerCaseString("x-envoy-mobile-cluster"))[0]
+                                    ->value()
+                                    .getStringView());
+        }));
+    send_headers_post_cb();
+    return cluster;
+  };
+
+  // The origin advertises HTTP/3.
+  EXPECT_EQ("base", send_request(1));
+  EXPECT_CALL(client_callbacks, onHeaders(_, true));
+  EXPECT_CALL(client_callbacks, onComplete());
+  TestResponseHeaderMapImpl response_headers{{":status", "200"},
+                                             {"x-envoy-upstream-service-time", "10"},
+                                             {"alt-svc", "h3=\":443\"; ma=3600, h2=\":443\""}};
+  response_encoder_->encodeHeaders(response_headers, true);
+
+  // Later requests to the origin use HTTP/3, until it fails to connect.
+  EXPECT_EQ("base_h3", send_request(2));
+  EXPECT_CALL(client_callbacks, onError(_));
+  TestResponseHeaderMapImpl failure_headers{{":status", "503"}};
+  response_encoder_->encodeHeaders(failure_headers, true);
+
+  EXPECT_EQ("base", send_request(3));
+}
+
+TEST_F(DispatcherTest, Http3AltSvcCacheSaved) {
+  ready();
+  const std::string path = TestEnvironment::temporaryPath("dispatcher_alt_svc_cache");
+  std::remove(path.c_str());
+
+  auto* save_timer = new NiceMock<Event::MockTimer>(&event_dispatcher_);
+  Event::PostCb enable_http3_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&enable_http3_post_cb));
+  http_dispatcher_.enableHttp3Upstream(path);
+  enable_http3_post_cb();
+
+  MockClientStreamCallbacks client_callbacks;
+  EXPECT_CALL(event_dispatcher_, isThreadSafe()).WillRepeatedly(Return(true));
+  EXPECT_CALL(event_dispatcher_, deferredDelete_(_)).Times(2);
+  EXPECT_CALL(client_callbacks, onHeaders(_, true)).Times(2);
+  EXPECT_CALL(client_callbacks, onComplete()).Times(2);
+  // Only the first response changes the cache, which is saved once the timer fires.
+  EXPECT_CALL(*save_timer, enableTimer(_, _));
+  for (envoy_stream_t stream = 1; stream <= 2; stream++) {
+    Event::PostCb start_stream_post_cb;
+    EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&start_stream_post_cb));
+    http_dispatcher_.startStream(stream, client_callbacks);
+    EXPECT_CALL(api_listener_, newStream(_, _))
+        .WillOnce(Invoke([&](ResponseEncoder& encoder, bool) -> RequestDecoder& {
+          response_encoder_ = &encoder;
+          return request_decoder_;
+        }));
+    start_stream_post_cb();
+
+    auto headers = std::make_unique<TestRequestHeaderMapImpl>();
+    HttpTestUtility::addDefaultHeaders(*headers);
+    Event::PostCb send_headers_post_cb;
+    EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_headers_post_cb));
+    http_dispatcher_.sendHeaders(stream, std::move(headers), true);
+    EXPECT_CALL(request_decoder_, decodeHeaders_(_, true));
+    send_headers_post_cb();
+
+    TestResponseHeaderMapImpl response_headers{{":status", "200"},
+                                               {"alt-svc", "h3=\":443\"; ma=3600"}};
+    response_encoder_->encodeHeaders(response_headers, true);
+  }
+  EXPECT_FALSE(std::ifstream(path).good());
+
+  save_timer->invokeCallback();
+  std::ifstream file(path);
+  std::string line;
+  ASSERT_TRUE(std::getline(file, line));
+  EXPECT_THAT(line, testing::StartsWith("host\th3\t\t443\t"));
+  http_dispatcher_.terminate();
+}
+
+TEST_F(DispatcherTest, BridgeCopyStats) {
+  ready();
+  Stats::BridgeCopyStats::resetForTest();
+
+  envoy_stream_t stream = 1;
+  envoy_http_callbacks bridge_callbacks;
+  callbacks_called cc = {0, 0, 0, 0, 0, 0};
+  bridge_callbacks.context = &cc;
+  bridge_callbacks.on_headers = [](envoy_headers c_headers, bool, void* context) -> void* {
+    release_envoy_headers(c_headers);
+    callbacks_called* cc = static_cast<callbacks_called*>(context);
+    cc->on_headers_calls++;
+    return nullptr;
+  };
+  bridge_callbacks.on_complete = [](void*) -> void* { return nullptr; };
+
+  Event::PostCb start_stream_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&start_stream_post_cb));
+  EXPECT_EQ(http_dispatcher_.startStream(stream, bridge_callbacks), ENVOY_SUCCESS);
+  EXPECT_CALL(api_listener_, newStream(_, _))
+      .WillOnce(Invoke([&](ResponseEncoder& encoder, bool) -> RequestDecoder& {
+        response_encoder_ = &encoder;
+        return request_decoder_;
+      }));
+  start_stream_post_cb();
+
+  TestRequestHeaderMapImpl headers;
+  HttpTestUtility::addDefaultHeaders(headers);
+  envoy_headers c_headers = Utility::toBridgeHeaders(headers);
+  Event::PostCb send_headers_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_headers_post_cb));
+  http_dispatcher_.sendHeaders(stream, c_headers, true);
+  EXPECT_CALL(request_decoder_, decodeHeaders_(_, true));
+  send_headers_post_cb();
+
+  // Conversions on the engine's thread are counted as they are made.
+  EXPECT_EQ(headers.byteSize(),
+            stats_store_.counter("http.dispatcher.bridge.to_request_headers.bytes_copied").value());
+  EXPECT_EQ(1UL + 2 * headers.size(),
+            stats_store_.counter("http.dispatcher.bridge.to_request_headers.allocations").value());
+
+  EXPECT_CALL(event_dispatcher_, isThreadSafe()).WillRepeatedly(Return(true));
+  EXPECT_CALL(event_dispatcher_, deferredDelete_(_));
+  TestResponseHeaderMapImpl response_headers{{":status", "200"}};
+  response_encoder_->encodeHeaders(response_headers, true);
+  ASSERT_EQ(cc.on_headers_calls, 1);
+
+  EXPECT_LE(headers.byteSize(),
+            stats_store_.counter("http.dispatcher.bridge.to_bridge_headers.bytes_copied").value());
+  EXPECT_EQ(0UL,
+            stats_store_.counter("http.dispatcher.bridge.to_bridge_data.bytes_copied").value());
+}
+
 TEST_F(DispatcherTest, Queueing) {
   envoy_stream_t stream = 1;
   // Setup bridge_callbacks to handle the response headers.
@@ -493,6 +691,64 @@ TEST_F(DispatcherTest, BasicStreamData) {
   ASSERT_EQ(cc.on_complete_calls, 1);
 }
 
+TEST_F(DispatcherTest, StreamArena) {
+  ready();
+  http_dispatcher_.enableStreamArena(4096);
+
+  envoy_stream_t stream = 1;
+  envoy_http_callbacks bridge_callbacks;
+  callbacks_called cc = {0, 0, 0, 0, 0, 0};
+  bridge_callbacks.context = &cc;
+  bridge_callbacks.on_headers = [](envoy_headers c_headers, bool, void* context) -> void* {
+    release_envoy_headers(c_headers);
+    static_cast<callbacks_called*>(context)->on_headers_calls++;
+    return nullptr;
+  };
+  bridge_callbacks.on_complete = [](void* context) -> void* {
+    static_cast<callbacks_called*>(context)->on_complete_calls++;
+    return nullptr;
+  };
+
+  // Request data is wrapped on the heap rather than in the stream's arena, so it may outlive both
+  // the stream and its arena, and is released by the caller's release function.
+  uint32_t released = 0;
+  std::string body = "request body";
+  envoy_data c_data = {body.size(), reinterpret_cast<const uint8_t*>(body.c_str()),
+                       [](void* context) -> void { (*static_cast<uint32_t*>(context))++; },
+                       &released};
+
+  Event::PostCb start_stream_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&start_stream_post_cb));
+  EXPECT_EQ(http_dispatcher_.startStream(stream, bridge_callbacks), ENVOY_SUCCESS);
+  EXPECT_CALL(api_listener_, newStream(_, _))
+      .WillOnce(Invoke([&](ResponseEncoder& encoder, bool) -> RequestDecoder& {
+        response_encoder_ = &encoder;
+        return request_decoder_;
+      }));
+  start_stream_post_cb();
+
+  // The request data is held, as if by an upstream connection, beyond the life of the stream.
+  Buffer::OwnedImpl upstream_buffer;
+  Event::PostCb data_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&data_post_cb));
+  http_dispatcher_.sendData(stream, c_data, true);
+  EXPECT_CALL(request_decoder_, decodeData(BufferStringEqual("request body"), true))
+      .WillOnce(Invoke([&](Buffer::Instance& data, bool) -> void { upstream_buffer.move(data); }));
+  data_post_cb();
+
+  EXPECT_CALL(event_dispatcher_, isThreadSafe()).Times(1).WillRepeatedly(Return(true));
+  EXPECT_CALL(event_dispatcher_, deferredDelete_(_)).Times(1);
+  TestResponseHeaderMapImpl response_headers{{":status", "200"}};
+  response_encoder_->encodeHeaders(response_headers, true);
+  ASSERT_EQ(cc.on_headers_calls, 1);
+  ASSERT_EQ(cc.on_complete_calls, 1);
+
+  EXPECT_EQ(upstream_buffer.toString(), "request body");
+  EXPECT_EQ(released, 0);
+  upstream_buffer.drain(upstream_buffer.length());
+  EXPECT_EQ(released, 1);
+}
+
 TEST_F(DispatcherTest, BasicStreamTrailers) {
   ready();
 
@@ -1111,6 +1367,787 @@ TEST_F(DispatcherTest, DoubleResetStreamLocal) {
   ASSERT_EQ(cc.on_complete_calls, 0);
 }
 
+TEST_F(DispatcherTest, ResetStreamGroup) {
+  ready();
+
+  envoy_stream_group_t group = 7;
+  envoy_http_callbacks bridge_callbacks;
+  callbacks_called group_cc = {0, 0, 0, 0, 0, 0};
+  bridge_callbacks.context = &group_cc;
+  bridge_callbacks.on_error = [](envoy_error, void* context) -> void* {
+    callbacks_called* cc = static_cast<callbacks_called*>(context);
+    cc->on_error_calls++;
+    return nullptr;
+  };
+  bridge_callbacks.on_cancel = [](void* context) -> void* {
+    callbacks_called* cc = static_cast<callbacks_called*>(context);
+    cc->on_cancel_calls++;
+    return nullptr;
+  };
+  envoy_http_callbacks ungrouped_bridge_callbacks = bridge_callbacks;
+  callbacks_called ungrouped_cc = {0, 0, 0, 0, 0, 0};
+  ungrouped_bridge_callbacks.context = &ungrouped_cc;
+
+  // Create two streams in the group, and one outside of it.
+  Event::PostCb start_stream1_post_cb;
+  Event::PostCb start_stream2_post_cb;
+  Event::PostCb start_stream3_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_))
+      .WillOnce(SaveArg<0>(&start_stream1_post_cb))
+      .WillOnce(SaveArg<0>(&start_stream2_post_cb))
+      .WillOnce(SaveArg<0>(&start_stream3_post_cb));
+  EXPECT_EQ(http_dispatcher_.startStream(1, bridge_callbacks, group), ENVOY_SUCCESS);
+  EXPECT_EQ(http_dispatcher_.startStream(2, bridge_callbacks, group), ENVOY_SUCCESS);
+  EXPECT_EQ(http_dispatcher_.startStream(3, ungrouped_bridge_callbacks), ENVOY_SUCCESS);
+
+  EXPECT_CALL(api_listener_, newStream(_, _)).Times(3).WillRepeatedly(ReturnRef(request_decoder_));
+  start_stream1_post_cb();
+  start_stream2_post_cb();
+  start_stream3_post_cb();
+
+  // The whole group is cancelled by a single post.
+  Event::PostCb cancel_group_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&cancel_group_post_cb));
+  ASSERT_EQ(http_dispatcher_.cancelStreamGroup(group), ENVOY_SUCCESS);
+
+  EXPECT_CALL(event_dispatcher_, isThreadSafe()).Times(2).WillRepeatedly(Return(true));
+  EXPECT_CALL(event_dispatcher_, deferredDelete_(_)).Times(2);
+  cancel_group_post_cb();
+  ASSERT_EQ(group_cc.on_cancel_calls, 2);
+  ASSERT_EQ(group_cc.on_error_calls, 0);
+  ASSERT_EQ(ungrouped_cc.on_cancel_calls, 0);
+  EXPECT_EQ(1UL, stats_store_.counter("http.dispatcher.stream_group_cancel").value());
+
+  // The group is now empty, so cancelling it again is a no-op.
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&cancel_group_post_cb));
+  ASSERT_EQ(http_dispatcher_.cancelStreamGroup(group), ENVOY_SUCCESS);
+  cancel_group_post_cb();
+  ASSERT_EQ(group_cc.on_cancel_calls, 2);
+  EXPECT_EQ(1UL, stats_store_.counter("http.dispatcher.stream_group_cancel").value());
+
+  // The stream outside of the group is still open.
+  Event::PostCb cancel_stream_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&cancel_stream_post_cb));
+  ASSERT_EQ(http_dispatcher_.cancelStream(3), ENVOY_SUCCESS);
+  EXPECT_CALL(event_dispatcher_, isThreadSafe()).WillOnce(Return(true));
+  EXPECT_CALL(event_dispatcher_, deferredDelete_(_));
+  cancel_stream_post_cb();
+  ASSERT_EQ(ungrouped_cc.on_cancel_calls, 1);
+}
+
+TEST_F(DispatcherTest, ClientStream) {
+  ready();
+
+  envoy_stream_t stream = 1;
+  MockClientStreamCallbacks client_callbacks;
+
+  // Create a stream.
+  Event::PostCb start_stream_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&start_stream_post_cb));
+  EXPECT_EQ(http_dispatcher_.startStream(stream, client_callbacks), ENVOY_SUCCESS);
+
+  EXPECT_CALL(api_listener_, newStream(_, _))
+      .WillOnce(Invoke([&](ResponseEncoder& encoder, bool) -> RequestDecoder& {
+        response_encoder_ = &encoder;
+        return request_decoder_;
+      }));
+  start_stream_post_cb();
+
+  // Send request headers and data, which are passed to the decoder as they are.
+  auto headers = std::make_unique<TestRequestHeaderMapImpl>();
+  HttpTestUtility::addDefaultHeaders(*headers);
+  Event::PostCb send_headers_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_headers_post_cb));
+  http_dispatcher_.sendHeaders(stream, std::move(headers), false);
+
+  EXPECT_CALL(request_decoder_, decodeHeaders_(_, false))
+      .WillOnce(Invoke([](RequestHeaderMapPtr& headers, bool) {
+        EXPECT_EQ("GET", headers->Method()->value().getStringView());
+        auto cluster = headers->get(LowerCaseString("x-envoy-mobile-cluster"));
+        ASSERT_EQ(1, cluster.size());
+        EXPECT_EQ("base", cluster[0]->value().getStringView());
+      }));
+  send_headers_post_cb();
+
+  Event::PostCb send_data_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_data_post_cb));
+  http_dispatcher_.sendData(stream, std::make_unique<Buffer::OwnedImpl>("request body"), true);
+
+  EXPECT_CALL(request_decoder_, decodeData(BufferStringEqual("request body"), true));
+  send_data_post_cb();
+
+  // Encode the response, which is delivered to the client callbacks.
+  EXPECT_CALL(client_callbacks, onHeaders(_, false))
+      .WillOnce(Invoke([](const ResponseHeaderMapPtr& headers, bool) {
+        EXPECT_EQ("200", headers->Status()->value().getStringView());
+      }));
+  TestResponseHeaderMapImpl response_headers{{":status", "200"}};
+  response_encoder_->encodeHeaders(response_headers, false);
+
+  EXPECT_CALL(event_dispatcher_, isThreadSafe()).Times(1).WillRepeatedly(Return(true));
+  EXPECT_CALL(event_dispatcher_, deferredDelete_(_)).Times(1);
+  EXPECT_CALL(client_callbacks, onData(_, true))
+      .WillOnce(Invoke([](const Buffer::InstancePtr& data, bool) {
+        EXPECT_EQ("response body", data->toString());
+      }));
+  EXPECT_CALL(client_callbacks, onComplete());
+  Buffer::OwnedImpl response_data("response body");
+  response_encoder_->encodeData(response_data, true);
+  // The response data was moved to the client.
+  EXPECT_EQ(0, response_data.length());
+}
+
+TEST_F(DispatcherTest, ClientStreamLocalReplyWithData) {
+  ready();
+
+  envoy_stream_t stream = 1;
+  MockClientStreamCallbacks client_callbacks;
+
+  // Create a stream.
+  Event::PostCb start_stream_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&start_stream_post_cb));
+  EXPECT_EQ(http_dispatcher_.startStream(stream, client_callbacks), ENVOY_SUCCESS);
+
+  EXPECT_CALL(api_listener_, newStream(_, _))
+      .WillOnce(Invoke([&](ResponseEncoder& encoder, bool) -> RequestDecoder& {
+        response_encoder_ = &encoder;
+        return request_decoder_;
+      }));
+  start_stream_post_cb();
+
+  // A 503 local reply is surfaced as an error carrying the reply's body.
+  TestResponseHeaderMapImpl response_headers{{":status", "503"}, {"x-envoy-attempt-count", "2"}};
+  response_encoder_->encodeHeaders(response_headers, false);
+
+  EXPECT_CALL(event_dispatcher_, isThreadSafe()).Times(1).WillRepeatedly(Return(true));
+  EXPECT_CALL(event_dispatcher_, deferredDelete_(_)).Times(1);
+  EXPECT_CALL(client_callbacks, onError(_)).WillOnce(Invoke([](const ClientStreamError& error) {
+    EXPECT_EQ(ENVOY_CONNECTION_FAILURE, error.error_code_);
+    EXPECT_EQ("error message", error.message_);
+    EXPECT_EQ(2, error.attempt_count_.value_or(-1));
+  }));
+  EXPECT_CALL(client_callbacks, onData(_, _)).Times(0);
+  Buffer::OwnedImpl response_data("error message");
+  response_encoder_->encodeData(response_data, true);
+}
+
+TEST_F(DispatcherTest, ClientStreamReplay) {
+  ready();
+
+  Event::PostCb enable_replay_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&enable_replay_post_cb));
+  http_dispatcher_.enableRequestReplay(1024, TestEnvironment::temporaryDirectory());
+  enable_replay_post_cb();
+
+  envoy_stream_t stream = 1;
+  MockClientStreamCallbacks client_callbacks;
+
+  // Create a stream.
+  Event::PostCb start_stream_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&start_stream_post_cb));
+  EXPECT_EQ(http_dispatcher_.startStream(stream, client_callbacks), ENVOY_SUCCESS);
+
+  EXPECT_CALL(api_listener_, newStream(_, _))
+      .WillOnce(Invoke([&](ResponseEncoder& encoder, bool) -> RequestDecoder& {
+        response_encoder_ = &encoder;
+        return request_decoder_;
+      }));
+  start_stream_post_cb();
+
+  // Send a request which allows retries, with a body too large for the router to retry.
+  auto headers = std::make_unique<TestRequestHeaderMapImpl>();
+  HttpTestUtility::addDefaultHeaders(*headers);
+  headers->addCopy(LowerCaseString("x-envoy-max-retries"), "1");
+  Event::PostCb send_headers_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_headers_post_cb));
+  http_dispatcher_.sendHeaders(stream, std::move(headers), false);
+  EXPECT_CALL(request_decoder_, decodeHeaders_(_, false));
+  send_headers_post_cb();
+
+  const std::string body(100000, 'a');
+  Event::PostCb send_data_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_data_post_cb));
+  http_dispatcher_.sendData(stream, std::make_unique<Buffer::OwnedImpl>(body), true);
+  EXPECT_CALL(request_decoder_, decodeData(BufferStringEqual(body), true));
+  send_data_post_cb();
+
+  // The connection fails. The caller is not told, and the stream is replaced.
+  MockRequestDecoder replay_decoder;
+  ResponseEncoder* replay_encoder{};
+  Event::PostCb replay_post_cb;
+  EXPECT_CALL(event_dispatcher_, isThreadSafe()).WillRepeatedly(Return(true));
+  EXPECT_CALL(event_dispatcher_, deferredDelete_(_));
+  EXPECT_CALL(client_callbacks, onError(_)).Times(0);
+  EXPECT_CALL(api_listener_, newStream(_, _))
+      .WillOnce(Invoke([&](ResponseEncoder& encoder, bool) -> RequestDecoder& {
+        replay_encoder = &encoder;
+        return replay_decoder;
+      }));
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&replay_post_cb));
+  TestResponseHeaderMapImpl failure_headers{{":status", "503"}};
+  response_encoder_->encodeHeaders(failure_headers, true);
+  EXPECT_EQ(1, http_dispatcher_.stats().stream_replay_.value());
+
+  // The request is replayed on the new stream. Each chunk of its body is sent from its own post;
+  // the chunks spilled to disk are read back, and posted, from the spill worker.
+  Event::PostCb chunk_post_cb;
+  std::unique_ptr<absl::Notification> chunk_posted;
+  auto expect_chunk_post = [&]() {
+    chunk_posted = std::make_unique<absl::Notification>();
+    EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(Invoke([&](Event::PostCb cb) {
+      chunk_post_cb = cb;
+      chunk_posted->Notify();
+    }));
+  };
+  EXPECT_CALL(replay_decoder, decodeHeaders_(_, false))
+      .WillOnce(Invoke([](RequestHeaderMapPtr& replayed_headers, bool) {
+        EXPECT_EQ("base", replayed_headers->get(LowerCaseString("x-envoy-mobile-cluster"))[0]
+                              ->value()
+                              .getStringView());
+      }));
+  expect_chunk_post();
+  replay_post_cb();
+
+  std::string replayed_body;
+  EXPECT_CALL(replay_decoder, decodeData(_, false))
+      .Times(2)
+      .WillRepeatedly(
+          Invoke([&](Buffer::Instance& data, bool) { replayed_body += data.toString(); }));
+  EXPECT_CALL(replay_decoder, decodeData(_, true))
+      .WillOnce(Invoke([&](Buffer::Instance& data, bool) { replayed_body += data.toString(); }));
+  // The part of the body held in memory, then two chunks read back from disk.
+  for (int i = 0; i < 3; i++) {
+    chunk_posted->WaitForNotification();
+    Event::PostCb cb = chunk_post_cb;
+    if (i < 2) {
+      expect_chunk_post();
+    }
+    cb();
+  }
+  EXPECT_EQ(body, replayed_body);
+
+  // The response on the new stream is delivered to the caller.
+  EXPECT_CALL(event_dispatcher_, deferredDelete_(_));
+  EXPECT_CALL(client_callbacks, onHeaders(_, true));
+  EXPECT_CALL(client_callbacks, onComplete());
+  TestResponseHeaderMapImpl response_headers{{":status", "200"},
+                                             {"x-envoy-upstream-service-time", "10"}};
+  replay_encoder->encodeHeaders(response_headers, true);
+}
+
+TEST_F(DispatcherTest, ClientStreamReplayReadDisabled) {
+  ready();
+
+  Event::PostCb enable_replay_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&enable_replay_post_cb));
+  http_dispatcher_.enableRequestReplay(1024 * 1024, TestEnvironment::temporaryDirectory());
+  enable_replay_post_cb();
+
+  envoy_stream_t stream = 1;
+  MockClientStreamCallbacks client_callbacks;
+  Event::PostCb start_stream_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&start_stream_post_cb));
+  EXPECT_EQ(http_dispatcher_.startStream(stream, client_callbacks), ENVOY_SUCCESS);
+  EXPECT_CALL(api_listener_, newStream(_, _))
+      .WillOnce(Invoke([&](ResponseEncoder& encoder, bool) -> RequestDecoder& {
+        response_encoder_ = &encoder;
+        return request_decoder_;
+      }));
+  start_stream_post_cb();
+
+  // Send the start of a request which allows retries, with a body too large for the router.
+  auto headers = std::make_unique<TestRequestHeaderMapImpl>();
+  HttpTestUtility::addDefaultHeaders(*headers);
+  headers->addCopy(LowerCaseString("x-envoy-max-retries"), "1");
+  Event::PostCb send_headers_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_headers_post_cb));
+  http_dispatcher_.sendHeaders(stream, std::move(headers), false);
+  EXPECT_CALL(request_decoder_, decodeHeaders_(_, false));
+  send_headers_post_cb();
+  const std::string body(100000, 'a');
+  Event::PostCb send_data_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_data_post_cb));
+  http_dispatcher_.sendData(stream, std::make_unique<Buffer::OwnedImpl>(body), false);
+  EXPECT_CALL(request_decoder_, decodeData(_, false));
+  send_data_post_cb();
+
+  // The connection fails, and the stream is replaced.
+  MockRequestDecoder replay_decoder;
+  ResponseEncoder* replay_encoder{};
+  Event::PostCb replay_post_cb;
+  EXPECT_CALL(event_dispatcher_, isThreadSafe()).WillRepeatedly(Return(true));
+  EXPECT_CALL(event_dispatcher_, deferredDelete_(_));
+  EXPECT_CALL(client_callbacks, onError(_)).Times(0);
+  EXPECT_CALL(api_listener_, newStream(_, _))
+      .WillOnce(Invoke([&](ResponseEncoder& encoder, bool) -> RequestDecoder& {
+        replay_encoder = &encoder;
+        return replay_decoder;
+      }));
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&replay_post_cb));
+  TestResponseHeaderMapImpl failure_headers{{":status", "503"}};
+  response_encoder_->encodeHeaders(failure_headers, true);
+
+  // The connection manager disables reading once the first chunk of the body is replayed.
+  Event::PostCb chunk_post_cb;
+  EXPECT_CALL(replay_decoder, decodeHeaders_(_, false));
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&chunk_post_cb));
+  replay_post_cb();
+  std::string replayed_body;
+  EXPECT_CALL(replay_decoder, decodeData(_, false))
+      .WillOnce(Invoke([&](Buffer::Instance& data, bool) {
+        replayed_body += data.toString();
+        replay_encoder->getStream().readDisable(true);
+      }));
+  EXPECT_CALL(event_dispatcher_, post(_)).Times(0);
+  chunk_post_cb();
+  EXPECT_EQ(64 * 1024, replayed_body.size());
+
+  // Meanwhile, the caller ends the request, which is only recorded.
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_data_post_cb));
+  http_dispatcher_.sendData(stream, std::make_unique<Buffer::OwnedImpl>("tail"), true);
+  send_data_post_cb();
+
+  // Once reading is enabled again, the rest of the request is replayed.
+  Event::PostCb resume_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&resume_post_cb));
+  replay_encoder->getStream().readDisable(false);
+  Event::PostCb second_chunk_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&second_chunk_post_cb));
+  resume_post_cb();
+  EXPECT_CALL(replay_decoder, decodeData(_, false))
+      .WillOnce(Invoke([&](Buffer::Instance& data, bool) { replayed_body += data.toString(); }));
+  Event::PostCb tail_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&tail_post_cb));
+  second_chunk_post_cb();
+  EXPECT_CALL(replay_decoder, decodeData(BufferStringEqual("tail"), true));
+  tail_post_cb();
+  EXPECT_EQ(body, replayed_body);
+
+  EXPECT_CALL(event_dispatcher_, deferredDelete_(_));
+  EXPECT_CALL(client_callbacks, onHeaders(_, true));
+  EXPECT_CALL(client_callbacks, onComplete());
+  TestResponseHeaderMapImpl response_headers{{":status", "200"},
+                                             {"x-envoy-upstream-service-time", "10"}};
+  replay_encoder->encodeHeaders(response_headers, true);
+}
+
+TEST_F(DispatcherTest, EarlyDataReplay) {
+  ready();
+
+  Event::PostCb enable_early_data_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&enable_early_data_post_cb));
+  http_dispatcher_.enableEarlyData();
+  enable_early_data_post_cb();
+
+  MockClientStreamCallbacks client_callbacks;
+  EXPECT_CALL(event_dispatcher_, isThreadSafe()).WillRepeatedly(Return(true));
+
+  // Starts a stream and sends its headers, returning the cluster they were routed to.
+  auto send_request = [&](envoy_stream_t stream, const std::string& method,
+                          bool early_data_header) -> std::string {
+    Event::PostCb start_stream_post_cb;
+    EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&start_stream_post_cb));
+    http_dispatcher_.startStream(stream, client_callbacks);
+    EXPECT_CALL(api_listener_, newStream(_, _))
+        .WillOnce(Invoke([&](ResponseEncoder& encoder, bool) -> RequestDecoder& {
+          response_encoder_ = &encoder;
+          return request_decoder_;
+        }));
+    start_stream_post_cb();
+
+    auto headers = std::make_unique<TestRequestHeaderMapImpl>();
+    HttpTestUtility::addDefaultHeaders(*headers);
+    headers->setMethod(method);
+    if (early_data_header) {
+      headers->addCopy(LowerCaseString("x-envoy-mobile-early-data"), "true");
+    }
+    Event::PostCb send_headers_post_cb;
+    EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_headers_post_cb));
+    http_dispatcher_.sendHeaders(stream, std::move(headers), true);
+    std::string cluster;
+    EXPECT_CALL(request_decoder_, decodeHeaders_(_, true))
+        .WillOnce(Invoke([&](RequestHeaderMapPtr& sent_headers, bool) {
+          EXPECT_TRUE(sent_headers->get(LowerCaseString("x-envoy-mobile-early-data")).empty());
+          cluster = std::string(sent_headers->get(LowerCaseString("x-envoy-mobile-cluster"))[0]
+                                    ->value()
+                                    .getStringView());
+        }));
+    send_headers_post_cb();
+    return cluster;
+  };
+  auto complete = [&](ResponseEncoder& encoder) {
+    EXPECT_CALL(event_dispatcher_, deferredDelete_(_));
+    EXPECT_CALL(client_callbacks, onHeaders(_, true));
+    EXPECT_CALL(client_callbacks, onComplete());
+    TestResponseHeaderMapImpl response_headers{{":status", "200"},
+                                               {"x-envoy-upstream-service-time", "10"}};
+    encoder.encodeHeaders(response_headers, true);
+  };
+
+  // Only idempotent requests, or those which opt in, are sent as early data.
+  EXPECT_EQ("base", send_request(1, "POST", false));
+  complete(*response_encoder_);
+  EXPECT_EQ("base_early_data", send_request(2, "POST", true));
+  complete(*response_encoder_);
+
+  // The connection fails for another reason than the early data being rejected. The caller is
+  // told, as it would be without early data.
+  EXPECT_EQ("base_early_data", send_request(3, "GET", false));
+  EXPECT_CALL(event_dispatcher_, deferredDelete_(_));
+  EXPECT_CALL(client_callbacks, onError(_)).WillOnce(Invoke([](const ClientStreamError& error) {
+    EXPECT_EQ(ENVOY_CONNECTION_FAILURE, error.error_code_);
+  }));
+  TestResponseHeaderMapImpl failure_headers{{":status", "503"}};
+  response_encoder_->encodeHeaders(failure_headers, true);
+  EXPECT_EQ(0, http_dispatcher_.stats().stream_replay_.value());
+
+  // The server rejects the early data, which its handshaker records before the connection fails.
+  // The caller is not told, and the stream is replaced.
+  EXPECT_EQ("base_early_data", send_request(4, "GET", false));
+  Network::EarlyDataRejections::onRejected("host");
+  MockRequestDecoder replay_decoder;
+  ResponseEncoder* replay_encoder{};
+  Event::PostCb replay_post_cb;
+  EXPECT_CALL(event_dispatcher_, deferredDelete_(_));
+  EXPECT_CALL(client_callbacks, onError(_)).Times(0);
+  EXPECT_CALL(api_listener_, newStream(_, _))
+      .WillOnce(Invoke([&](ResponseEncoder& encoder, bool) -> RequestDecoder& {
+        replay_encoder = &encoder;
+        return replay_decoder;
+      }));
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&replay_post_cb));
+  response_encoder_->encodeHeaders(failure_headers, true);
+  EXPECT_EQ(1, http_dispatcher_.stats().stream_replay_.value());
+
+  // The request is replayed without early data.
+  EXPECT_CALL(replay_decoder, decodeHeaders_(_, true))
+      .WillOnce(Invoke([](RequestHeaderMapPtr& replayed_headers, bool) {
+        EXPECT_EQ("base", replayed_headers->get(LowerCaseString("x-envoy-mobile-cluster"))[0]
+                              ->value()
+                              .getStringView());
+      }));
+  replay_post_cb();
+
+  // Should the replay fail as well, the caller is told.
+  EXPECT_CALL(event_dispatcher_, deferredDelete_(_));
+  EXPECT_CALL(client_callbacks, onError(_)).WillOnce(Invoke([](const ClientStreamError& error) {
+    EXPECT_EQ(ENVOY_CONNECTION_FAILURE, error.error_code_);
+  }));
+  replay_encoder->encodeHeaders(failure_headers, true);
+  EXPECT_EQ(1, http_dispatcher_.stats().stream_replay_.value());
+}
+
+TEST_F(DispatcherTest, WebSocketUpgrade) {
+  ready();
+
+  envoy_stream_t stream = 1;
+  MockClientStreamCallbacks client_callbacks;
+
+  // Create a stream.
+  Event::PostCb start_stream_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&start_stream_post_cb));
+  EXPECT_EQ(http_dispatcher_.startStream(stream, client_callbacks), ENVOY_SUCCESS);
+
+  EXPECT_CALL(api_listener_, newStream(_, _))
+      .WillOnce(Invoke([&](ResponseEncoder& encoder, bool) -> RequestDecoder& {
+        response_encoder_ = &encoder;
+        return request_decoder_;
+      }));
+  start_stream_post_cb();
+
+  // Send a WebSocket upgrade, which is passed to the decoder as it is.
+  auto headers = std::make_unique<TestRequestHeaderMapImpl>();
+  HttpTestUtility::addDefaultHeaders(*headers);
+  headers->addCopy(LowerCaseString("upgrade"), "websocket");
+  headers->addCopy(LowerCaseString("connection"), "upgrade");
+  Event::PostCb send_headers_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_headers_post_cb));
+  http_dispatcher_.sendHeaders(stream, std::move(headers), false);
+
+  EXPECT_CALL(request_decoder_, decodeHeaders_(_, false))
+      .WillOnce(Invoke([](RequestHeaderMapPtr& headers, bool) {
+        EXPECT_EQ("GET", headers->getMethodValue());
+        EXPECT_EQ("websocket", headers->getUpgradeValue());
+      }));
+  send_headers_post_cb();
+
+  // The upgrade is accepted, after which data flows both ways.
+  EXPECT_CALL(client_callbacks, onHeaders(_, false))
+      .WillOnce(Invoke([](const ResponseHeaderMapPtr& headers, bool) {
+        EXPECT_EQ("101", headers->getStatusValue());
+      }));
+  TestResponseHeaderMapImpl response_headers{{":status", "101"},
+                                             {"upgrade", "websocket"},
+                                             {"connection", "upgrade"},
+                                             {"x-envoy-upstream-service-time", "10"}};
+  response_encoder_->encodeHeaders(response_headers, false);
+
+  Event::PostCb send_data_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_data_post_cb));
+  http_dispatcher_.sendData(stream, std::make_unique<Buffer::OwnedImpl>("ping"), false);
+  EXPECT_CALL(request_decoder_, decodeData(BufferStringEqual("ping"), false));
+  send_data_post_cb();
+
+  EXPECT_CALL(client_callbacks, onData(_, false))
+      .WillOnce(Invoke([](const Buffer::InstancePtr& data, bool) {
+        EXPECT_EQ("pong", data->toString());
+      }));
+  Buffer::OwnedImpl response_data("pong");
+  response_encoder_->encodeData(response_data, false);
+
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_data_post_cb));
+  http_dispatcher_.sendData(stream, std::make_unique<Buffer::OwnedImpl>(""), true);
+  EXPECT_CALL(request_decoder_, decodeData(BufferStringEqual(""), true));
+  send_data_post_cb();
+
+  // The stream completes successfully when the server ends it.
+  EXPECT_CALL(event_dispatcher_, isThreadSafe()).WillRepeatedly(Return(true));
+  EXPECT_CALL(event_dispatcher_, deferredDelete_(_));
+  EXPECT_CALL(client_callbacks, onData(_, true));
+  EXPECT_CALL(client_callbacks, onComplete());
+  Buffer::OwnedImpl end_data;
+  response_encoder_->encodeData(end_data, true);
+  EXPECT_EQ(1UL, stats_store_.counter("http.dispatcher.stream_success").value());
+}
+
+TEST_F(DispatcherTest, ExtendedConnect) {
+  ready();
+
+  envoy_stream_t stream = 1;
+  MockClientStreamCallbacks client_callbacks;
+
+  // Create a stream.
+  Event::PostCb start_stream_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&start_stream_post_cb));
+  EXPECT_EQ(http_dispatcher_.startStream(stream, client_callbacks), ENVOY_SUCCESS);
+
+  EXPECT_CALL(api_listener_, newStream(_, _))
+      .WillOnce(Invoke([&](ResponseEncoder& encoder, bool) -> RequestDecoder& {
+        response_encoder_ = &encoder;
+        return request_decoder_;
+      }));
+  start_stream_post_cb();
+
+  // An extended CONNECT request is passed to the decoder as the equivalent upgrade.
+  auto headers = std::make_unique<TestRequestHeaderMapImpl>(
+      std::initializer_list<std::pair<std::string, std::string>>{{":method", "CONNECT"},
+                                                                  {":protocol", "websocket"},
+                                                                  {":scheme", "https"},
+                                                                  {":authority", "host"},
+                                                                  {":path", "/chat"}});
+  Event::PostCb send_headers_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_headers_post_cb));
+  http_dispatcher_.sendHeaders(stream, std::move(headers), false);
+
+  EXPECT_CALL(request_decoder_, decodeHeaders_(_, false))
+      .WillOnce(Invoke([](RequestHeaderMapPtr& headers, bool) {
+        EXPECT_EQ("GET", headers->getMethodValue());
+        EXPECT_EQ("websocket", headers->getUpgradeValue());
+        EXPECT_EQ("/chat", headers->getPathValue());
+      }));
+  send_headers_post_cb();
+
+  // The caller sees the upgrade accepted with a 200, as a response to an extended CONNECT.
+  EXPECT_CALL(client_callbacks, onHeaders(_, false))
+      .WillOnce(Invoke([](const ResponseHeaderMapPtr& headers, bool) {
+        EXPECT_EQ("200", headers->getStatusValue());
+        EXPECT_EQ(nullptr, headers->Upgrade());
+      }));
+  TestResponseHeaderMapImpl response_headers{{":status", "101"},
+                                             {"upgrade", "websocket"},
+                                             {"connection", "upgrade"},
+                                             {"x-envoy-upstream-service-time", "10"}};
+  response_encoder_->encodeHeaders(response_headers, false);
+
+  EXPECT_CALL(event_dispatcher_, isThreadSafe()).WillRepeatedly(Return(true));
+  EXPECT_CALL(event_dispatcher_, deferredDelete_(_));
+  EXPECT_CALL(client_callbacks, onCancel());
+  Event::PostCb cancel_stream_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&cancel_stream_post_cb));
+  http_dispatcher_.cancelStream(stream);
+  cancel_stream_post_cb();
+}
+
+TEST_F(DispatcherTest, ReadDisableHoldsRequest) {
+  ready();
+
+  envoy_stream_t stream = 1;
+  MockClientStreamCallbacks client_callbacks;
+
+  // Create a stream.
+  Event::PostCb start_stream_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&start_stream_post_cb));
+  EXPECT_EQ(http_dispatcher_.startStream(stream, client_callbacks), ENVOY_SUCCESS);
+
+  EXPECT_CALL(api_listener_, newStream(_, _))
+      .WillOnce(Invoke([&](ResponseEncoder& encoder, bool) -> RequestDecoder& {
+        response_encoder_ = &encoder;
+        return request_decoder_;
+      }));
+  start_stream_post_cb();
+
+  auto headers = std::make_unique<TestRequestHeaderMapImpl>();
+  HttpTestUtility::addDefaultHeaders(*headers);
+  Event::PostCb send_headers_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_headers_post_cb));
+  http_dispatcher_.sendHeaders(stream, std::move(headers), false);
+  EXPECT_CALL(request_decoder_, decodeHeaders_(_, false));
+  send_headers_post_cb();
+
+  // While the connection manager has reading disabled, the request is held.
+  response_encoder_->getStream().readDisable(true);
+  response_encoder_->getStream().readDisable(true);
+  EXPECT_CALL(request_decoder_, decodeData(_, _)).Times(0);
+  EXPECT_CALL(request_decoder_, decodeTrailers_(_)).Times(0);
+  for (const char* chunk : {"hello ", "world"}) {
+    Event::PostCb send_data_post_cb;
+    EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_data_post_cb));
+    http_dispatcher_.sendData(stream, std::make_unique<Buffer::OwnedImpl>(chunk), false);
+    send_data_post_cb();
+  }
+  Event::PostCb send_trailers_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_trailers_post_cb));
+  http_dispatcher_.sendTrailers(
+      stream, std::make_unique<TestRequestTrailerMapImpl>(
+                  std::initializer_list<std::pair<std::string, std::string>>{{"trailer", "1"}}));
+  send_trailers_post_cb();
+
+  // Reading is only enabled once each disable has been undone, and the held request is then
+  // passed on from the event loop.
+  EXPECT_CALL(event_dispatcher_, post(_)).Times(0);
+  response_encoder_->getStream().readDisable(false);
+  Event::PostCb resume_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&resume_post_cb));
+  response_encoder_->getStream().readDisable(false);
+
+  EXPECT_CALL(request_decoder_, decodeData(BufferStringEqual("hello world"), false));
+  EXPECT_CALL(request_decoder_, decodeTrailers_(_));
+  resume_post_cb();
+}
+
+TEST_F(DispatcherTest, PauseResponse) {
+  ready();
+
+  envoy_stream_t stream = 1;
+  MockClientStreamCallbacks client_callbacks;
+
+  // Create a stream.
+  Event::PostCb start_stream_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&start_stream_post_cb));
+  EXPECT_EQ(http_dispatcher_.startStream(stream, client_callbacks), ENVOY_SUCCESS);
+
+  EXPECT_CALL(api_listener_, newStream(_, _))
+      .WillOnce(Invoke([&](ResponseEncoder& encoder, bool) -> RequestDecoder& {
+        response_encoder_ = &encoder;
+        return request_decoder_;
+      }));
+  start_stream_post_cb();
+  Http::MockStreamCallbacks stream_callbacks;
+  response_encoder_->getStream().addCallbacks(stream_callbacks);
+
+  // Pausing appears to the connection manager as a full downstream write buffer.
+  Event::PostCb pause_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&pause_post_cb));
+  EXPECT_EQ(ENVOY_SUCCESS, http_dispatcher_.pauseResponse(stream, true));
+  EXPECT_CALL(stream_callbacks, onAboveWriteBufferHighWatermark());
+  pause_post_cb();
+
+  // Pausing a paused response has no effect.
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&pause_post_cb));
+  http_dispatcher_.pauseResponse(stream, true);
+  pause_post_cb();
+
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&pause_post_cb));
+  http_dispatcher_.pauseResponse(stream, false);
+  EXPECT_CALL(stream_callbacks, onBelowWriteBufferLowWatermark());
+  pause_post_cb();
+}
+
+TEST_F(DispatcherTest, StreamProgress) {
+  ready();
+
+  envoy_stream_t stream = 1;
+  MockClientStreamCallbacks client_callbacks;
+  envoy_stream_progress progress;
+  EXPECT_EQ(ENVOY_FAILURE, http_dispatcher_.getStreamProgress(stream, progress));
+
+  // Progress can be read as soon as the stream is started, before the event loop has started it.
+  Event::PostCb start_stream_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&start_stream_post_cb));
+  EXPECT_EQ(http_dispatcher_.startStream(stream, client_callbacks), ENVOY_SUCCESS);
+  ASSERT_EQ(ENVOY_SUCCESS, http_dispatcher_.getStreamProgress(stream, progress));
+  EXPECT_EQ(ENVOY_STREAM_SENDING_REQUEST, progress.state);
+  EXPECT_EQ(0, progress.bytes_sent);
+
+  EXPECT_CALL(api_listener_, newStream(_, _))
+      .WillOnce(Invoke([&](ResponseEncoder& encoder, bool) -> RequestDecoder& {
+        response_encoder_ = &encoder;
+        return request_decoder_;
+      }));
+  start_stream_post_cb();
+
+  auto headers = std::make_unique<TestRequestHeaderMapImpl>();
+  HttpTestUtility::addDefaultHeaders(*headers);
+  Event::PostCb send_headers_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_headers_post_cb));
+  http_dispatcher_.sendHeaders(stream, std::move(headers), false);
+  EXPECT_CALL(request_decoder_, decodeHeaders_(_, false));
+  send_headers_post_cb();
+
+  EXPECT_CALL(request_decoder_, decodeData(_, _)).Times(2);
+  Event::PostCb send_data_post_cb;
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_data_post_cb));
+  http_dispatcher_.sendData(stream, std::make_unique<Buffer::OwnedImpl>("hello "), false);
+  send_data_post_cb();
+  ASSERT_EQ(ENVOY_SUCCESS, http_dispatcher_.getStreamProgress(stream, progress));
+  EXPECT_EQ(ENVOY_STREAM_SENDING_REQUEST, progress.state);
+  EXPECT_EQ(6, progress.bytes_sent);
+
+  EXPECT_CALL(event_dispatcher_, post(_)).WillOnce(SaveArg<0>(&send_data_post_cb));
+  http_dispatcher_.sendData(stream, std::make_unique<Buffer::OwnedImpl>("world"), true);
+  send_data_post_cb();
+  ASSERT_EQ(ENVOY_SUCCESS, http_dispatcher_.getStreamProgress(stream, progress));
+  EXPECT_EQ(ENVOY_STREAM_AWAITING_RESPONSE, progress.state);
+  EXPECT_EQ(11, progress.bytes_sent);
+  EXPECT_EQ(0, progress.bytes_acknowledged);
+
+  // The whole request is acknowledged by the response.
+  EXPECT_CALL(client_callbacks, onHeaders(_, false));
+  TestResponseHeaderMapImpl response_headers{{":status", "200"}};
+  response_encoder_->encodeHeaders(response_headers, false);
+  ASSERT_EQ(ENVOY_SUCCESS, http_dispatcher_.getStreamProgress(stream, progress));
+  EXPECT_EQ(ENVOY_STREAM_RECEIVING_RESPONSE, progress.state);
+  EXPECT_EQ(11, progress.bytes_acknowledged);
+  EXPECT_EQ(0, progress.bytes_received);
+
+  EXPECT_CALL(client_callbacks, onData(_, false));
+  Buffer::OwnedImpl response_data("response");
+  response_encoder_->encodeData(response_data, false);
+  ASSERT_EQ(ENVOY_SUCCESS, http_dispatcher_.getStreamProgress(stream, progress));
+  EXPECT_EQ(8, progress.bytes_received);
+
+  // Progress is no longer available once the stream has completed.
+  EXPECT_CALL(event_dispatcher_, isThreadSafe()).Times(1).WillRepeatedly(Return(true));
+  EXPECT_CALL(event_dispatcher_, deferredDelete_(_)).Times(1);
+  EXPECT_CALL(client_callbacks, onData(_, true));
+  EXPECT_CALL(client_callbacks, onComplete());
+  Buffer::OwnedImpl final_data("!");
+  response_encoder_->encodeData(final_data, true);
+  EXPECT_EQ(ENVOY_FAILURE, http_dispatcher_.getStreamProgress(stream, progress));
+}
+
+TEST_F(DispatcherTest, StreamProgressOfStreamNeverStarted) {
+  envoy_stream_t stream = 1;
+  MockClientStreamCallbacks client_callbacks;
+  envoy_stream_progress progress;
+
+  // The stream is queued until the dispatcher is ready, which it never becomes.
+  EXPECT_EQ(http_dispatcher_.startStream(stream, client_callbacks), ENVOY_SUCCESS);
+  ASSERT_EQ(ENVOY_SUCCESS, http_dispatcher_.getStreamProgress(stream, progress));
+  http_dispatcher_.terminate();
+  EXPECT_EQ(ENVOY_FAILURE, http_dispatcher_.getStreamProgress(stream, progress));
+}
+
 TEST_F(DispatcherTest, RemoteResetAfterStreamStart) {
   ready();
 
@@ -1358,10 +2395,9 @@ TEST_F(DispatcherTest, Encode100Continue) {
   EXPECT_CALL(request_decoder_, decodeHeaders_(_, true));
   send_headers_post_cb();
 
-  // Encode 100 continue should blow up.
-  TestResponseHeaderMapImpl response_headers{{":status", "200"}};
-  EXPECT_DEATH(response_encoder_->encode100ContinueHeaders(response_headers),
-               "panic: not implemented");
+  // The interim response is dropped.
+  TestResponseHeaderMapImpl response_headers{{":status", "100"}};
+  response_encoder_->encode100ContinueHeaders(response_headers);
 }
 
 TEST_F(DispatcherTest, EncodeMetadata) {
@@ -1381,6 +2417,14 @@ TEST_F(DispatcherTest, EncodeMetadata) {
     cc->on_headers_calls++;
     return nullptr;
   };
+  // Metadata is delivered like headers.
+  static uint32_t on_metadata_calls = 0;
+  bridge_callbacks.on_metadata = [](envoy_headers c_metadata, void*) -> void* {
+    ResponseHeaderMapPtr metadata = toResponseHeaders(c_metadata);
+    EXPECT_EQ("value", metadata->get(LowerCaseString("key"))[0]->value().getStringView());
+    on_metadata_calls++;
+    return nullptr;
+  };
 
   // Build a set of request headers.
   TestRequestHeaderMapImpl headers;
@@ -1419,7 +2463,8 @@ TEST_F(DispatcherTest, EncodeMetadata) {
   MetadataMapPtr metadata_map_ptr = std::make_unique<MetadataMap>(metadata_map);
   MetadataMapVector metadata_map_vector;
   metadata_map_vector.push_back(std::move(metadata_map_ptr));
-  EXPECT_DEATH(response_encoder_->encodeMetadata(metadata_map_vector), "panic: not implemented");
+  response_encoder_->encodeMetadata(metadata_map_vector);
+  ASSERT_EQ(on_metadata_calls, 1);
 }
 
 TEST_F(DispatcherTest, NullAccessors) {
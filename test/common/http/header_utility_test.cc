@@ -147,5 +147,20 @@ TEST(HeaderDataConstructorTest, FromCppToC) {
   release_envoy_headers(c_headers);
 }
 
+TEST(MetadataConstructorTest, FromCppToC) {
+  MetadataMap metadata = {{"key", "value"}, {"other-key", "other-value"}};
+
+  envoy_headers c_metadata = Utility::toBridgeMetadata(metadata);
+
+  ASSERT_EQ(c_metadata.length, static_cast<envoy_header_size_t>(metadata.size()));
+  for (envoy_header_size_t i = 0; i < c_metadata.length; i++) {
+    const std::string actual_key = Utility::convertToString(c_metadata.headers[i].key);
+    ASSERT_EQ(1, metadata.count(actual_key));
+    EXPECT_EQ(metadata[actual_key], Utility::convertToString(c_metadata.headers[i].value));
+  }
+
+  release_envoy_headers(c_metadata);
+}
+
 } // namespace Http
 } // namespace Envoy
@@ -0,0 +1,73 @@
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "library/common/http/stream_progress_table.h"
+
+namespace Envoy {
+namespace Http {
+
+class StreamProgressTableTest : public testing::Test {
+public:
+  StreamProgressTableSharedPtr table_{std::make_shared<StreamProgressTable>()};
+  envoy_stream_progress progress_{};
+};
+
+TEST_F(StreamProgressTableTest, TracksUntilUntracked) {
+  EXPECT_FALSE(table_->read(1, progress_));
+
+  StreamProgressSharedPtr progress = table_->track(1);
+  progress->bytes_sent_ = 6;
+  progress->state_ = ENVOY_STREAM_AWAITING_RESPONSE;
+  ASSERT_TRUE(table_->read(1, progress_));
+  EXPECT_EQ(6, progress_.bytes_sent);
+  EXPECT_EQ(ENVOY_STREAM_AWAITING_RESPONSE, progress_.state);
+  EXPECT_FALSE(table_->read(1 + StreamProgressTable::Slots, progress_));
+
+  table_->untrack(1);
+  EXPECT_FALSE(table_->read(1, progress_));
+}
+
+TEST_F(StreamProgressTableTest, ReleasingStopsTracking) {
+  // e.g. when the post which would have started the stream is dropped.
+  table_->track(1);
+  EXPECT_FALSE(table_->read(1, progress_));
+
+  // The slot is reused, starting from scratch.
+  StreamProgressSharedPtr progress = table_->track(1 + StreamProgressTable::Slots);
+  ASSERT_TRUE(table_->read(1 + StreamProgressTable::Slots, progress_));
+  EXPECT_EQ(0, progress_.bytes_sent);
+  EXPECT_EQ(ENVOY_STREAM_SENDING_REQUEST, progress_.state);
+}
+
+TEST_F(StreamProgressTableTest, SlotHeldByOlderStream) {
+  StreamProgressSharedPtr older = table_->track(1);
+  older->bytes_received_ = 1;
+  StreamProgressSharedPtr newer = table_->track(1 + StreamProgressTable::Slots);
+  newer->bytes_received_ = 2;
+
+  ASSERT_TRUE(table_->read(1, progress_));
+  EXPECT_EQ(1, progress_.bytes_received);
+  ASSERT_TRUE(table_->read(1 + StreamProgressTable::Slots, progress_));
+  EXPECT_EQ(2, progress_.bytes_received);
+
+  // The older stream's slot isn't reused while its progress is still referenced.
+  table_->untrack(1);
+  StreamProgressSharedPtr newest = table_->track(1 + 2 * StreamProgressTable::Slots);
+  older.reset();
+  ASSERT_TRUE(table_->read(1 + 2 * StreamProgressTable::Slots, progress_));
+  EXPECT_EQ(0, progress_.bytes_received);
+
+  table_->untrack(1 + StreamProgressTable::Slots);
+  EXPECT_FALSE(table_->read(1 + StreamProgressTable::Slots, progress_));
+  newer.reset();
+  ASSERT_TRUE(table_->read(1 + 2 * StreamProgressTable::Slots, progress_));
+}
+
+TEST_F(StreamProgressTableTest, ProgressOutlivesTable) {
+  StreamProgressSharedPtr progress = table_->track(1);
+  table_.reset();
+  progress->bytes_sent_ = 1;
+}
+
+} // namespace Http
+} // namespace Envoy
@@ -0,0 +1,189 @@
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "test/test_common/environment.h"
+#include "test/test_common/utility.h"
+
+#include "absl/synchronization/notification.h"
+#include "gtest/gtest.h"
+#include "library/common/http/header_utility.h"
+#include "library/common/ipc/engine_client.h"
+#include "library/common/ipc/protocol.h"
+#include "library/common/main_interface.h"
+
+namespace Envoy {
+namespace Ipc {
+namespace {
+
+// Larger than the host's high watermark, so that a client which doesn't read its response has
+// its responses paused.
+constexpr uint64_t BodyBytes = 4 * 1024 * 1024;
+
+// Every request is answered by the mock_response filter.
+const std::string config = R"EOF(
+static_resources:
+  listeners:
+  - name: base_api_listener
+    address:
+      socket_address:
+        address: 0.0.0.0
+        port_value: 10000
+    api_listener:
+      api_listener:
+        "@type": type.googleapis.com/envoy.extensions.filters.network.http_connection_manager.v3.HttpConnectionManager
+        stat_prefix: hcm
+        route_config:
+          name: api_router
+        http_filters:
+        - name: envoy.filters.http.mock_response
+          typed_config:
+            "@type": type.googleapis.com/envoymobile.extensions.filters.http.mock_response.MockResponse
+            body_bytes: 4194304
+            chunk_bytes: 16384
+)EOF";
+
+struct EngineContext {
+  absl::Notification on_engine_running;
+  absl::Notification on_exit;
+};
+
+struct StreamContext {
+  std::string status;
+  uint64_t body_bytes{};
+  absl::Notification on_complete;
+  absl::Notification on_error;
+};
+
+envoy_http_callbacks streamCallbacks(StreamContext& context) {
+  return {[](envoy_headers headers, bool, void* context) -> void* {
+            for (envoy_header_size_t i = 0; i < headers.length; i++) {
+              if (Http::Utility::convertToString(headers.headers[i].key) == ":status") {
+                static_cast<StreamContext*>(context)->status =
+                    Http::Utility::convertToString(headers.headers[i].value);
+              }
+            }
+            release_envoy_headers(headers);
+            return nullptr;
+          } /* on_headers */,
+          [](envoy_data data, bool, void* context) -> void* {
+            static_cast<StreamContext*>(context)->body_bytes += data.length;
+            data.release(data.context);
+            return nullptr;
+          } /* on_data */,
+          nullptr /* on_metadata */,
+          nullptr /* on_trailers */,
+          [](envoy_error error, void* context) -> void* {
+            error.message.release(error.message.context);
+            static_cast<StreamContext*>(context)->on_error.Notify();
+            return nullptr;
+          } /* on_error */,
+          [](void* context) -> void* {
+            static_cast<StreamContext*>(context)->on_complete.Notify();
+            return nullptr;
+          } /* on_complete */,
+          nullptr /* on_cancel */,
+          &context /* context */};
+}
+
+Http::TestRequestHeaderMapImpl requestHeaders() {
+  return {{":method", "GET"}, {":scheme", "https"}, {":authority", "example.com"}, {":path", "/"}};
+}
+
+class EngineHostTest : public testing::Test {
+protected:
+  void SetUp() override {
+    engine_ = init_engine();
+    envoy_engine_callbacks callbacks{[](void* context) -> void {
+                                       static_cast<EngineContext*>(context)
+                                           ->on_engine_running.Notify();
+                                     } /* on_engine_running */,
+                                     [](void* context) -> void {
+                                       static_cast<EngineContext*>(context)->on_exit.Notify();
+                                     } /* on_exit */,
+                                     &engine_context_ /* context */};
+    ASSERT_EQ(ENVOY_SUCCESS, run_engine(engine_, callbacks, config.c_str(), "warn"));
+    ASSERT_TRUE(
+        engine_context_.on_engine_running.WaitForNotificationWithTimeout(absl::Seconds(10)));
+
+    path_ = TestEnvironment::unixDomainSocketPath("engine_host");
+    ASSERT_EQ(ENVOY_SUCCESS, host_engine(engine_, path_.c_str()));
+  }
+
+  void TearDown() override {
+    terminate_engine(engine_);
+    ASSERT_TRUE(engine_context_.on_exit.WaitForNotificationWithTimeout(absl::Seconds(10)));
+  }
+
+  // Connects to the host without a client, to send and read messages directly.
+  int connectRaw() {
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path_.c_str(), sizeof(address.sun_path) - 1);
+    EXPECT_EQ(0, ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+    configureSocket(fd);
+    return fd;
+  }
+
+  // Runs a stream on the host through a client, as connect_to_engine() would.
+  void runStream(EngineClient& client, envoy_stream_t stream) {
+    StreamContext context;
+    ASSERT_EQ(ENVOY_SUCCESS, client.startStream(stream, streamCallbacks(context)));
+    ASSERT_EQ(ENVOY_SUCCESS,
+              client.sendHeaders(stream, Http::Utility::toBridgeHeaders(requestHeaders()), true));
+    ASSERT_TRUE(context.on_complete.WaitForNotificationWithTimeout(absl::Seconds(10)));
+    EXPECT_FALSE(context.on_error.HasBeenNotified());
+    EXPECT_EQ("200", context.status);
+    EXPECT_EQ(BodyBytes, context.body_bytes);
+  }
+
+  envoy_engine_t engine_;
+  EngineContext engine_context_;
+  std::string path_;
+};
+
+TEST_F(EngineHostTest, SocketIsOnlyAccessibleToItsUser) {
+  struct stat status;
+  ASSERT_EQ(0, ::stat(path_.c_str(), &status));
+  EXPECT_EQ(S_IRUSR | S_IWUSR, status.st_mode & (S_IRWXU | S_IRWXG | S_IRWXO));
+}
+
+TEST_F(EngineHostTest, RelaysStreams) {
+  EngineClient client;
+  ASSERT_EQ(ENVOY_SUCCESS, client.connect(path_));
+  runStream(client, 1);
+  runStream(client, 2);
+}
+
+TEST_F(EngineHostTest, SlowClientDoesNotStallOtherClients) {
+  // The slow client's response is queued for it, rather than blocking the engine.
+  const int slow_client = connectRaw();
+  ASSERT_TRUE(writeMessage(slow_client, MessageType::StartStream, 1, false, ""));
+  ASSERT_TRUE(writeMessage(slow_client, MessageType::SendHeaders, 1, true,
+                           encodeHeaders(requestHeaders())));
+
+  EngineClient client;
+  ASSERT_EQ(ENVOY_SUCCESS, client.connect(path_));
+  runStream(client, 1);
+
+  // Once the slow client reads, its paused response is resumed and sent in full.
+  uint64_t body_bytes = 0;
+  Message message;
+  while (readMessage(slow_client, message) && message.type_ != MessageType::OnComplete) {
+    EXPECT_NE(MessageType::OnError, message.type_);
+    if (message.type_ == MessageType::OnData) {
+      body_bytes += message.payload_.size();
+    }
+  }
+  EXPECT_EQ(MessageType::OnComplete, message.type_);
+  EXPECT_EQ(BodyBytes, body_bytes);
+  ::close(slow_client);
+}
+
+} // namespace
+} // namespace Ipc
+} // namespace Envoy
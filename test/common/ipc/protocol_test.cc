@@ -0,0 +1,113 @@
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "test/test_common/utility.h"
+
+#include "gtest/gtest.h"
+#include "library/common/http/header_utility.h"
+#include "library/common/ipc/protocol.h"
+
+namespace Envoy {
+namespace Ipc {
+namespace {
+
+class ProtocolTest : public testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds_));
+    configureSocket(fds_[0]);
+    configureSocket(fds_[1]);
+  }
+  void TearDown() override {
+    ::close(fds_[0]);
+    ::close(fds_[1]);
+  }
+
+  int fds_[2];
+};
+
+TEST_F(ProtocolTest, MessageRoundTrip) {
+  ASSERT_TRUE(writeMessage(fds_[0], MessageType::SendData, 42, true, "request body"));
+  ASSERT_TRUE(writeMessage(fds_[0], MessageType::OnComplete, 43, false, ""));
+
+  Message message;
+  ASSERT_TRUE(readMessage(fds_[1], message));
+  EXPECT_EQ(MessageType::SendData, message.type_);
+  EXPECT_EQ(42, message.stream_);
+  EXPECT_TRUE(message.end_stream_);
+  EXPECT_EQ("request body", message.payload_);
+
+  ASSERT_TRUE(readMessage(fds_[1], message));
+  EXPECT_EQ(MessageType::OnComplete, message.type_);
+  EXPECT_EQ(43, message.stream_);
+  EXPECT_FALSE(message.end_stream_);
+  EXPECT_EQ("", message.payload_);
+}
+
+TEST_F(ProtocolTest, ReadFailsOnClose) {
+  ::shutdown(fds_[0], SHUT_WR);
+  Message message;
+  EXPECT_FALSE(readMessage(fds_[1], message));
+}
+
+TEST_F(ProtocolTest, ReadFailsOnUnknownType) {
+  ASSERT_TRUE(writeMessage(fds_[0], static_cast<MessageType>(200), 1, false, ""));
+  Message message;
+  EXPECT_FALSE(readMessage(fds_[1], message));
+}
+
+TEST(IpcEncodingTest, BridgeHeadersToHeaderMap) {
+  Http::TestRequestHeaderMapImpl headers{{":method", "GET"}, {"x-custom", "a"}, {"x-custom", "b"}};
+  envoy_headers bridge_headers = Http::Utility::toBridgeHeaders(headers);
+  const std::string payload = encodeHeaders(bridge_headers);
+  release_envoy_headers(bridge_headers);
+
+  Http::TestRequestHeaderMapImpl decoded;
+  ASSERT_TRUE(decodeHeaders(payload, decoded));
+  EXPECT_EQ(headers, decoded);
+}
+
+TEST(IpcEncodingTest, HeaderMapToBridgeHeaders) {
+  Http::TestResponseHeaderMapImpl headers{{":status", "200"}, {"content-length", "0"}};
+  const std::string payload = encodeHeaders(headers);
+
+  envoy_headers bridge_headers;
+  ASSERT_TRUE(decodeHeaders(payload, bridge_headers));
+  ASSERT_EQ(2, bridge_headers.length);
+  EXPECT_EQ(":status", Http::Utility::convertToString(bridge_headers.headers[0].key));
+  EXPECT_EQ("200", Http::Utility::convertToString(bridge_headers.headers[0].value));
+  EXPECT_EQ("content-length", Http::Utility::convertToString(bridge_headers.headers[1].key));
+  EXPECT_EQ("0", Http::Utility::convertToString(bridge_headers.headers[1].value));
+  release_envoy_headers(bridge_headers);
+}
+
+TEST(IpcEncodingTest, MalformedHeaders) {
+  Http::TestResponseHeaderMapImpl headers{{":status", "200"}};
+  const std::string payload = encodeHeaders(headers);
+  const std::string truncated = payload.substr(0, payload.size() - 1);
+
+  Http::TestResponseHeaderMapImpl decoded;
+  EXPECT_FALSE(decodeHeaders(truncated, decoded));
+  envoy_headers bridge_headers;
+  EXPECT_FALSE(decodeHeaders(truncated, bridge_headers));
+}
+
+TEST(IpcEncodingTest, Error) {
+  envoy_error error;
+  ASSERT_TRUE(decodeError(encodeError({ENVOY_CONNECTION_FAILURE, "no route", 3}), error));
+  EXPECT_EQ(ENVOY_CONNECTION_FAILURE, error.error_code);
+  EXPECT_EQ(3, error.attempt_count);
+  EXPECT_EQ("no route", Http::Utility::convertToString(error.message));
+  error.message.release(error.message.context);
+
+  ASSERT_TRUE(decodeError(encodeError({ENVOY_STREAM_RESET, "", absl::nullopt}), error));
+  EXPECT_EQ(ENVOY_STREAM_RESET, error.error_code);
+  EXPECT_EQ(-1, error.attempt_count);
+  EXPECT_EQ(0, error.message.length);
+
+  EXPECT_FALSE(decodeError("abc", error));
+}
+
+} // namespace
+} // namespace Ipc
+} // namespace Envoy
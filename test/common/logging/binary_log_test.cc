@@ -0,0 +1,132 @@
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "common/common/logger.h"
+
+#include "test/test_common/utility.h"
+
+#include "gtest/gtest.h"
+#include "library/common/logging/binary_log.h"
+
+namespace Envoy {
+namespace Logging {
+namespace {
+
+class BinaryLogTest : public testing::Test, public Logger::Loggable<Logger::Id::testing> {
+protected:
+  void SetUp() override {
+    level_ = ENVOY_LOGGER().level();
+    ENVOY_LOGGER().set_level(spdlog::level::debug);
+    BinaryLog::resetForTest();
+    BinaryLog::setEnabled(true);
+  }
+  void TearDown() override {
+    BinaryLog::setEnabled(false);
+    ENVOY_LOGGER().set_level(level_);
+  }
+
+  std::string dump() {
+    std::ostringstream os;
+    BinaryLog::dump(os);
+    return os.str();
+  }
+
+  std::string dumpOnCrash() {
+    std::ostringstream os;
+    BinaryLog::dumpOnCrash(os);
+    return os.str();
+  }
+
+  spdlog::level::level_enum level_;
+};
+
+TEST_F(BinaryLogTest, FormatsRecordsWhenDumped) {
+  ENVOY_MOBILE_LOG(debug, "[S{}] stream (end_stream={} length={}) via {}", 7, true, 12u, "h2");
+  ENVOY_MOBILE_LOG(debug, "no arguments {{}}");
+
+  const std::string output = dump();
+  EXPECT_NE(std::string::npos, output.find("] [S7] stream (end_stream=true length=12) via h2\n"));
+  EXPECT_NE(std::string::npos, output.find("] no arguments {}\n"));
+  EXPECT_NE(std::string::npos, output.find("binary_log_test.cc:"));
+  // Records are dumped oldest first.
+  EXPECT_LT(output.find("[S7]"), output.find("no arguments"));
+}
+
+TEST_F(BinaryLogTest, CapturesHeaders) {
+  Http::TestRequestHeaderMapImpl headers{{":method", "GET"}, {":authority", "example.com"}};
+  ENVOY_MOBILE_LOG(debug, "headers:\n{}", headers);
+
+  const std::string output = dump();
+  EXPECT_NE(std::string::npos, output.find(":method: GET\n:authority: example.com\n"));
+  EXPECT_EQ(std::string::npos, output.find("[truncated]"));
+}
+
+TEST_F(BinaryLogTest, TruncatesLargeArguments) {
+  const std::string large(BinaryLog::PayloadBytes * 2, 'a');
+  ENVOY_MOBILE_LOG(debug, "large {} {}", large, 1);
+
+  const std::string output = dump();
+  EXPECT_NE(std::string::npos, output.find("large aaaa"));
+  EXPECT_NE(std::string::npos, output.find("[truncated]"));
+  EXPECT_EQ(std::string::npos, output.find(large));
+}
+
+TEST_F(BinaryLogTest, DisabledDoesNotRecord) {
+  BinaryLog::setEnabled(false);
+  ENVOY_MOBILE_LOG(debug, "not recorded {}", 1);
+
+  EXPECT_EQ("", dump());
+}
+
+TEST_F(BinaryLogTest, DisabledLevelDoesNotRecord) {
+  ENVOY_MOBILE_LOG(trace, "not recorded {}", 1);
+
+  EXPECT_EQ("", dump());
+}
+
+TEST_F(BinaryLogTest, CrashDumpMatchesDump) {
+  ENVOY_MOBILE_LOG(debug, "[S{}] stream (end_stream={} length={}) via {}", 7, false, 12u, "h2");
+  std::thread([]() {
+    ENVOY_MOBILE_LOG(debug, "other thread {} {}", 1.5, "h3");
+  }).join();
+  ENVOY_MOBILE_LOG(debug, "last {}");
+
+  const std::string output = dumpOnCrash();
+  EXPECT_EQ(dump(), output);
+  EXPECT_NE(std::string::npos, output.find("] other thread 1.5 h3\n"));
+  // Records from all threads are merged oldest first.
+  EXPECT_LT(output.find("[S7]"), output.find("other thread"));
+  EXPECT_LT(output.find("other thread"), output.find("last ?"));
+}
+
+TEST_F(BinaryLogTest, ReusesRingsOfExitedThreads) {
+  std::thread([]() { ENVOY_MOBILE_LOG(debug, "thread {}", 0); }).join();
+  const size_t ring_count = BinaryLog::ringCount();
+  for (int i = 1; i < 4; i++) {
+    std::thread([i]() { ENVOY_MOBILE_LOG(debug, "thread {}", i); }).join();
+  }
+  EXPECT_EQ(ring_count, BinaryLog::ringCount());
+
+  // The records of exited threads are kept until they are overwritten.
+  const std::string output = dump();
+  for (int i = 0; i < 4; i++) {
+    EXPECT_NE(std::string::npos, output.find(absl::StrCat("] thread ", i, "\n")));
+  }
+}
+
+TEST_F(BinaryLogTest, KeepsMostRecentRecords) {
+  for (size_t i = 0; i < BinaryLog::RingSlots + 10; i++) {
+    ENVOY_MOBILE_LOG(debug, "record {}", i);
+  }
+
+  const std::string output = dump();
+  EXPECT_EQ(std::string::npos, output.find("record 9\n"));
+  EXPECT_NE(std::string::npos, output.find("record 10\n"));
+  EXPECT_NE(std::string::npos,
+            output.find(absl::StrCat("record ", BinaryLog::RingSlots + 9, "\n")));
+}
+
+} // namespace
+} // namespace Logging
+} // namespace Envoy
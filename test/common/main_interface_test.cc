@@ -45,6 +45,7 @@ Http::ResponseHeaderMapPtr toResponseHeaders(envoy_headers headers) {
 }
 
 TEST(MainInterfaceTest, BasicStream) {
+  const envoy_engine_t engine = init_engine();
   const std::string config =
       "{\"admin\":{},\"static_resources\":{\"listeners\":[{\"name\":\"base_api_listener\", "
       "\"address\":{\"socket_address\":{\"protocol\":\"TCP\",\"address\":\"0.0.0.0\",\"port_"
@@ -74,7 +75,7 @@ TEST(MainInterfaceTest, BasicStream) {
                                       exit->on_exit.Notify();
                                     } /*on_exit*/,
                                     &engine_cbs_context /*context*/};
-  run_engine(0, engine_cbs, config.c_str(), level.c_str());
+  run_engine(engine, engine_cbs, config.c_str(), level.c_str());
 
   ASSERT_TRUE(
       engine_cbs_context.on_engine_running.WaitForNotificationWithTimeout(absl::Seconds(10)));
@@ -108,7 +109,7 @@ TEST(MainInterfaceTest, BasicStream) {
   Http::TestRequestTrailerMapImpl trailers;
   envoy_headers c_trailers = Http::Utility::toBridgeHeaders(trailers);
 
-  envoy_stream_t stream = init_stream(0);
+  envoy_stream_t stream = init_stream(engine);
 
   start_stream(stream, stream_cbs);
 
@@ -118,12 +119,13 @@ TEST(MainInterfaceTest, BasicStream) {
 
   ASSERT_TRUE(on_complete_notification.WaitForNotificationWithTimeout(absl::Seconds(10)));
 
-  terminate_engine(0);
+  terminate_engine(engine);
 
   ASSERT_TRUE(engine_cbs_context.on_exit.WaitForNotificationWithTimeout(absl::Seconds(10)));
 }
 
 TEST(MainInterfaceTest, SendMetadata) {
+  const envoy_engine_t engine = init_engine();
   engine_test_context engine_cbs_context{};
   envoy_engine_callbacks engine_cbs{[](void* context) -> void {
                                       auto* engine_running =
@@ -138,7 +140,7 @@ TEST(MainInterfaceTest, SendMetadata) {
 
   // There is nothing functional about the config used to run the engine, as the created stream is
   // only used for send_metadata.
-  run_engine(0, engine_cbs, MINIMAL_NOOP_CONFIG.c_str(), LEVEL_DEBUG.c_str());
+  run_engine(engine, engine_cbs, MINIMAL_NOOP_CONFIG.c_str(), LEVEL_DEBUG.c_str());
 
   ASSERT_TRUE(
       engine_cbs_context.on_engine_running.WaitForNotificationWithTimeout(absl::Seconds(10)));
@@ -148,18 +150,19 @@ TEST(MainInterfaceTest, SendMetadata) {
                                   nullptr /* on_error */,    nullptr /* on_complete */,
                                   nullptr /* on_cancel */,   nullptr /* context */};
 
-  envoy_stream_t stream = init_stream(0);
+  envoy_stream_t stream = init_stream(engine);
 
   start_stream(stream, stream_cbs);
 
   EXPECT_EQ(ENVOY_FAILURE, send_metadata(stream, {}));
 
-  terminate_engine(0);
+  terminate_engine(engine);
 
   ASSERT_TRUE(engine_cbs_context.on_exit.WaitForNotificationWithTimeout(absl::Seconds(10)));
 }
 
 TEST(MainInterfaceTest, ResetStream) {
+  const envoy_engine_t engine = init_engine();
   engine_test_context engine_cbs_context{};
   envoy_engine_callbacks engine_cbs{[](void* context) -> void {
                                       auto* engine_running =
@@ -174,7 +177,7 @@ TEST(MainInterfaceTest, ResetStream) {
 
   // There is nothing functional about the config used to run the engine, as the created stream is
   // immediately reset.
-  run_engine(0, engine_cbs, MINIMAL_NOOP_CONFIG.c_str(), LEVEL_DEBUG.c_str());
+  run_engine(engine, engine_cbs, MINIMAL_NOOP_CONFIG.c_str(), LEVEL_DEBUG.c_str());
 
   ASSERT_TRUE(
       engine_cbs_context.on_engine_running.WaitForNotificationWithTimeout(absl::Seconds(10)));
@@ -194,7 +197,7 @@ TEST(MainInterfaceTest, ResetStream) {
                                   } /* on_cancel */,
                                   &on_cancel_notification /* context */};
 
-  envoy_stream_t stream = init_stream(0);
+  envoy_stream_t stream = init_stream(engine);
 
   start_stream(stream, stream_cbs);
 
@@ -202,7 +205,7 @@ TEST(MainInterfaceTest, ResetStream) {
 
   ASSERT_TRUE(on_cancel_notification.WaitForNotificationWithTimeout(absl::Seconds(10)));
 
-  terminate_engine(0);
+  terminate_engine(engine);
 
   ASSERT_TRUE(engine_cbs_context.on_exit.WaitForNotificationWithTimeout(absl::Seconds(10)));
 }
@@ -231,6 +234,7 @@ TEST(MainInterfaceTest, UsingMainInterfaceWithoutARunningEngine) {
 }
 
 TEST(MainInterfaceTest, RegisterPlatformApi) {
+  const envoy_engine_t engine = init_engine();
   engine_test_context engine_cbs_context{};
   envoy_engine_callbacks engine_cbs{[](void* context) -> void {
                                       auto* engine_running =
@@ -244,22 +248,151 @@ TEST(MainInterfaceTest, RegisterPlatformApi) {
                                     &engine_cbs_context /*context*/};
 
   // Using the minimal envoy mobile config that allows for running the engine.
-  run_engine(0, engine_cbs, MINIMAL_NOOP_CONFIG.c_str(), LEVEL_DEBUG.c_str());
+  run_engine(engine, engine_cbs, MINIMAL_NOOP_CONFIG.c_str(), LEVEL_DEBUG.c_str());
 
   ASSERT_TRUE(
       engine_cbs_context.on_engine_running.WaitForNotificationWithTimeout(absl::Seconds(10)));
 
   EXPECT_EQ(ENVOY_SUCCESS, register_platform_api("api", nullptr));
 
-  terminate_engine(0);
+  terminate_engine(engine);
 
   ASSERT_TRUE(engine_cbs_context.on_exit.WaitForNotificationWithTimeout(absl::Seconds(10)));
 }
 
-TEST(MainInterfaceTest, InitEngineReturns1) {
-  // TODO(goaway): return new handle once multiple engine support is in place.
-  // https://github.com/lyft/envoy-mobile/issues/332
-  ASSERT_EQ(1, init_engine());
+TEST(MainInterfaceTest, InitEngineReturnsDistinctHandles) {
+  const envoy_engine_t first = init_engine();
+  const envoy_engine_t second = init_engine();
+  EXPECT_NE(0, first);
+  EXPECT_NE(0, second);
+  EXPECT_NE(first, second);
+
+  // Streams are scoped to their engine.
+  EXPECT_NE(init_stream(first), init_stream(second));
+  EXPECT_NE(init_stream_group(first), init_stream_group(second));
+
+  terminate_engine(second);
+  terminate_engine(first);
+}
+
+TEST(MainInterfaceTest, RegisterEnginePlatformApi) {
+  const envoy_engine_t engine = init_engine();
+  EXPECT_EQ(ENVOY_SUCCESS, register_engine_platform_api(engine, "api", nullptr));
+  terminate_engine(engine);
+  EXPECT_EQ(ENVOY_FAILURE, register_engine_platform_api(engine, "api", nullptr));
+}
+
+TEST(MainInterfaceTest, IndependentEngines) {
+  engine_test_context first_context{};
+  engine_test_context second_context{};
+  auto engine_callbacks = [](engine_test_context& context) -> envoy_engine_callbacks {
+    return {[](void* context) -> void {
+              static_cast<engine_test_context*>(context)->on_engine_running.Notify();
+            } /*on_engine_running*/,
+            [](void* context) -> void {
+              static_cast<engine_test_context*>(context)->on_exit.Notify();
+            } /*on_exit*/,
+            &context /*context*/};
+  };
+
+  const envoy_engine_t first = init_engine();
+  const envoy_engine_t second = init_engine();
+  ASSERT_EQ(ENVOY_SUCCESS, run_engine(first, engine_callbacks(first_context),
+                                      MINIMAL_NOOP_CONFIG.c_str(), LEVEL_DEBUG.c_str()));
+  ASSERT_EQ(ENVOY_SUCCESS, run_engine(second, engine_callbacks(second_context),
+                                      MINIMAL_NOOP_CONFIG.c_str(), LEVEL_DEBUG.c_str()));
+  // An engine handle runs a single engine.
+  EXPECT_EQ(ENVOY_FAILURE, run_engine(first, engine_callbacks(first_context),
+                                      MINIMAL_NOOP_CONFIG.c_str(), LEVEL_DEBUG.c_str()));
+  ASSERT_TRUE(first_context.on_engine_running.WaitForNotificationWithTimeout(absl::Seconds(10)));
+  ASSERT_TRUE(second_context.on_engine_running.WaitForNotificationWithTimeout(absl::Seconds(10)));
+
+  // Each stream is cancelled by the engine it was initialized with.
+  absl::Notification first_cancelled;
+  absl::Notification second_cancelled;
+  auto stream_callbacks = [](absl::Notification& cancelled) -> envoy_http_callbacks {
+    return {nullptr /* on_headers */,
+            nullptr /* on_data */,
+            nullptr /* on_metadata */,
+            nullptr /* on_trailers */,
+            nullptr /* on_error */,
+            nullptr /* on_complete */,
+            [](void* context) -> void* {
+              static_cast<absl::Notification*>(context)->Notify();
+              return nullptr;
+            } /* on_cancel */,
+            &cancelled /* context */};
+  };
+  const envoy_stream_t first_stream = init_stream(first);
+  const envoy_stream_t second_stream = init_stream(second);
+  ASSERT_EQ(ENVOY_SUCCESS, start_stream(first_stream, stream_callbacks(first_cancelled)));
+  ASSERT_EQ(ENVOY_SUCCESS, start_stream(second_stream, stream_callbacks(second_cancelled)));
+  reset_stream(second_stream);
+  ASSERT_TRUE(second_cancelled.WaitForNotificationWithTimeout(absl::Seconds(10)));
+  EXPECT_FALSE(first_cancelled.HasBeenNotified());
+  reset_stream(first_stream);
+  ASSERT_TRUE(first_cancelled.WaitForNotificationWithTimeout(absl::Seconds(10)));
+
+  // Terminating an engine leaves the other running.
+  terminate_engine(second);
+  ASSERT_TRUE(second_context.on_exit.WaitForNotificationWithTimeout(absl::Seconds(10)));
+  EXPECT_EQ(ENVOY_FAILURE, record_counter(second, "counter", 1));
+  EXPECT_EQ(ENVOY_SUCCESS, record_counter(first, "counter", 1));
+  EXPECT_FALSE(first_context.on_exit.HasBeenNotified());
+
+  terminate_engine(first);
+  ASSERT_TRUE(first_context.on_exit.WaitForNotificationWithTimeout(absl::Seconds(10)));
+}
+
+TEST(MainInterfaceTest, EnginesAreTornDownInReverseOrder) {
+  engine_test_context first_context{};
+  engine_test_context second_context{};
+  auto engine_callbacks = [](engine_test_context& context) -> envoy_engine_callbacks {
+    return {[](void* context) -> void {
+              static_cast<engine_test_context*>(context)->on_engine_running.Notify();
+            } /*on_engine_running*/,
+            [](void* context) -> void {
+              static_cast<engine_test_context*>(context)->on_exit.Notify();
+            } /*on_exit*/,
+            &context /*context*/};
+  };
+
+  const envoy_engine_t first = init_engine();
+  const envoy_engine_t second = init_engine();
+  ASSERT_EQ(ENVOY_SUCCESS, run_engine(first, engine_callbacks(first_context),
+                                      MINIMAL_NOOP_CONFIG.c_str(), LEVEL_DEBUG.c_str()));
+  ASSERT_TRUE(first_context.on_engine_running.WaitForNotificationWithTimeout(absl::Seconds(10)));
+  ASSERT_EQ(ENVOY_SUCCESS, run_engine(second, engine_callbacks(second_context),
+                                      MINIMAL_NOOP_CONFIG.c_str(), LEVEL_DEBUG.c_str()));
+  ASSERT_TRUE(second_context.on_engine_running.WaitForNotificationWithTimeout(absl::Seconds(10)));
+
+  // The first engine's handle is released at once, but the engine outlives the second one.
+  terminate_engine(first);
+  EXPECT_EQ(ENVOY_FAILURE, record_counter(first, "counter", 1));
+  EXPECT_FALSE(first_context.on_exit.HasBeenNotified());
+  EXPECT_EQ(ENVOY_SUCCESS, record_counter(second, "counter", 1));
+
+  terminate_engine(second);
+  EXPECT_TRUE(second_context.on_exit.HasBeenNotified());
+  EXPECT_TRUE(first_context.on_exit.HasBeenNotified());
+}
+
+TEST(MainInterfaceTest, TerminateEngineFromCallback) {
+  struct Context {
+    envoy_engine_t engine;
+    absl::Notification on_exit;
+  } context;
+  context.engine = init_engine();
+  envoy_engine_callbacks engine_callbacks{
+      [](void* context) -> void {
+        // The engine is terminated on its own thread.
+        terminate_engine(static_cast<Context*>(context)->engine);
+      } /*on_engine_running*/,
+      [](void* context) -> void { static_cast<Context*>(context)->on_exit.Notify(); } /*on_exit*/,
+      &context /*context*/};
+  ASSERT_EQ(ENVOY_SUCCESS, run_engine(context.engine, engine_callbacks, MINIMAL_NOOP_CONFIG.c_str(),
+                                      LEVEL_DEBUG.c_str()));
+  ASSERT_TRUE(context.on_exit.WaitForNotificationWithTimeout(absl::Seconds(10)));
 }
 
 TEST(MainInterfaceTest, PreferredNetwork) {
@@ -267,6 +400,7 @@ TEST(MainInterfaceTest, PreferredNetwork) {
 }
 
 TEST(EngineTest, RecordCounter) {
+  const envoy_engine_t engine = init_engine();
   engine_test_context test_context{};
   envoy_engine_callbacks callbacks{[](void* context) -> void {
                                      auto* engine_running =
@@ -278,16 +412,17 @@ TEST(EngineTest, RecordCounter) {
                                      exit->on_exit.Notify();
                                    } /*on_exit*/,
                                    &test_context /*context*/};
-  EXPECT_EQ(ENVOY_FAILURE, record_counter(0, "counter", 1));
-  run_engine(0, callbacks, MINIMAL_NOOP_CONFIG.c_str(), LEVEL_DEBUG.c_str());
+  EXPECT_EQ(ENVOY_FAILURE, record_counter(engine, "counter", 1));
+  run_engine(engine, callbacks, MINIMAL_NOOP_CONFIG.c_str(), LEVEL_DEBUG.c_str());
   ASSERT_TRUE(test_context.on_engine_running.WaitForNotificationWithTimeout(absl::Seconds(3)));
-  EXPECT_EQ(ENVOY_SUCCESS, record_counter(0, "counter", 1));
+  EXPECT_EQ(ENVOY_SUCCESS, record_counter(engine, "counter", 1));
 
-  terminate_engine(0);
+  terminate_engine(engine);
   ASSERT_TRUE(test_context.on_exit.WaitForNotificationWithTimeout(absl::Seconds(3)));
 }
 
 TEST(EngineTest, SetGauge) {
+  const envoy_engine_t engine = init_engine();
   engine_test_context test_context{};
   envoy_engine_callbacks callbacks{[](void* context) -> void {
                                      auto* engine_running =
@@ -299,18 +434,19 @@ TEST(EngineTest, SetGauge) {
                                      exit->on_exit.Notify();
                                    } /*on_exit*/,
                                    &test_context /*context*/};
-  EXPECT_EQ(ENVOY_FAILURE, record_gauge_set(0, "gauge", 1));
-  run_engine(0, callbacks, MINIMAL_NOOP_CONFIG.c_str(), LEVEL_DEBUG.c_str());
+  EXPECT_EQ(ENVOY_FAILURE, record_gauge_set(engine, "gauge", 1));
+  run_engine(engine, callbacks, MINIMAL_NOOP_CONFIG.c_str(), LEVEL_DEBUG.c_str());
 
   ASSERT_TRUE(test_context.on_engine_running.WaitForNotificationWithTimeout(absl::Seconds(3)));
 
-  EXPECT_EQ(ENVOY_SUCCESS, record_gauge_set(0, "gauge", 1));
+  EXPECT_EQ(ENVOY_SUCCESS, record_gauge_set(engine, "gauge", 1));
 
-  terminate_engine(0);
+  terminate_engine(engine);
   ASSERT_TRUE(test_context.on_exit.WaitForNotificationWithTimeout(absl::Seconds(3)));
 }
 
 TEST(EngineTest, AddToGauge) {
+  const envoy_engine_t engine = init_engine();
   engine_test_context test_context{};
   envoy_engine_callbacks callbacks{[](void* context) -> void {
                                      auto* engine_running =
@@ -322,18 +458,19 @@ TEST(EngineTest, AddToGauge) {
                                      exit->on_exit.Notify();
                                    } /*on_exit*/,
                                    &test_context /*context*/};
-  EXPECT_EQ(ENVOY_FAILURE, record_gauge_add(0, "gauge", 30));
+  EXPECT_EQ(ENVOY_FAILURE, record_gauge_add(engine, "gauge", 30));
 
-  run_engine(0, callbacks, MINIMAL_NOOP_CONFIG.c_str(), LEVEL_DEBUG.c_str());
+  run_engine(engine, callbacks, MINIMAL_NOOP_CONFIG.c_str(), LEVEL_DEBUG.c_str());
   ASSERT_TRUE(test_context.on_engine_running.WaitForNotificationWithTimeout(absl::Seconds(3)));
 
-  EXPECT_EQ(ENVOY_SUCCESS, record_gauge_add(0, "gauge", 30));
+  EXPECT_EQ(ENVOY_SUCCESS, record_gauge_add(engine, "gauge", 30));
 
-  terminate_engine(0);
+  terminate_engine(engine);
   ASSERT_TRUE(test_context.on_exit.WaitForNotificationWithTimeout(absl::Seconds(3)));
 }
 
 TEST(EngineTest, SubFromGauge) {
+  const envoy_engine_t engine = init_engine();
   engine_test_context test_context{};
   envoy_engine_callbacks callbacks{[](void* context) -> void {
                                      auto* engine_running =
@@ -345,16 +482,16 @@ TEST(EngineTest, SubFromGauge) {
                                      exit->on_exit.Notify();
                                    } /*on_exit*/,
                                    &test_context /*context*/};
-  EXPECT_EQ(ENVOY_FAILURE, record_gauge_sub(0, "gauge", 30));
+  EXPECT_EQ(ENVOY_FAILURE, record_gauge_sub(engine, "gauge", 30));
 
-  run_engine(0, callbacks, MINIMAL_NOOP_CONFIG.c_str(), LEVEL_DEBUG.c_str());
+  run_engine(engine, callbacks, MINIMAL_NOOP_CONFIG.c_str(), LEVEL_DEBUG.c_str());
   ASSERT_TRUE(test_context.on_engine_running.WaitForNotificationWithTimeout(absl::Seconds(3)));
 
-  record_gauge_add(0, "gauge", 30);
+  record_gauge_add(engine, "gauge", 30);
 
-  EXPECT_EQ(ENVOY_SUCCESS, record_gauge_sub(0, "gauge", 30));
+  EXPECT_EQ(ENVOY_SUCCESS, record_gauge_sub(engine, "gauge", 30));
 
-  terminate_engine(0);
+  terminate_engine(engine);
   ASSERT_TRUE(test_context.on_exit.WaitForNotificationWithTimeout(absl::Seconds(3)));
 }
 
@@ -0,0 +1,93 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "test/test_common/environment.h"
+#include "test/test_common/utility.h"
+
+#include "gtest/gtest.h"
+#include "library/common/memory/heap_profiler.h"
+
+namespace Envoy {
+namespace Memory {
+namespace {
+
+class HeapProfilerTest : public testing::Test {
+protected:
+  void SetUp() override { HeapProfiler::resetForTest(); }
+};
+
+TEST_F(HeapProfilerTest, ParseProfile) {
+  const std::string profile = "heap profile:    3:   1536 [     3:   1536] @ heap_v2/524288\n"
+                              "     2:   1024 [     2:   1024] @ 0x4a10 0x4b20 0x4c30\n"
+                              "     1:    512 [     1:    512] @ 0x5d40\n"
+                              "\n"
+                              "MAPPED_LIBRARIES:\n"
+                              "00400000-00500000 r-xp 00000000 08:01 1234 /envoy\n";
+
+  const std::vector<AllocationSite> sites = HeapProfiler::parseProfile(profile);
+  ASSERT_EQ(2UL, sites.size());
+  EXPECT_EQ(2, sites[0].count_);
+  EXPECT_EQ(1024, sites[0].bytes_);
+  EXPECT_EQ((std::vector<uintptr_t>{0x4a10, 0x4b20, 0x4c30}), sites[0].frames_);
+  EXPECT_EQ(1, sites[1].count_);
+  EXPECT_EQ(512, sites[1].bytes_);
+  EXPECT_EQ((std::vector<uintptr_t>{0x5d40}), sites[1].frames_);
+}
+
+TEST_F(HeapProfilerTest, ParseEmptyProfile) {
+  EXPECT_TRUE(HeapProfiler::parseProfile("").empty());
+  EXPECT_TRUE(HeapProfiler::parseProfile("heap profile: 0: 0 [ 0: 0] @ heapprofile\n").empty());
+}
+
+TEST_F(HeapProfilerTest, ComponentOf) {
+  EXPECT_EQ("bridge", HeapProfiler::componentOf(
+                          {"tc_new", "Envoy::Buffer::Utility::copyToBridgeData()",
+                           "Envoy::Http::Dispatcher::DirectStreamCallbacks::encodeData()"}));
+  EXPECT_EQ("dns_cache",
+            HeapProfiler::componentOf(
+                {"operator new()",
+                 "Envoy::Extensions::Common::DynamicForwardProxy::DnsCacheImpl::startResolve()"}));
+  // The innermost frame belonging to a component decides.
+  EXPECT_EQ("stats", HeapProfiler::componentOf(
+                         {"Envoy::Stats::ThreadLocalStoreImpl::counterFromStatName()",
+                          "Envoy::Http::Http2::ConnPoolImpl::createCodecClient()"}));
+  EXPECT_EQ("connection_pool",
+            HeapProfiler::componentOf({"Envoy::Http::Http2::ConnPoolImpl::createCodecClient()"}));
+  EXPECT_EQ("other", HeapProfiler::componentOf({"tc_new", "main"}));
+  EXPECT_EQ("other", HeapProfiler::componentOf({}));
+}
+
+TEST_F(HeapProfilerTest, DeltaRequiresMark) {
+  EXPECT_FALSE(HeapProfiler::dumpDeltaSinceMark(TestEnvironment::temporaryPath("heap_delta"), 10));
+}
+
+TEST_F(HeapProfilerTest, DeltaSinceMark) {
+  if (!HeapProfiler::available()) {
+    HeapStats stats;
+    EXPECT_FALSE(HeapProfiler::stats(stats));
+    EXPECT_FALSE(HeapProfiler::mark());
+    EXPECT_FALSE(HeapProfiler::dumpSummary(TestEnvironment::temporaryPath("heap_summary"), 10));
+    return;
+  }
+
+  HeapStats before;
+  ASSERT_TRUE(HeapProfiler::stats(before));
+  EXPECT_LE(before.allocated_bytes_, before.heap_bytes_);
+  EXPECT_GE(before.fragmentation_, 0);
+  EXPECT_LE(before.fragmentation_, 1);
+
+  ASSERT_TRUE(HeapProfiler::mark());
+  auto held = std::make_unique<char[]>(4 << 20);
+  const std::string path = TestEnvironment::temporaryPath("heap_delta");
+  ASSERT_TRUE(HeapProfiler::dumpDeltaSinceMark(path, 10));
+
+  const std::string delta = TestEnvironment::readFileToStringForTest(path);
+  EXPECT_NE(std::string::npos, delta.find("allocated bytes since mark: "));
+  EXPECT_NE(std::string::npos, delta.find("top growing sites:"));
+  held.reset();
+}
+
+} // namespace
+} // namespace Memory
+} // namespace Envoy
@@ -0,0 +1,102 @@
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "library/common/memory/stream_arena.h"
+
+namespace Envoy {
+namespace Memory {
+namespace {
+
+bool aligned(const void* pointer, size_t alignment) {
+  return reinterpret_cast<uintptr_t>(pointer) % alignment == 0;
+}
+
+TEST(StreamArenaTest, AllocationsShareBlocks) {
+  StreamArena arena(1024);
+  EXPECT_EQ(0, arena.blockCount());
+
+  void* first = arena.allocate(100);
+  void* second = arena.allocate(100);
+  EXPECT_EQ(1, arena.blockCount());
+  EXPECT_EQ(200, arena.bytesAllocated());
+  EXPECT_TRUE(aligned(first, alignof(std::max_align_t)));
+  EXPECT_TRUE(aligned(second, alignof(std::max_align_t)));
+  EXPECT_GE(static_cast<uint8_t*>(second) - static_cast<uint8_t*>(first), 100);
+
+  // Allocations which don't fit in the current block start a new one.
+  arena.allocate(900);
+  EXPECT_EQ(2, arena.blockCount());
+}
+
+TEST(StreamArenaTest, Alignment) {
+  StreamArena arena(1024);
+  arena.allocate(1, 1);
+  EXPECT_TRUE(aligned(arena.allocate(8, 8), 8));
+  arena.allocate(1, 1);
+  EXPECT_TRUE(aligned(arena.allocate(64, 64), 64));
+  EXPECT_EQ(1, arena.blockCount());
+}
+
+TEST(StreamArenaTest, OversizedAllocation) {
+  StreamArena arena(64);
+  void* small = arena.allocate(16);
+  void* large = arena.allocate(1000, 128);
+  EXPECT_TRUE(aligned(large, 128));
+  EXPECT_EQ(2, arena.blockCount());
+
+  // The current block is still used after an oversized allocation.
+  void* next = arena.allocate(16);
+  EXPECT_EQ(2, arena.blockCount());
+  EXPECT_GE(static_cast<uint8_t*>(next) - static_cast<uint8_t*>(small), 16);
+  EXPECT_LT(static_cast<uint8_t*>(next) - static_cast<uint8_t*>(small), 64);
+}
+
+struct Tracked {
+  Tracked(int& destroyed, std::string value) : destroyed_(destroyed), value_(std::move(value)) {}
+  ~Tracked() { destroyed_++; }
+
+  int& destroyed_;
+  std::string value_;
+};
+
+TEST(StreamArenaTest, ArenaPtr) {
+  int destroyed = 0;
+  StreamArena arena(1024);
+  {
+    ArenaPtr<Tracked> in_arena = makeArenaPtr<Tracked>(&arena, destroyed, "arena");
+    ArenaPtr<Tracked> on_heap = makeArenaPtr<Tracked>(nullptr, destroyed, "heap");
+    EXPECT_EQ("arena", in_arena->value_);
+    EXPECT_EQ("heap", on_heap->value_);
+    EXPECT_EQ(1, arena.blockCount());
+  }
+  // Both objects are destroyed, whether or not they live in the arena.
+  EXPECT_EQ(2, destroyed);
+}
+
+TEST(StreamArenaTest, SharedObjectsKeepArenaAlive) {
+  int destroyed = 0;
+  std::weak_ptr<StreamArena> weak_arena;
+  std::shared_ptr<Tracked> object;
+  {
+    auto arena = std::make_shared<StreamArena>(1024);
+    weak_arena = arena;
+    object = makeArenaShared<Tracked>(arena, destroyed, "shared");
+    EXPECT_EQ(1, arena->blockCount());
+  }
+  EXPECT_FALSE(weak_arena.expired());
+  EXPECT_EQ("shared", object->value_);
+
+  object.reset();
+  EXPECT_EQ(1, destroyed);
+  EXPECT_TRUE(weak_arena.expired());
+
+  // Without an arena, objects are allocated on the heap.
+  EXPECT_NE(nullptr, makeArenaShared<Tracked>(nullptr, destroyed, "heap"));
+  EXPECT_EQ(2, destroyed);
+}
+
+} // namespace
+} // namespace Memory
+} // namespace Envoy
@@ -0,0 +1,62 @@
+#include <memory>
+
+#include "common/network/address_impl.h"
+
+#include "gtest/gtest.h"
+#include "library/common/network/connection_coalescing.h"
+
+namespace Envoy {
+namespace Network {
+namespace {
+
+TEST(ConnectionCoalescingTest, DnsNameMatch) {
+  EXPECT_TRUE(ConnectionCoalescing::dnsNameMatch("api.example.com", "api.example.com"));
+  EXPECT_TRUE(ConnectionCoalescing::dnsNameMatch("API.example.com", "api.EXAMPLE.com"));
+  EXPECT_TRUE(ConnectionCoalescing::dnsNameMatch("img.example.com", "*.example.com"));
+  EXPECT_FALSE(ConnectionCoalescing::dnsNameMatch("example.com", "*.example.com"));
+  EXPECT_FALSE(ConnectionCoalescing::dnsNameMatch("a.img.example.com", "*.example.com"));
+  EXPECT_FALSE(ConnectionCoalescing::dnsNameMatch(".example.com", "*.example.com"));
+  EXPECT_FALSE(ConnectionCoalescing::dnsNameMatch("img.example.org", "*.example.com"));
+  EXPECT_FALSE(ConnectionCoalescing::dnsNameMatch("img.example.com", "img.*.com"));
+}
+
+TEST(ConnectionCoalescingTest, Covers) {
+  // Two hosts whose names resolve to the same IP address, and a third at another.
+  const Address::InstanceConstSharedPtr api =
+      std::make_shared<Address::Ipv4Instance>("192.0.2.1", 443);
+  const Address::InstanceConstSharedPtr org =
+      std::make_shared<Address::Ipv4Instance>("192.0.2.1", 443);
+  const Address::InstanceConstSharedPtr other =
+      std::make_shared<Address::Ipv4Instance>("192.0.2.2", 443);
+
+  const ConnectionCoalescing::ConnectionId api_connection =
+      ConnectionCoalescing::add(api, {"api.example.com", "*.example.com"});
+
+  // Names are covered by the connections of the host they were made by.
+  EXPECT_TRUE(ConnectionCoalescing::covers(*api, "img.example.com"));
+  EXPECT_TRUE(ConnectionCoalescing::covers(*api, "api.example.com"));
+  EXPECT_FALSE(ConnectionCoalescing::covers(*api, "img.example.org"));
+  EXPECT_FALSE(ConnectionCoalescing::covers(*org, "img.example.com"));
+  EXPECT_FALSE(ConnectionCoalescing::covers(*other, "img.example.com"));
+
+  // Another host's connection to the same IP address doesn't cover names for this one.
+  const ConnectionCoalescing::ConnectionId org_connection =
+      ConnectionCoalescing::add(org, {"img.example.org"});
+  EXPECT_TRUE(ConnectionCoalescing::covers(*org, "img.example.org"));
+  EXPECT_FALSE(ConnectionCoalescing::covers(*api, "img.example.org"));
+  EXPECT_FALSE(ConnectionCoalescing::covers(*org, "img.example.com"));
+
+  // Names are only covered while a connection whose certificate covers them is open.
+  ConnectionCoalescing::remove(api_connection);
+  EXPECT_FALSE(ConnectionCoalescing::covers(*api, "img.example.com"));
+  EXPECT_TRUE(ConnectionCoalescing::covers(*org, "img.example.org"));
+  ConnectionCoalescing::remove(org_connection);
+  EXPECT_FALSE(ConnectionCoalescing::covers(*org, "img.example.org"));
+
+  // Removing a connection twice is harmless.
+  ConnectionCoalescing::remove(org_connection);
+}
+
+} // namespace
+} // namespace Network
+} // namespace Envoy
@@ -0,0 +1,22 @@
+#include "gtest/gtest.h"
+#include "library/common/network/early_data_rejections.h"
+
+namespace Envoy {
+namespace Network {
+namespace {
+
+TEST(EarlyDataRejectionsTest, CountsRejectionsByServerName) {
+  EXPECT_EQ(0, EarlyDataRejections::rejections("rejecting.example.com"));
+
+  EarlyDataRejections::onRejected("rejecting.example.com");
+  EXPECT_EQ(1, EarlyDataRejections::rejections("rejecting.example.com"));
+  // Names are compared case-insensitively.
+  EarlyDataRejections::onRejected("REJECTING.example.com");
+  EXPECT_EQ(2, EarlyDataRejections::rejections("rejecting.EXAMPLE.com"));
+
+  EXPECT_EQ(0, EarlyDataRejections::rejections("accepting.example.com"));
+}
+
+} // namespace
+} // namespace Network
+} // namespace Envoy
@@ -0,0 +1,104 @@
+#include <string>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/stats/isolated_store_impl.h"
+
+#include "gtest/gtest.h"
+#include "library/common/buffer/utility.h"
+#include "library/common/stats/bridge_copy_stats.h"
+#include "library/common/types/c_types.h"
+
+namespace Envoy {
+namespace Stats {
+
+class BridgeCopyStatsTest : public testing::Test {
+public:
+  BridgeCopyStatsTest() { BridgeCopyStats::resetForTest(); }
+
+  BridgeCopyCounterSet counters(const std::string& engine) {
+    BridgeCopyCounterSet counters;
+    for (size_t i = 0; i < BridgeCopyStats::SiteCount; i++) {
+      const std::string prefix = engine + BridgeCopyStats::name(BridgeCopySite(i));
+      counters.push_back({store_.counterFromString(prefix + ".bytes_copied"),
+                          store_.counterFromString(prefix + ".allocations")});
+    }
+    return counters;
+  }
+
+  IsolatedStoreImpl store_;
+};
+
+TEST_F(BridgeCopyStatsTest, Record) {
+  ENVOY_MOBILE_BRIDGE_COPY(to_bridge_data, 10, 1);
+  ENVOY_MOBILE_BRIDGE_COPY(to_bridge_data, 5, 2);
+  EXPECT_EQ(15UL, BridgeCopyStats::bytesCopied(BridgeCopySite::to_bridge_data));
+  EXPECT_EQ(3UL, BridgeCopyStats::allocations(BridgeCopySite::to_bridge_data));
+  EXPECT_EQ(0UL, BridgeCopyStats::bytesCopied(BridgeCopySite::copy_to_bridge_data));
+
+  BridgeCopyStats::resetForTest();
+  EXPECT_EQ(0UL, BridgeCopyStats::bytesCopied(BridgeCopySite::to_bridge_data));
+  EXPECT_EQ(0UL, BridgeCopyStats::allocations(BridgeCopySite::to_bridge_data));
+}
+
+TEST_F(BridgeCopyStatsTest, ChargedToEngines) {
+  const BridgeCopyCounterSet first = counters("first.");
+  const BridgeCopyCounterSet second = counters("second.");
+  const size_t site = static_cast<size_t>(BridgeCopySite::to_bridge_data);
+
+  // Copies on an engine's thread are charged to it as they are made.
+  BridgeCopyStats::setThreadCounters(first);
+  ENVOY_MOBILE_BRIDGE_COPY(to_bridge_data, 10, 1);
+  EXPECT_EQ(10UL, first[site].bytes_copied_.value());
+  EXPECT_EQ(1UL, first[site].allocations_.value());
+  BridgeCopyStats::clearThreadCounters(second);
+  ENVOY_MOBILE_BRIDGE_COPY(to_bridge_data, 10, 1);
+  EXPECT_EQ(20UL, first[site].bytes_copied_.value());
+  BridgeCopyStats::clearThreadCounters(first);
+
+  // Copies on other threads are held until the thread hands work to an engine.
+  ENVOY_MOBILE_BRIDGE_COPY(to_bridge_data, 5, 2);
+  EXPECT_EQ(20UL, first[site].bytes_copied_.value());
+  BridgeCopyStats::chargeThreadCopies(second);
+  EXPECT_EQ(5UL, second[site].bytes_copied_.value());
+  EXPECT_EQ(2UL, second[site].allocations_.value());
+  BridgeCopyStats::chargeThreadCopies(first);
+  EXPECT_EQ(20UL, first[site].bytes_copied_.value());
+
+  // The process-wide totals include every engine's copies.
+  EXPECT_EQ(25UL, BridgeCopyStats::bytesCopied(BridgeCopySite::to_bridge_data));
+}
+
+TEST_F(BridgeCopyStatsTest, Names) {
+  EXPECT_STREQ("copy_to_bridge_data", BridgeCopyStats::name(BridgeCopySite::copy_to_bridge_data));
+  EXPECT_STREQ("jni_on_data", BridgeCopyStats::name(BridgeCopySite::jni_on_data));
+}
+
+TEST_F(BridgeCopyStatsTest, BufferConversions) {
+  Buffer::OwnedImpl data("test string");
+  envoy_data copy = Buffer::Utility::copyToBridgeData(data);
+  EXPECT_EQ(11UL, BridgeCopyStats::bytesCopied(BridgeCopySite::copy_to_bridge_data));
+  EXPECT_EQ(1UL, BridgeCopyStats::allocations(BridgeCopySite::copy_to_bridge_data));
+
+  Buffer::InstancePtr internal = Buffer::Utility::toInternalData(copy);
+  EXPECT_EQ(0UL, BridgeCopyStats::bytesCopied(BridgeCopySite::bridge_fragment));
+  EXPECT_EQ(1UL, BridgeCopyStats::allocations(BridgeCopySite::bridge_fragment));
+
+  envoy_data drained = Buffer::Utility::toBridgeData(data);
+  EXPECT_EQ(11UL, BridgeCopyStats::bytesCopied(BridgeCopySite::to_bridge_data));
+  drained.release(drained.context);
+}
+
+TEST_F(BridgeCopyStatsTest, CopyEnvoyHeaders) {
+  envoy_header* header_array = static_cast<envoy_header*>(safe_malloc(sizeof(envoy_header)));
+  header_array[0] = {copy_envoy_data(3, reinterpret_cast<const uint8_t*>("key")),
+                     copy_envoy_data(5, reinterpret_cast<const uint8_t*>("value"))};
+  envoy_headers headers = {1, header_array};
+  envoy_headers copy = copy_envoy_headers(headers);
+  EXPECT_EQ(8UL, BridgeCopyStats::bytesCopied(BridgeCopySite::copy_envoy_headers));
+  EXPECT_EQ(3UL, BridgeCopyStats::allocations(BridgeCopySite::copy_envoy_headers));
+  release_envoy_headers(copy);
+  release_envoy_headers(headers);
+}
+
+} // namespace Stats
+} // namespace Envoy
@@ -0,0 +1,73 @@
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "library/common/thread/scheduling.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Envoy {
+namespace Thread {
+
+TEST(SchedulingTest, CpusOfClassBigLittle) {
+  const std::map<uint32_t, uint64_t> max_frequencies{
+      {0, 1800000}, {1, 1800000}, {2, 1800000}, {3, 1800000},
+      {4, 2400000}, {5, 2400000}, {6, 2400000}, {7, 2840000}};
+  EXPECT_EQ(std::vector<uint32_t>({0, 1, 2, 3, 4, 5, 6, 7}),
+            cpusOfClass(CoreClass::Any, max_frequencies));
+  // The prime core is one of the big cores.
+  EXPECT_EQ(std::vector<uint32_t>({4, 5, 6, 7}), cpusOfClass(CoreClass::Big, max_frequencies));
+  EXPECT_EQ(std::vector<uint32_t>({0, 1, 2, 3}), cpusOfClass(CoreClass::Little, max_frequencies));
+}
+
+TEST(SchedulingTest, CpusOfClassTwoClusters) {
+  const std::map<uint32_t, uint64_t> max_frequencies{
+      {0, 1700000}, {1, 1700000}, {2, 2200000}, {3, 2200000}};
+  EXPECT_EQ(std::vector<uint32_t>({2, 3}), cpusOfClass(CoreClass::Big, max_frequencies));
+  EXPECT_EQ(std::vector<uint32_t>({0, 1}), cpusOfClass(CoreClass::Little, max_frequencies));
+}
+
+TEST(SchedulingTest, CpusOfClassHomogeneous) {
+  const std::map<uint32_t, uint64_t> max_frequencies{{0, 3000000}, {1, 3000000}};
+  EXPECT_EQ(std::vector<uint32_t>({0, 1}), cpusOfClass(CoreClass::Big, max_frequencies));
+  EXPECT_EQ(std::vector<uint32_t>({0, 1}), cpusOfClass(CoreClass::Little, max_frequencies));
+}
+
+TEST(SchedulingTest, CpusOfClassUnknownFrequency) {
+  const std::map<uint32_t, uint64_t> max_frequencies{{0, 0}, {1, 2000000}};
+  EXPECT_EQ(std::vector<uint32_t>({0, 1}), cpusOfClass(CoreClass::Big, max_frequencies));
+  EXPECT_EQ(std::vector<uint32_t>({0, 1}), cpusOfClass(CoreClass::Little, max_frequencies));
+  EXPECT_TRUE(cpusOfClass(CoreClass::Big, {}).empty());
+}
+
+#if defined(__linux__)
+TEST(SchedulingTest, SetNiceValue) {
+  // Raising the nice value never requires privileges. Only the new thread is affected.
+  std::thread thread([]() -> void {
+    const id_t tid = static_cast<id_t>(::syscall(SYS_gettid));
+    const int nice = ::getpriority(PRIO_PROCESS, tid) + 1;
+    EXPECT_TRUE(setNiceValue(nice));
+    EXPECT_EQ(nice, ::getpriority(PRIO_PROCESS, tid));
+  });
+  thread.join();
+}
+
+TEST(SchedulingTest, SetCpuAffinity) {
+  std::thread thread([]() -> void {
+    // The CPU the thread is running on is one it is allowed to run on.
+    const uint32_t cpu = ::sched_getcpu();
+    EXPECT_TRUE(setCpuAffinity({cpu}));
+    EXPECT_EQ(cpu, static_cast<uint32_t>(::sched_getcpu()));
+    EXPECT_TRUE(setCpuAffinity({}));
+    EXPECT_FALSE(setCpuAffinity({CPU_SETSIZE}));
+  });
+  thread.join();
+}
+#endif
+
+} // namespace Thread
+} // namespace Envoy
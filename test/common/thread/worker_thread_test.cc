@@ -0,0 +1,37 @@
+#include <thread>
+#include <vector>
+
+#include "absl/synchronization/notification.h"
+#include "gtest/gtest.h"
+#include "library/common/thread/worker_thread.h"
+
+namespace Envoy {
+namespace Thread {
+
+TEST(WorkerThreadTest, RunsWorkOffTheCallingThread) {
+  WorkerThread worker;
+  const std::thread::id caller = std::this_thread::get_id();
+  std::thread::id runner;
+  absl::Notification done;
+  worker.post([&]() -> void {
+    runner = std::this_thread::get_id();
+    done.Notify();
+  });
+  done.WaitForNotification();
+  EXPECT_NE(caller, runner);
+}
+
+TEST(WorkerThreadTest, RunsWorkInOrder) {
+  WorkerThread worker;
+  std::vector<int> order;
+  absl::Notification done;
+  for (int i = 0; i < 10; i++) {
+    worker.post([&order, i]() -> void { order.push_back(i); });
+  }
+  worker.post([&done]() -> void { done.Notify(); });
+  done.WaitForNotification();
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), order);
+}
+
+} // namespace Thread
+} // namespace Envoy
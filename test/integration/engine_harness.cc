@@ -0,0 +1,221 @@
+#include "test/integration/engine_harness.h"
+
+#include <thread>
+
+#include "common/http/header_map_impl.h"
+#include "common/http/utility.h"
+#include "common/network/utility.h"
+
+#include "test/test_common/utility.h"
+
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+
+namespace Envoy {
+
+namespace {
+
+// The API listener routes everything to the upstream cluster, whose connections cross the
+// simulated network.
+std::string engineConfig(uint32_t upstream_port) {
+  return absl::StrCat(R"EOF(
+static_resources:
+  listeners:
+  - name: api_listener
+    address:
+      socket_address:
+        address: 127.0.0.1
+        port_value: 1
+    api_listener:
+      api_listener:
+        "@type": type.googleapis.com/envoy.extensions.filters.network.http_connection_manager.v3.HttpConnectionManager
+        stat_prefix: hcm
+        route_config:
+          name: api_router
+          virtual_hosts:
+          - name: api
+            domains: ["*"]
+            routes:
+            - match:
+                prefix: "/"
+              route:
+                cluster: upstream
+        http_filters:
+        - name: envoy.router
+          typed_config:
+            "@type": type.googleapis.com/envoy.extensions.filters.http.router.v3.Router
+  clusters:
+  - name: upstream
+    connect_timeout: 5s
+    type: STATIC
+    load_assignment:
+      cluster_name: upstream
+      endpoints:
+      - lb_endpoints:
+        - endpoint:
+            address:
+              socket_address:
+                address: 127.0.0.1
+                port_value: )EOF",
+                      upstream_port, "\n");
+}
+
+} // namespace
+
+constexpr std::chrono::milliseconds EngineHarness::StepLength;
+
+/**
+ * Records the outcome of a request, along with the simulated time it was reached at.
+ */
+class EngineHarness::ResponseCollector : public Http::ClientStreamCallbacks {
+public:
+  explicit ResponseCollector(TimeSource& time_source) : time_source_(time_source) {}
+
+  // Http::ClientStreamCallbacks
+  void onHeaders(Http::ResponseHeaderMapPtr&& headers, bool) override {
+    absl::MutexLock lock(&mutex_);
+    response_.status_ = Http::Utility::getResponseStatus(*headers);
+  }
+  void onData(Buffer::InstancePtr&& data, bool) override {
+    absl::MutexLock lock(&mutex_);
+    response_.body_length_ += data->length();
+  }
+  void onTrailers(Http::ResponseTrailerMapPtr&&) override {}
+  void onComplete() override {
+    absl::MutexLock lock(&mutex_);
+    response_.complete_ = true;
+    finish();
+  }
+  void onError(const Http::ClientStreamError& error) override {
+    absl::MutexLock lock(&mutex_);
+    response_.error_ = error;
+    finish();
+  }
+  void onCancel() override {
+    absl::MutexLock lock(&mutex_);
+    finish();
+  }
+
+  bool done() {
+    absl::MutexLock lock(&mutex_);
+    return done_;
+  }
+
+  void waitDone() {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(&done_));
+  }
+
+  Response response(MonotonicTime start) {
+    absl::MutexLock lock(&mutex_);
+    Response response = response_;
+    response.elapsed_ =
+        std::chrono::duration_cast<std::chrono::milliseconds>(finished_at_ - start);
+    return response;
+  }
+
+private:
+  void finish() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    finished_at_ = time_source_.monotonicTime();
+    done_ = true;
+  }
+
+  TimeSource& time_source_;
+  absl::Mutex mutex_;
+  Response response_ ABSL_GUARDED_BY(mutex_);
+  MonotonicTime finished_at_ ABSL_GUARDED_BY(mutex_);
+  bool done_ ABSL_GUARDED_BY(mutex_){};
+};
+
+EngineHarness::EngineHarness(const envoymobile::test::integration::SimulatedNetwork& network,
+                             ConfigModifier modifier) {
+  upstream_ = std::make_unique<AutonomousUpstream>(
+      Network::Utility::parseInternetAddress("127.0.0.1", 0), FakeHttpConnection::Type::HTTP1,
+      time_system_, false);
+
+  auto bootstrap = std::make_unique<envoy::config::bootstrap::v3::Bootstrap>();
+  TestUtility::loadFromYaml(engineConfig(upstream_->localAddress()->ip()->port()), *bootstrap);
+  auto* filter = bootstrap->mutable_static_resources()->mutable_clusters(0)->add_filters();
+  filter->set_name("simulated_network");
+  filter->mutable_typed_config()->PackFrom(network);
+  if (modifier != nullptr) {
+    modifier(*bootstrap);
+  }
+
+  envoy_engine_callbacks callbacks{
+      [](void* context) -> void { static_cast<EngineHarness*>(context)->running_.Notify(); },
+      [](void* context) -> void { static_cast<EngineHarness*>(context)->exited_.Notify(); },
+      this};
+  engine_ = std::make_unique<Engine>(callbacks, std::move(bootstrap), "error", preferred_network_,
+                                     &time_system_);
+  // Startup does not depend on timers, but time is advanced in case it ever does.
+  while (!running_.WaitForNotificationWithTimeout(absl::Milliseconds(10))) {
+    step();
+  }
+}
+
+EngineHarness::~EngineHarness() {
+  engine_.reset();
+  exited_.WaitForNotification();
+  upstream_.reset();
+}
+
+EngineHarness::Response EngineHarness::sendRequest(Http::RequestHeaderMapPtr headers,
+                                                   std::chrono::milliseconds timeout) {
+  ResponseCollector collector(time_system_);
+  const envoy_stream_t stream = next_stream_++;
+  const MonotonicTime start = time_system_.monotonicTime();
+  engine_->httpDispatcher().startStream(stream, collector);
+  engine_->httpDispatcher().sendHeaders(stream, std::move(headers), true);
+
+  settle();
+  while (!collector.done() && time_system_.monotonicTime() - start < timeout) {
+    step();
+  }
+  if (!collector.done()) {
+    engine_->httpDispatcher().cancelStream(stream);
+  }
+  collector.waitDone();
+  return collector.response(start);
+}
+
+void EngineHarness::advanceTime(std::chrono::milliseconds duration) {
+  const MonotonicTime end = time_system_.monotonicTime() + duration;
+  while (time_system_.monotonicTime() < end) {
+    step();
+  }
+}
+
+Http::RequestHeaderMapPtr EngineHarness::requestHeaders(uint64_t response_size_bytes) {
+  auto headers = Http::RequestHeaderMapImpl::create();
+  headers->setMethod("GET");
+  headers->setScheme("https");
+  headers->setHost("example.com");
+  headers->setPath("/");
+  headers->addCopy(Http::LowerCaseString(AutonomousStream::RESPONSE_SIZE_BYTES),
+                   response_size_bytes);
+  return headers;
+}
+
+void EngineHarness::settle() {
+  // The engine's thread runs anything ready before the posted functor. The upstream's thread is
+  // given the same chance, as it may have data in flight to the engine over loopback.
+  if (engine_ == nullptr) {
+    return;
+  }
+  for (int i = 0; i < 2; i++) {
+    absl::Notification posted;
+    if (engine_->post([&posted]() -> void { posted.Notify(); }) != ENVOY_SUCCESS) {
+      return;
+    }
+    posted.WaitForNotification();
+    std::this_thread::yield();
+  }
+}
+
+void EngineHarness::step() {
+  time_system_.advanceTimeWait(StepLength);
+  settle();
+}
+
+} // namespace Envoy
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+
+#include "envoy/config/bootstrap/v3/bootstrap.pb.h"
+
+#include "test/integration/autonomous_upstream.h"
+#include "test/integration/simulated_network.pb.h"
+#include "test/test_common/simulated_time_system.h"
+
+#include "absl/synchronization/notification.h"
+#include "absl/types/optional.h"
+#include "library/common/engine.h"
+#include "library/common/http/dispatcher.h"
+#include "library/common/types/c_types.h"
+
+namespace Envoy {
+
+/**
+ * Runs a complete Engine on simulated time, with its upstream connections crossing a scripted
+ * simulated network (@see SimulatedNetwork) to an in-process upstream which answers every request.
+ * Time only advances while the harness waits on a request, and it advances in fixed steps, so
+ * scenarios involving delays, timeouts, retries and backoff run far faster than real time. The
+ * harness doesn't wait for the upstream's thread, or for data in flight over loopback, before
+ * advancing time. An outcome may therefore be reached a few steps later than the simulated network
+ * alone would dictate, and tests should allow for this, @see settle().
+ *
+ * The engine routes every stream to the "upstream" cluster through the API listener's
+ * "api_router" route configuration. The upstream answers with a 200 and a 10 byte body, unless the
+ * request's headers ask otherwise (@see AutonomousStream).
+ */
+class EngineHarness {
+public:
+  using ConfigModifier = std::function<void(envoy::config::bootstrap::v3::Bootstrap&)>;
+
+  /**
+   * The outcome of a request.
+   */
+  struct Response {
+    // Whether the stream completed successfully.
+    bool complete_{};
+    uint64_t status_{};
+    uint64_t body_length_{};
+    absl::optional<Http::ClientStreamError> error_;
+    // Simulated time from starting the request until it completed or failed.
+    std::chrono::milliseconds elapsed_{};
+  };
+
+  /**
+   * Start an engine. Returns once it is running.
+   * @param network, the simulated network connections to the upstream cross.
+   * @param modifier, if set, applied to the engine's configuration before it starts, e.g. to set
+   *        route timeouts or retry policies.
+   */
+  explicit EngineHarness(const envoymobile::test::integration::SimulatedNetwork& network,
+                         ConfigModifier modifier = nullptr);
+  ~EngineHarness();
+
+  /**
+   * Send a request and wait for its outcome, advancing simulated time as needed.
+   * @param headers, the request headers. The request has no body.
+   * @param timeout, the simulated time after which the request is cancelled. It is then reported
+   *        as incomplete with no error.
+   * @return the outcome of the request.
+   */
+  Response sendRequest(Http::RequestHeaderMapPtr headers,
+                       std::chrono::milliseconds timeout = std::chrono::seconds(60));
+
+  /**
+   * Advance simulated time, letting the engine run its timers in order.
+   * @param duration, the simulated time to advance by. It is advanced in steps.
+   */
+  void advanceTime(std::chrono::milliseconds duration);
+
+  /**
+   * @param response_size_bytes, the length of the response body to ask the upstream for.
+   * @return a GET request for the upstream.
+   */
+  static Http::RequestHeaderMapPtr requestHeaders(uint64_t response_size_bytes = 10);
+
+  Event::SimulatedTimeSystem& timeSystem() { return time_system_; }
+  Engine& engine() { return *engine_; }
+
+private:
+  class ResponseCollector;
+
+  // Wait until the engine has processed the events that are ready to run. This gives the
+  // upstream's thread a chance to run, but doesn't wait for it.
+  void settle();
+  void step();
+
+  // Simulated time advances in steps of this length.
+  static constexpr std::chrono::milliseconds StepLength{1};
+
+  Event::SimulatedTimeSystem time_system_;
+  std::unique_ptr<AutonomousUpstream> upstream_;
+  std::atomic<envoy_network_t> preferred_network_{ENVOY_NET_GENERIC};
+  absl::Notification running_;
+  absl::Notification exited_;
+  envoy_stream_t next_stream_{1};
+  std::unique_ptr<Engine> engine_;
+};
+
+} // namespace Envoy
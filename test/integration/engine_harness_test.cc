@@ -0,0 +1,135 @@
+#include <chrono>
+
+#include "envoy/config/bootstrap/v3/bootstrap.pb.h"
+#include "envoy/config/route/v3/route_components.pb.h"
+#include "envoy/extensions/filters/network/http_connection_manager/v3/http_connection_manager.pb.h"
+
+#include "common/protobuf/protobuf.h"
+
+#include "test/integration/engine_harness.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace {
+
+using envoymobile::test::integration::SimulatedNetwork;
+using std::chrono::milliseconds;
+
+// Simulated time may advance a few steps while the engine and the upstream exchange data over
+// loopback, so outcomes are allowed to land this much later than the network dictates.
+constexpr milliseconds Slack{50};
+
+SimulatedNetwork::Link link(milliseconds latency, uint64_t bandwidth_bytes_per_second = 0) {
+  SimulatedNetwork::Link link;
+  *link.mutable_latency() = Protobuf::util::TimeUtil::MillisecondsToDuration(latency.count());
+  link.set_bandwidth_bytes_per_second(bandwidth_bytes_per_second);
+  return link;
+}
+
+// Sets the route's timeout, and allows one retry with the given per try timeout.
+EngineHarness::ConfigModifier routeTimeouts(milliseconds timeout, milliseconds per_try_timeout) {
+  return [timeout, per_try_timeout](envoy::config::bootstrap::v3::Bootstrap& bootstrap) -> void {
+    auto* hcm_config = bootstrap.mutable_static_resources()
+                           ->mutable_listeners(0)
+                           ->mutable_api_listener()
+                           ->mutable_api_listener();
+    envoy::extensions::filters::network::http_connection_manager::v3::HttpConnectionManager hcm;
+    hcm_config->UnpackTo(&hcm);
+    auto* route =
+        hcm.mutable_route_config()->mutable_virtual_hosts(0)->mutable_routes(0)->mutable_route();
+    *route->mutable_timeout() = Protobuf::util::TimeUtil::MillisecondsToDuration(timeout.count());
+    if (per_try_timeout.count() > 0) {
+      auto* retry_policy = route->mutable_retry_policy();
+      retry_policy->set_retry_on("5xx");
+      retry_policy->mutable_num_retries()->set_value(1);
+      *retry_policy->mutable_per_try_timeout() =
+          Protobuf::util::TimeUtil::MillisecondsToDuration(per_try_timeout.count());
+    }
+    hcm_config->PackFrom(hcm);
+  };
+}
+
+TEST(EngineHarnessTest, Latency) {
+  SimulatedNetwork network;
+  *network.mutable_default_link() = link(milliseconds(50));
+  EngineHarness harness(network);
+
+  // The request and the response each cross the link once.
+  const auto response = harness.sendRequest(EngineHarness::requestHeaders());
+  EXPECT_TRUE(response.complete_);
+  EXPECT_EQ(200UL, response.status_);
+  EXPECT_EQ(10UL, response.body_length_);
+  EXPECT_GE(response.elapsed_, milliseconds(100));
+  EXPECT_LE(response.elapsed_, milliseconds(100) + Slack);
+}
+
+TEST(EngineHarnessTest, Bandwidth) {
+  SimulatedNetwork network;
+  *network.mutable_default_link() = link(milliseconds(0), 100 * 1024);
+  EngineHarness harness(network);
+
+  // A 100KiB response takes a second to receive at 100KiB/s.
+  const auto response = harness.sendRequest(EngineHarness::requestHeaders(100 * 1024));
+  EXPECT_TRUE(response.complete_);
+  EXPECT_EQ(100UL * 1024, response.body_length_);
+  EXPECT_GE(response.elapsed_, milliseconds(1000));
+  EXPECT_LE(response.elapsed_, milliseconds(1000) + Slack);
+}
+
+TEST(EngineHarnessTest, Loss) {
+  SimulatedNetwork network;
+  *network.mutable_default_link() = link(milliseconds(10));
+  network.mutable_default_link()->set_loss_percent(100);
+  *network.mutable_default_link()->mutable_retransmission_timeout() =
+      Protobuf::util::TimeUtil::MillisecondsToDuration(300);
+  EngineHarness harness(network);
+
+  // Both the request and the response are lost once, and retransmitted.
+  const auto response = harness.sendRequest(EngineHarness::requestHeaders());
+  EXPECT_TRUE(response.complete_);
+  EXPECT_GE(response.elapsed_, milliseconds(620));
+  EXPECT_LE(response.elapsed_, milliseconds(620) + Slack);
+}
+
+TEST(EngineHarnessTest, RouteTimeout) {
+  SimulatedNetwork network;
+  network.mutable_default_link()->set_blackhole(true);
+  EngineHarness harness(network, routeTimeouts(milliseconds(2000), milliseconds(0)));
+
+  const auto response = harness.sendRequest(EngineHarness::requestHeaders());
+  EXPECT_FALSE(response.complete_);
+  ASSERT_TRUE(response.error_.has_value());
+  EXPECT_GE(response.elapsed_, milliseconds(2000));
+  EXPECT_LE(response.elapsed_, milliseconds(2000) + Slack);
+}
+
+TEST(EngineHarnessTest, RetryOnNewConnection) {
+  // The first connection loses everything; the retry's connection works.
+  SimulatedNetwork network;
+  network.add_connections()->set_blackhole(true);
+  *network.mutable_default_link() = link(milliseconds(20));
+  EngineHarness harness(network, routeTimeouts(milliseconds(5000), milliseconds(500)));
+
+  const auto response = harness.sendRequest(EngineHarness::requestHeaders());
+  EXPECT_TRUE(response.complete_);
+  EXPECT_EQ(200UL, response.status_);
+  // The retry is sent after the per try timeout and a jittered backoff of up to 25ms.
+  EXPECT_GE(response.elapsed_, milliseconds(540));
+  EXPECT_LE(response.elapsed_, milliseconds(565) + Slack);
+}
+
+TEST(EngineHarnessTest, RunsFasterThanRealTime) {
+  SimulatedNetwork network;
+  *network.mutable_default_link() = link(milliseconds(10));
+  EngineHarness harness(network);
+
+  const auto real_start = std::chrono::steady_clock::now();
+  harness.advanceTime(std::chrono::seconds(10));
+  const auto response = harness.sendRequest(EngineHarness::requestHeaders());
+  EXPECT_TRUE(response.complete_);
+  EXPECT_LT(std::chrono::steady_clock::now() - real_start, std::chrono::seconds(10));
+}
+
+} // namespace
+} // namespace Envoy
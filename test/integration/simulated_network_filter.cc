@@ -0,0 +1,152 @@
+#include "test/integration/simulated_network_filter.h"
+
+#include <algorithm>
+
+#include "envoy/registry/registry.h"
+
+#include "common/protobuf/utility.h"
+
+namespace Envoy {
+namespace Network {
+
+SimulatedNetworkConfig::SimulatedNetworkConfig(
+    const envoymobile::test::integration::SimulatedNetwork& proto_config)
+    : default_link_(toLink(proto_config.default_link())) {
+  for (const auto& link : proto_config.connections()) {
+    connections_.push_back(toLink(link));
+  }
+}
+
+SimulatedNetworkConfig::Link SimulatedNetworkConfig::toLink(
+    const envoymobile::test::integration::SimulatedNetwork::Link& proto_link) {
+  Link link;
+  link.latency_ =
+      std::chrono::milliseconds(DurationUtil::durationToMilliseconds(proto_link.latency()));
+  link.bandwidth_bytes_per_second_ = proto_link.bandwidth_bytes_per_second();
+  link.loss_percent_ = std::min<uint32_t>(proto_link.loss_percent(), 100);
+  if (proto_link.has_retransmission_timeout()) {
+    link.retransmission_timeout_ = std::chrono::milliseconds(
+        DurationUtil::durationToMilliseconds(proto_link.retransmission_timeout()));
+  }
+  link.blackhole_ = proto_link.blackhole();
+  return link;
+}
+
+const SimulatedNetworkConfig::Link& SimulatedNetworkConfig::nextLink() {
+  const uint64_t connection = connection_count_++;
+  return connection < connections_.size() ? connections_[connection] : default_link_;
+}
+
+SimulatedNetworkFilter::Direction::Direction(const SimulatedNetworkConfig::Link& link,
+                                             DeliverCb deliver)
+    : link_(link), deliver_(std::move(deliver)) {}
+
+void SimulatedNetworkFilter::Direction::send(Event::Dispatcher& dispatcher, Buffer::Instance& data,
+                                             bool end_stream) {
+  if (link_.blackhole_) {
+    data.drain(data.length());
+    return;
+  }
+  if (timer_ == nullptr) {
+    dispatcher_ = &dispatcher;
+    timer_ = dispatcher.createTimer([this]() -> void { onTimer(); });
+  }
+
+  const MonotonicTime now = dispatcher.timeSource().monotonicTime();
+  // Data is sent once the link has finished sending earlier data, and takes as long to send as the
+  // bandwidth allows.
+  free_at_ = std::max(free_at_, now);
+  if (link_.bandwidth_bytes_per_second_ > 0) {
+    free_at_ += std::chrono::microseconds(data.length() * 1000000 /
+                                          link_.bandwidth_bytes_per_second_);
+  }
+  MonotonicTime deliver_at = free_at_ + link_.latency_;
+  loss_accumulator_ += link_.loss_percent_;
+  if (loss_accumulator_ >= 100) {
+    loss_accumulator_ -= 100;
+    deliver_at += link_.retransmission_timeout_;
+  }
+  // Like TCP, data is delivered in order, so nothing overtakes a retransmission.
+  if (!pending_.empty()) {
+    deliver_at = std::max(deliver_at, pending_.back().deliver_at_);
+  }
+
+  pending_.emplace_back();
+  pending_.back().data_.move(data);
+  pending_.back().end_stream_ = end_stream;
+  pending_.back().deliver_at_ = deliver_at;
+  armTimer();
+}
+
+void SimulatedNetworkFilter::Direction::onTimer() {
+  const MonotonicTime now = dispatcher_->timeSource().monotonicTime();
+  while (!pending_.empty() && pending_.front().deliver_at_ <= now) {
+    deliver_(pending_.front().data_, pending_.front().end_stream_);
+    pending_.pop_front();
+  }
+  armTimer();
+}
+
+void SimulatedNetworkFilter::Direction::armTimer() {
+  if (pending_.empty()) {
+    return;
+  }
+  const MonotonicTime now = dispatcher_->timeSource().monotonicTime();
+  // Rounded up, so that the timer never fires before the data is due.
+  timer_->enableHRTimer(std::chrono::ceil<std::chrono::microseconds>(
+      std::max(pending_.front().deliver_at_ - now, MonotonicTime::duration::zero())));
+}
+
+SimulatedNetworkFilter::SimulatedNetworkFilter(SimulatedNetworkConfigSharedPtr config)
+    : config_(std::move(config)), link_(config_->nextLink()) {}
+
+void SimulatedNetworkFilter::initializeReadFilterCallbacks(ReadFilterCallbacks& callbacks) {
+  read_callbacks_ = &callbacks;
+  read_ = std::make_unique<Direction>(link_, [this](Buffer::Instance& data, bool end_stream) {
+    read_callbacks_->injectReadDataToFilterChain(data, end_stream);
+  });
+}
+
+void SimulatedNetworkFilter::initializeWriteFilterCallbacks(WriteFilterCallbacks& callbacks) {
+  write_callbacks_ = &callbacks;
+  write_ = std::make_unique<Direction>(link_, [this](Buffer::Instance& data, bool end_stream) {
+    write_callbacks_->injectWriteDataToFilterChain(data, end_stream);
+  });
+}
+
+FilterStatus SimulatedNetworkFilter::onData(Buffer::Instance& data, bool end_stream) {
+  ENVOY_CONN_LOG(trace, "simulated network: read {} bytes", read_callbacks_->connection(),
+                 data.length());
+  read_->send(read_callbacks_->connection().dispatcher(), data, end_stream);
+  return FilterStatus::StopIteration;
+}
+
+FilterStatus SimulatedNetworkFilter::onWrite(Buffer::Instance& data, bool end_stream) {
+  ENVOY_CONN_LOG(trace, "simulated network: write {} bytes", write_callbacks_->connection(),
+                 data.length());
+  write_->send(write_callbacks_->connection().dispatcher(), data, end_stream);
+  return FilterStatus::StopIteration;
+}
+
+FilterFactoryCb SimulatedNetworkFilterFactory::createFilterFactoryFromProto(
+    const Protobuf::Message& proto_config, Server::Configuration::CommonFactoryContext&) {
+  auto config = std::make_shared<SimulatedNetworkConfig>(
+      dynamic_cast<const envoymobile::test::integration::SimulatedNetwork&>(proto_config));
+  return [config](FilterManager& filter_manager) -> void {
+    filter_manager.addFilter(std::make_shared<SimulatedNetworkFilter>(config));
+  };
+}
+
+ProtobufTypes::MessagePtr SimulatedNetworkFilterFactory::createEmptyConfigProto() {
+  return std::make_unique<envoymobile::test::integration::SimulatedNetwork>();
+}
+
+/**
+ * Static registration for the simulated_network filter. @see
+ * NamedUpstreamNetworkFilterConfigFactory.
+ */
+REGISTER_FACTORY(SimulatedNetworkFilterFactory,
+                 Server::Configuration::NamedUpstreamNetworkFilterConfigFactory);
+
+} // namespace Network
+} // namespace Envoy
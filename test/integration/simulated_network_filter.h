@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "envoy/event/dispatcher.h"
+#include "envoy/event/timer.h"
+#include "envoy/network/filter.h"
+#include "envoy/server/filter_config.h"
+
+#include "common/buffer/buffer_impl.h"
+#include "common/common/logger.h"
+
+#include "test/integration/simulated_network.pb.h"
+
+namespace Envoy {
+namespace Network {
+
+/**
+ * The shape of the link each connection of a cluster crosses, shared by the cluster's filters.
+ */
+class SimulatedNetworkConfig {
+public:
+  struct Link {
+    std::chrono::milliseconds latency_{};
+    uint64_t bandwidth_bytes_per_second_{};
+    uint32_t loss_percent_{};
+    std::chrono::milliseconds retransmission_timeout_{200};
+    bool blackhole_{};
+  };
+
+  explicit SimulatedNetworkConfig(
+      const envoymobile::test::integration::SimulatedNetwork& proto_config);
+
+  /**
+   * @return the link of the next connection opened, @see SimulatedNetwork.connections.
+   */
+  const Link& nextLink();
+
+private:
+  static Link toLink(const envoymobile::test::integration::SimulatedNetwork::Link& proto_link);
+
+  std::vector<Link> connections_;
+  Link default_link_;
+  std::atomic<uint64_t> connection_count_{};
+};
+
+using SimulatedNetworkConfigSharedPtr = std::shared_ptr<SimulatedNetworkConfig>;
+
+/**
+ * Upstream network filter which delays, throttles and drops the data a connection reads and
+ * writes according to its simulated link. Data is held by the filter until it is due, and then
+ * passed on to the rest of the filter chain, so the order of data in each direction is kept.
+ */
+class SimulatedNetworkFilter : public Filter, Logger::Loggable<Logger::Id::filter> {
+public:
+  explicit SimulatedNetworkFilter(SimulatedNetworkConfigSharedPtr config);
+
+  // Network::ReadFilter
+  FilterStatus onData(Buffer::Instance& data, bool end_stream) override;
+  FilterStatus onNewConnection() override { return FilterStatus::Continue; }
+  void initializeReadFilterCallbacks(ReadFilterCallbacks& callbacks) override;
+
+  // Network::WriteFilter
+  FilterStatus onWrite(Buffer::Instance& data, bool end_stream) override;
+  void initializeWriteFilterCallbacks(WriteFilterCallbacks& callbacks) override;
+
+private:
+  // One direction of the connection.
+  class Direction {
+  public:
+    using DeliverCb = std::function<void(Buffer::Instance& data, bool end_stream)>;
+
+    Direction(const SimulatedNetworkConfig::Link& link, DeliverCb deliver);
+
+    // Takes data sent in this direction, to deliver once it has crossed the link.
+    void send(Event::Dispatcher& dispatcher, Buffer::Instance& data, bool end_stream);
+
+  private:
+    struct Pending {
+      Buffer::OwnedImpl data_;
+      bool end_stream_;
+      MonotonicTime deliver_at_;
+    };
+
+    void onTimer();
+    void armTimer();
+
+    const SimulatedNetworkConfig::Link& link_;
+    const DeliverCb deliver_;
+    Event::Dispatcher* dispatcher_{};
+    Event::TimerPtr timer_;
+    std::deque<Pending> pending_;
+    // When the link is next free to send, given the bandwidth used by earlier data.
+    MonotonicTime free_at_;
+    // Loss accumulated over writes; a write is lost each time this reaches 100.
+    uint32_t loss_accumulator_{};
+  };
+
+  const SimulatedNetworkConfigSharedPtr config_;
+  const SimulatedNetworkConfig::Link& link_;
+  std::unique_ptr<Direction> read_;
+  std::unique_ptr<Direction> write_;
+  ReadFilterCallbacks* read_callbacks_{};
+  WriteFilterCallbacks* write_callbacks_{};
+};
+
+/**
+ * Config registration for the simulated_network upstream network filter.
+ */
+class SimulatedNetworkFilterFactory
+    : public Server::Configuration::NamedUpstreamNetworkFilterConfigFactory {
+public:
+  FilterFactoryCb
+  createFilterFactoryFromProto(const Protobuf::Message& proto_config,
+                               Server::Configuration::CommonFactoryContext& context) override;
+  ProtobufTypes::MessagePtr createEmptyConfigProto() override;
+  std::string name() const override { return "simulated_network"; }
+};
+
+} // namespace Network
+} // namespace Envoy
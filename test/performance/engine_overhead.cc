@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "library/common/main_interface.h"
+
+// NOLINT(namespace-envoy)
+
+// This binary measures the engine's own overhead: the path from the bridge through the connection
+// manager and its filters and back, with every request answered by the mock_response filter rather
+// than an upstream. Please refer to the development docs for more information:
+// https://envoy-mobile.github.io/docs/envoy-mobile/latest/development/performance/engine_overhead.html
+//
+// Usage: engine_overhead [requests] [concurrency] [body_bytes] [chunk_bytes]
+
+namespace {
+
+// The mock_response filter takes the router's place.
+std::string config(uint64_t body_bytes, uint64_t chunk_bytes) {
+  return R"EOF(
+static_resources:
+  listeners:
+  - name: base_api_listener
+    address:
+      socket_address:
+        address: 0.0.0.0
+        port_value: 10000
+    api_listener:
+      api_listener:
+        "@type": type.googleapis.com/envoy.extensions.filters.network.http_connection_manager.v3.HttpConnectionManager
+        stat_prefix: hcm
+        route_config:
+          name: api_router
+        http_filters:
+        - name: envoy.filters.http.mock_response
+          typed_config:
+            "@type": type.googleapis.com/envoymobile.extensions.filters.http.mock_response.MockResponse
+            body_bytes: )EOF" +
+         std::to_string(body_bytes) + "\n            chunk_bytes: " + std::to_string(chunk_bytes) +
+         "\n";
+}
+
+std::mutex mutex;
+std::condition_variable cv;
+bool running = false;
+int outstanding = 0;
+
+envoy_engine_t engine;
+std::atomic<int> remaining_requests{0};
+std::atomic<uint64_t> bytes_received{0};
+std::vector<double> latencies_us;
+
+envoy_data toData(const char* value) {
+  return copy_envoy_data(strlen(value), reinterpret_cast<const uint8_t*>(value));
+}
+
+envoy_headers requestHeaders() {
+  const char* const headers[][2] = {
+      {":method", "GET"}, {":scheme", "https"}, {":authority", "example.com"}, {":path", "/"}};
+  const int length = sizeof(headers) / sizeof(headers[0]);
+  envoy_headers request_headers{
+      length, static_cast<envoy_header*>(safe_malloc(sizeof(envoy_header) * length))};
+  for (int i = 0; i < length; i++) {
+    request_headers.headers[i] = {toData(headers[i][0]), toData(headers[i][1])};
+  }
+  return request_headers;
+}
+
+// Each of the concurrent request slots sends its next request once the last one is done.
+struct Slot {
+  std::chrono::steady_clock::time_point start;
+};
+
+void sendRequest(Slot* slot);
+
+void* onHeaders(envoy_headers headers, bool, void*) {
+  release_envoy_headers(headers);
+  return nullptr;
+}
+
+void* onData(envoy_data data, bool, void*) {
+  bytes_received += data.length;
+  data.release(data.context);
+  return nullptr;
+}
+
+void* onDone(void* context) {
+  Slot* slot = static_cast<Slot*>(context);
+  const double latency_us =
+      std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - slot->start)
+          .count();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    latencies_us.push_back(latency_us);
+  }
+  if (remaining_requests.fetch_sub(1) > 0) {
+    sendRequest(slot);
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  outstanding--;
+  cv.notify_all();
+  return nullptr;
+}
+
+void* onError(envoy_error error, void* context) {
+  error.message.release(error.message.context);
+  return onDone(context);
+}
+
+void sendRequest(Slot* slot) {
+  envoy_http_callbacks stream_callbacks{
+      onHeaders, onData, nullptr /*on_metadata*/, nullptr /*on_trailers*/,
+      onError,   onDone, onDone /*on_cancel*/,    slot /*context*/};
+  slot->start = std::chrono::steady_clock::now();
+  envoy_stream_t stream = init_stream(engine);
+  start_stream(stream, stream_callbacks);
+  send_headers(stream, requestHeaders(), true);
+}
+
+double percentile(const std::vector<double>& sorted, double fraction) {
+  return sorted[std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * fraction))];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const int requests = argc > 1 ? std::max(1, std::atoi(argv[1])) : 10000;
+  const int concurrency = argc > 2 ? std::max(1, std::min(requests, std::atoi(argv[2]))) : 1;
+  const uint64_t body_bytes = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1024;
+  const uint64_t chunk_bytes = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 0;
+
+  engine = init_engine();
+  envoy_engine_callbacks callbacks{[](void*) -> void {
+                                     std::lock_guard<std::mutex> lock(mutex);
+                                     running = true;
+                                     cv.notify_all();
+                                   } /*on_engine_running*/,
+                                   [](void*) -> void {} /*on_exit*/, nullptr /*context*/};
+  run_engine(engine, callbacks, config(body_bytes, chunk_bytes).c_str(), "error");
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [] { return running; });
+  }
+
+  latencies_us.reserve(requests);
+  remaining_requests = requests - concurrency;
+  outstanding = concurrency;
+  std::vector<Slot> slots(concurrency);
+  const auto start = std::chrono::steady_clock::now();
+  for (Slot& slot : slots) {
+    sendRequest(&slot);
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [] { return outstanding == 0; });
+  }
+  const double elapsed_s =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::sort(latencies_us.begin(), latencies_us.end());
+  printf("requests: %d, concurrency: %d, body bytes: %llu, chunk bytes: %llu\n", requests,
+         concurrency, static_cast<unsigned long long>(body_bytes),
+         static_cast<unsigned long long>(chunk_bytes));
+  printf("throughput: %.0f requests/s, %.1f MB/s\n", requests / elapsed_s,
+         bytes_received / elapsed_s / 1e6);
+  printf("latency us: p50 %.0f, p90 %.0f, p99 %.0f, p99.9 %.0f, max %.0f\n",
+         percentile(latencies_us, 0.5), percentile(latencies_us, 0.9),
+         percentile(latencies_us, 0.99), percentile(latencies_us, 0.999), latencies_us.back());
+
+  terminate_engine(engine);
+  return 0;
+}
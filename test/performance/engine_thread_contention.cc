@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "library/common/main_interface.h"
+
+// NOLINT(namespace-envoy)
+
+// This binary measures the latency of requests to an engine whose thread competes for the CPU
+// with busy app threads, in order to compare the engine thread's scheduling options. Please refer
+// to the development docs for more information:
+// https://envoy-mobile.github.io/docs/envoy-mobile/latest/development/performance/cpu_battery_impact.html
+//
+// Usage: engine_thread_contention [requests] [busy_threads] [nice] [any|big|little]
+
+namespace {
+
+// Every request is answered by the engine itself, so that only the engine's scheduling is measured.
+const char* const Config = R"EOF(
+static_resources:
+  listeners:
+  - name: base_api_listener
+    address:
+      socket_address:
+        address: 0.0.0.0
+        port_value: 10000
+    api_listener:
+      api_listener:
+        "@type": type.googleapis.com/envoy.extensions.filters.network.http_connection_manager.v3.HttpConnectionManager
+        stat_prefix: hcm
+        route_config:
+          name: api_router
+          virtual_hosts:
+          - name: api
+            domains: ["*"]
+            routes:
+            - match:
+                prefix: "/"
+              direct_response:
+                status: 200
+        http_filters:
+        - name: envoy.router
+          typed_config:
+            "@type": type.googleapis.com/envoy.extensions.filters.http.router.v3.Router
+)EOF";
+
+std::mutex mutex;
+std::condition_variable cv;
+bool running = false;
+bool complete = false;
+
+envoy_data toData(const char* value) {
+  return copy_envoy_data(strlen(value), reinterpret_cast<const uint8_t*>(value));
+}
+
+envoy_headers requestHeaders() {
+  const char* const headers[][2] = {
+      {":method", "GET"}, {":scheme", "https"}, {":authority", "example.com"}, {":path", "/"}};
+  const int length = sizeof(headers) / sizeof(headers[0]);
+  envoy_headers request_headers{
+      length, static_cast<envoy_header*>(safe_malloc(sizeof(envoy_header) * length))};
+  for (int i = 0; i < length; i++) {
+    request_headers.headers[i] = {toData(headers[i][0]), toData(headers[i][1])};
+  }
+  return request_headers;
+}
+
+void* onHeaders(envoy_headers headers, bool, void*) {
+  release_envoy_headers(headers);
+  return nullptr;
+}
+
+void* onDone(void*) {
+  std::lock_guard<std::mutex> lock(mutex);
+  complete = true;
+  cv.notify_all();
+  return nullptr;
+}
+
+void* onError(envoy_error error, void* context) {
+  error.message.release(error.message.context);
+  return onDone(context);
+}
+
+double percentile(const std::vector<double>& sorted, double fraction) {
+  return sorted[std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * fraction))];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const int requests = argc > 1 ? std::max(1, std::atoi(argv[1])) : 2000;
+  const int busy_threads =
+      argc > 2 ? std::atoi(argv[2]) : static_cast<int>(std::thread::hardware_concurrency());
+
+  envoy_engine_t engine = init_engine();
+  envoy_engine_callbacks callbacks{[](void*) -> void {
+                                     std::lock_guard<std::mutex> lock(mutex);
+                                     running = true;
+                                     cv.notify_all();
+                                   } /*on_engine_running*/,
+                                   [](void*) -> void {} /*on_exit*/, nullptr /*context*/};
+  run_engine(engine, callbacks, Config, "error");
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [] { return running; });
+  }
+  if (argc > 3) {
+    set_engine_thread_priority(engine, std::atoi(argv[3]));
+  }
+  if (argc > 4) {
+    const std::string core_class = argv[4];
+    set_engine_thread_affinity(engine, core_class == "big"      ? ENVOY_CORES_BIG
+                                       : core_class == "little" ? ENVOY_CORES_LITTLE
+                                                                : ENVOY_CORES_ANY);
+  }
+
+  // The app's threads keep every core busy, as rendering and app logic would.
+  std::atomic<bool> busy{true};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < busy_threads; i++) {
+    threads.emplace_back([&busy]() -> void {
+      volatile uint64_t spins = 0;
+      while (busy) {
+        spins = spins + 1;
+      }
+    });
+  }
+
+  envoy_http_callbacks stream_callbacks{
+      onHeaders, nullptr /*on_data*/, nullptr /*on_metadata*/, nullptr /*on_trailers*/,
+      onError,   onDone,              onDone /*on_cancel*/,    nullptr /*context*/};
+  std::vector<double> latencies_us;
+  for (int i = 0; i < requests; i++) {
+    // Requests are spaced out, so that the engine's thread is asleep when each one is sent and
+    // has to be scheduled to serve it.
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      complete = false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    envoy_stream_t stream = init_stream(engine);
+    start_stream(stream, stream_callbacks);
+    send_headers(stream, requestHeaders(), true);
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [] { return complete; });
+    }
+    latencies_us.push_back(std::chrono::duration<double, std::micro>(
+                               std::chrono::steady_clock::now() - start)
+                               .count());
+  }
+
+  busy = false;
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  std::sort(latencies_us.begin(), latencies_us.end());
+  printf("requests: %d, busy threads: %d\n", requests, busy_threads);
+  printf("latency us: p50 %.0f, p90 %.0f, p99 %.0f, p99.9 %.0f, max %.0f\n",
+         percentile(latencies_us, 0.5), percentile(latencies_us, 0.9),
+         percentile(latencies_us, 0.99), percentile(latencies_us, 0.999), latencies_us.back());
+
+  terminate_engine(engine);
+  return 0;
+}
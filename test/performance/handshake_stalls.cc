@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "library/common/main_interface.h"
+
+// NOLINT(namespace-envoy)
+
+// This binary measures how long the engine's event loop stalls while a storm of TLS handshakes,
+// as after a network change, verifies certificate chains. Please refer to the development docs for
+// more information:
+// https://envoy-mobile.github.io/docs/envoy-mobile/latest/development/performance/handshake_stalls.html
+//
+// Usage: handshake_stalls <address> <port> <server_name> <ca_file> [sync|async] [handshakes]
+//                         [concurrency]
+
+namespace {
+
+// Requests for /probe are answered by the engine itself, so that their latency is the time the
+// event loop takes to get to them. Every other request opens a new connection to the server, and
+// every connection verifies the server's chain, as nothing is cached.
+std::string config(const std::string& address, const std::string& port,
+                   const std::string& server_name, const std::string& ca_file, bool async) {
+  return R"EOF(
+static_resources:
+  listeners:
+  - name: base_api_listener
+    address:
+      socket_address:
+        address: 0.0.0.0
+        port_value: 10000
+    api_listener:
+      api_listener:
+        "@type": type.googleapis.com/envoy.extensions.filters.network.http_connection_manager.v3.HttpConnectionManager
+        stat_prefix: hcm
+        route_config:
+          name: api_router
+          virtual_hosts:
+          - name: api
+            domains: ["*"]
+            routes:
+            - match:
+                path: "/probe"
+              direct_response:
+                status: 200
+            - match:
+                prefix: "/"
+              route:
+                cluster: upstream
+        http_filters:
+        - name: envoy.router
+          typed_config:
+            "@type": type.googleapis.com/envoy.extensions.filters.http.router.v3.Router
+  clusters:
+  - name: upstream
+    connect_timeout: 5s
+    max_requests_per_connection: 1
+    load_assignment:
+      cluster_name: upstream
+      endpoints:
+      - lb_endpoints:
+        - endpoint:
+            address:
+              socket_address:
+                address: )EOF" +
+         address + "\n                port_value: " + port + R"EOF(
+    transport_socket:
+      name: envoy.transport_sockets.tls
+      typed_config:
+        "@type": type.googleapis.com/envoy.extensions.transport_sockets.tls.v3.UpstreamTlsContext
+        sni: )EOF" +
+         server_name + R"EOF(
+        common_tls_context:
+          custom_handshaker:
+            name: envoy_mobile.tls.handshaker.cert_verifier
+            typed_config:
+              "@type": type.googleapis.com/envoymobile.extensions.tls.cert_verifier.CertVerifier
+              max_cache_entries: 0
+              async_verification: )EOF" +
+         (async ? "true" : "false") + R"EOF(
+          validation_context:
+            trusted_ca:
+              filename: )EOF" +
+         ca_file + "\n";
+}
+
+std::mutex mutex;
+std::condition_variable cv;
+bool running = false;
+int outstanding = 0;
+bool probe_complete = false;
+
+envoy_engine_t engine;
+std::string authority;
+std::atomic<int> remaining_handshakes{0};
+std::atomic<int> failed_handshakes{0};
+
+envoy_data toData(const char* value) {
+  return copy_envoy_data(strlen(value), reinterpret_cast<const uint8_t*>(value));
+}
+
+envoy_headers requestHeaders(const char* path) {
+  const char* const headers[][2] = {
+      {":method", "GET"}, {":scheme", "https"}, {":authority", authority.c_str()}, {":path", path}};
+  const int length = sizeof(headers) / sizeof(headers[0]);
+  envoy_headers request_headers{
+      length, static_cast<envoy_header*>(safe_malloc(sizeof(envoy_header) * length))};
+  for (int i = 0; i < length; i++) {
+    request_headers.headers[i] = {toData(headers[i][0]), toData(headers[i][1])};
+  }
+  return request_headers;
+}
+
+void* onHeaders(envoy_headers headers, bool, void*) {
+  release_envoy_headers(headers);
+  return nullptr;
+}
+
+void* onData(envoy_data data, bool, void*) {
+  data.release(data.context);
+  return nullptr;
+}
+
+void sendHandshake();
+
+void* onHandshakeDone(void*) {
+  if (remaining_handshakes.fetch_sub(1) > 0) {
+    sendHandshake();
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  outstanding--;
+  cv.notify_all();
+  return nullptr;
+}
+
+void* onHandshakeError(envoy_error error, void* context) {
+  error.message.release(error.message.context);
+  failed_handshakes++;
+  return onHandshakeDone(context);
+}
+
+void sendHandshake() {
+  envoy_http_callbacks stream_callbacks{onHeaders,
+                                        onData,
+                                        nullptr /*on_metadata*/,
+                                        nullptr /*on_trailers*/,
+                                        onHandshakeError,
+                                        onHandshakeDone,
+                                        onHandshakeDone /*on_cancel*/,
+                                        nullptr /*context*/};
+  envoy_stream_t stream = init_stream(engine);
+  start_stream(stream, stream_callbacks);
+  send_headers(stream, requestHeaders("/"), true);
+}
+
+void* onProbeDone(void*) {
+  std::lock_guard<std::mutex> lock(mutex);
+  probe_complete = true;
+  cv.notify_all();
+  return nullptr;
+}
+
+void* onProbeError(envoy_error error, void* context) {
+  error.message.release(error.message.context);
+  return onProbeDone(context);
+}
+
+// Sends probes one at a time until stopped, returning their latencies.
+std::vector<double> probe(const std::atomic<bool>& stop) {
+  envoy_http_callbacks stream_callbacks{
+      onHeaders,    nullptr /*on_data*/, nullptr /*on_metadata*/,    nullptr /*on_trailers*/,
+      onProbeError, onProbeDone,         onProbeDone /*on_cancel*/, nullptr /*context*/};
+  std::vector<double> latencies_us;
+  while (!stop) {
+    // Probes are spaced out, so that they sample the event loop rather than occupy it.
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      probe_complete = false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    envoy_stream_t stream = init_stream(engine);
+    start_stream(stream, stream_callbacks);
+    send_headers(stream, requestHeaders("/probe"), true);
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [] { return probe_complete; });
+    }
+    latencies_us.push_back(std::chrono::duration<double, std::micro>(
+                               std::chrono::steady_clock::now() - start)
+                               .count());
+  }
+  return latencies_us;
+}
+
+double percentile(const std::vector<double>& sorted, double fraction) {
+  return sorted[std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * fraction))];
+}
+
+void printLatencies(const char* name, std::vector<double> latencies_us) {
+  if (latencies_us.empty()) {
+    return;
+  }
+  std::sort(latencies_us.begin(), latencies_us.end());
+  printf("%s probe latency us: p50 %.0f, p90 %.0f, p99 %.0f, max %.0f (%zu probes)\n", name,
+         percentile(latencies_us, 0.5), percentile(latencies_us, 0.9),
+         percentile(latencies_us, 0.99), latencies_us.back(), latencies_us.size());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 5) {
+    fprintf(stderr,
+            "usage: %s <address> <port> <server_name> <ca_file> [sync|async] [handshakes] "
+            "[concurrency]\n",
+            argv[0]);
+    return 1;
+  }
+  const bool async = argc <= 5 || std::string(argv[5]) != "sync";
+  const int handshakes = argc > 6 ? std::max(1, std::atoi(argv[6])) : 500;
+  const int concurrency = argc > 7 ? std::max(1, std::min(handshakes, std::atoi(argv[7]))) : 32;
+  authority = argv[3];
+
+  engine = init_engine();
+  envoy_engine_callbacks callbacks{[](void*) -> void {
+                                     std::lock_guard<std::mutex> lock(mutex);
+                                     running = true;
+                                     cv.notify_all();
+                                   } /*on_engine_running*/,
+                                   [](void*) -> void {} /*on_exit*/, nullptr /*context*/};
+  run_engine(engine, callbacks, config(argv[1], argv[2], argv[3], argv[4], async).c_str(),
+             "error");
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [] { return running; });
+  }
+
+  // The event loop's latency when it has nothing else to do.
+  std::atomic<bool> stop{false};
+  std::vector<double> idle_latencies_us;
+  std::thread idle_prober([&]() -> void { idle_latencies_us = probe(stop); });
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  stop = true;
+  idle_prober.join();
+
+  // Its latency while handshakes are in flight.
+  stop = false;
+  std::vector<double> storm_latencies_us;
+  std::thread storm_prober([&]() -> void { storm_latencies_us = probe(stop); });
+  remaining_handshakes = handshakes - concurrency;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    outstanding = concurrency;
+  }
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < concurrency; i++) {
+    sendHandshake();
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [] { return outstanding == 0; });
+  }
+  const double elapsed_s =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  stop = true;
+  storm_prober.join();
+
+  printf("verification: %s, handshakes: %d, concurrency: %d, failed: %d\n",
+         async ? "async" : "sync", handshakes, concurrency, failed_handshakes.load());
+  printf("throughput: %.0f handshakes/s\n", handshakes / elapsed_s);
+  printLatencies("idle", idle_latencies_us);
+  printLatencies("storm", storm_latencies_us);
+
+  terminate_engine(engine);
+  return 0;
+}
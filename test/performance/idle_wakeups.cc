@@ -0,0 +1,133 @@
+#include <dirent.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "library/common/config_builder.h"
+#include "library/common/main_interface.h"
+
+// NOLINT(namespace-envoy)
+
+// This binary counts the wakeups of an idle engine's threads, in order to measure the engine's
+// idle battery cost. Linux only. Please refer to the development docs for more information:
+// https://envoy-mobile.github.io/docs/envoy-mobile/latest/development/performance/cpu_battery_impact.html
+//
+// Usage: idle_wakeups [duration_seconds] [idle_timer_slack_ms]
+
+namespace {
+
+struct TaskCounters {
+  std::string name;
+  uint64_t voluntary_switches{};
+  uint64_t involuntary_switches{};
+  // Read-like and write-like syscalls, if the kernel accounts task I/O.
+  uint64_t read_syscalls{};
+  uint64_t write_syscalls{};
+};
+
+std::set<std::string> listTasks() {
+  std::set<std::string> tasks;
+  DIR* dir = opendir("/proc/self/task");
+  if (dir == nullptr) {
+    return tasks;
+  }
+  while (dirent* entry = readdir(dir)) {
+    if (entry->d_name[0] != '.') {
+      tasks.insert(entry->d_name);
+    }
+  }
+  closedir(dir);
+  return tasks;
+}
+
+uint64_t readField(const std::string& path, const std::string& field) {
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.compare(0, field.size(), field) == 0) {
+      return std::strtoull(line.c_str() + field.size(), nullptr, 10);
+    }
+  }
+  return 0;
+}
+
+TaskCounters readTask(const std::string& tid) {
+  const std::string base = "/proc/self/task/" + tid;
+  TaskCounters counters;
+  std::ifstream comm(base + "/comm");
+  std::getline(comm, counters.name);
+  counters.voluntary_switches = readField(base + "/status", "voluntary_ctxt_switches:");
+  counters.involuntary_switches = readField(base + "/status", "nonvoluntary_ctxt_switches:");
+  counters.read_syscalls = readField(base + "/io", "syscr:");
+  counters.write_syscalls = readField(base + "/io", "syscw:");
+  return counters;
+}
+
+std::mutex running_mutex;
+std::condition_variable running_cv;
+bool running = false;
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const int duration_seconds = argc > 1 ? std::atoi(argv[1]) : 60;
+
+  // Tasks which exist before the engine starts are not the engine's.
+  const std::set<std::string> process_tasks = listTasks();
+
+  envoy_engine_t engine = init_engine();
+  envoy_config_builder* builder = envoy_config_builder_new();
+  envoy_engine_callbacks callbacks{[](void*) -> void {
+                                     std::lock_guard<std::mutex> lock(running_mutex);
+                                     running = true;
+                                     running_cv.notify_all();
+                                   } /*on_engine_running*/,
+                                   [](void*) -> void {} /*on_exit*/, nullptr /*context*/};
+  run_engine_with_config_builder(engine, callbacks, builder, "error");
+  envoy_config_builder_free(builder);
+  {
+    std::unique_lock<std::mutex> lock(running_mutex);
+    running_cv.wait(lock, [] { return running; });
+  }
+  if (argc > 2) {
+    set_idle_timer_slack(engine, std::atoi(argv[2]));
+  }
+
+  // Let startup work, e.g. initial DNS resolution, settle before measuring.
+  std::this_thread::sleep_for(std::chrono::seconds(5));
+
+  std::map<std::string, TaskCounters> before;
+  for (const std::string& tid : listTasks()) {
+    if (process_tasks.count(tid) == 0) {
+      before[tid] = readTask(tid);
+    }
+  }
+  std::this_thread::sleep_for(std::chrono::seconds(duration_seconds));
+
+  const double minutes = duration_seconds / 60.0;
+  uint64_t total_wakeups = 0;
+  printf("%-8s %-16s %12s %12s %12s\n", "tid", "thread", "wakeups/min", "preempt/min",
+         "rw_sys/min");
+  for (const auto& task : before) {
+    const TaskCounters after = readTask(task.first);
+    const uint64_t wakeups = after.voluntary_switches - task.second.voluntary_switches;
+    const uint64_t preemptions = after.involuntary_switches - task.second.involuntary_switches;
+    const uint64_t syscalls = (after.read_syscalls - task.second.read_syscalls) +
+                              (after.write_syscalls - task.second.write_syscalls);
+    total_wakeups += wakeups;
+    printf("%-8s %-16s %12.1f %12.1f %12.1f\n", task.first.c_str(), task.second.name.c_str(),
+           wakeups / minutes, preemptions / minutes, syscalls / minutes);
+  }
+  printf("total engine wakeups/min: %.1f\n", total_wakeups / minutes);
+
+  terminate_engine(engine);
+  return 0;
+}